@@ -0,0 +1,62 @@
+/* A64 encodings the decoder recognizes, as ENCODING(mask, value, decode):
+ * an instruction word w has the encoding when (w & mask) == value, and
+ * decode fills in the Instruction. tools/gen_decode_tree.c turns the table
+ * into the decoder's lookup tree at build time. Where patterns overlap,
+ * the earlier entry wins.
+ *
+ * Included without a guard; define ENCODING first.
+ */
+
+/* Data processing, immediate */
+ENCODING(0x1F000000, 0x10000000, decode_pc_relative)            /* ADR, ADRP */
+ENCODING(0x1F800000, 0x11000000, decode_add_sub_immediate)
+ENCODING(0x1F800000, 0x12000000, decode_logical_immediate)
+ENCODING(0x1F800000, 0x12800000, decode_move_wide)              /* MOVN, MOVZ, MOVK */
+ENCODING(0x1F800000, 0x13000000, decode_bitfield)               /* SBFM, BFM, UBFM */
+ENCODING(0x7FA00000, 0x13800000, decode_extract)                /* EXTR */
+
+/* Branches and system */
+ENCODING(0x7C000000, 0x14000000, decode_branch_immediate)       /* B, BL */
+ENCODING(0x7E000000, 0x34000000, decode_compare_branch)         /* CBZ, CBNZ */
+ENCODING(0x7E000000, 0x36000000, decode_test_branch)            /* TBZ, TBNZ */
+ENCODING(0xFF000010, 0x54000000, decode_conditional_branch)     /* B.cond */
+ENCODING(0xFF9FFC1F, 0xD61F0000, decode_branch_register)        /* BR, BLR, RET */
+ENCODING(0xFFFFF01F, 0xD503201F, decode_hint)                   /* NOP, YIELD, BTI, PACIASP... */
+ENCODING(0xFFFFF01F, 0xD503301F, decode_barrier)                /* CLREX, DSB, DMB, ISB, SB */
+ENCODING(0xFFF00000, 0xD5300000, decode_system_register)        /* MRS */
+ENCODING(0xFFF00000, 0xD5100000, decode_system_register)        /* MSR (register) */
+
+/* Loads and stores */
+ENCODING(0x3B000000, 0x18000000, decode_load_literal)
+ENCODING(0x3F000000, 0x08000000, decode_load_store_exclusive)   /* and LDAR, STLR */
+ENCODING(0x3A000000, 0x28000000, decode_load_store_pair)
+ENCODING(0x3B200000, 0x38000000, decode_load_store_immediate)   /* unscaled, pre- and post-index */
+ENCODING(0x3B200C00, 0x38200800, decode_load_store_register)    /* register offset */
+ENCODING(0x3B000000, 0x39000000, decode_load_store_unsigned)
+ENCODING(0xBFBFF000, 0x0C007000, decode_simd_load_store)        /* LD1, ST1 (one register) */
+ENCODING(0xBFA0F000, 0x0C807000, decode_simd_load_store)        /* and post-indexed */
+
+/* Data processing, register */
+ENCODING(0x1F000000, 0x0A000000, decode_logical_register)
+ENCODING(0x1F200000, 0x0B000000, decode_add_sub_shifted)
+ENCODING(0x1F200000, 0x0B200000, decode_add_sub_extended)
+ENCODING(0x1FE0FC00, 0x1A000000, decode_add_sub_carry)          /* ADC, SBC */
+ENCODING(0x1FE00410, 0x1A400000, decode_conditional_compare)    /* CCMN, CCMP */
+ENCODING(0x1FE00000, 0x1A800000, decode_conditional_select)     /* CSEL, CSINC, CSINV, CSNEG */
+ENCODING(0x5FE00000, 0x1AC00000, decode_data_processing_2)      /* UDIV, SDIV, LSLV... */
+ENCODING(0x5FE00000, 0x5AC00000, decode_data_processing_1)      /* RBIT, REV, CLZ, CLS */
+ENCODING(0x1F000000, 0x1B000000, decode_data_processing_3)      /* MADD, SMULH... */
+
+/* Advanced SIMD */
+ENCODING(0x9F200400, 0x0E200400, decode_simd_three_same)
+ENCODING(0xBF208C00, 0x0E000800, decode_simd_permute)           /* ZIP, UZP, TRN */
+ENCODING(0xBFE08400, 0x2E000000, decode_simd_extract)           /* EXT */
+ENCODING(0x9FE08400, 0x0E000400, decode_simd_copy)              /* DUP, INS, UMOV */
+ENCODING(0x9F800400, 0x0F000400, decode_simd_shift_immediate)   /* SHL, USHR, SSHR */
+
+/* Scalar floating point */
+ENCODING(0x7F3EFC00, 0x1E260000, decode_fp_move_general)        /* FMOV to and from X and W */
+ENCODING(0xFF000000, 0x1F000000, decode_fp_three_source)        /* FMADD... */
+ENCODING(0xFF200C00, 0x1E200800, decode_fp_two_source)
+ENCODING(0xFF207C00, 0x1E204000, decode_fp_one_source)
+ENCODING(0xFF20FC07, 0x1E202000, decode_fp_compare)
@@ -0,0 +1,143 @@
+#ifndef BLOCK_H
+#define BLOCK_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "block_cache.h"
+#include "instruction.h"
+
+struct Memory;
+struct RegisterFile;
+struct JITBlock;
+struct CompileJob;
+struct LLVMOrcOpaqueResourceTracker;
+struct JITContext;
+
+/* Translated code is entered as block(registers, memory, self) and returns
+ * the next guest PC. Each statically known successor is reached through a
+ * BlockExit: when the successor has host code the emitted exit tail-calls it
+ * directly, otherwise it returns the successor PC to the dispatcher.
+ */
+typedef uint64_t (*BlockFunction)(struct RegisterFile* registers,
+                                  struct Memory* memory,
+                                  struct JITBlock* self);
+
+/* Returned as pc | BLOCK_FAULT when the instruction at pc faulted; the
+ * registers then hold the state from just before it. Guest PCs are 4-byte
+ * aligned, so the bit is otherwise clear.
+ */
+#define BLOCK_FAULT 1ULL
+
+/* Exits of BR/BLR/RET sites start out with this target_pc. The site's
+ * inline cache is the exit itself: on a miss the resolver retargets it at
+ * the PC just seen, and from then on it is linked and unlinked like any
+ * direct exit.
+ */
+#define BLOCK_EXIT_INDIRECT UINT64_MAX
+
+typedef struct BlockExit {
+    struct JITBlock* target;    /* read by emitted code; NULL means unlinked */
+    uint64_t target_pc;         /* read by emitted code at indirect sites */
+    struct JITBlock* owner;
+    struct BlockExit* prev;     /* other exits waiting on the same target_pc */
+    struct BlockExit* next;
+    bool indirect;
+} BlockExit;
+
+typedef enum BlockTier {
+    BLOCK_TIER_INTERPRETER = 0,
+    BLOCK_TIER_JIT = 1
+} BlockTier;
+
+/* How much work the compiler puts into a block: instruction selection
+ * alone, a short cleanup pipeline, or the full O2 pipeline
+ */
+typedef enum BlockOptLevel {
+    BLOCK_OPT_NONE = 0,
+    BLOCK_OPT_FAST,
+    BLOCK_OPT_FULL
+} BlockOptLevel;
+
+#define BLOCK_OPT_LEVELS 3
+
+/* Superblock body: instructions from several guest blocks laid end to end
+ * along the profiled path, each with its own guest PC. Branches inside the
+ * trace continue to the next instruction; off-trace sides leave through
+ * side exits that return to the dispatcher.
+ */
+typedef struct BlockTrace {
+    Instruction* instructions;
+    uint64_t* pcs;
+    size_t count;
+    size_t capacity;
+    size_t block_count;
+} BlockTrace;
+
+typedef struct JITBlock {
+    uint64_t address;
+    uint64_t size;
+    void* code;
+    struct JITContext* context;      /* owner; translated code reaches runtime state through it */
+    struct LLVMOrcOpaqueResourceTracker* code_tracker;  /* owns code */
+    BlockExit* exits;
+    size_t exit_count;
+    
+    /* Decoded body, interpreted until the block is hot enough to compile */
+    Instruction* instructions;
+    size_t instruction_count;
+    uint64_t execution_count;
+    BlockTier tier;
+    BlockOptLevel opt_level;         /* chosen when compilation is requested */
+    bool promotion_failed;
+    struct CompileJob* compile_job;  /* in-flight background compile, if any */
+    BlockTrace* trace;               /* compiled body if it spans several blocks */
+    bool trace_formed;               /* trace decided (possibly none); kept from then on */
+    uint64_t branch_taken;           /* profile of a final B.cond while interpreted */
+    uint64_t branch_not_taken;
+    uint64_t cache_key;              /* persistent cache key, if enabled */
+    bool warm_started;               /* hot-tier code found on disk; compiled at that tier */
+
+    /* Code cache accounting, see code_cache.h */
+    size_t code_size;
+    uint8_t referenced;              /* set by translated code on entry */
+    struct JITBlock* clock_prev;
+    struct JITBlock* clock_next;
+
+    /* Guest pages the block was decoded from, registered in the page index */
+    uint64_t* pages;
+    size_t page_count;
+
+    struct JITBlock* next_retired;
+} JITBlock;
+
+/* Returns NULL on allocation failure */
+JITBlock* block_create(uint64_t address);
+void block_destroy(JITBlock* block);
+bool block_set_exits(JITBlock* block, const uint64_t* targets, size_t count);
+
+BlockTrace* block_trace_create(size_t capacity);
+void block_trace_destroy(BlockTrace* trace);
+/* Appends count instructions starting at address; false if it would overflow */
+bool block_trace_append(BlockTrace* trace, const Instruction* insts, size_t count, uint64_t address);
+bool block_trace_contains(const BlockTrace* trace, uint64_t pc);
+
+/* Guest code the block was built from: its own body plus any trace */
+bool block_overlaps(const JITBlock* block, uint64_t address, uint64_t size);
+/* Records a page base; false if it was already recorded or on failure */
+bool block_add_page(JITBlock* block, uint64_t page);
+
+/* exit_lists maps a guest PC to the head of the list of exits that branch
+ * to it, whether or not they are currently linked. blocks is the
+ * translation cache used to find successors that already have code.
+ */
+bool block_register_exits(JITBlock* block, BlockCache* exit_lists, BlockCache* blocks);
+void block_unregister_exits(JITBlock* block, BlockCache* exit_lists);
+size_t block_link_incoming(JITBlock* block, BlockCache* exit_lists);
+/* Moves an indirect exit to the list for target_pc and links it to target
+ * if that has code; target may be NULL.
+ */
+bool block_retarget_exit(BlockExit* exit, uint64_t target_pc, JITBlock* target, BlockCache* exit_lists);
+size_t block_unlink_incoming(uint64_t address, BlockCache* exit_lists);
+
+#endif // BLOCK_H
@@ -0,0 +1,65 @@
+#ifndef BLOCK_CACHE_H
+#define BLOCK_CACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/* Translation table mapping a full guest PC to a translated block.
+ *
+ * Open addressing with linear probing over a power-of-two array of
+ * 16-byte entries, so four entries share a cache line and most probes
+ * stay inside the line of the home slot. The table doubles once it is
+ * three quarters full. Removal uses backward-shift deletion, so there
+ * are no tombstones and probe sequences never degrade over time.
+ */
+
+/* Guest PCs are 4-byte aligned, so an all-ones key can never be a PC */
+#define BLOCK_CACHE_EMPTY_KEY UINT64_MAX
+
+typedef struct BlockCacheEntry {
+    uint64_t key;
+    void* value;
+} BlockCacheEntry;
+
+typedef struct BlockCacheStats {
+    uint64_t lookups;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t inserts;
+    uint64_t removals;
+    uint64_t collisions;      /* operations whose home slot held another key */
+    uint64_t total_probes;    /* slots inspected past the home slot */
+    uint64_t max_probe_length;
+    uint64_t resizes;
+} BlockCacheStats;
+
+typedef struct BlockCache {
+    BlockCacheEntry* entries;
+    size_t capacity;
+    size_t count;
+    uint32_t shift;
+    BlockCacheStats stats;
+} BlockCache;
+
+typedef void (*BlockCacheVisitor)(uint64_t key, void* value, void* opaque);
+
+/* Returns NULL on allocation failure. The capacity is rounded up to a power of two. */
+BlockCache* block_cache_create(size_t initial_capacity);
+void block_cache_destroy(BlockCache* cache);
+void block_cache_clear(BlockCache* cache);
+
+/* Inserting an existing key replaces its value */
+bool block_cache_insert(BlockCache* cache, uint64_t key, void* value);
+void* block_cache_lookup(BlockCache* cache, uint64_t key);
+void* block_cache_remove(BlockCache* cache, uint64_t key);
+
+/* The visitor must not insert into or remove from the cache */
+void block_cache_foreach(const BlockCache* cache, BlockCacheVisitor visitor, void* opaque);
+
+size_t block_cache_count(const BlockCache* cache);
+void block_cache_get_stats(const BlockCache* cache, BlockCacheStats* stats);
+void block_cache_reset_stats(BlockCache* cache);
+void block_cache_print_stats(const BlockCache* cache);
+
+#endif // BLOCK_CACHE_H
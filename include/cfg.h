@@ -0,0 +1,65 @@
+#ifndef CFG_H
+#define CFG_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "block_cache.h"
+#include "memory.h"
+
+/* Static control-flow graph of the guest code reachable from a set of
+ * roots (the entry point, symbols) through direct branches, calls and
+ * fall-through. Indirect branches end discovery; their targets are left
+ * to the runtime.
+ *
+ * Discovery runs on a pool of workers that each own every worker_count-th
+ * guest page: a worker decodes the code on its pages and hands addresses
+ * on other pages to their owner. Each worker then cuts the blocks starting
+ * on its pages at every branch and every address some branch jumps to, so
+ * no instruction lands in two blocks. Memory must not change while the
+ * graph is built.
+ */
+
+typedef enum CFGEdgeKind {
+    CFG_EDGE_FALLTHROUGH,   /* next block, or return site of a call */
+    CFG_EDGE_BRANCH,
+    CFG_EDGE_CALL           /* BL target */
+} CFGEdgeKind;
+
+typedef struct CFGEdge {
+    uint64_t target;
+    CFGEdgeKind kind;
+} CFGEdge;
+
+#define CFG_BLOCK_FUNCTION  0x1     /* a root or a BL target */
+#define CFG_BLOCK_INDIRECT  0x2     /* ends in BR, BLR or RET */
+#define CFG_BLOCK_INVALID   0x4     /* runs into a word that does not decode */
+
+typedef struct CFGBlock {
+    uint64_t address;
+    uint32_t instruction_count;
+    uint32_t flags;
+    CFGEdge successors[2];
+    size_t successor_count;
+} CFGBlock;
+
+typedef struct ControlFlowGraph {
+    BlockCache** blocks;    /* address -> CFGBlock, one table per worker's pages */
+    size_t table_count;
+    size_t edge_count;
+    size_t instruction_count;
+} ControlFlowGraph;
+
+/* Returns NULL on allocation failure. A worker_count of 0 or 1 builds the
+ * graph on the calling thread.
+ */
+ControlFlowGraph* cfg_build(Memory* memory, const uint64_t* roots, size_t root_count, size_t worker_count);
+void cfg_destroy(ControlFlowGraph* cfg);
+
+/* The block starting at address, or NULL */
+const CFGBlock* cfg_get_block(ControlFlowGraph* cfg, uint64_t address);
+size_t cfg_block_count(const ControlFlowGraph* cfg);
+/* Visits blocks in no particular order; values are const CFGBlock* */
+void cfg_foreach_block(const ControlFlowGraph* cfg, BlockCacheVisitor visitor, void* opaque);
+
+#endif // CFG_H
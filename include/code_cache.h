@@ -0,0 +1,57 @@
+#ifndef CODE_CACHE_H
+#define CODE_CACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "block.h"
+
+/* Byte budget for translated host code, enforced with clock eviction.
+ *
+ * Every block holding code sits on a circular list in install order.
+ * Translated code sets its block's referenced flag on entry, so access
+ * tracking costs a single byte store per block run, chained or not. When
+ * new code would exceed the budget the clock hand sweeps the ring, giving
+ * referenced blocks a second chance, and the first unreferenced block it
+ * meets is evicted. A block's size is that of the object it was linked
+ * from, which bounds the executable and relocation memory it holds.
+ */
+
+typedef struct CodeCacheStats {
+    uint64_t insertions;
+    uint64_t evictions;
+    uint64_t evicted_bytes;
+    uint64_t peak_bytes;
+} CodeCacheStats;
+
+typedef struct CodeCache {
+    JITBlock* hand;     /* next eviction candidate; NULL when empty */
+    size_t budget;      /* 0 means unlimited */
+    size_t used;
+    size_t count;
+    CodeCacheStats stats;
+} CodeCache;
+
+CodeCache* code_cache_create(size_t budget);
+void code_cache_destroy(CodeCache* cache);
+void code_cache_set_budget(CodeCache* cache, size_t budget);
+
+/* Adds block, which must have code, behind the hand so it is examined last */
+void code_cache_insert(CodeCache* cache, JITBlock* block);
+/* Does nothing if block is not in the cache */
+void code_cache_remove(CodeCache* cache, JITBlock* block);
+bool code_cache_contains(const CodeCache* cache, const JITBlock* block);
+
+/* True while adding size more bytes would exceed the budget and there is
+ * still something to evict; one block larger than the budget is admitted
+ * on its own.
+ */
+bool code_cache_needs_space(const CodeCache* cache, size_t size);
+
+/* Removes and returns the next victim; the caller unlinks and frees it */
+JITBlock* code_cache_evict(CodeCache* cache);
+
+void code_cache_get_stats(const CodeCache* cache, CodeCacheStats* stats);
+void code_cache_print_stats(const CodeCache* cache);
+
+#endif // CODE_CACHE_H
@@ -0,0 +1,30 @@
+#ifndef CODE_SCAN_H
+#define CODE_SCAN_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/* Bulk classification of A64 code, a whole page or segment at a time,
+ * for block boundaries without decoding every word. Bit i of a bitmap
+ * stands for word i of code; bitmaps hold (count + 63) / 64 entries.
+ *
+ * Branches are the words the decoder turns into INST_BRANCH. Targets are
+ * the words a direct branch among them jumps to, when inside the scanned
+ * range. Data in the range may add spurious entries to both.
+ */
+
+typedef enum CodeScanLevel {
+    CODE_SCAN_SCALAR,
+    CODE_SCAN_SSE2,
+    CODE_SCAN_AVX2
+} CodeScanLevel;
+
+void code_scan(const uint8_t* code, size_t count, uint64_t* branches, uint64_t* targets);
+
+/* The best level the host supports, used unless overridden */
+CodeScanLevel code_scan_get_level(void);
+/* Caps the level used, for testing; levels the host lacks are ignored */
+void code_scan_set_level(CodeScanLevel level);
+
+#endif // CODE_SCAN_H
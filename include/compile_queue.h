@@ -0,0 +1,75 @@
+#ifndef COMPILE_QUEUE_H
+#define COMPILE_QUEUE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "jit.h"
+
+/* Background compilation. The execution thread submits blocks and keeps
+ * interpreting them; a worker compiles the block with its own JITCompiler
+ * and publishes the result by setting job->done with release ordering.
+ * The execution thread polls compile_queue_is_done() and installs the code
+ * itself, so all linking and cache updates stay on one thread.
+ */
+
+typedef struct CompileJob {
+    JITBlock* block;            /* read-only to the worker */
+    CompileResult result;       /* valid once done is set */
+    bool done;
+    bool cancelled;             /* set by the execution thread; skips the compile */
+    struct CompileJob* next;
+} CompileJob;
+
+typedef struct CompileWorker {
+    pthread_t thread;
+    JITCompiler* compiler;
+    struct CompileQueue* queue;
+    bool started;
+} CompileWorker;
+
+typedef struct CompileQueue {
+    CompileWorker* workers;
+    size_t worker_count;
+
+    pthread_mutex_t lock;
+    pthread_cond_t work_available;
+    pthread_cond_t job_finished;
+    CompileJob* head;
+    CompileJob* tail;
+    size_t pending;
+    bool shutting_down;
+
+    uint64_t submitted;
+    uint64_t completed;
+} CompileQueue;
+
+/* Returns NULL if worker_count is 0 or the workers cannot be started.
+ * helpers is the optional helper bitcode, loaded into each worker.
+ */
+CompileQueue* compile_queue_create(size_t worker_count, TranslationCache* cache,
+                                   LLVMMemoryBufferRef helpers);
+
+/* Cancels queued jobs and joins the workers. The compilers stay alive so
+ * code they produced can still be released.
+ */
+void compile_queue_shutdown(CompileQueue* queue);
+
+/* Shuts the queue down if needed and destroys the workers' compilers,
+ * which must no longer own any block's code.
+ */
+void compile_queue_destroy(CompileQueue* queue);
+
+/* urgent jobs go to the front of the queue; used for cold misses the
+ * execution thread is about to wait on.
+ */
+CompileJob* compile_queue_submit(CompileQueue* queue, JITBlock* block, bool urgent);
+bool compile_queue_is_done(const CompileJob* job);
+void compile_queue_wait(CompileQueue* queue, CompileJob* job);
+void compile_queue_cancel(CompileJob* job);
+
+/* Frees the job and any result it still owns; the job must be done */
+void compile_job_destroy(CompileJob* job);
+
+#endif // COMPILE_QUEUE_H
@@ -0,0 +1,71 @@
+#ifndef DECODE_CACHE_H
+#define DECODE_CACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "instruction.h"
+#include "block_cache.h"
+#include "memory.h"
+
+/* Guest page -> its instructions, decoded once and shared by every block
+ * built from the page: interpreted blocks, their compiled promotions,
+ * trace successors and blocks rebuilt after eviction. Slots are filled on
+ * first use, since code pages often hold literal pools and other data.
+ *
+ * Each page is scanned for branches and in-page branch targets when first
+ * touched (see code_scan.h); blocks end at either.
+ *
+ * Pages are marked as code when first decoded. The owner must route the
+ * memory code write handler to decode_cache_invalidate, and may only clear
+ * a page's code mark once decode_cache_contains is false for it.
+ */
+
+#define DECODE_PAGE_SLOTS (MEMORY_PAGE_SIZE / 4)
+#define DECODE_PAGE_WORDS (DECODE_PAGE_SLOTS / 64)
+
+typedef enum DecodeSlotState {
+    DECODE_SLOT_EMPTY = 0,
+    DECODE_SLOT_VALID,
+    DECODE_SLOT_INVALID     /* not an instruction the decoder knows */
+} DecodeSlotState;
+
+typedef struct DecodedPage {
+    uint8_t state[DECODE_PAGE_SLOTS];
+    Instruction insts[DECODE_PAGE_SLOTS];
+    uint64_t branches[DECODE_PAGE_WORDS];  /* slot bitmaps from code_scan */
+    uint64_t targets[DECODE_PAGE_WORDS];
+} DecodedPage;
+
+typedef struct DecodeCacheStats {
+    uint64_t decoded;       /* slots filled by the decoder */
+    uint64_t reused;        /* fetches answered from a filled slot */
+    uint64_t invalidations; /* pages dropped by stores or unmaps */
+} DecodeCacheStats;
+
+typedef struct DecodeCache {
+    BlockCache* pages;
+    Memory* memory;
+    DecodeCacheStats stats;
+} DecodeCache;
+
+DecodeCache* decode_cache_create(Memory* memory);
+void decode_cache_destroy(DecodeCache* cache);
+
+/* The instruction at pc, decoded on first use. NULL if pc is not in
+ * executable memory or does not decode. Valid until the page is invalidated.
+ */
+const Instruction* decode_cache_fetch(DecodeCache* cache, uint64_t pc);
+/* Decodes up to max_count instructions from pc into insts, stopping after
+ * the first branch or before the next branch target on the same page.
+ * Returns the number decoded.
+ */
+size_t decode_cache_fetch_block(DecodeCache* cache, uint64_t pc, Instruction* insts, size_t max_count);
+
+/* Drops every page overlapping [address, address + size) */
+void decode_cache_invalidate(DecodeCache* cache, uint64_t address, uint64_t size);
+bool decode_cache_contains(DecodeCache* cache, uint64_t page);
+size_t decode_cache_page_count(const DecodeCache* cache);
+void decode_cache_get_stats(const DecodeCache* cache, DecodeCacheStats* stats);
+
+#endif // DECODE_CACHE_H
@@ -1,41 +1,141 @@
-#ifndef EMITTER_H
-#define EMITTER_H
-
-#include "instruction.h"
-#include "jit.h"
-#include <llvm-c/Core.h>
-#include <stdbool.h>
-
-typedef struct EmitterContext {
-    JITContext* jit;
-    LLVMBasicBlockRef current_block;
-    LLVMValueRef function;
-    LLVMValueRef* register_values;
-    LLVMValueRef* vector_registers;
-    LLVMValueRef flag_n;
-    LLVMValueRef flag_z;
-    LLVMValueRef flag_c;
-    LLVMValueRef flag_v;
-} EmitterContext;
-
-EmitterContext* emitter_create(JITContext* jit);
-void emitter_destroy(EmitterContext* context);
-
-bool emitter_emit_instruction(EmitterContext* context, const Instruction* inst);
-LLVMValueRef emitter_finalize_block(EmitterContext* context);
-
-LLVMValueRef emitter_get_register(EmitterContext* context, uint8_t reg);
-void emitter_set_register(EmitterContext* context, uint8_t reg, LLVMValueRef value);
-void emitter_update_flags(EmitterContext* context, LLVMValueRef result, bool update_overflow);
-
-bool emitter_emit_arithmetic(EmitterContext* context, const Instruction* inst);
-bool emitter_emit_logical(EmitterContext* context, const Instruction* inst);
-bool emitter_emit_memory(EmitterContext* context, const Instruction* inst);
-bool emitter_emit_branch(EmitterContext* context, const Instruction* inst);
-bool emitter_emit_move(EmitterContext* context, const Instruction* inst);
-
-LLVMValueRef emitter_create_entry_block(EmitterContext* context);
-void emitter_create_exit_block(EmitterContext* context);
-LLVMValueRef emitter_get_condition_value(EmitterContext* context, uint8_t condition);
-
+#ifndef EMITTER_H
+#define EMITTER_H
+
+#include "instruction.h"
+#include "jit.h"
+#include "liveness.h"
+#include "registers.h"
+#include <llvm-c/Core.h>
+#include <stdbool.h>
+
+/* NZCV is not computed when an instruction sets it. The emitter records
+ * the producing operation and its operands, and derives only the flags a
+ * B.cond asks for, or the packed NZCV when the block exits. A flag result
+ * overwritten before anything reads it costs nothing.
+ */
+typedef enum EmitterFlagOp {
+    FLAGS_IN_REGISTER = 0,  /* x[ARM64_REG_NZCV] is current */
+    FLAGS_ADD,
+    FLAGS_SUB,
+    FLAGS_LOGICAL
+} EmitterFlagOp;
+
+typedef struct EmitterFlags {
+    EmitterFlagOp op;
+    LLVMValueRef op1;           /* i64 operands and result, not yet */
+    LLVMValueRef op2;           /* narrowed to the operation width */
+    LLVMValueRef result;
+    bool is_64bit;
+} EmitterFlags;
+
+/* What a load or store touches, for type-based alias analysis. Each is
+ * its own TBAA type, so LLVM knows a guest memory access never clobbers
+ * a register slot, NZCV or the TLB. Accesses to runtime structures
+ * (the block, its exits, the return stack) stay untagged.
+ */
+typedef enum EmitterAccessClass {
+    ACCESS_GUEST_REGISTER = 0,  /* x[], SP and PC */
+    ACCESS_GUEST_VECTOR,        /* v[] */
+    ACCESS_GUEST_FLAGS,         /* x[ARM64_REG_NZCV] */
+    ACCESS_GUEST_FP_CONTROL,    /* fpcr */
+    ACCESS_TLB,
+    ACCESS_GUEST_MEMORY,
+    ACCESS_CLASS_COUNT
+} EmitterAccessClass;
+
+typedef struct EmitterContext {
+    JITCompiler* compiler;
+    LLVMBasicBlockRef current_block;
+    LLVMValueRef function;
+    LLVMTypeRef function_type;
+    uint64_t pc;
+    /* Guest X registers live in SSA while the block runs: each is loaded
+     * from the RegisterFile once, in the entry block, on first use, and
+     * only registers marked dirty are stored back on the way out.
+     */
+    LLVMValueRef* register_values;
+    uint64_t dirty_registers;       /* bit per register_values slot */
+    LLVMValueRef register_load_point;   /* entry loads go before this */
+    LLVMValueRef* vector_registers;     /* V registers as <16 x i8>, promoted the same way */
+    uint32_t dirty_vectors;
+    EmitterFlags flags;
+    LLVMValueRef load_slot;         /* out-parameter of memory_load_slow */
+    LLVMValueRef fpcr_default;      /* i1: host FP arithmetic matches the guest's */
+    bool fpcr_written;              /* an MSR may have changed FPCR since the entry */
+    LLVMValueRef access_tags[ACCESS_CLASS_COUNT];   /* !tbaa nodes, built on first use */
+    
+    /* Liveness of the instruction being emitted; all false means unknown */
+    InstructionLiveness liveness;
+    
+    /* The native loop whose body is being emitted; phis are NULL for
+     * state that is not carried round it
+     */
+    LLVMBasicBlockRef loop_header;
+    uint64_t loop_pc;
+    LLVMValueRef loop_phis[ARM64_NUM_REGS];
+    LLVMValueRef loop_vector_phis[ARM64_NUM_VECTOR_REGS];
+    
+    /* Successor PCs in exit index order; index i reads self->exits[i] */
+    uint64_t* exit_targets;
+    size_t exit_count;
+    size_t exit_capacity;
+} EmitterContext;
+
+EmitterContext* emitter_create(JITCompiler* compiler);
+void emitter_destroy(EmitterContext* context);
+
+bool emitter_emit_instruction(EmitterContext* context, const Instruction* inst);
+LLVMValueRef emitter_finalize_block(EmitterContext* context);
+
+/* Loads the guest register on first use; NULL outside the register file */
+LLVMValueRef emitter_get_register(EmitterContext* context, uint8_t reg);
+/* Records a new value and marks the register dirty */
+void emitter_set_register(EmitterContext* context, uint8_t reg, LLVMValueRef value);
+/* V register reg as <16 x i8>; loaded on first use like X registers */
+LLVMValueRef emitter_get_vector(EmitterContext* context, uint8_t reg);
+/* value may be any 128-bit vector type */
+void emitter_set_vector(EmitterContext* context, uint8_t reg, LLVMValueRef value);
+/* Stores dirty registers, and NZCV if it was set, to the RegisterFile;
+ * done before every exit
+ */
+void emitter_write_back_registers(EmitterContext* context);
+/* Records op as the producer of NZCV; op2 is unused for FLAGS_LOGICAL */
+void emitter_update_flags(EmitterContext* context, EmitterFlagOp op, LLVMValueRef op1,
+                          LLVMValueRef op2, LLVMValueRef result, bool is_64bit);
+
+bool emitter_emit_arithmetic(EmitterContext* context, const Instruction* inst);
+bool emitter_emit_logical(EmitterContext* context, const Instruction* inst);
+bool emitter_emit_memory(EmitterContext* context, const Instruction* inst);
+bool emitter_emit_branch(EmitterContext* context, const Instruction* inst);
+bool emitter_emit_move(EmitterContext* context, const Instruction* inst);
+/* MRS and MSR of NZCV, FPCR and FPSR, and NOPs */
+bool emitter_emit_system(EmitterContext* context, const Instruction* inst);
+/* AdvSIMD, lowered to LLVM vector operations on 128-bit values */
+bool emitter_emit_vector(EmitterContext* context, const Instruction* inst);
+/* Scalar FP: native LLVM operations while FPCR is in its default state,
+ * calls to the exact runtime path otherwise
+ */
+bool emitter_emit_float(EmitterContext* context, const Instruction* inst);
+
+LLVMValueRef emitter_create_entry_block(EmitterContext* context);
+void emitter_create_exit_block(EmitterContext* context);
+bool emitter_emit_exit(EmitterContext* context, uint64_t target_pc);
+
+/* Branch inside a superblock: execution continues at next_pc, the next
+ * instruction of the trace, and the other side of a B.cond leaves through
+ * a side exit that returns to the dispatcher.
+ */
+bool emitter_emit_trace_branch(EmitterContext* context, const Instruction* inst, uint64_t next_pc);
+void emitter_emit_side_exit(EmitterContext* context, uint64_t target_pc);
+LLVMValueRef emitter_get_condition_value(EmitterContext* context, uint8_t condition);
+
+/* Native loops. When a run ends in a B or B.cond back to one of its own
+ * instructions, emitter_begin_loop is called before that instruction with
+ * the rest of the run as the body, and the closing branch is emitted by
+ * emitter_emit_loop_branch. Guest state carried from one iteration to the
+ * next becomes phis at the loop header.
+ */
+bool emitter_begin_loop(EmitterContext* context, const Instruction* body, size_t count);
+bool emitter_emit_loop_branch(EmitterContext* context, const Instruction* inst);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,44 @@
+#ifndef FPU_H
+#define FPU_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "registers.h"
+
+/* FPCR fields that change scalar arithmetic results */
+#define FPCR_RMODE_SHIFT 22
+#define FPCR_RMODE_MASK  (3U << FPCR_RMODE_SHIFT)
+#define FPCR_FZ          (1U << 24)
+#define FPCR_DN          (1U << 25)
+/* With all of these clear, host arithmetic gives the guest's results */
+#define FPCR_EXACT_MASK  (FPCR_RMODE_MASK | FPCR_FZ | FPCR_DN)
+
+/* FPSR cumulative exception bits */
+#define FPSR_IOC (1U << 0)
+#define FPSR_DZC (1U << 1)
+#define FPSR_OFC (1U << 2)
+#define FPSR_UFC (1U << 3)
+#define FPSR_IXC (1U << 4)
+#define FPSR_IDC (1U << 7)
+
+typedef enum FPUOperation {
+    FPU_ADD,
+    FPU_SUB,
+    FPU_MUL,
+    FPU_DIV,
+    FPU_FMA,        /* a * b + c, rounded once */
+    FPU_SQRT,       /* of a */
+    FPU_CONVERT     /* FCVT, through fpu_exact_narrow and fpu_exact_widen */
+} FPUOperation;
+
+/* The exact path for translated code running under a non-default FPCR.
+ * Each call rounds as FPCR.RMode says, applies FZ and DN, and adds the
+ * exceptions it raised to FPSR. Unused operands are passed as zero.
+ */
+double fpu_exact_double(RegisterFile* regs, uint64_t op, double a, double b, double c);
+float fpu_exact_float(RegisterFile* regs, uint64_t op, float a, float b, float c);
+/* FCVT between single and double precision */
+float fpu_exact_narrow(RegisterFile* regs, double value);
+double fpu_exact_widen(RegisterFile* regs, float value);
+
+#endif // FPU_H
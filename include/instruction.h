@@ -1,63 +1,132 @@
-#ifndef INSTRUCTION_H
-#define INSTRUCTION_H
-
-#include <stdint.h>
-
-typedef enum {
-    INST_UNKNOWN,
-    INST_ARITHMETIC,
-    INST_LOGICAL,
-    INST_MOVE,
-    INST_BRANCH,
-    INST_LOAD_STORE,
-    INST_SYSTEM,
-    INST_FLOAT,
-    INST_VECTOR
-} InstructionType;
-
-typedef enum {
-    OP_NONE,
-    OP_IMMEDIATE,
-    OP_REGISTER,
-    OP_MEMORY,
-    OP_SHIFT,
-    OP_EXTEND
-} OperandType;
-
-typedef struct {
-    OperandType type;
-    union {
-        uint64_t immediate;
-        uint8_t reg;
-        struct {
-            uint8_t base_reg;
-            int32_t offset;
-            uint8_t index_reg;
-            uint8_t shift_amount;
-        } mem;
-    } value;
-} Operand;
-
-typedef struct Instruction {
-    uint32_t raw;
-    InstructionType type;
-    uint8_t opcode;
-    uint8_t condition;
-    uint8_t dest_reg;
-    Operand operands[4];
-    uint8_t operand_count;
-    bool sets_flags;
-} Instruction;
-
-void instruction_init(Instruction* inst);
-void instruction_set_operand(Instruction* inst, uint8_t index, Operand op);
-const char* instruction_to_string(const Instruction* inst, char* buffer, size_t size);
-bool instruction_is_branch(const Instruction* inst);
-bool instruction_is_memory_access(const Instruction* inst);
-uint64_t instruction_get_branch_target(const Instruction* inst, uint64_t pc);
-
-bool instruction_modifies_register(const Instruction* inst, uint8_t reg);
-bool instruction_reads_register(const Instruction* inst, uint8_t reg);
-bool instruction_can_be_reordered(const Instruction* inst);
-
+#ifndef INSTRUCTION_H
+#define INSTRUCTION_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+typedef enum {
+    INST_UNKNOWN,
+    INST_ARITHMETIC,
+    INST_LOGICAL,
+    INST_MOVE,
+    INST_BRANCH,
+    INST_LOAD_STORE,
+    INST_SYSTEM,
+    INST_FLOAT,
+    INST_VECTOR
+} InstructionType;
+
+typedef enum {
+    OP_NONE,
+    OP_IMMEDIATE,
+    OP_REGISTER,
+    OP_MEMORY,
+    OP_SHIFT,
+    OP_EXTEND
+} OperandType;
+
+/* How a memory operand forms its address. Pre- and post-indexed forms
+ * write base + offset back to the base register.
+ */
+typedef enum {
+    ADDR_OFFSET,        /* [base, #offset] or [base, index] */
+    ADDR_PRE_INDEX,     /* [base, #offset]! */
+    ADDR_POST_INDEX,    /* [base], #offset or [base], index */
+    ADDR_LITERAL        /* pc + offset; there is no base register */
+} AddressingMode;
+
+/* System registers of MRS and MSR: o0:op1:CRn:CRm:op2 */
+#define SYSREG_NZCV 0x5A10
+#define SYSREG_FPCR 0x5A20
+#define SYSREG_FPSR 0x5A21
+
+/* Shift types of OP_SHIFT, as encoded */
+#define SHIFT_LSL 0
+#define SHIFT_LSR 1
+#define SHIFT_ASR 2
+#define SHIFT_ROR 3
+
+typedef struct {
+    OperandType type;
+    union {
+        uint64_t immediate;
+        uint8_t reg;
+        struct {
+            uint8_t base_reg;
+            int32_t offset;
+            uint8_t index_reg;      /* 0xFF if none */
+            uint8_t shift_amount;   /* index is extended, then shifted left by this */
+            uint8_t extend;         /* index extend option, as OP_EXTEND */
+            uint8_t mode;           /* AddressingMode */
+        } mem;
+        /* OP_SHIFT: SHIFT_* applied to the preceding register operand;
+         * OP_EXTEND: the option field, UXTB (0) to SXTX (7), then LSL
+         */
+        struct {
+            uint8_t type;
+            uint8_t amount;
+        } shift;
+    } value;
+} Operand;
+
+/* A decoded instruction, packed into 16 bytes so pages of them stay small
+ * in the decode cache. Operands live in a byte each (a register, a small
+ * immediate, a shift, or a memory operand's base and mode) and share one
+ * 32-bit slot for the instruction's single wider immediate, memory offset
+ * or index register. They are read and written through the accessors
+ * below, with Operand as their unpacked form.
+ */
+#define INSTRUCTION_MAX_OPERANDS 3
+
+typedef struct Instruction {
+    uint32_t raw;
+    int32_t imm;
+    uint8_t opcode;
+    uint8_t dest_reg;                           /* 0xFF if none */
+    uint8_t operand_fields[INSTRUCTION_MAX_OPERANDS];
+    unsigned type : 4;                          /* InstructionType */
+    unsigned condition : 4;
+    unsigned sets_flags : 1;
+    unsigned operand_count : 2;
+    unsigned operand_kinds : 9;                 /* 3 bits per operand */
+    unsigned element_shift : 3;                 /* log2 of element_size, plus one; 0 if unset */
+} Instruction;
+
+_Static_assert(sizeof(Instruction) == 16, "Instruction must stay 16 bytes");
+
+void instruction_init(Instruction* inst);
+/* False if op does not fit the packed form; every operand the decoder
+ * produces does, as long as at most one needs the wide slot.
+ */
+bool instruction_set_operand(Instruction* inst, uint8_t index, Operand op);
+Operand instruction_get_operand(const Instruction* inst, uint8_t index);
+OperandType instruction_get_operand_type(const Instruction* inst, uint8_t index);
+uint8_t instruction_get_register(const Instruction* inst, uint8_t index);
+uint64_t instruction_get_immediate(const Instruction* inst, uint8_t index);
+/* AdvSIMD lane width, or bytes per register a load or store moves; 0 if unset */
+uint8_t instruction_get_element_size(const Instruction* inst);
+void instruction_set_element_size(Instruction* inst, uint8_t size);
+/* DecodeBitMasks of logical immediates; false for reserved encodings */
+bool instruction_decode_bit_mask(uint32_t n, uint32_t imms, uint32_t immr, bool is_64bit, uint64_t* mask);
+
+const char* instruction_to_string(const Instruction* inst, char* buffer, size_t size);
+bool instruction_is_branch(const Instruction* inst);
+/* B.cond, CBZ, CBNZ, TBZ and TBNZ */
+bool instruction_is_conditional_branch(const Instruction* inst);
+/* BR, BLR and RET: the target comes from a register */
+bool instruction_is_indirect_branch(const Instruction* inst);
+bool instruction_is_memory_access(const Instruction* inst);
+uint64_t instruction_get_branch_target(const Instruction* inst, uint64_t pc);
+bool instruction_is_64bit(const Instruction* inst);
+uint8_t instruction_get_access_size(const Instruction* inst);
+/* AdvSIMD register width in bytes: 16 with the Q bit set, else 8 */
+uint8_t instruction_get_vector_size(const Instruction* inst);
+
+bool instruction_modifies_register(const Instruction* inst, uint8_t reg);
+bool instruction_reads_register(const Instruction* inst, uint8_t reg);
+/* Conditional branches and selects, CCMP, ADC and SBC, and MRS of NZCV */
+bool instruction_reads_flags(const Instruction* inst);
+bool instruction_can_be_reordered(const Instruction* inst);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,39 @@
+#ifndef INTERPRETER_H
+#define INTERPRETER_H
+
+#include "instruction.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+struct Memory;
+struct RegisterFile;
+
+/* Tier-0 execution: runs decoded Instructions directly against the guest
+ * register file and memory, so blocks can execute before (or without)
+ * being compiled by the LLVM tier.
+ */
+
+typedef enum InterpreterResult {
+    INTERP_SUCCESS = 0,
+    INTERP_ERROR_NULL_PARAM = -1,
+    INTERP_ERROR_UNSUPPORTED = -2,
+    INTERP_ERROR_MEMORY_FAULT = -3
+} InterpreterResult;
+
+bool interpreter_can_execute(const Instruction* inst);
+
+/* Executes one instruction at pc and stores the address of the next one */
+InterpreterResult interpreter_execute(struct RegisterFile* regs, struct Memory* memory,
+                                      const Instruction* inst, uint64_t pc, uint64_t* next_pc);
+
+/* Executes a straight-line block starting at address; stops after the
+ * first branch or at the end of the block.
+ */
+InterpreterResult interpreter_execute_block(struct RegisterFile* regs, struct Memory* memory,
+                                            const Instruction* insts, size_t count,
+                                            uint64_t address, uint64_t* next_pc);
+
+bool interpreter_condition_holds(const struct RegisterFile* regs, uint8_t condition);
+
+#endif // INTERPRETER_H
@@ -1,43 +1,185 @@
-#ifndef JIT_H
-#define JIT_H
-
-#include <llvm-c/Core.h>
-#include <llvm-c/ExecutionEngine.h>
-#include <llvm-c/Target.h>
-#include <llvm-c/Analysis.h>
-#include <llvm-c/BitWriter.h>
-#include <stdint.h>
-#include <stdbool.h>
-
-struct Instruction;
-struct Memory;
-struct RegisterFile;
-
-typedef struct JITContext {
-    LLVMContextRef llvm_context;
-    LLVMModuleRef module;
-    LLVMBuilderRef builder;
-    LLVMExecutionEngineRef engine;
-    LLVMPassManagerRef pass_manager;
-    
-    void** compiled_blocks;
-    size_t cache_size;
-    
-    struct Memory* memory;
-    struct RegisterFile* registers;
-} JITContext;
-
-JITContext* jit_create(struct Memory* memory, struct RegisterFile* registers);
-void jit_destroy(JITContext* context);
-
-void* jit_compile_block(JITContext* context, uint64_t address);
-bool jit_execute_block(JITContext* context, void* block);
-void jit_invalidate_cache(JITContext* context, uint64_t address);
-
-void jit_optimize_block(JITContext* context, LLVMValueRef function);
-void jit_add_basic_optimizations(JITContext* context);
-
-void jit_cache_compiled_block(JITContext* context, uint64_t address, void* block);
-void* jit_get_cached_block(JITContext* context, uint64_t address);
-
+#ifndef JIT_H
+#define JIT_H
+
+#include <llvm-c/Core.h>
+#include <llvm-c/Error.h>
+#include <llvm-c/LLJIT.h>
+#include <llvm-c/Orc.h>
+#include <llvm-c/TargetMachine.h>
+#include <llvm-c/Target.h>
+#include <llvm-c/Analysis.h>
+#include <llvm-c/BitReader.h>
+#include <llvm-c/BitWriter.h>
+#include <llvm-c/Linker.h>
+#include <llvm-c/Transforms/IPO.h>
+#include <llvm-c/Transforms/PassBuilder.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "block_cache.h"
+#include "block.h"
+#include "code_cache.h"
+#include "decode_cache.h"
+#include "page_index.h"
+#include "translation_cache.h"
+
+struct Instruction;
+struct Memory;
+struct RegisterFile;
+struct CompileQueue;
+
+/* LLVM state for one compiling thread. LLVM contexts are not thread-safe,
+ * so every compile worker owns a JITCompiler and nothing in it is shared
+ * except the translation cache. Blocks are compiled to relocatable objects
+ * (so they can be cached on disk) by the target machine for their
+ * optimization level, and each object is added to the LLJIT under its own
+ * resource tracker, which owns the block's machine code until the tracker
+ * is removed.
+ */
+typedef struct JITCompiler {
+    LLVMContextRef llvm_context;
+    LLVMModuleRef module;           /* module being emitted; NULL between blocks */
+    LLVMBuilderRef builder;
+    /* One per BlockOptLevel, for the host CPU and its features, with the
+     * codegen level to match the level's IR pipeline
+     */
+    LLVMTargetMachineRef target_machines[BLOCK_OPT_LEVELS];
+    LLVMOrcLLJITRef lljit;
+    TranslationCache* translation_cache;
+    uint64_t compiled_count;
+    
+    /* Runtime helpers as bitcode (make helpers), or NULL. A copy is linked
+     * into every block module before it is optimized; the runtime functions
+     * it defines are forced inline there and the rest stays private to the
+     * block. Without it, helpers are calls to the absolute symbols.
+     */
+    LLVMModuleRef helpers;
+    LLVMPassManagerRef helper_inliner;
+} JITCompiler;
+
+/* Output of compiling one block. Exits are returned rather than written to
+ * the block so a worker never touches state the execution thread reads.
+ */
+typedef struct CompileResult {
+    void* code;
+    LLVMOrcResourceTrackerRef tracker;
+    size_t code_size;
+    uint64_t* exit_targets;
+    size_t exit_count;
+} CompileResult;
+
+/* Shadow return-address stack kept by translated code. BL and BLR push the
+ * return address together with an exit of the calling block that is linked
+ * to the return site's translation; RET pops it and, if the address matches
+ * X30, chains straight there. Entries are only hints: a mismatch falls back
+ * to the RET site's inline cache. The stack wraps instead of overflowing and
+ * is cleared whenever blocks are freed, since entries point into them.
+ */
+#define RETURN_STACK_SIZE 32
+
+typedef struct ReturnStackEntry {
+    uint64_t pc;
+    BlockExit* exit;
+} ReturnStackEntry;
+
+typedef struct ReturnStack {
+    ReturnStackEntry entries[RETURN_STACK_SIZE];
+    uint64_t top;
+} ReturnStack;
+
+typedef struct IndirectBranchStats {
+    uint64_t resolves;      /* inline cache misses handled by the resolver */
+    uint64_t retargets;     /* sites moved to a different target */
+    uint64_t linked;        /* misses that found translated code */
+} IndirectBranchStats;
+
+typedef struct JITContext {
+    JITCompiler* compiler;              /* synchronous compiles; NULL with workers */
+    struct CompileQueue* compile_queue; /* created on first use */
+    size_t worker_count;
+    TranslationCache* translation_cache;
+    LLVMMemoryBufferRef helper_bitcode; /* read-only; every compiler parses its own copy */
+    uint64_t helper_hash;               /* of helper_bitcode, part of every cache key */
+    
+    BlockCache* block_cache;
+    BlockCache* exit_lists;
+    CodeCache* code_cache;
+    PageIndex* page_index;
+    DecodeCache* decode_cache;          /* instructions of every page blocks were built from */
+    JITBlock* retired_blocks;
+    uint64_t tier_threshold;
+    BlockOptLevel first_opt_level;      /* blocks compiled before they were profiled */
+    BlockOptLevel hot_opt_level;        /* blocks promoted from the interpreter, and loops */
+    
+    ReturnStack return_stack;
+    IndirectBranchStats indirect_stats;
+    
+    struct Memory* memory;
+    struct RegisterFile* registers;
+} JITContext;
+
+JITContext* jit_create(struct Memory* memory, struct RegisterFile* registers);
+void jit_destroy(JITContext* context);
+
+JITBlock* jit_compile_block(JITContext* context, uint64_t address);
+bool jit_execute_block(JITContext* context, JITBlock* block);
+void jit_invalidate_cache(JITContext* context, uint64_t address);
+/* Drops every block decoded from guest code in [address, address + size).
+ * Stores into translated pages call this through the memory subsystem.
+ */
+void jit_invalidate_range(JITContext* context, uint64_t address, uint64_t size);
+bool jit_promote_block(JITContext* context, JITBlock* block);
+void jit_set_tier_threshold(JITContext* context, uint64_t threshold);
+/* Optimization for blocks compiled on first use, which have not been
+ * profiled, and for hot ones: blocks the interpreter promotes and blocks
+ * that loop back into themselves. Applies to compiles requested from now on.
+ */
+void jit_set_opt_levels(JITContext* context, BlockOptLevel first, BlockOptLevel hot);
+
+/* Number of background compile threads; 0 compiles on the execution
+ * thread. Fails once the first block has been compiled.
+ */
+bool jit_set_worker_count(JITContext* context, size_t count);
+
+/* Enables the persistent translation cache in directory; like the worker
+ * count it must be set before the first block is compiled.
+ */
+bool jit_set_cache_directory(JITContext* context, const char* directory);
+
+/* Links the runtime helper bitcode at path into translated code; also
+ * only before the first block is compiled.
+ */
+bool jit_set_helper_bitcode(JITContext* context, const char* path);
+
+/* Caps the bytes of translated code kept alive, evicting cold blocks
+ * once it is reached; 0 removes the limit. Takes effect immediately.
+ */
+void jit_set_code_budget(JITContext* context, size_t bytes);
+
+/* cache may be NULL; it is shared with, not owned by, the compiler */
+JITCompiler* jit_compiler_create(TranslationCache* cache);
+void jit_compiler_destroy(JITCompiler* compiler);
+/* Parses bitcode into the compiler's context; the buffer is not kept */
+bool jit_compiler_load_helpers(JITCompiler* compiler, LLVMMemoryBufferRef bitcode);
+bool jit_compiler_compile(JITCompiler* compiler, const JITBlock* block, CompileResult* result);
+void jit_compile_result_free(CompileResult* result);
+
+/* Called by translated code when a BR/BLR/RET inline cache misses: points
+ * exit exit_index of self at target_pc and returns the block to chain to,
+ * or NULL to return to the dispatcher.
+ */
+JITBlock* jit_resolve_indirect(JITBlock* self, uint64_t exit_index, uint64_t target_pc);
+
+/* Drops the block's machine code; it must not be running or linked */
+void jit_release_code(JITBlock* block);
+
+/* Runs the IR pipeline for level over compiler->module */
+bool jit_optimize_module(JITCompiler* compiler, BlockOptLevel level);
+
+void jit_cache_compiled_block(JITContext* context, uint64_t address, JITBlock* block);
+JITBlock* jit_get_cached_block(JITContext* context, uint64_t address);
+void jit_get_cache_stats(const JITContext* context, BlockCacheStats* stats);
+void jit_get_indirect_stats(const JITContext* context, IndirectBranchStats* stats);
+void jit_get_decode_stats(const JITContext* context, DecodeCacheStats* stats);
+void jit_print_indirect_stats(const JITContext* context);
+
 #endif // JIT_H 
\ No newline at end of file
@@ -0,0 +1,30 @@
+#ifndef LIVENESS_H
+#define LIVENESS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "instruction.h"
+
+/* Backward liveness of guest registers and NZCV over a straight-line run
+ * of instructions: a block body or a superblock trace. A register or flag
+ * result is dead when it is overwritten before anything reads it. Guest
+ * state is assumed live wherever control can leave the run: at the last
+ * instruction, at every B.cond (a superblock's side exit), at indirect
+ * branches, since the code there is not known at compile time, and just
+ * before every load or store, which may fault.
+ */
+
+typedef struct InstructionLiveness {
+    bool dead_result;   /* no register it writes is read; true if it writes none */
+    bool dead_flags;    /* the NZCV it sets is never read */
+} InstructionLiveness;
+
+/* Fills one entry per instruction */
+void liveness_analyze(const Instruction* insts, size_t count, InstructionLiveness* out);
+/* Guest state read before the run writes it: a bit per register below
+ * ARM64_REG_PC, and bit ARM64_REG_NZCV for the flags
+ */
+uint64_t liveness_live_in(const Instruction* insts, size_t count);
+
+#endif // LIVENESS_H
@@ -1,55 +1,102 @@
-#ifndef MEMORY_H
-#define MEMORY_H
-
-#include <stdint.h>
-#include <stddef.h>
-#include <stdbool.h>
-
-typedef enum {
-    PERM_NONE = 0,
-    PERM_READ = 1,
-    PERM_WRITE = 2,
-    PERM_EXEC = 4
-} MemoryPermissions;
-
-typedef struct MemoryRegion {
-    uint64_t start;
-    uint64_t size;
-    uint8_t* data;
-    MemoryPermissions permissions;
-    struct MemoryRegion* next;
-} MemoryRegion;
-
-typedef struct Memory {
-    MemoryRegion* regions;
-    size_t total_mapped_size;
-    bool little_endian;
-} Memory;
-
-Memory* memory_create(void);
-void memory_destroy(Memory* mem);
-
-bool memory_map(Memory* mem, uint64_t address, size_t size, MemoryPermissions perms);
-bool memory_unmap(Memory* mem, uint64_t address, size_t size);
-bool memory_protect(Memory* mem, uint64_t address, size_t size, MemoryPermissions perms);
-
-bool memory_read8(Memory* mem, uint64_t address, uint8_t* value);
-bool memory_read16(Memory* mem, uint64_t address, uint16_t* value);
-bool memory_read32(Memory* mem, uint64_t address, uint32_t* value);
-bool memory_read64(Memory* mem, uint64_t address, uint64_t* value);
-
-bool memory_write8(Memory* mem, uint64_t address, uint8_t value);
-bool memory_write16(Memory* mem, uint64_t address, uint16_t value);
-bool memory_write32(Memory* mem, uint64_t address, uint32_t value);
-bool memory_write64(Memory* mem, uint64_t address, uint64_t value);
-
-MemoryRegion* memory_find_region(Memory* mem, uint64_t address);
-bool memory_is_mapped(Memory* mem, uint64_t address, size_t size);
-bool memory_copy_to(Memory* mem, uint64_t address, const void* data, size_t size);
-bool memory_copy_from(Memory* mem, uint64_t address, void* data, size_t size);
-
-size_t memory_get_mapped_size(const Memory* mem);
-void memory_print_regions(const Memory* mem);
-bool memory_validate_access(const Memory* mem, uint64_t address, size_t size, MemoryPermissions required_perms);
-
+#ifndef MEMORY_H
+#define MEMORY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#define MEMORY_PAGE_SHIFT 12
+#define MEMORY_PAGE_SIZE (1ULL << MEMORY_PAGE_SHIFT)
+
+typedef enum {
+    PERM_NONE = 0,
+    PERM_READ = 1,
+    PERM_WRITE = 2,
+    PERM_EXEC = 4
+} MemoryPermissions;
+
+typedef struct MemoryRegion {
+    uint64_t start;
+    uint64_t size;
+    uint8_t* data;
+    MemoryPermissions permissions;
+    uint8_t* code_pages;    /* per page: holds decoded code; NULL until first marked */
+    struct MemoryRegion* next;
+} MemoryRegion;
+
+/* Called after a store to a page marked as holding code, so the JIT can
+ * drop translations of the bytes that changed.
+ */
+typedef void (*MemoryCodeWriteHandler)(void* opaque, uint64_t address, size_t size);
+
+/* Software TLB probed inline by translated code. An entry maps one guest
+ * page to host memory as host = guest + addend. An access hits when its
+ * address masked with ~(page size - 1) | (access size - 1) equals the
+ * read or write tag, so unaligned accesses always take the slow path.
+ * Only whole pages inside a region are entered, and pages holding decoded
+ * code never get a write tag, so stores to them still reach the code write
+ * handler.
+ */
+#define MEMORY_TLB_BITS 8
+#define MEMORY_TLB_SIZE (1 << MEMORY_TLB_BITS)
+#define MEMORY_TLB_INVALID UINT64_MAX   /* matches no masked address */
+
+typedef struct MemoryTLBEntry {
+    uint64_t read_tag;      /* page base, or MEMORY_TLB_INVALID */
+    uint64_t write_tag;
+    uintptr_t addend;
+} MemoryTLBEntry;
+
+typedef struct Memory {
+    MemoryRegion* regions;
+    size_t total_mapped_size;
+    bool little_endian;
+    MemoryCodeWriteHandler code_write_handler;
+    void* code_write_opaque;
+    MemoryTLBEntry tlb[MEMORY_TLB_SIZE];
+    uint64_t tlb_misses;
+} Memory;
+
+Memory* memory_create(void);
+void memory_destroy(Memory* mem);
+
+bool memory_map(Memory* mem, uint64_t address, size_t size, MemoryPermissions perms);
+bool memory_unmap(Memory* mem, uint64_t address, size_t size);
+bool memory_protect(Memory* mem, uint64_t address, size_t size, MemoryPermissions perms);
+
+bool memory_read8(Memory* mem, uint64_t address, uint8_t* value);
+bool memory_read16(Memory* mem, uint64_t address, uint16_t* value);
+bool memory_read32(Memory* mem, uint64_t address, uint32_t* value);
+bool memory_read64(Memory* mem, uint64_t address, uint64_t* value);
+
+bool memory_write8(Memory* mem, uint64_t address, uint8_t value);
+bool memory_write16(Memory* mem, uint64_t address, uint16_t value);
+bool memory_write32(Memory* mem, uint64_t address, uint32_t value);
+bool memory_write64(Memory* mem, uint64_t address, uint64_t value);
+
+/* Slow paths of the inline TLB probe: a full access of size bytes that
+ * refills the page's entry; false on a guest fault.
+ */
+bool memory_load_slow(Memory* mem, uint64_t address, uint64_t size, uint64_t* value);
+bool memory_store_slow(Memory* mem, uint64_t address, uint64_t size, uint64_t value);
+void memory_tlb_flush(Memory* mem);
+
+MemoryRegion* memory_find_region(Memory* mem, uint64_t address);
+bool memory_is_mapped(Memory* mem, uint64_t address, size_t size);
+bool memory_copy_to(Memory* mem, uint64_t address, const void* data, size_t size);
+bool memory_copy_from(Memory* mem, uint64_t address, void* data, size_t size);
+
+/* Code page tracking for self-modifying code. Stores to unmarked pages
+ * cost one extra test; stores to marked pages call the write handler,
+ * once per store with its whole range.
+ */
+void memory_set_code_write_handler(Memory* mem, MemoryCodeWriteHandler handler, void* opaque);
+bool memory_mark_code(Memory* mem, uint64_t address, size_t size);
+void memory_clear_code(Memory* mem, uint64_t address, size_t size);
+bool memory_page_has_code(Memory* mem, uint64_t address);
+
+size_t memory_get_mapped_size(const Memory* mem);
+void memory_print_regions(const Memory* mem);
+bool memory_validate_access(const Memory* mem, uint64_t address, size_t size, MemoryPermissions required_perms);
+
 #endif // MEMORY_H 
\ No newline at end of file
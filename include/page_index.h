@@ -0,0 +1,36 @@
+#ifndef PAGE_INDEX_H
+#define PAGE_INDEX_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "block.h"
+#include "block_cache.h"
+
+/* Guest page -> blocks decoded from it, so a store into guest code can
+ * find every translation it makes stale without scanning the translation
+ * table. Pages are keyed by base address in a BlockCache; each holds a
+ * small unordered array of blocks.
+ */
+
+typedef struct PageBlocks {
+    JITBlock** blocks;
+    size_t count;
+    size_t capacity;
+} PageBlocks;
+
+typedef struct PageIndex {
+    BlockCache* pages;
+} PageIndex;
+
+PageIndex* page_index_create(void);
+void page_index_destroy(PageIndex* index);
+
+bool page_index_add(PageIndex* index, uint64_t page, JITBlock* block);
+/* Returns true once the page has no blocks left */
+bool page_index_remove(PageIndex* index, uint64_t page, JITBlock* block);
+/* NULL if no block covers the page; invalid after the next add or remove */
+const PageBlocks* page_index_lookup(PageIndex* index, uint64_t page);
+size_t page_index_page_count(const PageIndex* index);
+
+#endif // PAGE_INDEX_H
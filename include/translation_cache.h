@@ -0,0 +1,95 @@
+#ifndef TRANSLATION_CACHE_H
+#define TRANSLATION_CACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "instruction.h"
+
+/* Persistent translation cache: one file per compiled block, named after a
+ * key that hashes the entry block's instruction words, its address and the
+ * options it was compiled with. A file holds the block's relocatable
+ * object together with the metadata needed to install it without running
+ * LLVM again, including the PC and word of every guest instruction it was
+ * compiled from (a superblock spans more than the entry block), so users
+ * can check the code is unchanged before trusting it. Files are written to
+ * a temporary name and renamed, so concurrent processes sharing a
+ * directory only ever see complete entries.
+ */
+
+#define TRANSLATION_CACHE_MAGIC 0x54343641   /* "A64T" */
+#define TRANSLATION_CACHE_VERSION 3
+
+typedef struct TranslationCacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;
+    uint64_t address;
+    uint32_t instruction_count;
+    uint32_t exit_count;
+    uint32_t symbol_length;
+    uint32_t object_size;
+} TranslationCacheHeader;
+
+typedef struct TranslationCacheStats {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t stores;
+    uint64_t rejected;      /* present but corrupt or for different code */
+} TranslationCacheStats;
+
+typedef struct TranslationCache {
+    char* directory;
+    uint64_t options_hash;
+    TranslationCacheStats stats;    /* updated atomically by compile workers */
+} TranslationCache;
+
+/* A loaded entry; the pointers refer into a read-only mapping of the file */
+typedef struct TranslationCacheEntry {
+    void* mapping;
+    size_t mapping_size;
+    uint64_t address;
+    const uint64_t* pcs;
+    const uint32_t* words;
+    size_t instruction_count;
+    const uint64_t* exit_targets;
+    size_t exit_count;
+    const char* symbol;
+    const void* object;
+    size_t object_size;
+} TranslationCacheEntry;
+
+/* Creates the directory if needed. options_hash identifies the host and
+ * the JIT build; callers fold the rest of what affects the generated
+ * object (pipeline, helper bitcode) into the keys they derive.
+ */
+TranslationCache* translation_cache_open(const char* directory, uint64_t options_hash);
+void translation_cache_close(TranslationCache* cache);
+
+uint64_t translation_cache_hash(const void* data, size_t size, uint64_t seed);
+uint64_t translation_cache_key(const TranslationCache* cache, uint64_t address,
+                               const Instruction* insts, size_t count);
+bool translation_cache_contains(const TranslationCache* cache, uint64_t key);
+
+/* Returns NULL on a miss or if the file is damaged or for another address */
+TranslationCacheEntry* translation_cache_load(TranslationCache* cache, uint64_t key, uint64_t address);
+void translation_cache_release(TranslationCacheEntry* entry);
+
+/* Checks the entry was compiled from exactly this code and counts a hit or
+ * a rejection. pcs may be NULL for straight-line code at the entry address.
+ */
+bool translation_cache_validate(TranslationCache* cache, const TranslationCacheEntry* entry,
+                                const Instruction* insts, const uint64_t* pcs, size_t count);
+
+/* Counts an entry the caller found stale by other means */
+void translation_cache_reject(TranslationCache* cache);
+
+bool translation_cache_store(TranslationCache* cache, uint64_t key, uint64_t address,
+                             const Instruction* insts, const uint64_t* pcs, size_t count,
+                             const uint64_t* exit_targets, size_t exit_count,
+                             const char* symbol, const void* object, size_t object_size);
+
+void translation_cache_get_stats(const TranslationCache* cache, TranslationCacheStats* stats);
+void translation_cache_print_stats(const TranslationCache* cache);
+
+#endif // TRANSLATION_CACHE_H
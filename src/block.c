@@ -0,0 +1,216 @@
+#include "block.h"
+#include <stdlib.h>
+#include <string.h>
+
+JITBlock* block_create(uint64_t address) {
+    JITBlock* block = (JITBlock*)calloc(1, sizeof(JITBlock));
+    if (!block) return NULL;
+    block->address = address;
+    return block;
+}
+
+void block_destroy(JITBlock* block) {
+    if (!block) return;
+    free(block->exits);
+    free(block->instructions);
+    block_trace_destroy(block->trace);
+    free(block->pages);
+    free(block);
+}
+
+bool block_set_exits(JITBlock* block, const uint64_t* targets, size_t count) {
+    if (!block || (count && !targets)) return false;
+
+    BlockExit* exits = NULL;
+    if (count) {
+        exits = (BlockExit*)calloc(count, sizeof(BlockExit));
+        if (!exits) return false;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        exits[i].target_pc = targets[i];
+        exits[i].owner = block;
+        exits[i].indirect = targets[i] == BLOCK_EXIT_INDIRECT;
+    }
+
+    free(block->exits);
+    block->exits = exits;
+    block->exit_count = count;
+    return true;
+}
+
+BlockTrace* block_trace_create(size_t capacity) {
+    BlockTrace* trace = (BlockTrace*)calloc(1, sizeof(BlockTrace));
+    if (!trace) return NULL;
+
+    trace->instructions = (Instruction*)malloc(capacity * sizeof(Instruction));
+    trace->pcs = (uint64_t*)malloc(capacity * sizeof(uint64_t));
+    if (!trace->instructions || !trace->pcs) {
+        block_trace_destroy(trace);
+        return NULL;
+    }
+    trace->capacity = capacity;
+    return trace;
+}
+
+void block_trace_destroy(BlockTrace* trace) {
+    if (!trace) return;
+    free(trace->instructions);
+    free(trace->pcs);
+    free(trace);
+}
+
+bool block_trace_append(BlockTrace* trace, const Instruction* insts, size_t count, uint64_t address) {
+    if (!trace || !insts || count > trace->capacity - trace->count) return false;
+
+    memcpy(&trace->instructions[trace->count], insts, count * sizeof(Instruction));
+    for (size_t i = 0; i < count; i++) {
+        trace->pcs[trace->count + i] = address + i * 4;
+    }
+    trace->count += count;
+    trace->block_count++;
+    return true;
+}
+
+bool block_trace_contains(const BlockTrace* trace, uint64_t pc) {
+    if (!trace) return false;
+    for (size_t i = 0; i < trace->count; i++) {
+        if (trace->pcs[i] == pc) return true;
+    }
+    return false;
+}
+
+bool block_overlaps(const JITBlock* block, uint64_t address, uint64_t size) {
+    if (!block || !size) return false;
+    
+    uint64_t end = address + size;
+    if (address < block->address + block->size && block->address < end) return true;
+    
+    const BlockTrace* trace = block->trace;
+    for (size_t i = 0; trace && i < trace->count; i++) {
+        if (address < trace->pcs[i] + 4 && trace->pcs[i] < end) return true;
+    }
+    return false;
+}
+
+bool block_add_page(JITBlock* block, uint64_t page) {
+    if (!block) return false;
+    for (size_t i = 0; i < block->page_count; i++) {
+        if (block->pages[i] == page) return false;
+    }
+    
+    uint64_t* pages = (uint64_t*)realloc(block->pages, (block->page_count + 1) * sizeof(uint64_t));
+    if (!pages) return false;
+    pages[block->page_count++] = page;
+    block->pages = pages;
+    return true;
+}
+
+static void link_exit(BlockExit* exit, JITBlock* target) {
+    __atomic_store_n(&exit->target, target, __ATOMIC_RELEASE);
+}
+
+static bool register_exit(BlockExit* exit, BlockCache* exit_lists) {
+    BlockExit* head = (BlockExit*)block_cache_lookup(exit_lists, exit->target_pc);
+
+    exit->prev = NULL;
+    exit->next = head;
+    if (!block_cache_insert(exit_lists, exit->target_pc, exit)) {
+        exit->next = NULL;
+        return false;
+    }
+    if (head) head->prev = exit;
+    return true;
+}
+
+static void unregister_exit(BlockExit* exit, BlockCache* exit_lists) {
+    if (exit->prev) {
+        exit->prev->next = exit->next;
+    } else if (exit->next) {
+        block_cache_insert(exit_lists, exit->target_pc, exit->next);
+    } else {
+        block_cache_remove(exit_lists, exit->target_pc);
+    }
+    if (exit->next) exit->next->prev = exit->prev;
+
+    exit->prev = NULL;
+    exit->next = NULL;
+    link_exit(exit, NULL);
+}
+
+bool block_register_exits(JITBlock* block, BlockCache* exit_lists, BlockCache* blocks) {
+    if (!block || !exit_lists) return false;
+
+    for (size_t i = 0; i < block->exit_count; i++) {
+        BlockExit* exit = &block->exits[i];
+        /* Indirect exits join a list once their site resolves a target */
+        if (exit->target_pc == BLOCK_EXIT_INDIRECT) continue;
+
+        if (!register_exit(exit, exit_lists)) {
+            /* Leave the exits registered so far consistent for unregister */
+            block->exit_count = i;
+            return false;
+        }
+
+        JITBlock* target = blocks ? (JITBlock*)block_cache_lookup(blocks, exit->target_pc) : NULL;
+        if (target && target->code) {
+            link_exit(exit, target);
+        }
+    }
+    return true;
+}
+
+void block_unregister_exits(JITBlock* block, BlockCache* exit_lists) {
+    if (!block || !exit_lists) return;
+
+    for (size_t i = 0; i < block->exit_count; i++) {
+        BlockExit* exit = &block->exits[i];
+        if (exit->target_pc == BLOCK_EXIT_INDIRECT) continue;
+        unregister_exit(exit, exit_lists);
+        if (exit->indirect) exit->target_pc = BLOCK_EXIT_INDIRECT;
+    }
+}
+
+size_t block_link_incoming(JITBlock* block, BlockCache* exit_lists) {
+    if (!block || !block->code || !exit_lists) return 0;
+
+    size_t linked = 0;
+    BlockExit* exit = (BlockExit*)block_cache_lookup(exit_lists, block->address);
+    for (; exit; exit = exit->next) {
+        link_exit(exit, block);
+        linked++;
+    }
+    return linked;
+}
+
+bool block_retarget_exit(BlockExit* exit, uint64_t target_pc, JITBlock* target, BlockCache* exit_lists) {
+    if (!exit || !exit->indirect || !exit_lists || target_pc == BLOCK_EXIT_INDIRECT) return false;
+
+    if (exit->target_pc != BLOCK_EXIT_INDIRECT) {
+        unregister_exit(exit, exit_lists);
+    }
+    /* Emitted code compares target_pc before loading target */
+    exit->target_pc = target_pc;
+    if (!register_exit(exit, exit_lists)) {
+        exit->target_pc = BLOCK_EXIT_INDIRECT;
+        return false;
+    }
+    if (target && target->code) {
+        link_exit(exit, target);
+    }
+    return true;
+}
+
+size_t block_unlink_incoming(uint64_t address, BlockCache* exit_lists) {
+    if (!exit_lists) return 0;
+
+    size_t unlinked = 0;
+    BlockExit* exit = (BlockExit*)block_cache_lookup(exit_lists, address);
+    for (; exit; exit = exit->next) {
+        if (exit->target) {
+            link_exit(exit, NULL);
+            unlinked++;
+        }
+    }
+    return unlinked;
+}
@@ -0,0 +1,233 @@
+#include "block_cache.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#define MIN_CAPACITY 16
+#define HASH_MULTIPLIER 0x9E3779B97F4A7C15ULL
+
+/* Fibonacci hashing on the instruction index; the top bits of the
+ * product are well mixed even for long runs of sequential PCs.
+ */
+static inline size_t hash_key(const BlockCache* cache, uint64_t key) {
+    return (size_t)(((key >> 2) * HASH_MULTIPLIER) >> cache->shift);
+}
+
+static inline void record_probes(BlockCache* cache, uint64_t probes) {
+    if (probes == 0) return;
+    cache->stats.collisions++;
+    cache->stats.total_probes += probes;
+    if (probes > cache->stats.max_probe_length) {
+        cache->stats.max_probe_length = probes;
+    }
+}
+
+static BlockCacheEntry* allocate_entries(size_t capacity) {
+    BlockCacheEntry* entries = (BlockCacheEntry*)malloc(capacity * sizeof(BlockCacheEntry));
+    if (!entries) return NULL;
+    for (size_t i = 0; i < capacity; i++) {
+        entries[i].key = BLOCK_CACHE_EMPTY_KEY;
+        entries[i].value = NULL;
+    }
+    return entries;
+}
+
+static uint32_t shift_for_capacity(size_t capacity) {
+    uint32_t bits = 0;
+    while (((size_t)1 << bits) < capacity) {
+        bits++;
+    }
+    return 64 - bits;
+}
+
+BlockCache* block_cache_create(size_t initial_capacity) {
+    size_t capacity = MIN_CAPACITY;
+    while (capacity < initial_capacity) {
+        capacity <<= 1;
+    }
+
+    BlockCache* cache = (BlockCache*)calloc(1, sizeof(BlockCache));
+    if (!cache) return NULL;
+
+    cache->entries = allocate_entries(capacity);
+    if (!cache->entries) {
+        free(cache);
+        return NULL;
+    }
+
+    cache->capacity = capacity;
+    cache->count = 0;
+    cache->shift = shift_for_capacity(capacity);
+    return cache;
+}
+
+void block_cache_destroy(BlockCache* cache) {
+    if (!cache) return;
+    free(cache->entries);
+    free(cache);
+}
+
+void block_cache_clear(BlockCache* cache) {
+    if (!cache) return;
+    for (size_t i = 0; i < cache->capacity; i++) {
+        cache->entries[i].key = BLOCK_CACHE_EMPTY_KEY;
+        cache->entries[i].value = NULL;
+    }
+    cache->count = 0;
+}
+
+static bool grow(BlockCache* cache) {
+    size_t new_capacity = cache->capacity << 1;
+    BlockCacheEntry* new_entries = allocate_entries(new_capacity);
+    if (!new_entries) return false;
+
+    BlockCacheEntry* old_entries = cache->entries;
+    size_t old_capacity = cache->capacity;
+
+    cache->entries = new_entries;
+    cache->capacity = new_capacity;
+    cache->shift = shift_for_capacity(new_capacity);
+
+    size_t mask = new_capacity - 1;
+    for (size_t i = 0; i < old_capacity; i++) {
+        if (old_entries[i].key == BLOCK_CACHE_EMPTY_KEY) continue;
+        size_t index = hash_key(cache, old_entries[i].key);
+        while (new_entries[index].key != BLOCK_CACHE_EMPTY_KEY) {
+            index = (index + 1) & mask;
+        }
+        new_entries[index] = old_entries[i];
+    }
+
+    free(old_entries);
+    cache->stats.resizes++;
+    return true;
+}
+
+bool block_cache_insert(BlockCache* cache, uint64_t key, void* value) {
+    if (!cache || key == BLOCK_CACHE_EMPTY_KEY) return false;
+
+    if ((cache->count + 1) * 4 > cache->capacity * 3) {
+        if (!grow(cache)) return false;
+    }
+
+    size_t mask = cache->capacity - 1;
+    size_t index = hash_key(cache, key);
+    uint64_t probes = 0;
+
+    while (cache->entries[index].key != BLOCK_CACHE_EMPTY_KEY) {
+        if (cache->entries[index].key == key) {
+            cache->entries[index].value = value;
+            record_probes(cache, probes);
+            return true;
+        }
+        index = (index + 1) & mask;
+        probes++;
+    }
+
+    cache->entries[index].key = key;
+    cache->entries[index].value = value;
+    cache->count++;
+    cache->stats.inserts++;
+    record_probes(cache, probes);
+    return true;
+}
+
+void* block_cache_lookup(BlockCache* cache, uint64_t key) {
+    if (!cache || key == BLOCK_CACHE_EMPTY_KEY) return NULL;
+
+    size_t mask = cache->capacity - 1;
+    size_t index = hash_key(cache, key);
+    uint64_t probes = 0;
+
+    cache->stats.lookups++;
+    while (true) {
+        const BlockCacheEntry* entry = &cache->entries[index];
+        if (entry->key == key) {
+            cache->stats.hits++;
+            record_probes(cache, probes);
+            return entry->value;
+        }
+        if (entry->key == BLOCK_CACHE_EMPTY_KEY) {
+            cache->stats.misses++;
+            record_probes(cache, probes);
+            return NULL;
+        }
+        index = (index + 1) & mask;
+        probes++;
+    }
+}
+
+void* block_cache_remove(BlockCache* cache, uint64_t key) {
+    if (!cache || key == BLOCK_CACHE_EMPTY_KEY) return NULL;
+
+    size_t mask = cache->capacity - 1;
+    size_t hole = hash_key(cache, key);
+
+    while (cache->entries[hole].key != key) {
+        if (cache->entries[hole].key == BLOCK_CACHE_EMPTY_KEY) return NULL;
+        hole = (hole + 1) & mask;
+    }
+
+    void* value = cache->entries[hole].value;
+
+    /* Backward-shift deletion: pull later members of the probe run into
+     * the hole as long as that does not move them before their home slot.
+     */
+    size_t next = (hole + 1) & mask;
+    while (cache->entries[next].key != BLOCK_CACHE_EMPTY_KEY) {
+        size_t home = hash_key(cache, cache->entries[next].key);
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            cache->entries[hole] = cache->entries[next];
+            hole = next;
+        }
+        next = (next + 1) & mask;
+    }
+
+    cache->entries[hole].key = BLOCK_CACHE_EMPTY_KEY;
+    cache->entries[hole].value = NULL;
+    cache->count--;
+    cache->stats.removals++;
+    return value;
+}
+
+void block_cache_foreach(const BlockCache* cache, BlockCacheVisitor visitor, void* opaque) {
+    if (!cache || !visitor) return;
+    for (size_t i = 0; i < cache->capacity; i++) {
+        if (cache->entries[i].key != BLOCK_CACHE_EMPTY_KEY) {
+            visitor(cache->entries[i].key, cache->entries[i].value, opaque);
+        }
+    }
+}
+
+size_t block_cache_count(const BlockCache* cache) {
+    return cache ? cache->count : 0;
+}
+
+void block_cache_get_stats(const BlockCache* cache, BlockCacheStats* stats) {
+    if (!cache || !stats) return;
+    *stats = cache->stats;
+}
+
+void block_cache_reset_stats(BlockCache* cache) {
+    if (!cache) return;
+    memset(&cache->stats, 0, sizeof(BlockCacheStats));
+}
+
+void block_cache_print_stats(const BlockCache* cache) {
+    if (!cache) return;
+
+    const BlockCacheStats* stats = &cache->stats;
+    uint64_t operations = stats->lookups + stats->inserts;
+
+    printf("Translation Cache:\n");
+    printf("Blocks: %zu / %zu slots (load %.2f)\n",
+           cache->count, cache->capacity,
+           (double)cache->count / (double)cache->capacity);
+    printf("Lookups: %lu (hits %lu, misses %lu)\n",
+           stats->lookups, stats->hits, stats->misses);
+    printf("Collisions: %lu  Avg probe length: %.3f  Max probe length: %lu\n",
+           stats->collisions,
+           operations ? (double)stats->total_probes / (double)operations : 0.0,
+           stats->max_probe_length);
+    printf("Resizes: %lu\n", stats->resizes);
+}
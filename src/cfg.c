@@ -0,0 +1,539 @@
+#include "cfg.h"
+#include "decoder.h"
+#include <stdlib.h>
+#include <pthread.h>
+
+#define CFG_PAGE_SLOTS (MEMORY_PAGE_SIZE / 4)
+#define CFG_PAGE_WORDS (CFG_PAGE_SLOTS / 64)
+#define INITIAL_PAGE_COUNT 64
+#define INITIAL_BLOCK_COUNT 1024
+#define OUTBOX_FLUSH_COUNT 256
+
+#define WORK_LEADER     0x1
+#define WORK_FUNCTION   0x2
+
+/* What discovery learned about one page; only its owner touches it until
+ * all workers have finished
+ */
+typedef struct CFGPage {
+    uint64_t visited[CFG_PAGE_WORDS];
+    uint64_t leaders[CFG_PAGE_WORDS];   /* block starts */
+    uint64_t functions[CFG_PAGE_WORDS];
+    uint64_t ends[CFG_PAGE_WORDS];      /* branches and words that do not decode */
+} CFGPage;
+
+/* An address to decode from, on its way to the owner of its page */
+typedef struct CFGWork {
+    uint64_t pc;
+    uint32_t flags;
+} CFGWork;
+
+typedef struct CFGWorkList {
+    CFGWork* items;
+    size_t count;
+    size_t capacity;
+} CFGWorkList;
+
+typedef struct CFGWorker {
+    pthread_t thread;
+    struct CFGBuilder* builder;
+    BlockCache* pages;          /* page -> CFGPage, for the pages it owns */
+
+    pthread_mutex_t lock;
+    pthread_cond_t work_available;
+    CFGWorkList inbox;          /* guarded by lock */
+    CFGWorkList batch;          /* inbox taken over for processing */
+    CFGWorkList local;          /* addresses on its own pages */
+    CFGWorkList* outboxes;      /* per owner, sent in batches */
+
+    BlockCache* blocks;         /* the blocks it forms, handed to the graph */
+    size_t edge_count;
+    size_t instruction_count;
+    bool started;
+} CFGWorker;
+
+typedef struct CFGPageRef {
+    uint64_t page;
+    const CFGPage* entry;
+} CFGPageRef;
+
+typedef struct CFGBuilder {
+    Memory* memory;
+    CFGWorker* workers;
+    size_t worker_count;
+    size_t outstanding;         /* queued or in-progress work, updated atomically */
+    bool done;
+    bool failed;
+
+    CFGPageRef* pages;          /* every worker's pages by address, once discovery is over */
+    size_t page_count;
+} CFGBuilder;
+
+static bool test_bit(const uint64_t* bitmap, size_t slot) {
+    return (bitmap[slot / 64] >> (slot % 64)) & 1;
+}
+
+static void set_bit(uint64_t* bitmap, size_t slot) {
+    bitmap[slot / 64] |= 1ULL << (slot % 64);
+}
+
+static uint64_t page_of(uint64_t pc) {
+    return pc & ~(uint64_t)(MEMORY_PAGE_SIZE - 1);
+}
+
+static size_t slot_of(uint64_t pc) {
+    return (pc & (MEMORY_PAGE_SIZE - 1)) / 4;
+}
+
+static CFGWorker* owner_of(CFGBuilder* builder, uint64_t pc) {
+    return &builder->workers[(pc / MEMORY_PAGE_SIZE) % builder->worker_count];
+}
+
+static void fail(CFGBuilder* builder) {
+    __atomic_store_n(&builder->failed, true, __ATOMIC_RELAXED);
+}
+
+static bool work_list_push(CFGWorkList* list, uint64_t pc, uint32_t flags) {
+    if (list->count == list->capacity) {
+        size_t capacity = list->capacity ? list->capacity * 2 : 64;
+        CFGWork* items = (CFGWork*)realloc(list->items, capacity * sizeof(CFGWork));
+        if (!items) return false;
+        list->items = items;
+        list->capacity = capacity;
+    }
+    list->items[list->count++] = (CFGWork){ .pc = pc, .flags = flags };
+    return true;
+}
+
+/* Direct successors of a branch at pc; returns how many */
+static size_t branch_edges(const Instruction* inst, uint64_t pc, CFGEdge* edges) {
+    uint64_t target = instruction_get_branch_target(inst, pc);
+    switch (inst->opcode) {
+        case 0x20:
+            edges[0] = (CFGEdge){ target, CFG_EDGE_BRANCH };
+            return 1;
+        case 0x25:
+            edges[0] = (CFGEdge){ target, CFG_EDGE_CALL };
+            edges[1] = (CFGEdge){ pc + 4, CFG_EDGE_FALLTHROUGH };
+            return 2;
+        case 0x26:
+            edges[0] = (CFGEdge){ pc + 4, CFG_EDGE_FALLTHROUGH };
+            return 1;
+        case 0x23:
+        case 0x24:
+            return 0;
+        default:
+            edges[0] = (CFGEdge){ target, CFG_EDGE_BRANCH };
+            edges[1] = (CFGEdge){ pc + 4, CFG_EDGE_FALLTHROUGH };
+            return 2;
+    }
+}
+
+static bool decode_at(CFGBuilder* builder, uint64_t pc, Instruction* inst) {
+    MemoryRegion* region = memory_find_region(builder->memory, pc);
+    if (!region || !(region->permissions & PERM_EXEC) || pc + 4 > region->start + region->size) return false;
+
+    DecoderContext decoder = { .pc = pc - region->start, .code_buffer = region->data, .buffer_size = region->size };
+    return decoder_decode_at(&decoder, decoder.pc, inst) == DECODER_SUCCESS;
+}
+
+static void finish(CFGBuilder* builder) {
+    __atomic_store_n(&builder->done, true, __ATOMIC_RELEASE);
+    for (size_t i = 0; i < builder->worker_count; i++) {
+        CFGWorker* worker = &builder->workers[i];
+        pthread_mutex_lock(&worker->lock);
+        pthread_cond_broadcast(&worker->work_available);
+        pthread_mutex_unlock(&worker->lock);
+    }
+}
+
+/* Returns how many items made it onto list */
+static size_t work_list_append(CFGWorkList* list, const CFGWorkList* items) {
+    size_t i = 0;
+    while (i < items->count && work_list_push(list, items->items[i].pc, items->items[i].flags)) i++;
+    return i;
+}
+
+static void flush_outbox(CFGWorker* worker, size_t index) {
+    CFGBuilder* builder = worker->builder;
+    CFGWorkList* outbox = &worker->outboxes[index];
+    if (!outbox->count) return;
+
+    /* Counted before the owner can see it, so it cannot finish early */
+    CFGWorker* owner = &builder->workers[index];
+    __atomic_add_fetch(&builder->outstanding, outbox->count, __ATOMIC_ACQ_REL);
+    pthread_mutex_lock(&owner->lock);
+    size_t queued = work_list_append(&owner->inbox, outbox);
+    pthread_cond_signal(&owner->work_available);
+    pthread_mutex_unlock(&owner->lock);
+    if (queued < outbox->count) {
+        fail(builder);
+        if (__atomic_sub_fetch(&builder->outstanding, outbox->count - queued, __ATOMIC_ACQ_REL) == 0) {
+            finish(builder);
+        }
+    }
+    outbox->count = 0;
+}
+
+static void send(CFGWorker* worker, uint64_t pc, uint32_t flags) {
+    CFGBuilder* builder = worker->builder;
+    CFGWorker* owner = owner_of(builder, pc);
+    if (owner == worker) {
+        if (!work_list_push(&worker->local, pc, flags)) fail(builder);
+        return;
+    }
+
+    size_t index = (size_t)(owner - builder->workers);
+    if (!work_list_push(&worker->outboxes[index], pc, flags)) {
+        fail(builder);
+    } else if (worker->outboxes[index].count >= OUTBOX_FLUSH_COUNT) {
+        flush_outbox(worker, index);
+    }
+}
+
+static CFGPage* get_page(CFGWorker* worker, uint64_t page) {
+    CFGPage* entry = (CFGPage*)block_cache_lookup(worker->pages, page);
+    if (entry) return entry;
+
+    entry = (CFGPage*)calloc(1, sizeof(CFGPage));
+    if (!entry) return NULL;
+    if (!block_cache_insert(worker->pages, page, entry)) {
+        free(entry);
+        return NULL;
+    }
+    return entry;
+}
+
+/* Decodes from pc to the end of its run: a branch, a word that does not
+ * decode, code already visited, or the end of the page, where the owner of
+ * the next page takes over.
+ */
+static void walk(CFGWorker* worker, CFGWork work) {
+    CFGBuilder* builder = worker->builder;
+    uint64_t pc = work.pc;
+    MemoryRegion* region = memory_find_region(builder->memory, pc);
+    if ((pc & 3) || !region || !(region->permissions & PERM_EXEC)) return;
+
+    uint64_t page = page_of(pc);
+    CFGPage* entry = get_page(worker, page);
+    if (!entry) {
+        fail(builder);
+        return;
+    }
+    size_t slot = slot_of(pc);
+    if (work.flags & WORK_LEADER) set_bit(entry->leaders, slot);
+    if (work.flags & WORK_FUNCTION) set_bit(entry->functions, slot);
+
+    DecoderContext decoder = { .code_buffer = region->data, .buffer_size = region->size };
+    while (!test_bit(entry->visited, slot)) {
+        set_bit(entry->visited, slot);
+
+        Instruction inst;
+        decoder.pc = pc - region->start;
+        if (pc + 4 > region->start + region->size ||
+            decoder_decode_at(&decoder, decoder.pc, &inst) != DECODER_SUCCESS) {
+            set_bit(entry->ends, slot);
+            return;
+        }
+        if (instruction_is_branch(&inst)) {
+            set_bit(entry->ends, slot);
+            CFGEdge edges[2];
+            size_t count = branch_edges(&inst, pc, edges);
+            for (size_t i = 0; i < count; i++) {
+                send(worker, edges[i].target, WORK_LEADER | (edges[i].kind == CFG_EDGE_CALL ? WORK_FUNCTION : 0));
+            }
+            return;
+        }
+
+        uint64_t next;
+        decoder_get_next_pc(&decoder, &inst, &next);
+        pc = region->start + next;
+        if (page_of(pc) != page) {
+            send(worker, pc, 0);
+            return;
+        }
+        slot = slot_of(pc);
+    }
+}
+
+/* Discovery is over once no work is queued or in progress anywhere;
+ * work is counted from when it is sent until its batch has been walked.
+ */
+static void* worker_main(void* arg) {
+    CFGWorker* worker = (CFGWorker*)arg;
+    CFGBuilder* builder = worker->builder;
+
+    pthread_mutex_lock(&worker->lock);
+    for (;;) {
+        while (!worker->inbox.count && !__atomic_load_n(&builder->done, __ATOMIC_ACQUIRE)) {
+            pthread_cond_wait(&worker->work_available, &worker->lock);
+        }
+        if (!worker->inbox.count) break;
+
+        CFGWorkList batch = worker->inbox;
+        worker->inbox = worker->batch;
+        worker->batch = batch;
+        pthread_mutex_unlock(&worker->lock);
+
+        for (size_t i = 0; i < batch.count; i++) {
+            walk(worker, batch.items[i]);
+            while (worker->local.count) {
+                walk(worker, worker->local.items[--worker->local.count]);
+            }
+        }
+        worker->batch.count = 0;
+        for (size_t i = 0; i < builder->worker_count; i++) {
+            flush_outbox(worker, i);
+        }
+        if (__atomic_sub_fetch(&builder->outstanding, batch.count, __ATOMIC_ACQ_REL) == 0) {
+            finish(builder);
+        }
+        pthread_mutex_lock(&worker->lock);
+    }
+    pthread_mutex_unlock(&worker->lock);
+    return NULL;
+}
+
+static int compare_page_refs(const void* a, const void* b) {
+    uint64_t left = ((const CFGPageRef*)a)->page;
+    uint64_t right = ((const CFGPageRef*)b)->page;
+    return left < right ? -1 : left > right;
+}
+
+static void collect_page(uint64_t page, void* value, void* opaque) {
+    CFGBuilder* builder = (CFGBuilder*)opaque;
+    builder->pages[builder->page_count++] = (CFGPageRef){ page, (const CFGPage*)value };
+}
+
+/* Blocks may run onto pages other workers own, so formation looks pages
+ * up in a sorted copy of all the tables rather than in the tables
+ * themselves
+ */
+static bool index_pages(CFGBuilder* builder) {
+    size_t total = 0;
+    for (size_t i = 0; i < builder->worker_count; i++) {
+        total += block_cache_count(builder->workers[i].pages);
+    }
+    builder->pages = (CFGPageRef*)malloc((total ? total : 1) * sizeof(CFGPageRef));
+    if (!builder->pages) return false;
+
+    for (size_t i = 0; i < builder->worker_count; i++) {
+        block_cache_foreach(builder->workers[i].pages, collect_page, builder);
+    }
+    qsort(builder->pages, builder->page_count, sizeof(CFGPageRef), compare_page_refs);
+    return true;
+}
+
+static const CFGPage* find_page(const CFGBuilder* builder, uint64_t pc) {
+    CFGPageRef key = { .page = page_of(pc) };
+    const CFGPageRef* ref = (const CFGPageRef*)bsearch(&key, builder->pages, builder->page_count,
+                                                       sizeof(CFGPageRef), compare_page_refs);
+    return ref ? ref->entry : NULL;
+}
+
+/* Runs from a leader to the next branch or leader */
+static bool add_block(CFGWorker* worker, const CFGPage* page, uint64_t address) {
+    CFGBlock* block = (CFGBlock*)calloc(1, sizeof(CFGBlock));
+    if (!block) return false;
+    block->address = address;
+    block->flags = test_bit(page->functions, slot_of(address)) ? CFG_BLOCK_FUNCTION : 0;
+
+    uint64_t pc = address;
+    const CFGPage* entry = page;
+    while (entry && test_bit(entry->visited, slot_of(pc))) {
+        if (test_bit(entry->ends, slot_of(pc))) {
+            Instruction inst;
+            if (!decode_at(worker->builder, pc, &inst)) {
+                block->flags |= CFG_BLOCK_INVALID;
+                break;
+            }
+            block->instruction_count++;
+            block->successor_count = branch_edges(&inst, pc, block->successors);
+            if (instruction_is_indirect_branch(&inst)) block->flags |= CFG_BLOCK_INDIRECT;
+            break;
+        }
+
+        block->instruction_count++;
+        pc += 4;
+        if (!slot_of(pc)) entry = find_page(worker->builder, pc);
+        if (entry && test_bit(entry->leaders, slot_of(pc))) {
+            block->successors[block->successor_count++] = (CFGEdge){ pc, CFG_EDGE_FALLTHROUGH };
+            break;
+        }
+    }
+
+    if (!block_cache_insert(worker->blocks, address, block)) {
+        free(block);
+        return false;
+    }
+    worker->edge_count += block->successor_count;
+    worker->instruction_count += block->instruction_count;
+    return true;
+}
+
+static void form_page_blocks(uint64_t page, void* value, void* opaque) {
+    CFGWorker* worker = (CFGWorker*)opaque;
+    const CFGPage* entry = (const CFGPage*)value;
+
+    for (size_t i = 0; i < CFG_PAGE_WORDS; i++) {
+        for (uint64_t bits = entry->leaders[i] & entry->visited[i]; bits; bits &= bits - 1) {
+            size_t slot = i * 64 + __builtin_ctzll(bits);
+            if (!add_block(worker, entry, page + slot * 4)) fail(worker->builder);
+        }
+    }
+}
+
+/* Each worker forms the blocks starting on its own pages */
+static void* form_main(void* arg) {
+    CFGWorker* worker = (CFGWorker*)arg;
+    worker->blocks = block_cache_create(INITIAL_BLOCK_COUNT);
+    if (!worker->blocks) {
+        fail(worker->builder);
+        return NULL;
+    }
+    block_cache_foreach(worker->pages, form_page_blocks, worker);
+    return NULL;
+}
+
+/* Runs entry on every worker, on the calling thread if there is only one */
+static void run_workers(CFGBuilder* builder, void* (*entry)(void*)) {
+    if (builder->worker_count == 1) {
+        entry(&builder->workers[0]);
+        return;
+    }
+
+    for (size_t i = 0; i < builder->worker_count; i++) {
+        CFGWorker* worker = &builder->workers[i];
+        worker->started = pthread_create(&worker->thread, NULL, entry, worker) == 0;
+        if (!worker->started) {
+            fail(builder);
+            finish(builder);
+            break;
+        }
+    }
+    for (size_t i = 0; i < builder->worker_count; i++) {
+        if (builder->workers[i].started) pthread_join(builder->workers[i].thread, NULL);
+        builder->workers[i].started = false;
+    }
+}
+
+static void free_value(uint64_t key, void* value, void* opaque) {
+    (void)key;
+    (void)opaque;
+    free(value);
+}
+
+static void destroy_builder(CFGBuilder* builder) {
+    for (size_t i = 0; i < builder->worker_count; i++) {
+        CFGWorker* worker = &builder->workers[i];
+        if (worker->pages) {
+            block_cache_foreach(worker->pages, free_value, NULL);
+            block_cache_destroy(worker->pages);
+        }
+        if (worker->blocks) {
+            block_cache_foreach(worker->blocks, free_value, NULL);
+            block_cache_destroy(worker->blocks);
+        }
+        if (worker->outboxes) {
+            for (size_t j = 0; j < builder->worker_count; j++) {
+                free(worker->outboxes[j].items);
+            }
+            free(worker->outboxes);
+        }
+        free(worker->inbox.items);
+        free(worker->batch.items);
+        free(worker->local.items);
+        pthread_mutex_destroy(&worker->lock);
+        pthread_cond_destroy(&worker->work_available);
+    }
+    free(builder->workers);
+    free(builder->pages);
+}
+
+ControlFlowGraph* cfg_build(Memory* memory, const uint64_t* roots, size_t root_count, size_t worker_count) {
+    if (!memory || (root_count && !roots)) return NULL;
+
+    CFGBuilder builder = { .memory = memory, .worker_count = worker_count ? worker_count : 1 };
+    builder.workers = (CFGWorker*)calloc(builder.worker_count, sizeof(CFGWorker));
+    if (!builder.workers) return NULL;
+
+    for (size_t i = 0; i < builder.worker_count; i++) {
+        CFGWorker* worker = &builder.workers[i];
+        worker->builder = &builder;
+        pthread_mutex_init(&worker->lock, NULL);
+        pthread_cond_init(&worker->work_available, NULL);
+        worker->pages = block_cache_create(INITIAL_PAGE_COUNT);
+        worker->outboxes = (CFGWorkList*)calloc(builder.worker_count, sizeof(CFGWorkList));
+        if (!worker->pages || !worker->outboxes) fail(&builder);
+    }
+    for (size_t i = 0; i < root_count && !builder.failed; i++) {
+        if (!work_list_push(&owner_of(&builder, roots[i])->inbox, roots[i], WORK_LEADER | WORK_FUNCTION)) {
+            fail(&builder);
+        }
+        builder.outstanding++;
+    }
+    if (builder.failed || !builder.outstanding) {
+        builder.done = true;
+    }
+
+    run_workers(&builder, worker_main);
+    if (!builder.failed && index_pages(&builder)) {
+        run_workers(&builder, form_main);
+    } else {
+        fail(&builder);
+    }
+
+    ControlFlowGraph* cfg = NULL;
+    if (!builder.failed) {
+        cfg = (ControlFlowGraph*)calloc(1, sizeof(ControlFlowGraph));
+        if (cfg) cfg->blocks = (BlockCache**)calloc(builder.worker_count, sizeof(BlockCache*));
+        if (cfg && cfg->blocks) {
+            /* The graph keeps the workers' tables, still split by page */
+            cfg->table_count = builder.worker_count;
+            for (size_t i = 0; i < builder.worker_count; i++) {
+                CFGWorker* worker = &builder.workers[i];
+                cfg->blocks[i] = worker->blocks;
+                cfg->edge_count += worker->edge_count;
+                cfg->instruction_count += worker->instruction_count;
+                worker->blocks = NULL;
+            }
+        } else if (cfg) {
+            free(cfg);
+            cfg = NULL;
+        }
+    }
+
+    destroy_builder(&builder);
+    return cfg;
+}
+
+void cfg_destroy(ControlFlowGraph* cfg) {
+    if (!cfg) return;
+    for (size_t i = 0; i < cfg->table_count; i++) {
+        block_cache_foreach(cfg->blocks[i], free_value, NULL);
+        block_cache_destroy(cfg->blocks[i]);
+    }
+    free(cfg->blocks);
+    free(cfg);
+}
+
+const CFGBlock* cfg_get_block(ControlFlowGraph* cfg, uint64_t address) {
+    if (!cfg || !cfg->table_count) return NULL;
+    return (const CFGBlock*)block_cache_lookup(cfg->blocks[(address / MEMORY_PAGE_SIZE) % cfg->table_count], address);
+}
+
+size_t cfg_block_count(const ControlFlowGraph* cfg) {
+    if (!cfg) return 0;
+    size_t count = 0;
+    for (size_t i = 0; i < cfg->table_count; i++) {
+        count += block_cache_count(cfg->blocks[i]);
+    }
+    return count;
+}
+
+void cfg_foreach_block(const ControlFlowGraph* cfg, BlockCacheVisitor visitor, void* opaque) {
+    if (!cfg || !visitor) return;
+    for (size_t i = 0; i < cfg->table_count; i++) {
+        block_cache_foreach(cfg->blocks[i], visitor, opaque);
+    }
+}
@@ -0,0 +1,104 @@
+#include "code_cache.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+CodeCache* code_cache_create(size_t budget) {
+    CodeCache* cache = (CodeCache*)calloc(1, sizeof(CodeCache));
+    if (!cache) return NULL;
+    cache->budget = budget;
+    return cache;
+}
+
+void code_cache_destroy(CodeCache* cache) {
+    /* The ring is threaded through the blocks, which the caller owns */
+    free(cache);
+}
+
+void code_cache_set_budget(CodeCache* cache, size_t budget) {
+    if (!cache) return;
+    cache->budget = budget;
+}
+
+void code_cache_insert(CodeCache* cache, JITBlock* block) {
+    if (!cache || !block || block->clock_next) return;
+
+    if (!cache->hand) {
+        block->clock_prev = block->clock_next = block;
+        cache->hand = block;
+    } else {
+        JITBlock* tail = cache->hand->clock_prev;
+        block->clock_prev = tail;
+        block->clock_next = cache->hand;
+        tail->clock_next = block;
+        cache->hand->clock_prev = block;
+    }
+
+    cache->used += block->code_size;
+    cache->count++;
+    cache->stats.insertions++;
+    if (cache->used > cache->stats.peak_bytes) {
+        cache->stats.peak_bytes = cache->used;
+    }
+}
+
+void code_cache_remove(CodeCache* cache, JITBlock* block) {
+    if (!cache || !block || !block->clock_next) return;
+
+    if (block->clock_next == block) {
+        cache->hand = NULL;
+    } else {
+        block->clock_prev->clock_next = block->clock_next;
+        block->clock_next->clock_prev = block->clock_prev;
+        if (cache->hand == block) cache->hand = block->clock_next;
+    }
+    block->clock_prev = block->clock_next = NULL;
+
+    cache->used -= block->code_size;
+    cache->count--;
+}
+
+bool code_cache_contains(const CodeCache* cache, const JITBlock* block) {
+    return cache && block && block->clock_next != NULL;
+}
+
+bool code_cache_needs_space(const CodeCache* cache, size_t size) {
+    if (!cache || cache->budget == 0 || cache->count == 0) return false;
+    return cache->used + size > cache->budget;
+}
+
+JITBlock* code_cache_evict(CodeCache* cache) {
+    if (!cache || !cache->hand) return NULL;
+
+    /* Terminates within two sweeps: the first clears every flag */
+    while (cache->hand->referenced) {
+        cache->hand->referenced = 0;
+        cache->hand = cache->hand->clock_next;
+    }
+
+    JITBlock* victim = cache->hand;
+    code_cache_remove(cache, victim);
+    cache->stats.evictions++;
+    cache->stats.evicted_bytes += victim->code_size;
+    return victim;
+}
+
+void code_cache_get_stats(const CodeCache* cache, CodeCacheStats* stats) {
+    if (!cache || !stats) return;
+    *stats = cache->stats;
+}
+
+void code_cache_print_stats(const CodeCache* cache) {
+    if (!cache) return;
+
+    const CodeCacheStats* stats = &cache->stats;
+    printf("Code Cache:\n");
+    if (cache->budget) {
+        printf("Used: %zu / %zu bytes in %zu blocks (peak %lu)\n",
+               cache->used, cache->budget, cache->count, stats->peak_bytes);
+    } else {
+        printf("Used: %zu bytes in %zu blocks (peak %lu, unlimited)\n",
+               cache->used, cache->count, stats->peak_bytes);
+    }
+    printf("Insertions: %lu  Evictions: %lu (%lu bytes)\n",
+           stats->insertions, stats->evictions, stats->evicted_bytes);
+}
@@ -0,0 +1,162 @@
+#include "code_scan.h"
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CODE_SCAN_X86
+#endif
+
+/* The branch encodings of a64_encodings.h. CBZ, CBNZ, TBZ and TBNZ share
+ * one pattern, and BR and BLR another; BR's fourth opc value is not a
+ * branch, so RET gets a pattern of its own.
+ */
+#define BRANCH_PATTERNS 5
+
+static const uint32_t branch_masks[BRANCH_PATTERNS] = {
+    0x7C000000,     /* B, BL */
+    0x7C000000,     /* CBZ, CBNZ, TBZ, TBNZ */
+    0xFF000010,     /* B.cond */
+    0xFFDFFC1F,     /* BR, BLR */
+    0xFFFFFC1F,     /* RET */
+};
+
+static const uint32_t branch_values[BRANCH_PATTERNS] = {
+    0x14000000,
+    0x34000000,
+    0x54000000,
+    0xD61F0000,
+    0xD65F0000,
+};
+
+static CodeScanLevel level_cap = CODE_SCAN_AVX2;
+
+static uint32_t load_word(const uint8_t* code, size_t index) {
+    uint32_t word;
+    memcpy(&word, code + index * 4, sizeof(word));
+    return word;
+}
+
+static bool is_branch(uint32_t word) {
+    for (int i = 0; i < BRANCH_PATTERNS; i++) {
+        if ((word & branch_masks[i]) == branch_values[i]) return true;
+    }
+    return false;
+}
+
+static void classify_scalar(const uint8_t* code, size_t start, size_t count, uint64_t* branches) {
+    for (size_t i = start; i < count; i++) {
+        if (is_branch(load_word(code, i))) branches[i / 64] |= 1ULL << (i % 64);
+    }
+}
+
+#ifdef CODE_SCAN_X86
+/* Both return how many words they classified; groups of 8 and 4 words
+ * never straddle a bitmap entry
+ */
+__attribute__((target("avx2")))
+static size_t classify_avx2(const uint8_t* code, size_t count, uint64_t* branches) {
+    __m256i masks[BRANCH_PATTERNS], values[BRANCH_PATTERNS];
+    for (int p = 0; p < BRANCH_PATTERNS; p++) {
+        masks[p] = _mm256_set1_epi32((int)branch_masks[p]);
+        values[p] = _mm256_set1_epi32((int)branch_values[p]);
+    }
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i words = _mm256_loadu_si256((const __m256i*)(code + i * 4));
+        __m256i hits = _mm256_setzero_si256();
+        for (int p = 0; p < BRANCH_PATTERNS; p++) {
+            hits = _mm256_or_si256(hits, _mm256_cmpeq_epi32(_mm256_and_si256(words, masks[p]), values[p]));
+        }
+        uint64_t bits = (uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(hits));
+        branches[i / 64] |= bits << (i % 64);
+    }
+    return i;
+}
+
+static size_t classify_sse2(const uint8_t* code, size_t count, uint64_t* branches) {
+    __m128i masks[BRANCH_PATTERNS], values[BRANCH_PATTERNS];
+    for (int p = 0; p < BRANCH_PATTERNS; p++) {
+        masks[p] = _mm_set1_epi32((int)branch_masks[p]);
+        values[p] = _mm_set1_epi32((int)branch_values[p]);
+    }
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i words = _mm_loadu_si128((const __m128i*)(code + i * 4));
+        __m128i hits = _mm_setzero_si128();
+        for (int p = 0; p < BRANCH_PATTERNS; p++) {
+            hits = _mm_or_si128(hits, _mm_cmpeq_epi32(_mm_and_si128(words, masks[p]), values[p]));
+        }
+        uint64_t bits = (uint32_t)_mm_movemask_ps(_mm_castsi128_ps(hits));
+        branches[i / 64] |= bits << (i % 64);
+    }
+    return i;
+}
+#endif
+
+CodeScanLevel code_scan_get_level(void) {
+#ifdef CODE_SCAN_X86
+    static int host = -1;
+    if (host < 0) {
+        __builtin_cpu_init();
+        host = __builtin_cpu_supports("avx2") ? CODE_SCAN_AVX2 : CODE_SCAN_SSE2;
+    }
+    return (CodeScanLevel)host < level_cap ? (CodeScanLevel)host : level_cap;
+#else
+    return CODE_SCAN_SCALAR;
+#endif
+}
+
+void code_scan_set_level(CodeScanLevel level) {
+    level_cap = level;
+}
+
+static int64_t sign_extend(uint32_t value, unsigned bits) {
+    uint32_t sign = 1U << (bits - 1);
+    return (int64_t)(value ^ sign) - sign;
+}
+
+/* Word offset of a direct branch's target; false for BR, BLR and RET */
+static bool branch_offset(uint32_t word, int64_t* offset) {
+    if ((word & 0x7C000000) == 0x14000000) {
+        *offset = sign_extend(word & 0x3FFFFFF, 26);
+    } else if ((word & 0x7E000000) == 0x34000000 || (word & 0xFF000010) == 0x54000000) {
+        *offset = sign_extend((word >> 5) & 0x7FFFF, 19);
+    } else if ((word & 0x7E000000) == 0x36000000) {
+        *offset = sign_extend((word >> 5) & 0x3FFF, 14);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void code_scan(const uint8_t* code, size_t count, uint64_t* branches, uint64_t* targets) {
+    if (!code || !branches) return;
+
+    size_t entries = (count + 63) / 64;
+    memset(branches, 0, entries * sizeof(uint64_t));
+    if (targets) memset(targets, 0, entries * sizeof(uint64_t));
+
+    size_t done = 0;
+#ifdef CODE_SCAN_X86
+    switch (code_scan_get_level()) {
+        case CODE_SCAN_AVX2: done = classify_avx2(code, count, branches); break;
+        case CODE_SCAN_SSE2: done = classify_sse2(code, count, branches); break;
+        default: break;
+    }
+#endif
+    classify_scalar(code, done, count, branches);
+    if (!targets) return;
+
+    /* Branches are sparse; decode only their offsets */
+    for (size_t e = 0; e < entries; e++) {
+        for (uint64_t bits = branches[e]; bits; bits &= bits - 1) {
+            size_t i = e * 64 + __builtin_ctzll(bits);
+            int64_t offset;
+            if (!branch_offset(load_word(code, i), &offset)) continue;
+            int64_t target = (int64_t)i + offset;
+            if (target >= 0 && (uint64_t)target < count) targets[target / 64] |= 1ULL << (target % 64);
+        }
+    }
+}
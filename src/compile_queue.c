@@ -0,0 +1,162 @@
+#include "compile_queue.h"
+#include <stdlib.h>
+
+static CompileJob* pop_job(CompileQueue* queue) {
+    CompileJob* job = queue->head;
+    if (!job) return NULL;
+    queue->head = job->next;
+    if (!queue->head) queue->tail = NULL;
+    job->next = NULL;
+    queue->pending--;
+    return job;
+}
+
+static void finish_job(CompileQueue* queue, CompileJob* job) {
+    /* Caller holds the lock; the release store publishes job->result */
+    __atomic_store_n(&job->done, true, __ATOMIC_RELEASE);
+    queue->completed++;
+    pthread_cond_broadcast(&queue->job_finished);
+}
+
+static void* worker_main(void* arg) {
+    CompileWorker* worker = (CompileWorker*)arg;
+    CompileQueue* queue = worker->queue;
+
+    pthread_mutex_lock(&queue->lock);
+    for (;;) {
+        while (!queue->head && !queue->shutting_down) {
+            pthread_cond_wait(&queue->work_available, &queue->lock);
+        }
+        if (queue->shutting_down) break;
+
+        CompileJob* job = pop_job(queue);
+        pthread_mutex_unlock(&queue->lock);
+
+        if (!__atomic_load_n(&job->cancelled, __ATOMIC_ACQUIRE)) {
+            jit_compiler_compile(worker->compiler, job->block, &job->result);
+        }
+
+        pthread_mutex_lock(&queue->lock);
+        finish_job(queue, job);
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return NULL;
+}
+
+CompileQueue* compile_queue_create(size_t worker_count, TranslationCache* cache,
+                                   LLVMMemoryBufferRef helpers) {
+    if (worker_count == 0) return NULL;
+
+    CompileQueue* queue = (CompileQueue*)calloc(1, sizeof(CompileQueue));
+    if (!queue) return NULL;
+
+    queue->workers = (CompileWorker*)calloc(worker_count, sizeof(CompileWorker));
+    if (!queue->workers) {
+        free(queue);
+        return NULL;
+    }
+    queue->worker_count = worker_count;
+    pthread_mutex_init(&queue->lock, NULL);
+    pthread_cond_init(&queue->work_available, NULL);
+    pthread_cond_init(&queue->job_finished, NULL);
+
+    for (size_t i = 0; i < worker_count; i++) {
+        CompileWorker* worker = &queue->workers[i];
+        worker->queue = queue;
+        worker->compiler = jit_compiler_create(cache);
+        if (worker->compiler && helpers) jit_compiler_load_helpers(worker->compiler, helpers);
+        if (!worker->compiler ||
+            pthread_create(&worker->thread, NULL, worker_main, worker) != 0) {
+            compile_queue_destroy(queue);
+            return NULL;
+        }
+        worker->started = true;
+    }
+
+    return queue;
+}
+
+void compile_queue_shutdown(CompileQueue* queue) {
+    if (!queue) return;
+
+    pthread_mutex_lock(&queue->lock);
+    queue->shutting_down = true;
+    CompileJob* job;
+    while ((job = pop_job(queue)) != NULL) {
+        job->cancelled = true;
+        finish_job(queue, job);
+    }
+    pthread_cond_broadcast(&queue->work_available);
+    pthread_mutex_unlock(&queue->lock);
+
+    for (size_t i = 0; i < queue->worker_count; i++) {
+        CompileWorker* worker = &queue->workers[i];
+        if (worker->started) pthread_join(worker->thread, NULL);
+        worker->started = false;
+    }
+}
+
+void compile_queue_destroy(CompileQueue* queue) {
+    if (!queue) return;
+
+    compile_queue_shutdown(queue);
+    for (size_t i = 0; i < queue->worker_count; i++) {
+        jit_compiler_destroy(queue->workers[i].compiler);
+    }
+
+    pthread_cond_destroy(&queue->job_finished);
+    pthread_cond_destroy(&queue->work_available);
+    pthread_mutex_destroy(&queue->lock);
+    free(queue->workers);
+    free(queue);
+}
+
+CompileJob* compile_queue_submit(CompileQueue* queue, JITBlock* block, bool urgent) {
+    if (!queue || !block) return NULL;
+
+    CompileJob* job = (CompileJob*)calloc(1, sizeof(CompileJob));
+    if (!job) return NULL;
+    job->block = block;
+
+    pthread_mutex_lock(&queue->lock);
+    if (!queue->head) {
+        queue->head = queue->tail = job;
+    } else if (urgent) {
+        job->next = queue->head;
+        queue->head = job;
+    } else {
+        queue->tail->next = job;
+        queue->tail = job;
+    }
+    queue->pending++;
+    queue->submitted++;
+    pthread_cond_signal(&queue->work_available);
+    pthread_mutex_unlock(&queue->lock);
+
+    return job;
+}
+
+bool compile_queue_is_done(const CompileJob* job) {
+    return job && __atomic_load_n(&job->done, __ATOMIC_ACQUIRE);
+}
+
+void compile_queue_wait(CompileQueue* queue, CompileJob* job) {
+    if (!queue || !job) return;
+
+    pthread_mutex_lock(&queue->lock);
+    while (!job->done) {
+        pthread_cond_wait(&queue->job_finished, &queue->lock);
+    }
+    pthread_mutex_unlock(&queue->lock);
+}
+
+void compile_queue_cancel(CompileJob* job) {
+    if (!job) return;
+    __atomic_store_n(&job->cancelled, true, __ATOMIC_RELEASE);
+}
+
+void compile_job_destroy(CompileJob* job) {
+    if (!job) return;
+    jit_compile_result_free(&job->result);
+    free(job);
+}
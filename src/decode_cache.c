@@ -0,0 +1,186 @@
+#include "decode_cache.h"
+#include "decoder.h"
+#include "code_scan.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define INITIAL_PAGE_COUNT 64
+
+DecodeCache* decode_cache_create(Memory* memory) {
+    if (!memory) return NULL;
+
+    DecodeCache* cache = (DecodeCache*)calloc(1, sizeof(DecodeCache));
+    if (!cache) return NULL;
+
+    cache->pages = block_cache_create(INITIAL_PAGE_COUNT);
+    if (!cache->pages) {
+        free(cache);
+        return NULL;
+    }
+    cache->memory = memory;
+    return cache;
+}
+
+static void free_page(uint64_t page, void* value, void* opaque) {
+    (void)page;
+    (void)opaque;
+    free(value);
+}
+
+void decode_cache_destroy(DecodeCache* cache) {
+    if (!cache) return;
+    block_cache_foreach(cache->pages, free_page, NULL);
+    block_cache_destroy(cache->pages);
+    free(cache);
+}
+
+/* Scans the page's executable words; anything else reads as zero, which
+ * is not a branch
+ */
+static void scan_page(DecodeCache* cache, DecodedPage* entry, uint64_t page) {
+    uint64_t page_end = page + MEMORY_PAGE_SIZE;
+    MemoryRegion* region = memory_find_region(cache->memory, page);
+    if (region && (region->permissions & PERM_EXEC) && region->start + region->size >= page_end) {
+        code_scan(region->data + (page - region->start), DECODE_PAGE_SLOTS, entry->branches, entry->targets);
+        return;
+    }
+
+    uint32_t words[DECODE_PAGE_SLOTS] = { 0 };
+    for (uint64_t address = page; address < page_end;) {
+        region = memory_find_region(cache->memory, address);
+        if (!region) {
+            address += 4;
+            continue;
+        }
+        uint64_t end = region->start + region->size < page_end ? region->start + region->size : page_end;
+        if (region->permissions & PERM_EXEC) {
+            memcpy((uint8_t*)words + (address - page), region->data + (address - region->start), end - address);
+        }
+        address = end;
+    }
+    code_scan((const uint8_t*)words, DECODE_PAGE_SLOTS, entry->branches, entry->targets);
+}
+
+static DecodedPage* get_page(DecodeCache* cache, uint64_t page) {
+    DecodedPage* entry = (DecodedPage*)block_cache_lookup(cache->pages, page);
+    if (entry) return entry;
+
+    /* Stores into the page must reach decode_cache_invalidate from now on */
+    if (!memory_mark_code(cache->memory, page, MEMORY_PAGE_SIZE)) return NULL;
+
+    entry = (DecodedPage*)calloc(1, sizeof(DecodedPage));
+    if (!entry) return NULL;
+    scan_page(cache, entry, page);
+    if (!block_cache_insert(cache->pages, page, entry)) {
+        free(entry);
+        return NULL;
+    }
+    return entry;
+}
+
+static void fill_slot(DecodeCache* cache, DecodedPage* entry, size_t slot, uint64_t pc) {
+    entry->state[slot] = DECODE_SLOT_INVALID;
+    cache->stats.decoded++;
+
+    MemoryRegion* region = memory_find_region(cache->memory, pc);
+    if (!region || !(region->permissions & PERM_EXEC)) return;
+
+    DecoderContext decoder = {
+        .pc = pc - region->start,
+        .code_buffer = region->data,
+        .buffer_size = region->size,
+    };
+    if (decoder_decode_next(&decoder, &entry->insts[slot]) == DECODER_SUCCESS) {
+        entry->state[slot] = DECODE_SLOT_VALID;
+    }
+}
+
+const Instruction* decode_cache_fetch(DecodeCache* cache, uint64_t pc) {
+    if (!cache || (pc & 3)) return NULL;
+
+    MemoryRegion* region = memory_find_region(cache->memory, pc);
+    if (!region || !(region->permissions & PERM_EXEC) || pc + 4 > region->start + region->size) {
+        return NULL;
+    }
+
+    DecodedPage* entry = get_page(cache, pc & ~(MEMORY_PAGE_SIZE - 1));
+    if (!entry) return NULL;
+
+    size_t slot = (pc & (MEMORY_PAGE_SIZE - 1)) / 4;
+    if (entry->state[slot] == DECODE_SLOT_EMPTY) {
+        fill_slot(cache, entry, slot, pc);
+    } else {
+        cache->stats.reused++;
+    }
+    return entry->state[slot] == DECODE_SLOT_VALID ? &entry->insts[slot] : NULL;
+}
+
+/* Slots from slot up to the page's next block boundary: through the next
+ * branch, or up to the next branch target. A target at slot itself only
+ * ends the run when the block did not start there. Sets ends if a
+ * boundary was found.
+ */
+static size_t run_length(const DecodedPage* entry, size_t slot, bool block_start, bool* ends) {
+    *ends = true;
+    for (size_t i = slot / 64; i < DECODE_PAGE_WORDS; i++) {
+        uint64_t branches = entry->branches[i];
+        uint64_t targets = entry->targets[i];
+        if (i == slot / 64) {
+            uint64_t from = ~0ULL << (slot % 64);
+            branches &= from;
+            targets &= block_start ? from << 1 : from;
+        }
+        if (!branches && !targets) continue;
+
+        size_t branch = branches ? (size_t)__builtin_ctzll(branches) + 1 : 65;
+        size_t target = targets ? (size_t)__builtin_ctzll(targets) : 65;
+        return i * 64 + (branch <= target ? branch : target) - slot;
+    }
+    *ends = false;
+    return DECODE_PAGE_SLOTS - slot;
+}
+
+size_t decode_cache_fetch_block(DecodeCache* cache, uint64_t pc, Instruction* insts, size_t max_count) {
+    if (!insts) return 0;
+
+    size_t count = 0;
+    bool ends = false;
+    while (count < max_count && !ends) {
+        uint64_t start = pc + count * 4;
+        const Instruction* inst = decode_cache_fetch(cache, start);
+        if (!inst) break;
+
+        DecodedPage* entry = (DecodedPage*)block_cache_lookup(cache->pages, start & ~(MEMORY_PAGE_SIZE - 1));
+        size_t run = run_length(entry, (start & (MEMORY_PAGE_SIZE - 1)) / 4, count == 0, &ends);
+        for (size_t i = 0; i < run && count < max_count; i++) {
+            if (i > 0 && !(inst = decode_cache_fetch(cache, start + i * 4))) return count;
+            insts[count++] = *inst;
+        }
+    }
+    return count;
+}
+
+void decode_cache_invalidate(DecodeCache* cache, uint64_t address, uint64_t size) {
+    if (!cache || !size) return;
+
+    uint64_t page = address & ~(MEMORY_PAGE_SIZE - 1);
+    for (; page < address + size; page += MEMORY_PAGE_SIZE) {
+        DecodedPage* entry = (DecodedPage*)block_cache_remove(cache->pages, page);
+        if (!entry) continue;
+        free(entry);
+        cache->stats.invalidations++;
+    }
+}
+
+bool decode_cache_contains(DecodeCache* cache, uint64_t page) {
+    return cache && block_cache_lookup(cache->pages, page) != NULL;
+}
+
+size_t decode_cache_page_count(const DecodeCache* cache) {
+    return cache ? block_cache_count(cache->pages) : 0;
+}
+
+void decode_cache_get_stats(const DecodeCache* cache, DecodeCacheStats* stats) {
+    if (!cache || !stats) return;
+    *stats = cache->stats;
+}
@@ -1,218 +1,951 @@
-#include "decoder.h"
-#include <stdlib.h>
-#include <string.h>
-
-#define MASK_BITS(low, high) ((((1ULL << ((high) - (low) + 1)) - 1)) << (low))
-#define EXTRACT_BITS(value, start, length) ((value >> start) & ((1ULL << length) - 1))
-
-#define CLASS_DATA_PROCESSING_IMM   0x11000000
-#define CLASS_BRANCHES              0x14000000
-#define CLASS_LOADS_STORES          0x08000000
-#define CLASS_DATA_PROCESSING_REG   0x0A000000
-#define CLASS_FP_AND_SIMD          0x04000000
-
-DecoderContext* decoder_create(const uint8_t* code, size_t size) {
-    if (!code) return NULL;
-    DecoderContext* ctx = (DecoderContext*)calloc(1, sizeof(DecoderContext));
-    if (!ctx) return NULL;
-    ctx->code_buffer = code;
-    ctx->buffer_size = size;
-    ctx->pc = 0;
-    ctx->is_thumb_mode = false;
-    return ctx;
-}
-
-void decoder_destroy(DecoderContext* context) {
-    if (!context) return;
-    
-    /* Note: code_buffer is const and not owned by the decoder,
-     * so we don't free it. If any dynamically allocated members
-     * are added to DecoderContext in the future, free them here
-     * before freeing the context itself.
-     */
-    
-    free(context);
-    /* Context is freed and should not be used after this point :) */
-}
-
-uint32_t decoder_extract_bits(uint32_t instruction, uint8_t start, uint8_t length) {
-    return EXTRACT_BITS(instruction, start, length);
-}
-
-static DecoderError decode_data_processing_immediate(uint32_t inst, Instruction* decoded) {
-    if (!decoded) return DECODER_ERROR_NULL_PARAM;
-    
-    uint32_t op0 = decoder_extract_bits(inst, 23, 3);
-    uint32_t op1 = decoder_extract_bits(inst, 30, 2);
-    
-    decoded->type = INST_ARITHMETIC;
-    decoded->dest_reg = decoder_extract_bits(inst, 0, 5);
-    
-    if (op0 == 0x2) {
-        decoded->opcode = (op1 & 1) ? 0x01 : 0x00;
-        decoded->sets_flags = (op1 & 2) != 0;
-        
-        Operand imm_op = {
-            .type = OP_IMMEDIATE,
-            .value.immediate = decoder_extract_bits(inst, 10, 12)
-        };
-        instruction_set_operand(decoded, 0, imm_op);
-        
-        Operand reg_op = {
-            .type = OP_REGISTER,
-            .value.reg = decoder_extract_bits(inst, 5, 5)
-        };
-        instruction_set_operand(decoded, 1, reg_op);
-        return DECODER_SUCCESS;
-    }
-    return DECODER_ERROR_INVALID_INSTRUCTION;
-}
-
-static DecoderError decode_branches(uint32_t inst, Instruction* decoded) {
-    uint32_t op0 = decoder_extract_bits(inst, 29, 3);
-    decoded->type = INST_BRANCH;
-    
-    if (op0 == 0x0 || op0 == 0x4) {
-        decoded->opcode = (op0 == 0x4) ? 0x25 : 0x20;
-        int32_t imm26 = decoder_extract_bits(inst, 0, 26);
-        if (imm26 & (1 << 25)) {
-            imm26 |= ~((1 << 26) - 1);
-        }
-        Operand target = {
-            .type = OP_IMMEDIATE,
-            .value.immediate = imm26 << 2
-        };
-        instruction_set_operand(decoded, 0, target);
-        return DECODER_SUCCESS;
-    }
-    
-    if (op0 == 0x2) {
-        decoded->opcode = 0x22;
-        decoded->condition = decoder_extract_bits(inst, 0, 4);
-        int32_t imm19 = decoder_extract_bits(inst, 5, 19);
-        if (imm19 & (1 << 18)) {
-            imm19 |= ~((1 << 19) - 1);
-        }
-        Operand target = {
-            .type = OP_IMMEDIATE,
-            .value.immediate = imm19 << 2
-        };
-        instruction_set_operand(decoded, 0, target);
-        return DECODER_SUCCESS;
-    }
-    return DECODER_ERROR_INVALID_INSTRUCTION;
-}
-
-static DecoderError decode_loads_stores(uint32_t inst, Instruction* decoded) {
-    uint32_t size = decoder_extract_bits(inst, 30, 2);
-    uint32_t op = decoder_extract_bits(inst, 22, 2);
-    decoded->type = INST_LOAD_STORE;
-    decoded->dest_reg = decoder_extract_bits(inst, 0, 5);
-    
-    if ((inst & 0x3B000000) == 0x39000000) {
-        decoded->opcode = (op & 1) ? 0x40 : 0x41;
-        Operand mem = {
-            .type = OP_MEMORY,
-            .value = {
-                .mem = {
-                    .base_reg = decoder_extract_bits(inst, 5, 5),
-                    .offset = decoder_extract_bits(inst, 12, 9) << size,
-                    .index_reg = 0xFF,
-                    .shift_amount = 0
-                }
-            }
-        };
-        instruction_set_operand(decoded, 0, mem);
-        return DECODER_SUCCESS;
-    }
-    return DECODER_ERROR_INVALID_INSTRUCTION;
-}
-
-DecoderError decoder_decode_next(DecoderContext* context, Instruction* inst) {
-    if (!context || !inst) return DECODER_ERROR_NULL_PARAM;
-    if (context->pc >= context->buffer_size) return DECODER_ERROR_BUFFER_OVERFLOW;
-    
-    uint32_t raw_inst;
-    memcpy(&raw_inst, context->code_buffer + context->pc, sizeof(raw_inst));
-    instruction_init(inst);
-    inst->raw = raw_inst;
-    DecoderError result = DECODER_ERROR_INVALID_INSTRUCTION;
-    
-    if ((raw_inst & 0x1F000000) == CLASS_DATA_PROCESSING_IMM) {
-        result = decode_data_processing_immediate(raw_inst, inst);
-    } else if ((raw_inst & 0x1C000000) == CLASS_BRANCHES) {
-        result = decode_branches(raw_inst, inst);
-    } else if ((raw_inst & 0x0A000000) == CLASS_LOADS_STORES) {
-        result = decode_loads_stores(raw_inst, inst);
-    }
-    
-    if (result == DECODER_SUCCESS) {
-        context->pc += 4;
-    }
-    return result;
-}
-
-DecoderError decoder_decode_at(DecoderContext* context, uint64_t address, Instruction* inst) {
-    if (!context || !inst) return DECODER_ERROR_NULL_PARAM;
-    if (address >= context->buffer_size) return DECODER_ERROR_INVALID_ADDRESS;
-    
-    uint64_t old_pc = context->pc;
-    context->pc = address;
-    DecoderError result = decoder_decode_next(context, inst);
-    context->pc = old_pc;
-    return result;
-}
-
-DecoderError decoder_decode_block(DecoderContext* context, Instruction* insts, size_t max_count, size_t* decoded_count) {
-    if (!context || !insts || !decoded_count) return DECODER_ERROR_NULL_PARAM;
-    if (!max_count) return DECODER_SUCCESS;
-    
-    *decoded_count = 0;
-    DecoderError result;
-    
-    while (*decoded_count < max_count) {
-        result = decoder_decode_next(context, &insts[*decoded_count]);
-        if (result != DECODER_SUCCESS) {
-            return (*decoded_count > 0) ? DECODER_SUCCESS : result;
-        }
-        (*decoded_count)++;
-        if (instruction_is_branch(&insts[*decoded_count - 1])) {
-            break;
-        }
-    }
-    return DECODER_SUCCESS;
-}
-
-bool decoder_is_valid_instruction(uint32_t raw_instruction) {
-    if ((raw_instruction & 0x1F000000) == CLASS_DATA_PROCESSING_IMM) return true;
-    if ((raw_instruction & 0x1C000000) == CLASS_BRANCHES) return true;
-    if ((raw_instruction & 0x0A000000) == CLASS_LOADS_STORES) return true;
-    if ((raw_instruction & 0x0F000000) == CLASS_DATA_PROCESSING_REG) return true;
-    if ((raw_instruction & 0x0F000000) == CLASS_FP_AND_SIMD) return true;
-    return false;
-}
-
-bool decoder_can_fallthrough(const Instruction* inst) {
-    if (!inst) return false;
-    if (inst->type == INST_BRANCH) {
-        return inst->condition != 0xF;
-    }
-    return true;
-}
-
-DecoderError decoder_get_next_pc(const DecoderContext* context, const Instruction* inst, uint64_t* next_pc) {
-    if (!context || !inst || !next_pc) return DECODER_ERROR_NULL_PARAM;
-    
-    if (!instruction_is_branch(inst)) {
-        *next_pc = context->pc + 4;
-        return DECODER_SUCCESS;
-    }
-    
-    uint64_t target = instruction_get_branch_target(inst, context->pc);
-    if (target == 0) {
-        *next_pc = context->pc + 4;
-    } else {
-        *next_pc = target;
-    }
-    return DECODER_SUCCESS;
+#include "decoder.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define EXTRACT_BITS(value, start, length) ((value >> start) & ((1ULL << length) - 1))
+
+DecoderContext* decoder_create(const uint8_t* code, size_t size) {
+    if (!code) return NULL;
+    DecoderContext* ctx = (DecoderContext*)calloc(1, sizeof(DecoderContext));
+    if (!ctx) return NULL;
+    ctx->code_buffer = code;
+    ctx->buffer_size = size;
+    ctx->pc = 0;
+    ctx->is_thumb_mode = false;
+    return ctx;
+}
+
+void decoder_destroy(DecoderContext* context) {
+    if (!context) return;
+    
+    /* Note: code_buffer is const and not owned by the decoder,
+     * so we don't free it. If any dynamically allocated members
+     * are added to DecoderContext in the future, free them here
+     * before freeing the context itself.
+     */
+    
+    free(context);
+    /* Context is freed and should not be used after this point :) */
+}
+
+uint32_t decoder_extract_bits(uint32_t instruction, uint8_t start, uint8_t length) {
+    return EXTRACT_BITS(instruction, start, length);
+}
+
+static int64_t sign_extend(uint64_t value, unsigned bits) {
+    uint64_t sign = 1ULL << (bits - 1);
+    return (int64_t)((value ^ sign) - sign);
+}
+
+static void set_register_operand(Instruction* decoded, uint8_t index, uint32_t inst, uint8_t start) {
+    Operand reg = { .type = OP_REGISTER, .value.reg = decoder_extract_bits(inst, start, 5) };
+    instruction_set_operand(decoded, index, reg);
+}
+
+static void set_immediate_operand(Instruction* decoded, uint8_t index, uint64_t value) {
+    Operand imm = { .type = OP_IMMEDIATE, .value.immediate = value };
+    instruction_set_operand(decoded, index, imm);
+}
+
+static void set_shift_operand(Instruction* decoded, uint8_t index, OperandType type,
+                              uint8_t shift, uint8_t amount) {
+    Operand op = { .type = type, .value.shift = { .type = shift, .amount = amount } };
+    instruction_set_operand(decoded, index, op);
+}
+
+static void set_memory_operand(Instruction* decoded, uint8_t base, int32_t offset, AddressingMode mode) {
+    Operand mem = {
+        .type = OP_MEMORY,
+        .value.mem = {
+            .base_reg = mode == ADDR_LITERAL ? 0xFF : base,
+            .offset = offset,
+            .index_reg = 0xFF,
+            .mode = mode
+        }
+    };
+    instruction_set_operand(decoded, 0, mem);
+}
+
+/* [base, index, extend #amount], or [base], index when post-indexed */
+static void set_indexed_operand(Instruction* decoded, uint8_t base, uint8_t index, uint8_t extend,
+                                uint8_t amount, AddressingMode mode) {
+    Operand mem = {
+        .type = OP_MEMORY,
+        .value.mem = {
+            .base_reg = base,
+            .index_reg = index,
+            .shift_amount = amount,
+            .extend = extend,
+            .mode = mode
+        }
+    };
+    instruction_set_operand(decoded, 0, mem);
+}
+
+/* Hints, barriers and prefetches change nothing the JIT models */
+static DecoderError decode_nop(Instruction* decoded) {
+    decoded->type = INST_SYSTEM;
+    decoded->opcode = 0x80;
+    decoded->dest_reg = 0xFF;
+    return DECODER_SUCCESS;
+}
+
+/* Data processing, immediate */
+
+static DecoderError decode_pc_relative(uint32_t inst, Instruction* decoded) {
+    bool page = decoder_extract_bits(inst, 31, 1);
+    uint64_t imm = decoder_extract_bits(inst, 5, 19) << 2 | decoder_extract_bits(inst, 29, 2);
+    decoded->type = INST_MOVE;
+    decoded->opcode = page ? 0x34 : 0x33;
+    decoded->dest_reg = decoder_extract_bits(inst, 0, 5);
+    set_immediate_operand(decoded, 0, (uint64_t)(sign_extend(imm, 21) * (page ? 4096 : 1)));
+    return DECODER_SUCCESS;
+}
+
+static DecoderError decode_add_sub_immediate(uint32_t inst, Instruction* decoded) {
+    decoded->type = INST_ARITHMETIC;
+    decoded->dest_reg = decoder_extract_bits(inst, 0, 5);
+    decoded->opcode = decoder_extract_bits(inst, 30, 1) ? 0x01 : 0x00;
+    decoded->sets_flags = decoder_extract_bits(inst, 29, 1) != 0;
+    uint32_t shift = decoder_extract_bits(inst, 22, 1) ? 12 : 0;
+
+    set_register_operand(decoded, 0, inst, 5);
+    set_immediate_operand(decoded, 1, (uint64_t)decoder_extract_bits(inst, 10, 12) << shift);
+    return DECODER_SUCCESS;
+}
+
+static DecoderError decode_logical_immediate(uint32_t inst, Instruction* decoded) {
+    static const uint8_t opcodes[4] = { 0x10, 0x11, 0x12, 0x10 };   /* AND, ORR, EOR, ANDS */
+    uint32_t opc = decoder_extract_bits(inst, 29, 2);
+    uint64_t imm;
+    if (!instruction_decode_bit_mask(decoder_extract_bits(inst, 22, 1), decoder_extract_bits(inst, 10, 6),
+                         decoder_extract_bits(inst, 16, 6), decoder_extract_bits(inst, 31, 1), &imm)) {
+        return DECODER_ERROR_INVALID_INSTRUCTION;
+    }
+    decoded->type = INST_LOGICAL;
+    decoded->opcode = opcodes[opc];
+    decoded->sets_flags = opc == 3;
+    decoded->dest_reg = decoder_extract_bits(inst, 0, 5);
+    set_register_operand(decoded, 0, inst, 5);
+    set_immediate_operand(decoded, 1, imm);
+    return DECODER_SUCCESS;
+}
+
+/* MOVZ and MOVN carry the value they write; MOVK the shifted immediate
+ * and the shift
+ */
+static DecoderError decode_move_wide(uint32_t inst, Instruction* decoded) {
+    uint32_t opc = decoder_extract_bits(inst, 29, 2);
+    uint32_t hw = decoder_extract_bits(inst, 21, 2);
+    if (opc == 1 || (!decoder_extract_bits(inst, 31, 1) && hw > 1)) return DECODER_ERROR_INVALID_INSTRUCTION;
+
+    uint64_t imm = (uint64_t)decoder_extract_bits(inst, 5, 16) << (hw * 16);
+    decoded->type = INST_MOVE;
+    decoded->dest_reg = decoder_extract_bits(inst, 0, 5);
+    switch (opc) {
+        case 0:
+            decoded->opcode = 0x31;
+            set_immediate_operand(decoded, 0, ~imm);
+            break;
+        case 2:
+            decoded->opcode = 0x30;
+            set_immediate_operand(decoded, 0, imm);
+            break;
+        default:
+            decoded->opcode = 0x32;
+            set_immediate_operand(decoded, 0, imm);
+            set_immediate_operand(decoded, 1, hw * 16);
+            break;
+    }
+    return DECODER_SUCCESS;
+}
+
+static DecoderError decode_bitfield(uint32_t inst, Instruction* decoded) {
+    bool sf = decoder_extract_bits(inst, 31, 1);
+    uint32_t opc = decoder_extract_bits(inst, 29, 2);
+    uint32_t immr = decoder_extract_bits(inst, 16, 6);
+    uint32_t imms = decoder_extract_bits(inst, 10, 6);
+    if (opc == 3 || decoder_extract_bits(inst, 22, 1) != sf) return DECODER_ERROR_INVALID_INSTRUCTION;
+    if (!sf && (immr > 31 || imms > 31)) return DECODER_ERROR_INVALID_INSTRUCTION;
+
+    decoded->type = INST_LOGICAL;
+    decoded->opcode = 0x1A + opc;
+    decoded->dest_reg = decoder_extract_bits(inst, 0, 5);
+    set_register_operand(decoded, 0, inst, 5);
+    set_immediate_operand(decoded, 1, immr);
+    set_immediate_operand(decoded, 2, imms);
+    return DECODER_SUCCESS;
+}
+
+static DecoderError decode_extract(uint32_t inst, Instruction* decoded) {
+    bool sf = decoder_extract_bits(inst, 31, 1);
+    uint32_t lsb = decoder_extract_bits(inst, 10, 6);
+    if (decoder_extract_bits(inst, 22, 1) != sf || (!sf && lsb > 31)) return DECODER_ERROR_INVALID_INSTRUCTION;
+
+    decoded->type = INST_LOGICAL;
+    decoded->opcode = 0x1D;
+    decoded->dest_reg = decoder_extract_bits(inst, 0, 5);
+    set_register_operand(decoded, 0, inst, 5);
+    set_register_operand(decoded, 1, inst, 16);
+    set_immediate_operand(decoded, 2, lsb);
+    return DECODER_SUCCESS;
+}
+
+/* Branches and system */
+
+static DecoderError decode_branch_immediate(uint32_t inst, Instruction* decoded) {
+    decoded->type = INST_BRANCH;
+    decoded->opcode = decoder_extract_bits(inst, 31, 1) ? 0x25 : 0x20;
+    set_immediate_operand(decoded, 0, (uint64_t)(sign_extend(decoder_extract_bits(inst, 0, 26), 26) * 4));
+    return DECODER_SUCCESS;
+}
+
+/* CBZ and CBNZ test operand 1; the width is the sf bit */
+static DecoderError decode_compare_branch(uint32_t inst, Instruction* decoded) {
+    decoded->type = INST_BRANCH;
+    decoded->opcode = decoder_extract_bits(inst, 24, 1) ? 0x28 : 0x27;
+    set_immediate_operand(decoded, 0, (uint64_t)(sign_extend(decoder_extract_bits(inst, 5, 19), 19) * 4));
+    set_register_operand(decoded, 1, inst, 0);
+    return DECODER_SUCCESS;
+}
+
+/* TBZ and TBNZ test bit operand 2 of operand 1 */
+static DecoderError decode_test_branch(uint32_t inst, Instruction* decoded) {
+    decoded->type = INST_BRANCH;
+    decoded->opcode = decoder_extract_bits(inst, 24, 1) ? 0x2A : 0x29;
+    set_immediate_operand(decoded, 0, (uint64_t)(sign_extend(decoder_extract_bits(inst, 5, 14), 14) * 4));
+    set_register_operand(decoded, 1, inst, 0);
+    set_immediate_operand(decoded, 2, decoder_extract_bits(inst, 31, 1) << 5 | decoder_extract_bits(inst, 19, 5));
+    return DECODER_SUCCESS;
+}
+
+static DecoderError decode_conditional_branch(uint32_t inst, Instruction* decoded) {
+    decoded->type = INST_BRANCH;
+    decoded->opcode = 0x22;
+    decoded->condition = decoder_extract_bits(inst, 0, 4);
+    set_immediate_operand(decoded, 0, (uint64_t)(sign_extend(decoder_extract_bits(inst, 5, 19), 19) * 4));
+    return DECODER_SUCCESS;
+}
+
+/* BR, BLR, RET: unconditional branch (register) without pointer auth */
+static DecoderError decode_branch_register(uint32_t inst, Instruction* decoded) {
+    uint32_t opc = decoder_extract_bits(inst, 21, 2);
+    if (opc == 0x3) return DECODER_ERROR_INVALID_INSTRUCTION;
+    decoded->type = INST_BRANCH;
+    decoded->opcode = opc == 0x0 ? 0x23 : (opc == 0x1 ? 0x26 : 0x24);
+    set_register_operand(decoded, 0, inst, 5);
+    return DECODER_SUCCESS;
+}
+
+/* Every hint, pointer authentication and BTI included, may execute as a NOP */
+static DecoderError decode_hint(uint32_t inst, Instruction* decoded) {
+    (void)inst;
+    return decode_nop(decoded);
+}
+
+/* A single guest thread needs no ordering, and nothing models the
+ * exclusive monitor CLREX clears
+ */
+static DecoderError decode_barrier(uint32_t inst, Instruction* decoded) {
+    switch (decoder_extract_bits(inst, 5, 3)) {
+        case 2: case 4: case 5: case 6:
+            return decode_nop(decoded);
+        case 7:
+            if (decoder_extract_bits(inst, 8, 4)) return DECODER_ERROR_INVALID_INSTRUCTION;
+            return decode_nop(decoded);
+        default:
+            return DECODER_ERROR_INVALID_INSTRUCTION;
+    }
+}
+
+/* MRS and MSR of NZCV, FPCR and FPSR */
+static DecoderError decode_system_register(uint32_t inst, Instruction* decoded) {
+    uint32_t sysreg = decoder_extract_bits(inst, 5, 15);
+    if (sysreg != SYSREG_NZCV && sysreg != SYSREG_FPCR && sysreg != SYSREG_FPSR) {
+        return DECODER_ERROR_INVALID_INSTRUCTION;
+    }
+    decoded->type = INST_SYSTEM;
+    if (decoder_extract_bits(inst, 21, 1)) {
+        decoded->opcode = 0x81;
+        decoded->dest_reg = decoder_extract_bits(inst, 0, 5);
+        set_immediate_operand(decoded, 0, sysreg);
+    } else {
+        decoded->opcode = 0x82;
+        decoded->dest_reg = 0xFF;
+        decoded->sets_flags = sysreg == SYSREG_NZCV;
+        set_register_operand(decoded, 0, inst, 0);
+        set_immediate_operand(decoded, 1, sysreg);
+    }
+    return DECODER_SUCCESS;
+}
+
+/* Loads and stores */
+
+static uint8_t log2_size(uint8_t size) {
+    uint8_t shift = 0;
+    while ((1U << shift) < size) shift++;
+    return shift;
+}
+
+/* Opcode and access size of a single register load or store from size,
+ * V and opc. PRFM comes back as a NOP.
+ */
+static DecoderError decode_transfer(uint32_t inst, Instruction* decoded) {
+    uint32_t size = decoder_extract_bits(inst, 30, 2);
+    uint32_t opc = decoder_extract_bits(inst, 22, 2);
+    decoded->type = INST_LOAD_STORE;
+    decoded->dest_reg = decoder_extract_bits(inst, 0, 5);
+    instruction_set_element_size(decoded, 1 << size);
+
+    /* B, H, S, D or Q register; opc<1> selects Q */
+    if (decoder_extract_bits(inst, 26, 1)) {
+        if (opc & 2) {
+            if (size) return DECODER_ERROR_INVALID_INSTRUCTION;
+            instruction_set_element_size(decoded, 16);
+        }
+        decoded->opcode = (opc & 1) ? 0x42 : 0x43;
+        return DECODER_SUCCESS;
+    }
+
+    switch (opc) {
+        case 0: decoded->opcode = 0x41; break;
+        case 1: decoded->opcode = 0x40; break;
+        case 2:
+            if (size == 3) return decode_nop(decoded);
+            decoded->opcode = 0x46;                 /* LDRSB, LDRSH, LDRSW into X */
+            break;
+        default:
+            if (size > 1) return DECODER_ERROR_INVALID_INSTRUCTION;
+            decoded->opcode = 0x47;                 /* LDRSB, LDRSH into W */
+            break;
+    }
+    return DECODER_SUCCESS;
+}
+
+static DecoderError decode_load_literal(uint32_t inst, Instruction* decoded) {
+    uint32_t opc = decoder_extract_bits(inst, 30, 2);
+    int64_t offset = sign_extend(decoder_extract_bits(inst, 5, 19), 19) * 4;
+    decoded->type = INST_LOAD_STORE;
+    decoded->dest_reg = decoder_extract_bits(inst, 0, 5);
+
+    if (decoder_extract_bits(inst, 26, 1)) {
+        if (opc == 3) return DECODER_ERROR_INVALID_INSTRUCTION;
+        decoded->opcode = 0x42;
+        instruction_set_element_size(decoded, 4 << opc);
+    } else {
+        static const uint8_t opcodes[3] = { 0x40, 0x40, 0x46 };    /* LDR W, LDR X, LDRSW */
+        if (opc == 3) return decode_nop(decoded);
+        decoded->opcode = opcodes[opc];
+        instruction_set_element_size(decoded, opc == 1 ? 8 : 4);
+    }
+    set_memory_operand(decoded, 0, (int32_t)offset, ADDR_LITERAL);
+    return DECODER_SUCCESS;
+}
+
+/* LDXR and STXR, with or without acquire and release, and LDAR and STLR.
+ * With one guest thread an exclusive store always succeeds; STXR's status
+ * register is operand 1.
+ */
+static DecoderError decode_load_store_exclusive(uint32_t inst, Instruction* decoded) {
+    bool ordered = decoder_extract_bits(inst, 23, 1);
+    bool load = decoder_extract_bits(inst, 22, 1);
+    if (decoder_extract_bits(inst, 21, 1)) return DECODER_ERROR_INVALID_INSTRUCTION;
+
+    decoded->type = INST_LOAD_STORE;
+    decoded->dest_reg = decoder_extract_bits(inst, 0, 5);
+    instruction_set_element_size(decoded, 1 << decoder_extract_bits(inst, 30, 2));
+    if (ordered) {
+        decoded->opcode = load ? 0x40 : 0x41;
+    } else {
+        decoded->opcode = load ? 0x4D : 0x4E;
+    }
+    set_memory_operand(decoded, decoder_extract_bits(inst, 5, 5), 0, ADDR_OFFSET);
+    if (decoded->opcode == 0x4E) set_register_operand(decoded, 1, inst, 16);
+    return DECODER_SUCCESS;
+}
+
+/* LDP, STP and LDPSW; the second register is operand 1 */
+static DecoderError decode_load_store_pair(uint32_t inst, Instruction* decoded) {
+    static const AddressingMode modes[4] = { ADDR_OFFSET, ADDR_POST_INDEX, ADDR_OFFSET, ADDR_PRE_INDEX };
+    uint32_t opc = decoder_extract_bits(inst, 30, 2);
+    uint32_t index = decoder_extract_bits(inst, 23, 2);
+    bool load = decoder_extract_bits(inst, 22, 1);
+    if (opc == 3) return DECODER_ERROR_INVALID_INSTRUCTION;
+
+    decoded->type = INST_LOAD_STORE;
+    decoded->dest_reg = decoder_extract_bits(inst, 0, 5);
+    if (decoder_extract_bits(inst, 26, 1)) {
+        decoded->opcode = load ? 0x4B : 0x4C;
+        instruction_set_element_size(decoded, 4 << opc);
+    } else if (opc == 1) {
+        /* LDPSW; the store form is STGP, and there is no non-temporal one */
+        if (!load || index == 0) return DECODER_ERROR_INVALID_INSTRUCTION;
+        decoded->opcode = 0x4A;
+        instruction_set_element_size(decoded, 4);
+    } else {
+        decoded->opcode = load ? 0x48 : 0x49;
+        instruction_set_element_size(decoded, opc ? 8 : 4);
+    }
+
+    int64_t offset = sign_extend(decoder_extract_bits(inst, 15, 7), 7) * instruction_get_element_size(decoded);
+    set_memory_operand(decoded, decoder_extract_bits(inst, 5, 5), (int32_t)offset, modes[index]);
+    set_register_operand(decoded, 1, inst, 10);
+    return DECODER_SUCCESS;
+}
+
+/* Unscaled (LDUR, STUR), unprivileged (LDTR, STTR), pre- and post-indexed */
+static DecoderError decode_load_store_immediate(uint32_t inst, Instruction* decoded) {
+    static const AddressingMode modes[4] = { ADDR_OFFSET, ADDR_POST_INDEX, ADDR_OFFSET, ADDR_PRE_INDEX };
+    uint32_t index = decoder_extract_bits(inst, 10, 2);
+    if (index == 2 && decoder_extract_bits(inst, 26, 1)) return DECODER_ERROR_INVALID_INSTRUCTION;
+
+    DecoderError result = decode_transfer(inst, decoded);
+    if (result != DECODER_SUCCESS) return result;
+    /* Only the unscaled form has a prefetch, PRFUM */
+    if (decoded->type == INST_SYSTEM) return index == 0 ? DECODER_SUCCESS : DECODER_ERROR_INVALID_INSTRUCTION;
+
+    int64_t offset = sign_extend(decoder_extract_bits(inst, 12, 9), 9);
+    set_memory_operand(decoded, decoder_extract_bits(inst, 5, 5), (int32_t)offset, modes[index]);
+    return DECODER_SUCCESS;
+}
+
+/* [Xn, Wm|Xm, extend #amount]; the amount is 0 or the access size's log2 */
+static DecoderError decode_load_store_register(uint32_t inst, Instruction* decoded) {
+    uint32_t option = decoder_extract_bits(inst, 13, 3);
+    if (!(option & 2)) return DECODER_ERROR_INVALID_INSTRUCTION;
+
+    DecoderError result = decode_transfer(inst, decoded);
+    if (result != DECODER_SUCCESS || decoded->type == INST_SYSTEM) return result;
+
+    uint8_t amount = decoder_extract_bits(inst, 12, 1) ? log2_size(instruction_get_element_size(decoded)) : 0;
+    set_indexed_operand(decoded, decoder_extract_bits(inst, 5, 5), decoder_extract_bits(inst, 16, 5),
+                        option, amount, ADDR_OFFSET);
+    return DECODER_SUCCESS;
+}
+
+static DecoderError decode_load_store_unsigned(uint32_t inst, Instruction* decoded) {
+    DecoderError result = decode_transfer(inst, decoded);
+    if (result != DECODER_SUCCESS || decoded->type == INST_SYSTEM) return result;
+
+    uint32_t offset = decoder_extract_bits(inst, 10, 12) << log2_size(instruction_get_element_size(decoded));
+    set_memory_operand(decoded, decoder_extract_bits(inst, 5, 5), (int32_t)offset, ADDR_OFFSET);
+    return DECODER_SUCCESS;
+}
+
+/* LD1/ST1 of one register, optionally post-indexed by its size or Xm */
+static DecoderError decode_simd_load_store(uint32_t inst, Instruction* decoded) {
+    decoded->type = INST_LOAD_STORE;
+    decoded->dest_reg = decoder_extract_bits(inst, 0, 5);
+    decoded->opcode = decoder_extract_bits(inst, 22, 1) ? 0x44 : 0x45;
+    instruction_set_element_size(decoded, 1 << decoder_extract_bits(inst, 10, 2));
+
+    uint8_t base = decoder_extract_bits(inst, 5, 5);
+    if (!decoder_extract_bits(inst, 23, 1)) {
+        set_memory_operand(decoded, base, 0, ADDR_OFFSET);
+        return DECODER_SUCCESS;
+    }
+    uint32_t rm = decoder_extract_bits(inst, 16, 5);
+    if (rm == 31) {
+        set_memory_operand(decoded, base, instruction_get_vector_size(decoded), ADDR_POST_INDEX);
+    } else {
+        set_indexed_operand(decoded, base, rm, 3, 0, ADDR_POST_INDEX);
+    }
+    return DECODER_SUCCESS;
+}
+
+/* Data processing, register */
+
+static DecoderError decode_logical_register(uint32_t inst, Instruction* decoded) {
+    /* opc:N selects AND, BIC, ORR, ORN, EOR, EON, ANDS, BICS */
+    static const uint8_t opcodes[8] = { 0x10, 0x13, 0x11, 0x14, 0x12, 0x15, 0x10, 0x13 };
+    uint32_t opc = decoder_extract_bits(inst, 29, 2);
+    uint32_t amount = decoder_extract_bits(inst, 10, 6);
+    if (!decoder_extract_bits(inst, 31, 1) && amount > 31) return DECODER_ERROR_INVALID_INSTRUCTION;
+
+    decoded->type = INST_LOGICAL;
+    decoded->opcode = opcodes[opc << 1 | decoder_extract_bits(inst, 21, 1)];
+    decoded->sets_flags = opc == 3;
+    decoded->dest_reg = decoder_extract_bits(inst, 0, 5);
+    set_register_operand(decoded, 0, inst, 5);
+    set_register_operand(decoded, 1, inst, 16);
+    if (amount) set_shift_operand(decoded, 2, OP_SHIFT, decoder_extract_bits(inst, 22, 2), amount);
+    return DECODER_SUCCESS;
+}
+
+static DecoderError decode_add_sub_shifted(uint32_t inst, Instruction* decoded) {
+    uint32_t shift = decoder_extract_bits(inst, 22, 2);
+    uint32_t amount = decoder_extract_bits(inst, 10, 6);
+    if (shift == SHIFT_ROR || (!decoder_extract_bits(inst, 31, 1) && amount > 31)) {
+        return DECODER_ERROR_INVALID_INSTRUCTION;
+    }
+
+    decoded->type = INST_ARITHMETIC;
+    decoded->opcode = decoder_extract_bits(inst, 30, 1) ? 0x01 : 0x00;
+    decoded->sets_flags = decoder_extract_bits(inst, 29, 1) != 0;
+    decoded->dest_reg = decoder_extract_bits(inst, 0, 5);
+    set_register_operand(decoded, 0, inst, 5);
+    set_register_operand(decoded, 1, inst, 16);
+    if (amount) set_shift_operand(decoded, 2, OP_SHIFT, shift, amount);
+    return DECODER_SUCCESS;
+}
+
+/* Rn and, without S, Rd may be SP here */
+static DecoderError decode_add_sub_extended(uint32_t inst, Instruction* decoded) {
+    uint32_t amount = decoder_extract_bits(inst, 10, 3);
+    if (decoder_extract_bits(inst, 22, 2) || amount > 4) return DECODER_ERROR_INVALID_INSTRUCTION;
+
+    decoded->type = INST_ARITHMETIC;
+    decoded->opcode = decoder_extract_bits(inst, 30, 1) ? 0x01 : 0x00;
+    decoded->sets_flags = decoder_extract_bits(inst, 29, 1) != 0;
+    decoded->dest_reg = decoder_extract_bits(inst, 0, 5);
+    set_register_operand(decoded, 0, inst, 5);
+    set_register_operand(decoded, 1, inst, 16);
+    set_shift_operand(decoded, 2, OP_EXTEND, decoder_extract_bits(inst, 13, 3), amount);
+    return DECODER_SUCCESS;
+}
+
+static DecoderError decode_add_sub_carry(uint32_t inst, Instruction* decoded) {
+    decoded->type = INST_ARITHMETIC;
+    decoded->opcode = decoder_extract_bits(inst, 30, 1) ? 0x03 : 0x02;
+    decoded->sets_flags = decoder_extract_bits(inst, 29, 1) != 0;
+    decoded->dest_reg = decoder_extract_bits(inst, 0, 5);
+    set_register_operand(decoded, 0, inst, 5);
+    set_register_operand(decoded, 1, inst, 16);
+    return DECODER_SUCCESS;
+}
+
+/* Operand 1 is Rm or imm5, operand 2 the NZCV to set if the condition
+ * fails, already in place at bits 31:28
+ */
+static DecoderError decode_conditional_compare(uint32_t inst, Instruction* decoded) {
+    if (!decoder_extract_bits(inst, 29, 1)) return DECODER_ERROR_INVALID_INSTRUCTION;
+
+    decoded->type = INST_ARITHMETIC;
+    decoded->opcode = decoder_extract_bits(inst, 30, 1) ? 0x05 : 0x04;
+    decoded->sets_flags = true;
+    decoded->condition = decoder_extract_bits(inst, 12, 4);
+    decoded->dest_reg = 0xFF;
+    set_register_operand(decoded, 0, inst, 5);
+    if (decoder_extract_bits(inst, 11, 1)) {
+        set_immediate_operand(decoded, 1, decoder_extract_bits(inst, 16, 5));
+    } else {
+        set_register_operand(decoded, 1, inst, 16);
+    }
+    set_immediate_operand(decoded, 2, (uint64_t)decoder_extract_bits(inst, 0, 4) << 28);
+    return DECODER_SUCCESS;
+}
+
+static DecoderError decode_conditional_select(uint32_t inst, Instruction* decoded) {
+    uint32_t op2 = decoder_extract_bits(inst, 10, 2);
+    if (op2 > 1) return DECODER_ERROR_INVALID_INSTRUCTION;
+
+    decoded->type = INST_MOVE;
+    decoded->opcode = 0x35 + (decoder_extract_bits(inst, 30, 1) << 1 | op2);
+    decoded->condition = decoder_extract_bits(inst, 12, 4);
+    decoded->dest_reg = decoder_extract_bits(inst, 0, 5);
+    set_register_operand(decoded, 0, inst, 5);
+    set_register_operand(decoded, 1, inst, 16);
+    return DECODER_SUCCESS;
+}
+
+static DecoderError decode_data_processing_2(uint32_t inst, Instruction* decoded) {
+    switch (decoder_extract_bits(inst, 10, 6)) {
+        case 0x02: decoded->type = INST_ARITHMETIC; decoded->opcode = 0x0E; break;     /* UDIV */
+        case 0x03: decoded->type = INST_ARITHMETIC; decoded->opcode = 0x0F; break;     /* SDIV */
+        case 0x08: decoded->type = INST_LOGICAL; decoded->opcode = 0x16; break;        /* LSLV */
+        case 0x09: decoded->type = INST_LOGICAL; decoded->opcode = 0x17; break;        /* LSRV */
+        case 0x0A: decoded->type = INST_LOGICAL; decoded->opcode = 0x18; break;        /* ASRV */
+        case 0x0B: decoded->type = INST_LOGICAL; decoded->opcode = 0x19; break;        /* RORV */
+        default:
+            return DECODER_ERROR_INVALID_INSTRUCTION;
+    }
+    decoded->dest_reg = decoder_extract_bits(inst, 0, 5);
+    set_register_operand(decoded, 0, inst, 5);
+    set_register_operand(decoded, 1, inst, 16);
+    return DECODER_SUCCESS;
+}
+
+/* REV16, REV32 and REV reverse the bytes of each element_size container */
+static DecoderError decode_data_processing_1(uint32_t inst, Instruction* decoded) {
+    bool sf = decoder_extract_bits(inst, 31, 1);
+    uint32_t opcode = decoder_extract_bits(inst, 10, 6);
+    if (decoder_extract_bits(inst, 16, 5)) return DECODER_ERROR_INVALID_INSTRUCTION;
+
+    decoded->type = INST_MOVE;
+    switch (opcode) {
+        case 0x00: decoded->opcode = 0x39; break;
+        case 0x01:
+        case 0x02:
+        case 0x03:
+            if (opcode == 3 && !sf) return DECODER_ERROR_INVALID_INSTRUCTION;
+            decoded->opcode = 0x3A;
+            instruction_set_element_size(decoded, 1 << opcode);
+            break;
+        case 0x04: decoded->opcode = 0x3B; break;
+        case 0x05: decoded->opcode = 0x3C; break;
+        default:
+            return DECODER_ERROR_INVALID_INSTRUCTION;
+    }
+    decoded->dest_reg = decoder_extract_bits(inst, 0, 5);
+    set_register_operand(decoded, 0, inst, 5);
+    return DECODER_SUCCESS;
+}
+
+/* Multiply-add: Rn, Rm and the addend Ra; SMULH and UMULH have no Ra */
+static DecoderError decode_data_processing_3(uint32_t inst, Instruction* decoded) {
+    bool sf = decoder_extract_bits(inst, 31, 1);
+    bool o0 = decoder_extract_bits(inst, 15, 1);
+    if (decoder_extract_bits(inst, 29, 2)) return DECODER_ERROR_INVALID_INSTRUCTION;
+
+    switch (decoder_extract_bits(inst, 21, 3)) {
+        case 0: decoded->opcode = o0 ? 0x07 : 0x06; break;     /* MADD, MSUB */
+        case 1: decoded->opcode = o0 ? 0x09 : 0x08; break;     /* SMADDL, SMSUBL */
+        case 5: decoded->opcode = o0 ? 0x0B : 0x0A; break;     /* UMADDL, UMSUBL */
+        case 2: decoded->opcode = o0 ? 0 : 0x0C; break;        /* SMULH */
+        case 6: decoded->opcode = o0 ? 0 : 0x0D; break;        /* UMULH */
+        default: decoded->opcode = 0; break;
+    }
+    if (!decoded->opcode || (decoded->opcode > 0x07 && !sf)) return DECODER_ERROR_INVALID_INSTRUCTION;
+
+    decoded->type = INST_ARITHMETIC;
+    decoded->dest_reg = decoder_extract_bits(inst, 0, 5);
+    set_register_operand(decoded, 0, inst, 5);
+    set_register_operand(decoded, 1, inst, 16);
+    if (decoded->opcode < 0x0C) set_register_operand(decoded, 2, inst, 10);
+    return DECODER_SUCCESS;
+}
+
+/* Advanced SIMD */
+
+static void set_vector_operands(Instruction* decoded, uint32_t inst, bool has_rm) {
+    decoded->type = INST_VECTOR;
+    decoded->dest_reg = decoder_extract_bits(inst, 0, 5);
+    set_register_operand(decoded, 0, inst, 5);
+    if (has_rm) set_register_operand(decoded, 1, inst, 16);
+}
+
+/* AdvSIMD three registers of the same type */
+static DecoderError decode_simd_three_same(uint32_t inst, Instruction* decoded) {
+    bool u = decoder_extract_bits(inst, 29, 1);
+    bool q = decoder_extract_bits(inst, 30, 1);
+    uint32_t size = decoder_extract_bits(inst, 22, 2);
+    uint32_t opcode = decoder_extract_bits(inst, 11, 5);
+    instruction_set_element_size(decoded, 1 << size);
+
+    switch (opcode) {
+        case 0x10: decoded->opcode = u ? 0x51 : 0x50; break;       /* SUB, ADD */
+        case 0x13:                                                  /* MUL */
+            if (u || size == 3) return DECODER_ERROR_INVALID_INSTRUCTION;
+            decoded->opcode = 0x52;
+            break;
+        case 0x11:                                                  /* CMEQ */
+            if (!u) return DECODER_ERROR_INVALID_INSTRUCTION;
+            decoded->opcode = 0x57;
+            break;
+        case 0x06: decoded->opcode = u ? 0x59 : 0x58; break;       /* CMHI, CMGT */
+        case 0x03: {
+            /* AND, BIC, ORR, EOR: size selects the operation */
+            static const uint8_t logical[2][4] = { { 0x53, 0x54, 0x55, 0 }, { 0x56, 0, 0, 0 } };
+            decoded->opcode = logical[u][size];
+            if (!decoded->opcode) return DECODER_ERROR_INVALID_INSTRUCTION;
+            instruction_set_element_size(decoded, 1);
+            break;
+        }
+        case 0x1A:                                                  /* FADD, FSUB */
+        case 0x1B:                                                  /* FMUL */
+        case 0x1F:                                                  /* FDIV */
+            instruction_set_element_size(decoded, (size & 1) ? 8 : 4);
+            if (opcode == 0x1A && !u) {
+                decoded->opcode = (size & 2) ? 0x5B : 0x5A;
+            } else if (opcode == 0x1B && u && !(size & 2)) {
+                decoded->opcode = 0x5C;
+            } else if (opcode == 0x1F && u && !(size & 2)) {
+                decoded->opcode = 0x5D;
+            } else {
+                return DECODER_ERROR_INVALID_INSTRUCTION;
+            }
+            break;
+        default:
+            return DECODER_ERROR_INVALID_INSTRUCTION;
+    }
+
+    /* One-lane 64-bit arrangements (.1D) are reserved */
+    if (instruction_get_element_size(decoded) == 8 && !q) return DECODER_ERROR_INVALID_INSTRUCTION;
+    set_vector_operands(decoded, inst, true);
+    return DECODER_SUCCESS;
+}
+
+/* ZIP, UZP and TRN */
+static DecoderError decode_simd_permute(uint32_t inst, Instruction* decoded) {
+    static const uint8_t permutes[8] = { 0, 0x62, 0x64, 0x60, 0, 0x63, 0x65, 0x61 };
+    uint32_t size = decoder_extract_bits(inst, 22, 2);
+    decoded->opcode = permutes[decoder_extract_bits(inst, 12, 3)];
+    instruction_set_element_size(decoded, 1 << size);
+    if (!decoded->opcode || (size == 3 && !decoder_extract_bits(inst, 30, 1))) {
+        return DECODER_ERROR_INVALID_INSTRUCTION;
+    }
+    set_vector_operands(decoded, inst, true);
+    return DECODER_SUCCESS;
+}
+
+static DecoderError decode_simd_extract(uint32_t inst, Instruction* decoded) {
+    uint32_t index = decoder_extract_bits(inst, 11, 4);
+    if (!decoder_extract_bits(inst, 30, 1) && index >= 8) return DECODER_ERROR_INVALID_INSTRUCTION;
+    decoded->opcode = 0x66;
+    instruction_set_element_size(decoded, 1);
+    set_vector_operands(decoded, inst, true);
+    set_immediate_operand(decoded, 2, index);
+    return DECODER_SUCCESS;
+}
+
+/* Lane size encoded by the lowest set bit of imm5, as in DUP, INS and UMOV */
+static uint8_t copy_element_size(uint32_t imm5) {
+    for (uint8_t size = 1; size <= 8; size <<= 1) {
+        if (imm5 & size) return size;
+    }
+    return 0;
+}
+
+/* DUP, INS and UMOV between a lane and a general register */
+static DecoderError decode_simd_copy(uint32_t inst, Instruction* decoded) {
+    bool q = decoder_extract_bits(inst, 30, 1);
+    uint32_t imm5 = decoder_extract_bits(inst, 16, 5);
+    uint8_t size = copy_element_size(imm5);
+    if (!size) return DECODER_ERROR_INVALID_INSTRUCTION;
+    instruction_set_element_size(decoded, size);
+    uint64_t lane = imm5 / (size * 2);
+
+    switch (decoder_extract_bits(inst, 11, 4)) {
+        case 0x1:
+            if (size == 8 && !q) return DECODER_ERROR_INVALID_INSTRUCTION;
+            decoded->opcode = 0x67;
+            set_vector_operands(decoded, inst, false);
+            return DECODER_SUCCESS;
+        case 0x3:
+            if (!q) return DECODER_ERROR_INVALID_INSTRUCTION;
+            decoded->opcode = 0x69;
+            set_vector_operands(decoded, inst, false);
+            set_immediate_operand(decoded, 1, lane);
+            return DECODER_SUCCESS;
+        case 0x7:
+            /* Q is set exactly for the X destination */
+            if (q != (size == 8)) return DECODER_ERROR_INVALID_INSTRUCTION;
+            decoded->opcode = 0x68;
+            set_vector_operands(decoded, inst, false);
+            set_immediate_operand(decoded, 1, lane);
+            return DECODER_SUCCESS;
+        default:
+            return DECODER_ERROR_INVALID_INSTRUCTION;
+    }
+}
+
+/* SHL, USHR and SSHR by immediate; immh == 0 encodes MOVI and friends */
+static DecoderError decode_simd_shift_immediate(uint32_t inst, Instruction* decoded) {
+    uint32_t immh = decoder_extract_bits(inst, 19, 4);
+    uint32_t shift = decoder_extract_bits(inst, 16, 7);
+    if (!immh) return DECODER_ERROR_INVALID_INSTRUCTION;
+    uint8_t size = immh >= 8 ? 8 : immh >= 4 ? 4 : immh >= 2 ? 2 : 1;
+    uint32_t bits = size * 8;
+    if (size == 8 && !decoder_extract_bits(inst, 30, 1)) return DECODER_ERROR_INVALID_INSTRUCTION;
+    instruction_set_element_size(decoded, size);
+
+    bool u = decoder_extract_bits(inst, 29, 1);
+    switch (decoder_extract_bits(inst, 11, 5)) {
+        case 0x0A:
+            if (u) return DECODER_ERROR_INVALID_INSTRUCTION;
+            decoded->opcode = 0x6A;
+            shift -= bits;
+            break;
+        case 0x00:
+            decoded->opcode = u ? 0x6B : 0x6C;
+            shift = bits * 2 - shift;
+            break;
+        default:
+            return DECODER_ERROR_INVALID_INSTRUCTION;
+    }
+    set_vector_operands(decoded, inst, false);
+    set_immediate_operand(decoded, 1, shift);
+    return DECODER_SUCCESS;
+}
+
+/* Scalar floating point on S and D registers; half precision is not supported */
+
+static DecoderError begin_fp(uint32_t inst, Instruction* decoded) {
+    uint32_t ftype = decoder_extract_bits(inst, 22, 2);
+    if (decoder_extract_bits(inst, 29, 1) || ftype > 1) return DECODER_ERROR_INVALID_INSTRUCTION;
+    instruction_set_element_size(decoded, ftype ? 8 : 4);
+    set_vector_operands(decoded, inst, false);
+    decoded->type = INST_FLOAT;
+    return DECODER_SUCCESS;
+}
+
+/* FMOV between a general register and an FP register of the same width */
+static DecoderError decode_fp_move_general(uint32_t inst, Instruction* decoded) {
+    if (begin_fp(inst, decoded) != DECODER_SUCCESS ||
+        decoder_extract_bits(inst, 31, 1) != decoder_extract_bits(inst, 22, 2)) {
+        return DECODER_ERROR_INVALID_INSTRUCTION;
+    }
+    decoded->opcode = decoder_extract_bits(inst, 16, 1) ? 0x7F : 0x7E;
+    return DECODER_SUCCESS;
+}
+
+/* FMADD, FMSUB, FNMADD, FNMSUB: o1 and o0 select the negations */
+static DecoderError decode_fp_three_source(uint32_t inst, Instruction* decoded) {
+    if (begin_fp(inst, decoded) != DECODER_SUCCESS) return DECODER_ERROR_INVALID_INSTRUCTION;
+    decoded->opcode = 0x74 | decoder_extract_bits(inst, 21, 1) << 1 | decoder_extract_bits(inst, 15, 1);
+    set_register_operand(decoded, 1, inst, 16);
+    set_register_operand(decoded, 2, inst, 10);
+    return DECODER_SUCCESS;
+}
+
+static DecoderError decode_fp_two_source(uint32_t inst, Instruction* decoded) {
+    static const uint8_t two_source[4] = { 0x72, 0x73, 0x70, 0x71 };   /* FMUL, FDIV, FADD, FSUB */
+    uint32_t opcode = decoder_extract_bits(inst, 12, 4);
+    if (begin_fp(inst, decoded) != DECODER_SUCCESS || opcode > 3) return DECODER_ERROR_INVALID_INSTRUCTION;
+    decoded->opcode = two_source[opcode];
+    set_register_operand(decoded, 1, inst, 16);
+    return DECODER_SUCCESS;
+}
+
+/* FMOV, FABS, FNEG, FSQRT, and FCVT with the target size as operand 1 */
+static DecoderError decode_fp_one_source(uint32_t inst, Instruction* decoded) {
+    uint32_t opcode = decoder_extract_bits(inst, 15, 6);
+    if (begin_fp(inst, decoded) != DECODER_SUCCESS) return DECODER_ERROR_INVALID_INSTRUCTION;
+    if (opcode <= 3) {
+        decoded->opcode = 0x78 + opcode;
+        return DECODER_SUCCESS;
+    }
+    if ((opcode == 4 || opcode == 5) && opcode - 4 != decoder_extract_bits(inst, 22, 2)) {
+        decoded->opcode = 0x7C;
+        set_immediate_operand(decoded, 1, opcode == 5 ? 8 : 4);
+        return DECODER_SUCCESS;
+    }
+    return DECODER_ERROR_INVALID_INSTRUCTION;
+}
+
+/* FCMP and FCMPE, against Rm or #0.0 */
+static DecoderError decode_fp_compare(uint32_t inst, Instruction* decoded) {
+    if (begin_fp(inst, decoded) != DECODER_SUCCESS) return DECODER_ERROR_INVALID_INSTRUCTION;
+    decoded->opcode = 0x7D;
+    decoded->sets_flags = true;
+    set_register_operand(decoded, 1, inst, 16);
+    if (decoder_extract_bits(inst, 3, 1)) set_immediate_operand(decoded, 1, 0);
+    return DECODER_SUCCESS;
+}
+
+typedef DecoderError (*DecodeFunction)(uint32_t inst, Instruction* decoded);
+
+typedef struct DecodeEncoding {
+    uint32_t mask;
+    uint32_t value;
+    DecodeFunction decode;
+} DecodeEncoding;
+
+static const DecodeEncoding encodings[] = {
+#define ENCODING(mask, value, decode) { mask, value, decode },
+#include "a64_encodings.h"
+#undef ENCODING
+};
+
+/* A node selects child + ((word >> shift) & ((1 << width) - 1)); a leaf,
+ * with width 0, the candidate encodings from decode_candidates[child] up
+ * to DECODE_END
+ */
+typedef struct DecodeNode {
+    uint8_t shift;
+    uint8_t width;
+    uint16_t child;
+} DecodeNode;
+
+#define DECODE_END 0xFFFF
+
+#include "decode_tree.h"
+
+static const DecodeEncoding* find_encoding(uint32_t raw) {
+    const DecodeNode* node = decode_tree;
+    while (node->width) {
+        node = &decode_tree[node->child + ((raw >> node->shift) & ((1U << node->width) - 1))];
+    }
+    for (const uint16_t* candidate = &decode_candidates[node->child]; *candidate != DECODE_END; candidate++) {
+        const DecodeEncoding* encoding = &encodings[*candidate];
+        if ((raw & encoding->mask) == encoding->value) return encoding;
+    }
+    return NULL;
+}
+
+DecoderError decoder_decode_next(DecoderContext* context, Instruction* inst) {
+    if (!context || !inst) return DECODER_ERROR_NULL_PARAM;
+    if (context->pc >= context->buffer_size) return DECODER_ERROR_BUFFER_OVERFLOW;
+
+    uint32_t raw_inst;
+    memcpy(&raw_inst, context->code_buffer + context->pc, sizeof(raw_inst));
+    instruction_init(inst);
+    inst->raw = raw_inst;
+
+    const DecodeEncoding* encoding = find_encoding(raw_inst);
+    DecoderError result = encoding ? encoding->decode(raw_inst, inst) : DECODER_ERROR_INVALID_INSTRUCTION;
+    if (result == DECODER_SUCCESS) {
+        context->pc += 4;
+    }
+    return result;
+}
+
+DecoderError decoder_decode_at(DecoderContext* context, uint64_t address, Instruction* inst) {
+    if (!context || !inst) return DECODER_ERROR_NULL_PARAM;
+    if (address >= context->buffer_size) return DECODER_ERROR_INVALID_ADDRESS;
+    
+    uint64_t old_pc = context->pc;
+    context->pc = address;
+    DecoderError result = decoder_decode_next(context, inst);
+    context->pc = old_pc;
+    return result;
+}
+
+DecoderError decoder_decode_block(DecoderContext* context, Instruction* insts, size_t max_count, size_t* decoded_count) {
+    if (!context || !insts || !decoded_count) return DECODER_ERROR_NULL_PARAM;
+    if (!max_count) return DECODER_SUCCESS;
+    
+    *decoded_count = 0;
+    DecoderError result;
+    
+    while (*decoded_count < max_count) {
+        result = decoder_decode_next(context, &insts[*decoded_count]);
+        if (result != DECODER_SUCCESS) {
+            return (*decoded_count > 0) ? DECODER_SUCCESS : result;
+        }
+        (*decoded_count)++;
+        if (instruction_is_branch(&insts[*decoded_count - 1])) {
+            break;
+        }
+    }
+    return DECODER_SUCCESS;
+}
+
+bool decoder_is_valid_instruction(uint32_t raw_instruction) {
+    return find_encoding(raw_instruction) != NULL;
+}
+
+bool decoder_can_fallthrough(const Instruction* inst) {
+    if (!inst) return false;
+    if (inst->type == INST_BRANCH) {
+        return inst->condition != 0xF;
+    }
+    return true;
+}
+
+DecoderError decoder_get_next_pc(const DecoderContext* context, const Instruction* inst, uint64_t* next_pc) {
+    if (!context || !inst || !next_pc) return DECODER_ERROR_NULL_PARAM;
+    
+    if (!instruction_is_branch(inst)) {
+        *next_pc = context->pc + 4;
+        return DECODER_SUCCESS;
+    }
+    
+    uint64_t target = instruction_get_branch_target(inst, context->pc);
+    if (target == 0) {
+        *next_pc = context->pc + 4;
+    } else {
+        *next_pc = target;
+    }
+    return DECODER_SUCCESS;
 } 
\ No newline at end of file
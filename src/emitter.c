@@ -1,332 +1,2029 @@
-#include "emitter.h"
-#include <stdlib.h>
-#include <string.h>
-
-static LLVMTypeRef get_int1_type(EmitterContext* ctx) {
-    return LLVMInt1TypeInContext(ctx->jit->llvm_context);
-}
-
-static LLVMTypeRef get_int8_type(EmitterContext* ctx) {
-    return LLVMInt8TypeInContext(ctx->jit->llvm_context);
-}
-
-static LLVMTypeRef get_int32_type(EmitterContext* ctx) {
-    return LLVMInt32TypeInContext(ctx->jit->llvm_context);
-}
-
-static LLVMTypeRef get_int64_type(EmitterContext* ctx) {
-    return LLVMInt64TypeInContext(ctx->jit->llvm_context);
-}
-
-EmitterContext* emitter_create(JITContext* jit) {
-    if (!jit) return NULL;
-    
-    EmitterContext* ctx = (EmitterContext*)calloc(1, sizeof(EmitterContext));
-    if (!ctx) return NULL;
-    
-    ctx->jit = jit;
-    ctx->register_values = (LLVMValueRef*)calloc(64, sizeof(LLVMValueRef));
-    ctx->vector_registers = (LLVMValueRef*)calloc(32, sizeof(LLVMValueRef));
-    
-    if (!ctx->register_values || !ctx->vector_registers) {
-        free(ctx->register_values);
-        free(ctx->vector_registers);
-        free(ctx);
-        return NULL;
-    }
-    
-    return ctx;
-}
-
-void emitter_destroy(EmitterContext* context) {
-    if (!context) return;
-    free(context->register_values);
-    free(context->vector_registers);
-    free(context);
-}
-
-LLVMValueRef emitter_get_register(EmitterContext* context, uint8_t reg) {
-    if (!context || reg >= 64) return NULL;
-    return context->register_values[reg];
-}
-
-void emitter_set_register(EmitterContext* context, uint8_t reg, LLVMValueRef value) {
-    if (!context || reg >= 64) return;
-    context->register_values[reg] = value;
-}
-
-static LLVMValueRef create_memory_access_function(EmitterContext* ctx, bool is_store, int size) {
-    LLVMTypeRef param_types[] = {
-        LLVMPointerType(get_int8_type(ctx), 0),
-        get_int64_type(ctx),
-        is_store ? get_int64_type(ctx) : NULL
-    };
-    
-    LLVMTypeRef return_type = is_store ? get_int1_type(ctx) : get_int64_type(ctx);
-    int param_count = is_store ? 3 : 2;
-    
-    LLVMTypeRef func_type = LLVMFunctionType(return_type, param_types, param_count, false);
-    const char* func_name = is_store ? 
-        (size == 8 ? "memory_write64" : "memory_write32") :
-        (size == 8 ? "memory_read64" : "memory_read32");
-    
-    return LLVMAddFunction(ctx->jit->module, func_name, func_type);
-}
-
-static LLVMValueRef emit_memory_access(EmitterContext* ctx, uint64_t address, 
-                                     LLVMValueRef value, bool is_store, int size) {
-    LLVMValueRef func = create_memory_access_function(ctx, is_store, size);
-    if (!func) return NULL;
-    
-    LLVMValueRef args[] = {
-        LLVMBuildBitCast(ctx->jit->builder, 
-                         ctx->jit->memory,
-                         LLVMPointerType(get_int8_type(ctx), 0),
-                         "memory_ctx"),
-        LLVMConstInt(get_int64_type(ctx), address, false),
-        value
-    };
-    
-    return LLVMBuildCall2(ctx->jit->builder, func, args, is_store ? 3 : 2, "");
-}
-
-void emitter_update_flags(EmitterContext* context, LLVMValueRef result, bool update_overflow) {
-    if (!context || !result) return;
-    
-    LLVMBuilderRef builder = context->jit->builder;
-    
-    context->flag_n = LLVMBuildICmp(builder, LLVMIntSLT,
-                                   result,
-                                   LLVMConstInt(get_int64_type(context), 0, false),
-                                   "flag_n");
-    
-    context->flag_z = LLVMBuildICmp(builder, LLVMIntEQ,
-                                   result,
-                                   LLVMConstInt(get_int64_type(context), 0, false),
-                                   "flag_z");
-    
-    if (update_overflow) {
-        context->flag_c = LLVMConstInt(get_int1_type(context), 0, false);
-        context->flag_v = LLVMConstInt(get_int1_type(context), 0, false);
-    }
-}
-
-bool emitter_emit_arithmetic(EmitterContext* context, const Instruction* inst) {
-    if (!context || !inst) return false;
-    
-    LLVMBuilderRef builder = context->jit->builder;
-    LLVMValueRef op1 = emitter_get_register(context, inst->operands[0].value.reg);
-    LLVMValueRef op2;
-    
-    if (inst->operands[1].type == OP_IMMEDIATE) {
-        op2 = LLVMConstInt(get_int64_type(context),
-                          inst->operands[1].value.immediate,
-                          false);
-    } else {
-        op2 = emitter_get_register(context, inst->operands[1].value.reg);
-    }
-    
-    LLVMValueRef result;
-    switch (inst->opcode) {
-        case 0x00:
-            result = LLVMBuildAdd(builder, op1, op2, "add");
-            break;
-        case 0x01:
-            result = LLVMBuildSub(builder, op1, op2, "sub");
-            break;
-        default:
-            return false;
-    }
-    
-    emitter_set_register(context, inst->dest_reg, result);
-    
-    if (inst->sets_flags) {
-        emitter_update_flags(context, result, true);
-    }
-    
-    return true;
-}
-
-bool emitter_emit_logical(EmitterContext* context, const Instruction* inst) {
-    if (!context || !inst) return false;
-    
-    LLVMBuilderRef builder = context->jit->builder;
-    LLVMValueRef op1 = emitter_get_register(context, inst->operands[0].value.reg);
-    LLVMValueRef op2;
-    
-    if (inst->operands[1].type == OP_IMMEDIATE) {
-        op2 = LLVMConstInt(get_int64_type(context),
-                          inst->operands[1].value.immediate,
-                          false);
-    } else {
-        op2 = emitter_get_register(context, inst->operands[1].value.reg);
-    }
-    
-    LLVMValueRef result;
-    switch (inst->opcode) {
-        case 0x10:
-            result = LLVMBuildAnd(builder, op1, op2, "and");
-            break;
-        case 0x11:
-            result = LLVMBuildOr(builder, op1, op2, "orr");
-            break;
-        case 0x12:
-            result = LLVMBuildXor(builder, op1, op2, "eor");
-            break;
-        default:
-            return false;
-    }
-    
-    emitter_set_register(context, inst->dest_reg, result);
-    
-    if (inst->sets_flags) {
-        emitter_update_flags(context, result, false);
-    }
-    
-    return true;
-}
-
-bool emitter_emit_memory(EmitterContext* context, const Instruction* inst) {
-    if (!context || !inst) return false;
-    
-    LLVMBuilderRef builder = context->jit->builder;
-    LLVMValueRef base = emitter_get_register(context, inst->operands[0].value.mem.base_reg);
-    LLVMValueRef offset = LLVMConstInt(get_int64_type(context),
-                                     inst->operands[0].value.mem.offset,
-                                     true);
-    LLVMValueRef addr = LLVMBuildAdd(builder, base, offset, "addr");
-    
-    switch (inst->opcode) {
-        case 0x40: {
-            LLVMValueRef value = emit_memory_access(context, 0, NULL, false, 8);
-            if (!value) return false;
-            emitter_set_register(context, inst->dest_reg, value);
-            break;
-        }
-        case 0x41: {
-            LLVMValueRef value = emitter_get_register(context, inst->dest_reg);
-            if (!emit_memory_access(context, 0, value, true, 8)) {
-                return false;
-            }
-            break;
-        }
-        default:
-            return false;
-    }
-    
-    return true;
-}
-
-bool emitter_emit_branch(EmitterContext* context, const Instruction* inst) {
-    if (!context || !inst) return false;
-    
-    LLVMBuilderRef builder = context->jit->builder;
-    LLVMBasicBlockRef target_block = LLVMAppendBasicBlock(context->function, "target");
-    LLVMBasicBlockRef next_block = LLVMAppendBasicBlock(context->function, "next");
-    
-    switch (inst->opcode) {
-        case 0x20:
-            LLVMBuildBr(builder, target_block);
-            break;
-            
-        case 0x22: {
-            LLVMValueRef condition = emitter_get_condition_value(context, inst->condition);
-            LLVMBuildCondBr(builder, condition, target_block, next_block);
-            break;
-        }
-            
-        case 0x25: {
-            LLVMValueRef return_addr = LLVMConstInt(get_int64_type(context),
-                                                  inst->operands[0].value.immediate + 4,
-                                                  false);
-            emitter_set_register(context, 30, return_addr);
-            LLVMBuildBr(builder, target_block);
-            break;
-        }
-            
-        default:
-            return false;
-    }
-    
-    return true;
-}
-
-LLVMValueRef emitter_get_condition_value(EmitterContext* context, uint8_t condition) {
-    if (!context) return NULL;
-    
-    LLVMBuilderRef builder = context->jit->builder;
-    
-    switch (condition) {
-        case 0x0:
-            return context->flag_z;
-        case 0x1:
-            return LLVMBuildNot(builder, context->flag_z, "ne");
-        case 0x2:
-            return context->flag_c;
-        case 0x3:
-            return LLVMBuildNot(builder, context->flag_c, "cc");
-        case 0x4:
-            return context->flag_n;
-        case 0x5:
-            return LLVMBuildNot(builder, context->flag_n, "pl");
-        case 0x6:
-            return context->flag_v;
-        case 0x7:
-            return LLVMBuildNot(builder, context->flag_v, "vc");
-        default:
-            return LLVMConstInt(get_int1_type(context), 1, false);
-    }
-}
-
-LLVMValueRef emitter_create_entry_block(EmitterContext* context) {
-    if (!context) return NULL;
-    
-    LLVMTypeRef param_types[] = {
-        LLVMPointerType(get_int8_type(context), 0),
-        LLVMPointerType(get_int8_type(context), 0)
-    };
-    
-    LLVMTypeRef func_type = LLVMFunctionType(get_int64_type(context),
-                                            param_types, 2, false);
-    
-    context->function = LLVMAddFunction(context->jit->module, "block", func_type);
-    context->current_block = LLVMAppendBasicBlock(context->function, "entry");
-    LLVMPositionBuilderAtEnd(context->jit->builder, context->current_block);
-    
-    return context->function;
-}
-
-void emitter_create_exit_block(EmitterContext* context) {
-    if (!context) return;
-    
-    LLVMBuilderRef builder = context->jit->builder;
-    LLVMBasicBlockRef exit_block = LLVMAppendBasicBlock(context->function, "exit");
-    LLVMPositionBuilderAtEnd(builder, exit_block);
-    
-    LLVMValueRef next_pc = emitter_get_register(context, 32);
-    LLVMBuildRet(builder, next_pc);
-}
-
-bool emitter_emit_instruction(EmitterContext* context, const Instruction* inst) {
-    if (!context || !inst) return false;
-    
-    switch (inst->type) {
-        case INST_ARITHMETIC:
-            return emitter_emit_arithmetic(context, inst);
-        case INST_LOGICAL:
-            return emitter_emit_logical(context, inst);
-        case INST_LOAD_STORE:
-            return emitter_emit_memory(context, inst);
-        case INST_BRANCH:
-            return emitter_emit_branch(context, inst);
-        default:
-            return false;
-    }
-}
-
-LLVMValueRef emitter_finalize_block(EmitterContext* context) {
-    if (!context) return NULL;
-    
-    emitter_create_exit_block(context);
-    return context->function;
+#include "emitter.h"
+#include "fpu.h"
+#include "memory.h"
+#include "registers.h"
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+static LLVMTypeRef get_int1_type(EmitterContext* ctx) {
+    return LLVMInt1TypeInContext(ctx->compiler->llvm_context);
+}
+
+static LLVMTypeRef get_int8_type(EmitterContext* ctx) {
+    return LLVMInt8TypeInContext(ctx->compiler->llvm_context);
+}
+
+static LLVMTypeRef get_int32_type(EmitterContext* ctx) {
+    return LLVMInt32TypeInContext(ctx->compiler->llvm_context);
+}
+
+static LLVMTypeRef get_int64_type(EmitterContext* ctx) {
+    return LLVMInt64TypeInContext(ctx->compiler->llvm_context);
+}
+
+/* base + offset, typed as a pointer to type; offset is an i64 value */
+static LLVMValueRef field_address(EmitterContext* ctx, LLVMValueRef base,
+                                  LLVMValueRef offset, LLVMTypeRef type) {
+    LLVMBuilderRef builder = ctx->compiler->builder;
+    LLVMValueRef field = LLVMBuildGEP2(builder, get_int8_type(ctx), base, &offset, 1, "");
+    return LLVMBuildBitCast(builder, field, LLVMPointerType(type, 0), "");
+}
+
+static LLVMValueRef const_offset(EmitterContext* ctx, size_t offset) {
+    return LLVMConstInt(get_int64_type(ctx), offset, false);
+}
+
+static const char* const access_class_names[ACCESS_CLASS_COUNT] = {
+    "guest register",
+    "guest vector register",
+    "guest flags",
+    "guest fp control",
+    "soft tlb",
+    "guest memory"
+};
+
+/* Scalar TBAA tags under a root of our own; LLVM treats types from other
+ * roots, such as those in the helper bitcode, as aliasing everything.
+ */
+static void set_access_class(EmitterContext* ctx, LLVMValueRef inst, EmitterAccessClass access) {
+    LLVMContextRef llvm_context = ctx->compiler->llvm_context;
+    if (!ctx->access_tags[access]) {
+        static const char root_name[] = "arm64 guest state";
+        const char* name = access_class_names[access];
+        LLVMMetadataRef zero = LLVMValueAsMetadata(const_offset(ctx, 0));
+        LLVMMetadataRef root_name_md = LLVMMDStringInContext2(llvm_context, root_name, strlen(root_name));
+        LLVMMetadataRef root = LLVMMDNodeInContext2(llvm_context, &root_name_md, 1);
+        LLVMMetadataRef type_ops[] = { LLVMMDStringInContext2(llvm_context, name, strlen(name)), root, zero };
+        LLVMMetadataRef type = LLVMMDNodeInContext2(llvm_context, type_ops, 3);
+        LLVMMetadataRef tag_ops[] = { type, type, zero };
+        ctx->access_tags[access] = LLVMMetadataAsValue(llvm_context, LLVMMDNodeInContext2(llvm_context, tag_ops, 3));
+    }
+    LLVMSetMetadata(inst, LLVMGetMDKindIDInContext(llvm_context, "tbaa", 4), ctx->access_tags[access]);
+}
+
+static LLVMValueRef load_pointer_field(EmitterContext* ctx, LLVMValueRef base,
+                                       size_t offset, const char* name) {
+    LLVMTypeRef ptr_type = LLVMPointerType(get_int8_type(ctx), 0);
+    LLVMValueRef field = field_address(ctx, base, const_offset(ctx, offset), ptr_type);
+    return LLVMBuildLoad2(ctx->compiler->builder, ptr_type, field, name);
+}
+
+/* Guest registers live in the RegisterFile passed as the first argument */
+static LLVMValueRef guest_register_address(EmitterContext* ctx, uint8_t reg) {
+    size_t offset = offsetof(RegisterFile, x) + reg * sizeof(uint64_t);
+    return field_address(ctx, LLVMGetParam(ctx->function, 0), const_offset(ctx, offset),
+                         get_int64_type(ctx));
+}
+
+static EmitterAccessClass register_access_class(uint8_t reg) {
+    return reg == ARM64_REG_NZCV ? ACCESS_GUEST_FLAGS : ACCESS_GUEST_REGISTER;
+}
+
+static LLVMValueRef load_guest_register(EmitterContext* ctx, uint8_t reg) {
+    LLVMValueRef value = LLVMBuildLoad2(ctx->compiler->builder, get_int64_type(ctx),
+                                        guest_register_address(ctx, reg), "guest_reg");
+    set_access_class(ctx, value, register_access_class(reg));
+    return value;
+}
+
+static void store_guest_register(EmitterContext* ctx, uint8_t reg, LLVMValueRef value) {
+    LLVMValueRef store = LLVMBuildStore(ctx->compiler->builder, value, guest_register_address(ctx, reg));
+    set_access_class(ctx, store, register_access_class(reg));
+}
+
+static LLVMTypeRef get_vector_type(EmitterContext* ctx) {
+    return LLVMVectorType(get_int8_type(ctx), 16);
+}
+
+static LLVMValueRef vector_register_address(EmitterContext* ctx, uint8_t reg) {
+    size_t offset = offsetof(RegisterFile, v) + reg * 16;
+    return field_address(ctx, LLVMGetParam(ctx->function, 0), const_offset(ctx, offset),
+                         get_vector_type(ctx));
+}
+
+EmitterContext* emitter_create(JITCompiler* compiler) {
+    if (!compiler) return NULL;
+    
+    EmitterContext* ctx = (EmitterContext*)calloc(1, sizeof(EmitterContext));
+    if (!ctx) return NULL;
+    
+    ctx->compiler = compiler;
+    ctx->register_values = (LLVMValueRef*)calloc(64, sizeof(LLVMValueRef));
+    ctx->vector_registers = (LLVMValueRef*)calloc(32, sizeof(LLVMValueRef));
+    
+    if (!ctx->register_values || !ctx->vector_registers) {
+        free(ctx->register_values);
+        free(ctx->vector_registers);
+        free(ctx);
+        return NULL;
+    }
+    
+    return ctx;
+}
+
+void emitter_destroy(EmitterContext* context) {
+    if (!context) return;
+    free(context->register_values);
+    free(context->vector_registers);
+    free(context->exit_targets);
+    free(context);
+}
+
+LLVMValueRef emitter_get_register(EmitterContext* context, uint8_t reg) {
+    if (!context || reg >= 64) return NULL;
+    if (context->register_values[reg] || reg >= ARM64_NUM_REGS) {
+        return context->register_values[reg];
+    }
+    
+    /* The entry block dominates every use, wherever the first one is */
+    LLVMBuilderRef builder = context->compiler->builder;
+    LLVMBasicBlockRef current = LLVMGetInsertBlock(builder);
+    LLVMPositionBuilderBefore(builder, context->register_load_point);
+    context->register_values[reg] = load_guest_register(context, reg);
+    LLVMPositionBuilderAtEnd(builder, current);
+    return context->register_values[reg];
+}
+
+void emitter_set_register(EmitterContext* context, uint8_t reg, LLVMValueRef value) {
+    if (!context || reg >= 64) return;
+    context->register_values[reg] = value;
+    if (reg < ARM64_NUM_REGS) context->dirty_registers |= 1ULL << reg;
+}
+
+LLVMValueRef emitter_get_vector(EmitterContext* context, uint8_t reg) {
+    if (!context || reg >= ARM64_NUM_VECTOR_REGS) return NULL;
+    if (context->vector_registers[reg]) return context->vector_registers[reg];
+    
+    LLVMBuilderRef builder = context->compiler->builder;
+    LLVMBasicBlockRef current = LLVMGetInsertBlock(builder);
+    LLVMPositionBuilderBefore(builder, context->register_load_point);
+    LLVMValueRef value = LLVMBuildLoad2(builder, get_vector_type(context),
+                                        vector_register_address(context, reg), "guest_vreg");
+    LLVMSetAlignment(value, sizeof(uint64_t));
+    set_access_class(context, value, ACCESS_GUEST_VECTOR);
+    context->vector_registers[reg] = value;
+    LLVMPositionBuilderAtEnd(builder, current);
+    return value;
+}
+
+void emitter_set_vector(EmitterContext* context, uint8_t reg, LLVMValueRef value) {
+    if (!context || reg >= ARM64_NUM_VECTOR_REGS) return;
+    context->vector_registers[reg] = LLVMBuildBitCast(context->compiler->builder, value,
+                                                      get_vector_type(context), "");
+    context->dirty_vectors |= 1U << reg;
+}
+
+/* NZCV bit positions in x[ARM64_REG_NZCV] */
+#define NZCV_N 31
+#define NZCV_Z 30
+#define NZCV_C 29
+#define NZCV_V 28
+
+void emitter_update_flags(EmitterContext* context, EmitterFlagOp op, LLVMValueRef op1,
+                          LLVMValueRef op2, LLVMValueRef result, bool is_64bit) {
+    if (!context) return;
+    context->flags.op = op;
+    context->flags.op1 = op1;
+    context->flags.op2 = op2;
+    context->flags.result = result;
+    context->flags.is_64bit = is_64bit;
+}
+
+static LLVMValueRef flag_operand(EmitterContext* ctx, LLVMValueRef value) {
+    if (ctx->flags.is_64bit) return value;
+    return LLVMBuildTrunc(ctx->compiler->builder, value, get_int32_type(ctx), "");
+}
+
+static LLVMValueRef is_negative(EmitterContext* ctx, LLVMValueRef value) {
+    return LLVMBuildICmp(ctx->compiler->builder, LLVMIntSLT, value,
+                         LLVMConstNull(LLVMTypeOf(value)), "");
+}
+
+/* One flag, computed at the current insertion point from the recorded
+ * producer, or read from the register file if none ran in this block.
+ */
+static LLVMValueRef get_flag(EmitterContext* ctx, unsigned bit) {
+    LLVMBuilderRef builder = ctx->compiler->builder;
+    const EmitterFlags* flags = &ctx->flags;
+    
+    if (flags->op == FLAGS_IN_REGISTER) {
+        LLVMValueRef nzcv = emitter_get_register(ctx, ARM64_REG_NZCV);
+        LLVMValueRef shifted = LLVMBuildLShr(builder, nzcv, LLVMConstInt(get_int64_type(ctx), bit, false), "");
+        return LLVMBuildTrunc(builder, shifted, get_int1_type(ctx), "");
+    }
+    
+    LLVMValueRef result = flag_operand(ctx, flags->result);
+    if (bit == NZCV_N) return is_negative(ctx, result);
+    if (bit == NZCV_Z) {
+        return LLVMBuildICmp(builder, LLVMIntEQ, result, LLVMConstNull(LLVMTypeOf(result)), "");
+    }
+    if (flags->op == FLAGS_LOGICAL) return LLVMConstInt(get_int1_type(ctx), 0, false);
+    
+    LLVMValueRef a = flag_operand(ctx, flags->op1);
+    LLVMValueRef b = flag_operand(ctx, flags->op2);
+    if (bit == NZCV_C) {
+        /* Carry out of a + b; for a - b, no borrow */
+        if (flags->op == FLAGS_ADD) return LLVMBuildICmp(builder, LLVMIntULT, result, a, "");
+        return LLVMBuildICmp(builder, LLVMIntUGE, a, b, "");
+    }
+    
+    /* Signed overflow: the result's sign disagrees with what the operands allow */
+    LLVMValueRef x = LLVMBuildXor(builder, a, result, "");
+    LLVMValueRef y = flags->op == FLAGS_ADD ? LLVMBuildXor(builder, b, result, "")
+                                            : LLVMBuildXor(builder, a, b, "");
+    return is_negative(ctx, LLVMBuildAnd(builder, x, y, ""));
+}
+
+/* NZCV packed as x[ARM64_REG_NZCV] holds it */
+static LLVMValueRef packed_flags(EmitterContext* ctx) {
+    LLVMBuilderRef builder = ctx->compiler->builder;
+    static const unsigned bits[] = { NZCV_N, NZCV_Z, NZCV_C, NZCV_V };
+    LLVMValueRef nzcv = LLVMConstInt(get_int64_type(ctx), 0, false);
+    for (size_t i = 0; i < sizeof(bits) / sizeof(bits[0]); i++) {
+        LLVMValueRef flag = LLVMBuildZExt(builder, get_flag(ctx, bits[i]), get_int64_type(ctx), "");
+        flag = LLVMBuildShl(builder, flag, LLVMConstInt(get_int64_type(ctx), bits[i], false), "");
+        nzcv = LLVMBuildOr(builder, nzcv, flag, "");
+    }
+    return nzcv;
+}
+
+static void write_back_flags(EmitterContext* ctx) {
+    if (ctx->flags.op == FLAGS_IN_REGISTER) return;
+    store_guest_register(ctx, ARM64_REG_NZCV, packed_flags(ctx));
+}
+
+LLVMValueRef emitter_get_condition_value(EmitterContext* context, uint8_t condition) {
+    if (!context) return NULL;
+    
+    LLVMBuilderRef builder = context->compiler->builder;
+    unsigned base = (condition >> 1) & 7;
+    if (base == 7) return LLVMConstInt(get_int1_type(context), 1, false);
+    
+    /* After a compare most conditions are a single comparison of its operands */
+    LLVMValueRef holds = NULL;
+    if (context->flags.op == FLAGS_SUB) {
+        LLVMIntPredicate predicate;
+        bool direct = true;
+        switch (base) {
+            case 0: predicate = LLVMIntEQ; break;
+            case 1: predicate = LLVMIntUGE; break;
+            case 4: predicate = LLVMIntUGT; break;
+            case 5: predicate = LLVMIntSGE; break;
+            case 6: predicate = LLVMIntSGT; break;
+            default: direct = false; break;
+        }
+        if (direct) {
+            holds = LLVMBuildICmp(builder, predicate, flag_operand(context, context->flags.op1),
+                                  flag_operand(context, context->flags.op2), "cond");
+        }
+    }
+    
+    if (!holds) {
+        switch (base) {
+            case 0: holds = get_flag(context, NZCV_Z); break;
+            case 1: holds = get_flag(context, NZCV_C); break;
+            case 2: holds = get_flag(context, NZCV_N); break;
+            case 3: holds = get_flag(context, NZCV_V); break;
+            case 4:
+                holds = LLVMBuildAnd(builder, get_flag(context, NZCV_C),
+                                     LLVMBuildNot(builder, get_flag(context, NZCV_Z), ""), "cond");
+                break;
+            case 5:
+                holds = LLVMBuildICmp(builder, LLVMIntEQ, get_flag(context, NZCV_N),
+                                      get_flag(context, NZCV_V), "cond");
+                break;
+            default:
+                holds = LLVMBuildAnd(builder,
+                                     LLVMBuildICmp(builder, LLVMIntEQ, get_flag(context, NZCV_N),
+                                                   get_flag(context, NZCV_V), ""),
+                                     LLVMBuildNot(builder, get_flag(context, NZCV_Z), ""), "cond");
+                break;
+        }
+    }
+    
+    if (condition & 1) {
+        return LLVMBuildNot(builder, holds, "cond_inv");
+    }
+    return holds;
+}
+
+void emitter_write_back_registers(EmitterContext* context) {
+    if (!context) return;
+    for (uint8_t reg = 0; reg < ARM64_NUM_REGS; reg++) {
+        if (context->dirty_registers & (1ULL << reg)) {
+            store_guest_register(context, reg, context->register_values[reg]);
+        }
+    }
+    for (uint8_t reg = 0; reg < ARM64_NUM_VECTOR_REGS; reg++) {
+        if (context->dirty_vectors & (1U << reg)) {
+            LLVMValueRef store = LLVMBuildStore(context->compiler->builder, context->vector_registers[reg],
+                                                vector_register_address(context, reg));
+            LLVMSetAlignment(store, sizeof(uint64_t));
+            set_access_class(context, store, ACCESS_GUEST_VECTOR);
+        }
+    }
+    write_back_flags(context);
+}
+
+/* Register 31 reads as XZR unless the encoding selects SP, as in the interpreter */
+static LLVMValueRef read_operand(EmitterContext* ctx, uint8_t reg, bool sp_allowed) {
+    if (reg == ARM64_REG_SP && !sp_allowed) return LLVMConstInt(get_int64_type(ctx), 0, false);
+    return emitter_get_register(ctx, reg);
+}
+
+static void write_result(EmitterContext* ctx, uint8_t reg, LLVMValueRef value,
+                         bool is_64bit, bool sp_allowed) {
+    if (reg == ARM64_REG_SP && !sp_allowed) return;
+    /* W results are zero-extended into the X register */
+    if (LLVMTypeOf(value) != get_int64_type(ctx)) {
+        value = LLVMBuildZExt(ctx->compiler->builder, value, get_int64_type(ctx), "");
+    } else if (!is_64bit) {
+        value = LLVMBuildAnd(ctx->compiler->builder, value,
+                             LLVMConstInt(get_int64_type(ctx), 0xFFFFFFFFULL, false), "");
+    }
+    emitter_set_register(ctx, reg, value);
+}
+
+static LLVMValueRef call_intrinsic(EmitterContext* ctx, const char* name, LLVMValueRef* args, unsigned count) {
+    LLVMTypeRef type = LLVMTypeOf(args[0]);
+    unsigned id = LLVMLookupIntrinsicID(name, strlen(name));
+    LLVMValueRef func = LLVMGetIntrinsicDeclaration(ctx->compiler->module, id, &type, 1);
+    return LLVMBuildCall2(ctx->compiler->builder, LLVMIntrinsicGetType(ctx->compiler->llvm_context, id, &type, 1),
+                          func, args, count, "");
+}
+
+/* Data processing runs in the operation width, i32 for W registers */
+static LLVMTypeRef width_type(EmitterContext* ctx, bool is_64bit) {
+    return is_64bit ? get_int64_type(ctx) : get_int32_type(ctx);
+}
+
+static LLVMValueRef to_width(EmitterContext* ctx, LLVMValueRef value, bool is_64bit) {
+    if (is_64bit) return value;
+    return LLVMBuildTrunc(ctx->compiler->builder, value, get_int32_type(ctx), "");
+}
+
+static LLVMValueRef to_int64(EmitterContext* ctx, LLVMValueRef value) {
+    if (LLVMTypeOf(value) == get_int64_type(ctx)) return value;
+    return LLVMBuildZExt(ctx->compiler->builder, value, get_int64_type(ctx), "");
+}
+
+static LLVMValueRef read_width(EmitterContext* ctx, uint8_t reg, bool is_64bit) {
+    return to_width(ctx, read_operand(ctx, reg, false), is_64bit);
+}
+
+/* Register reg extended by option (UXTB to SXTX) and shifted left by amount */
+static LLVMValueRef extended_register(EmitterContext* ctx, uint8_t reg, uint8_t option, uint8_t amount) {
+    LLVMBuilderRef builder = ctx->compiler->builder;
+    LLVMTypeRef i64 = get_int64_type(ctx);
+    LLVMValueRef value = read_operand(ctx, reg, false);
+    unsigned bits = 8U << (option & 3);
+    if (bits < 64) {
+        value = LLVMBuildTrunc(builder, value, LLVMIntTypeInContext(ctx->compiler->llvm_context, bits), "");
+        value = (option & 4) ? LLVMBuildSExt(builder, value, i64, "") : LLVMBuildZExt(builder, value, i64, "");
+    }
+    if (!amount) return value;
+    return LLVMBuildShl(builder, value, LLVMConstInt(i64, amount, false), "");
+}
+
+/* Operand index: an immediate, or a register with the shift or extend of
+ * the operand after it applied, in the operation width
+ */
+static LLVMValueRef shifted_operand(EmitterContext* ctx, const Instruction* inst, uint8_t index, bool is_64bit) {
+    LLVMBuilderRef builder = ctx->compiler->builder;
+    LLVMTypeRef type = width_type(ctx, is_64bit);
+    if (instruction_get_operand_type(inst, index) == OP_IMMEDIATE) {
+        return LLVMConstInt(type, instruction_get_immediate(inst, index), false);
+    }
+
+    uint8_t reg = instruction_get_register(inst, index);
+    Operand shift = instruction_get_operand(inst, index + 1);
+    if (shift.type == OP_EXTEND) {
+        return to_width(ctx, extended_register(ctx, reg, shift.value.shift.type, shift.value.shift.amount),
+                        is_64bit);
+    }
+
+    LLVMValueRef value = read_width(ctx, reg, is_64bit);
+    if (shift.type != OP_SHIFT) return value;
+    LLVMValueRef amount = LLVMConstInt(type, shift.value.shift.amount, false);
+    switch (shift.value.shift.type) {
+        case SHIFT_LSL: return LLVMBuildShl(builder, value, amount, "");
+        case SHIFT_LSR: return LLVMBuildLShr(builder, value, amount, "");
+        case SHIFT_ASR: return LLVMBuildAShr(builder, value, amount, "");
+        default: {
+            LLVMValueRef args[] = { value, value, amount };
+            return call_intrinsic(ctx, "llvm.fshr", args, 3);
+        }
+    }
+}
+
+/* NZCV from four i1 values, for producers the lazy scheme does not cover */
+static void set_packed_flags(EmitterContext* ctx, LLVMValueRef n, LLVMValueRef z, LLVMValueRef c, LLVMValueRef v) {
+    LLVMBuilderRef builder = ctx->compiler->builder;
+    LLVMTypeRef i64 = get_int64_type(ctx);
+    const struct { LLVMValueRef flag; unsigned bit; } flags[] = {
+        { n, NZCV_N }, { z, NZCV_Z }, { c, NZCV_C }, { v, NZCV_V }
+    };
+    LLVMValueRef nzcv = LLVMConstInt(i64, 0, false);
+    for (size_t i = 0; i < sizeof(flags) / sizeof(flags[0]); i++) {
+        LLVMValueRef flag = LLVMBuildZExt(builder, flags[i].flag, i64, "");
+        flag = LLVMBuildShl(builder, flag, LLVMConstInt(i64, flags[i].bit, false), "");
+        nzcv = LLVMBuildOr(builder, nzcv, flag, "");
+    }
+    emitter_update_flags(ctx, FLAGS_IN_REGISTER, NULL, NULL, NULL, true);
+    emitter_set_register(ctx, ARM64_REG_NZCV, nzcv);
+}
+
+/* ADC and SBC: a + b + C, with SBC inverting b. The flags are computed
+ * here, since the carry in has no place in EmitterFlags.
+ */
+static LLVMValueRef emit_add_with_carry(EmitterContext* ctx, const Instruction* inst, bool is_64bit) {
+    LLVMBuilderRef builder = ctx->compiler->builder;
+    LLVMTypeRef type = width_type(ctx, is_64bit);
+    LLVMValueRef a = read_width(ctx, instruction_get_register(inst, 0), is_64bit);
+    LLVMValueRef b = read_width(ctx, instruction_get_register(inst, 1), is_64bit);
+    if (inst->opcode == 0x03) b = LLVMBuildNot(builder, b, "");
+    LLVMValueRef carry = LLVMBuildZExt(builder, get_flag(ctx, NZCV_C), type, "");
+    LLVMValueRef result = LLVMBuildAdd(builder, LLVMBuildAdd(builder, a, b, ""), carry, "adc");
+    if (!inst->sets_flags || ctx->liveness.dead_flags) return result;
+
+    /* Carry out is the bit above the width in the widened sum */
+    unsigned bits = is_64bit ? 64 : 32;
+    LLVMTypeRef wide = LLVMIntTypeInContext(ctx->compiler->llvm_context, bits * 2);
+    LLVMValueRef sum = LLVMBuildAdd(builder, LLVMBuildZExt(builder, a, wide, ""), LLVMBuildZExt(builder, b, wide, ""), "");
+    sum = LLVMBuildAdd(builder, sum, LLVMBuildZExt(builder, carry, wide, ""), "");
+    LLVMValueRef carry_out = LLVMBuildTrunc(builder, LLVMBuildLShr(builder, sum, LLVMConstInt(wide, bits, false), ""),
+                                            get_int1_type(ctx), "");
+    LLVMValueRef overflow = is_negative(ctx, LLVMBuildAnd(builder, LLVMBuildXor(builder, a, result, ""),
+                                                          LLVMBuildXor(builder, b, result, ""), ""));
+    set_packed_flags(ctx, is_negative(ctx, result),
+                     LLVMBuildICmp(builder, LLVMIntEQ, result, LLVMConstNull(type), ""), carry_out, overflow);
+    return result;
+}
+
+/* CCMP and CCMN: the compare's flags if the condition holds, the
+ * immediate NZCV otherwise
+ */
+static void emit_conditional_compare(EmitterContext* ctx, const Instruction* inst, bool is_64bit) {
+    LLVMBuilderRef builder = ctx->compiler->builder;
+    LLVMValueRef holds = emitter_get_condition_value(ctx, inst->condition);
+    LLVMValueRef a = read_operand(ctx, instruction_get_register(inst, 0), false);
+    LLVMValueRef b = to_int64(ctx, shifted_operand(ctx, inst, 1, is_64bit));
+    bool is_add = inst->opcode == 0x04;
+    LLVMValueRef result = is_add ? LLVMBuildAdd(builder, a, b, "ccmn") : LLVMBuildSub(builder, a, b, "ccmp");
+
+    emitter_update_flags(ctx, is_add ? FLAGS_ADD : FLAGS_SUB, a, b, result, is_64bit);
+    LLVMValueRef nzcv = LLVMBuildSelect(builder, holds, packed_flags(ctx),
+                                        LLVMConstInt(get_int64_type(ctx), instruction_get_immediate(inst, 2), false),
+                                        "nzcv");
+    emitter_update_flags(ctx, FLAGS_IN_REGISTER, NULL, NULL, NULL, true);
+    emitter_set_register(ctx, ARM64_REG_NZCV, nzcv);
+}
+
+/* Division by zero gives zero, and INT_MIN / -1 wraps, where LLVM's
+ * divisions are undefined
+ */
+static LLVMValueRef emit_divide(EmitterContext* ctx, LLVMValueRef n, LLVMValueRef d, bool is_signed) {
+    LLVMBuilderRef builder = ctx->compiler->builder;
+    LLVMTypeRef type = LLVMTypeOf(n);
+    LLVMValueRef zero = LLVMConstNull(type);
+    LLVMValueRef one = LLVMConstInt(type, 1, false);
+    LLVMValueRef by_zero = LLVMBuildICmp(builder, LLVMIntEQ, d, zero, "");
+    if (!is_signed) {
+        LLVMValueRef quotient = LLVMBuildUDiv(builder, n, LLVMBuildSelect(builder, by_zero, one, d, ""), "udiv");
+        return LLVMBuildSelect(builder, by_zero, zero, quotient, "");
+    }
+
+    LLVMValueRef by_minus_one = LLVMBuildICmp(builder, LLVMIntEQ, d, LLVMConstAllOnes(type), "");
+    LLVMValueRef safe = LLVMBuildSelect(builder, LLVMBuildOr(builder, by_zero, by_minus_one, ""), one, d, "");
+    LLVMValueRef quotient = LLVMBuildSDiv(builder, n, safe, "sdiv");
+    quotient = LLVMBuildSelect(builder, by_minus_one, LLVMBuildNeg(builder, n, ""), quotient, "");
+    return LLVMBuildSelect(builder, by_zero, zero, quotient, "");
+}
+
+/* MADD to UMULH; the long forms take W sources and an X addend */
+static LLVMValueRef emit_multiply(EmitterContext* ctx, const Instruction* inst, bool is_64bit) {
+    LLVMBuilderRef builder = ctx->compiler->builder;
+    LLVMTypeRef i64 = get_int64_type(ctx);
+    uint8_t rn = instruction_get_register(inst, 0);
+    uint8_t rm = instruction_get_register(inst, 1);
+
+    if (inst->opcode == 0x0C || inst->opcode == 0x0D) {
+        LLVMTypeRef i128 = LLVMIntTypeInContext(ctx->compiler->llvm_context, 128);
+        LLVMValueRef a = read_operand(ctx, rn, false);
+        LLVMValueRef b = read_operand(ctx, rm, false);
+        if (inst->opcode == 0x0C) {
+            a = LLVMBuildSExt(builder, a, i128, "");
+            b = LLVMBuildSExt(builder, b, i128, "");
+        } else {
+            a = LLVMBuildZExt(builder, a, i128, "");
+            b = LLVMBuildZExt(builder, b, i128, "");
+        }
+        LLVMValueRef product = LLVMBuildMul(builder, a, b, "");
+        return LLVMBuildTrunc(builder, LLVMBuildLShr(builder, product, LLVMConstInt(i128, 64, false), ""), i64, "mulh");
+    }
+
+    LLVMValueRef a, b, addend;
+    if (inst->opcode <= 0x07) {
+        a = read_width(ctx, rn, is_64bit);
+        b = read_width(ctx, rm, is_64bit);
+        addend = read_width(ctx, instruction_get_register(inst, 2), is_64bit);
+    } else {
+        a = read_width(ctx, rn, false);
+        b = read_width(ctx, rm, false);
+        if (inst->opcode <= 0x09) {
+            a = LLVMBuildSExt(builder, a, i64, "");
+            b = LLVMBuildSExt(builder, b, i64, "");
+        } else {
+            a = LLVMBuildZExt(builder, a, i64, "");
+            b = LLVMBuildZExt(builder, b, i64, "");
+        }
+        addend = read_operand(ctx, instruction_get_register(inst, 2), false);
+    }
+    LLVMValueRef product = LLVMBuildMul(builder, a, b, "");
+    /* MSUB, SMSUBL and UMSUBL have odd opcodes */
+    if (inst->opcode & 1) return LLVMBuildSub(builder, addend, product, "msub");
+    return LLVMBuildAdd(builder, addend, product, "madd");
+}
+
+bool emitter_emit_arithmetic(EmitterContext* context, const Instruction* inst) {
+    if (!context || !inst) return false;
+    /* Nothing reads what it computes */
+    if (context->liveness.dead_result && (!inst->sets_flags || context->liveness.dead_flags)) {
+        return true;
+    }
+
+    LLVMBuilderRef builder = context->compiler->builder;
+    bool is_64bit = instruction_is_64bit(inst);
+    LLVMValueRef result;
+
+    switch (inst->opcode) {
+        case 0x02:
+        case 0x03:
+            result = emit_add_with_carry(context, inst, is_64bit);
+            break;
+        case 0x04:
+        case 0x05:
+            emit_conditional_compare(context, inst, is_64bit);
+            return true;
+        case 0x06: case 0x07: case 0x08: case 0x09:
+        case 0x0A: case 0x0B: case 0x0C: case 0x0D:
+            result = emit_multiply(context, inst, is_64bit);
+            break;
+        case 0x0E:
+        case 0x0F:
+            result = emit_divide(context, read_width(context, instruction_get_register(inst, 0), is_64bit),
+                                 read_width(context, instruction_get_register(inst, 1), is_64bit), inst->opcode == 0x0F);
+            break;
+        default:
+            result = NULL;
+            break;
+    }
+    if (result) {
+        write_result(context, inst->dest_reg, result, is_64bit, false);
+        return true;
+    }
+    if (inst->opcode > 0x01) return false;
+
+    /* ADD and SUB. The immediate and extended register forms accept SP
+     * as source and, without S, as destination.
+     */
+    bool sp_allowed = instruction_get_operand_type(inst, 1) == OP_IMMEDIATE ||
+                      (inst->operand_count > 2 && instruction_get_operand_type(inst, 2) == OP_EXTEND);
+    LLVMValueRef op1 = read_operand(context, instruction_get_register(inst, 0), sp_allowed);
+    LLVMValueRef op2 = to_int64(context, shifted_operand(context, inst, 1, is_64bit));
+    if (!op1 || !op2) return false;
+
+    if (inst->opcode == 0x00) {
+        result = LLVMBuildAdd(builder, op1, op2, "add");
+    } else {
+        result = LLVMBuildSub(builder, op1, op2, "sub");
+    }
+
+    if (inst->sets_flags && !context->liveness.dead_flags) {
+        emitter_update_flags(context, inst->opcode == 0x00 ? FLAGS_ADD : FLAGS_SUB,
+                             op1, op2, result, is_64bit);
+    }
+    if (!context->liveness.dead_result) {
+        write_result(context, inst->dest_reg, result, is_64bit, sp_allowed && !inst->sets_flags);
+    }
+    return true;
+}
+
+/* SBFM, BFM and UBFM. With imms >= immr, bits imms:immr of the source go
+ * to the bottom; otherwise bits imms:0 go to bits - immr.
+ */
+static LLVMValueRef emit_bitfield(EmitterContext* ctx, const Instruction* inst, bool is_64bit) {
+    LLVMBuilderRef builder = ctx->compiler->builder;
+    LLVMTypeRef type = width_type(ctx, is_64bit);
+    unsigned bits = is_64bit ? 64 : 32;
+    unsigned immr = (unsigned)instruction_get_immediate(inst, 1);
+    unsigned imms = (unsigned)instruction_get_immediate(inst, 2);
+    unsigned width = imms >= immr ? imms - immr + 1 : imms + 1;
+    unsigned position = imms >= immr ? 0 : bits - immr;
+    uint64_t mask = width == 64 ? UINT64_MAX : (1ULL << width) - 1;
+
+    LLVMValueRef field = read_width(ctx, instruction_get_register(inst, 0), is_64bit);
+    if (imms >= immr) field = LLVMBuildLShr(builder, field, LLVMConstInt(type, immr, false), "");
+    if (inst->opcode == 0x1A) {
+        LLVMValueRef top = LLVMConstInt(type, bits - width, false);
+        field = LLVMBuildAShr(builder, LLVMBuildShl(builder, field, top, ""), top, "");
+    } else {
+        field = LLVMBuildAnd(builder, field, LLVMConstInt(type, mask, false), "");
+    }
+    field = LLVMBuildShl(builder, field, LLVMConstInt(type, position, false), "bitfield");
+    if (inst->opcode != 0x1B) return field;
+
+    LLVMValueRef kept = LLVMBuildAnd(builder, read_width(ctx, inst->dest_reg, is_64bit),
+                                     LLVMConstInt(type, ~(mask << position), false), "");
+    return LLVMBuildOr(builder, kept, field, "bfm");
+}
+
+bool emitter_emit_logical(EmitterContext* context, const Instruction* inst) {
+    if (!context || !inst) return false;
+    if (context->liveness.dead_result && (!inst->sets_flags || context->liveness.dead_flags)) {
+        return true;
+    }
+
+    LLVMBuilderRef builder = context->compiler->builder;
+    bool is_64bit = instruction_is_64bit(inst);
+    LLVMTypeRef type = width_type(context, is_64bit);
+    bool immediate = instruction_get_operand_type(inst, 1) == OP_IMMEDIATE;
+
+    if (inst->opcode == 0x1A || inst->opcode == 0x1B || inst->opcode == 0x1C) {
+        write_result(context, inst->dest_reg, emit_bitfield(context, inst, is_64bit), is_64bit, false);
+        return true;
+    }
+
+    LLVMValueRef op1 = read_width(context, instruction_get_register(inst, 0), is_64bit);
+    LLVMValueRef op2 = inst->opcode == 0x1D ? read_width(context, instruction_get_register(inst, 1), is_64bit)
+                                            : shifted_operand(context, inst, 1, is_64bit);
+    if (!op1 || !op2) return false;
+
+    LLVMValueRef result;
+    switch (inst->opcode) {
+        case 0x10:
+            result = LLVMBuildAnd(builder, op1, op2, "and");
+            break;
+        case 0x11:
+            result = LLVMBuildOr(builder, op1, op2, "orr");
+            break;
+        case 0x12:
+            result = LLVMBuildXor(builder, op1, op2, "eor");
+            break;
+        case 0x13:
+            result = LLVMBuildAnd(builder, op1, LLVMBuildNot(builder, op2, ""), "bic");
+            break;
+        case 0x14:
+            result = LLVMBuildOr(builder, op1, LLVMBuildNot(builder, op2, ""), "orn");
+            break;
+        case 0x15:
+            result = LLVMBuildXor(builder, op1, LLVMBuildNot(builder, op2, ""), "eon");
+            break;
+        case 0x16: case 0x17: case 0x18: case 0x19: {
+            /* Shifts by register take the amount modulo the width */
+            LLVMValueRef amount = LLVMBuildAnd(builder, op2, LLVMConstInt(type, is_64bit ? 63 : 31, false), "");
+            if (inst->opcode == 0x16) {
+                result = LLVMBuildShl(builder, op1, amount, "lslv");
+            } else if (inst->opcode == 0x17) {
+                result = LLVMBuildLShr(builder, op1, amount, "lsrv");
+            } else if (inst->opcode == 0x18) {
+                result = LLVMBuildAShr(builder, op1, amount, "asrv");
+            } else {
+                LLVMValueRef args[] = { op1, op1, amount };
+                result = call_intrinsic(context, "llvm.fshr", args, 3);
+            }
+            break;
+        }
+        case 0x1D: {
+            /* EXTR: the low half of Rn:Rm shifted right by lsb */
+            LLVMValueRef args[] = { op1, op2, LLVMConstInt(type, instruction_get_immediate(inst, 2), false) };
+            result = call_intrinsic(context, "llvm.fshr", args, 3);
+            break;
+        }
+        default:
+            return false;
+    }
+
+    result = to_int64(context, result);
+    if (inst->sets_flags && !context->liveness.dead_flags) {
+        emitter_update_flags(context, FLAGS_LOGICAL, result, NULL, result, is_64bit);
+    }
+    if (!context->liveness.dead_result) {
+        /* Logical immediates without S may write SP */
+        write_result(context, inst->dest_reg, result, is_64bit, immediate && !inst->sets_flags);
+    }
+    return true;
+}
+
+/* REV16, REV32 and REV: byte reversal within containers of size bytes */
+static LLVMValueRef emit_byte_reverse(EmitterContext* ctx, LLVMValueRef value, uint8_t size) {
+    LLVMBuilderRef builder = ctx->compiler->builder;
+    LLVMTypeRef type = LLVMTypeOf(value);
+    unsigned bits = LLVMGetIntTypeWidth(type);
+    if (size * 8U == bits) return call_intrinsic(ctx, "llvm.bswap", &value, 1);
+
+    LLVMTypeRef containers = LLVMVectorType(LLVMIntTypeInContext(ctx->compiler->llvm_context, size * 8),
+                                            bits / (size * 8));
+    LLVMValueRef lanes = LLVMBuildBitCast(builder, value, containers, "");
+    return LLVMBuildBitCast(builder, call_intrinsic(ctx, "llvm.bswap", &lanes, 1), type, "rev");
+}
+
+bool emitter_emit_move(EmitterContext* context, const Instruction* inst) {
+    if (!context || !inst) return false;
+    if (context->liveness.dead_result) return true;
+
+    LLVMBuilderRef builder = context->compiler->builder;
+    LLVMTypeRef i64 = get_int64_type(context);
+    bool is_64bit = instruction_is_64bit(inst);
+    uint64_t imm = instruction_get_immediate(inst, 0);
+    LLVMValueRef result;
+
+    switch (inst->opcode) {
+        case 0x30:
+        case 0x31:
+            result = LLVMConstInt(i64, imm, false);
+            break;
+        case 0x32: {
+            /* MOVK keeps the other halfwords */
+            uint64_t field = 0xFFFFULL << instruction_get_immediate(inst, 1);
+            result = LLVMBuildAnd(builder, read_operand(context, inst->dest_reg, false),
+                                  LLVMConstInt(i64, ~field, false), "");
+            result = LLVMBuildOr(builder, result, LLVMConstInt(i64, imm, false), "movk");
+            break;
+        }
+        case 0x33:
+            result = LLVMConstInt(i64, context->pc + imm, false);
+            break;
+        case 0x34:
+            result = LLVMConstInt(i64, (context->pc & ~0xFFFULL) + imm, false);
+            break;
+        case 0x35: case 0x36: case 0x37: case 0x38: {
+            LLVMValueRef holds = emitter_get_condition_value(context, inst->condition);
+            LLVMValueRef a = read_width(context, instruction_get_register(inst, 0), is_64bit);
+            LLVMValueRef b = read_width(context, instruction_get_register(inst, 1), is_64bit);
+            if (inst->opcode == 0x36) b = LLVMBuildAdd(builder, b, LLVMConstInt(LLVMTypeOf(b), 1, false), "");
+            if (inst->opcode == 0x37) b = LLVMBuildNot(builder, b, "");
+            if (inst->opcode == 0x38) b = LLVMBuildNeg(builder, b, "");
+            result = LLVMBuildSelect(builder, holds, a, b, "csel");
+            break;
+        }
+        case 0x39: case 0x3A: case 0x3B: case 0x3C: {
+            LLVMValueRef value = read_width(context, instruction_get_register(inst, 0), is_64bit);
+            LLVMValueRef args[] = { value, LLVMConstInt(get_int1_type(context), 0, false) };
+            if (inst->opcode == 0x39) {
+                result = call_intrinsic(context, "llvm.bitreverse", args, 1);
+            } else if (inst->opcode == 0x3A) {
+                result = emit_byte_reverse(context, value, instruction_get_element_size(inst));
+            } else if (inst->opcode == 0x3B) {
+                result = call_intrinsic(context, "llvm.ctlz", args, 2);
+            } else {
+                /* CLS: leading zeros of x ^ (x >> 1), less the sign bit */
+                LLVMValueRef type_one = LLVMConstInt(LLVMTypeOf(value), 1, false);
+                args[0] = LLVMBuildXor(builder, value, LLVMBuildAShr(builder, value, type_one, ""), "");
+                result = LLVMBuildSub(builder, call_intrinsic(context, "llvm.ctlz", args, 2), type_one, "cls");
+            }
+            break;
+        }
+        default:
+            return false;
+    }
+
+    write_result(context, inst->dest_reg, result, is_64bit, false);
+    return true;
+}
+
+static LLVMValueRef get_slow_path_function(EmitterContext* ctx, bool is_store) {
+    const char* name = is_store ? "memory_store_slow" : "memory_load_slow";
+    LLVMValueRef func = LLVMGetNamedFunction(ctx->compiler->module, name);
+    if (func) return func;
+    
+    /* bool (Memory*, address, size, uint64_t value or uint64_t* value) */
+    LLVMTypeRef ptr_type = LLVMPointerType(get_int8_type(ctx), 0);
+    LLVMTypeRef param_types[] = {
+        ptr_type,
+        get_int64_type(ctx),
+        get_int64_type(ctx),
+        is_store ? get_int64_type(ctx) : LLVMPointerType(get_int64_type(ctx), 0)
+    };
+    LLVMTypeRef func_type = LLVMFunctionType(get_int8_type(ctx), param_types, 4, false);
+    return LLVMAddFunction(ctx->compiler->module, name, func_type);
+}
+
+/* Runtime functions linked from the helper bitcode take the C struct
+ * pointer types rather than i8*, so pointer arguments are cast to match.
+ */
+static LLVMValueRef build_runtime_call(EmitterContext* ctx, LLVMValueRef func,
+                                       LLVMValueRef* args, unsigned count) {
+    LLVMTypeRef func_type = LLVMGlobalGetValueType(func);
+    LLVMTypeRef param_types[8];
+    LLVMGetParamTypes(func_type, param_types);
+    for (unsigned i = 0; i < count; i++) {
+        if (LLVMTypeOf(args[i]) != param_types[i]) {
+            args[i] = LLVMBuildPointerCast(ctx->compiler->builder, args[i], param_types[i], "");
+        }
+    }
+    return LLVMBuildCall2(ctx->compiler->builder, func_type, func, args, count, "");
+}
+
+static LLVMValueRef get_load_slot(EmitterContext* ctx) {
+    if (ctx->load_slot) return ctx->load_slot;
+    
+    LLVMBuilderRef builder = ctx->compiler->builder;
+    LLVMBasicBlockRef current = LLVMGetInsertBlock(builder);
+    LLVMPositionBuilderBefore(builder, ctx->register_load_point);
+    ctx->load_slot = LLVMBuildAlloca(builder, get_int64_type(ctx), "load_slot");
+    LLVMPositionBuilderAtEnd(builder, current);
+    return ctx->load_slot;
+}
+
+/* Guest access of size bytes at address. The memory's TLB entry for the
+ * page is probed inline and a hit is a plain host load or store; a miss
+ * calls the slow path, and if that faults the block leaves with
+ * pc | BLOCK_FAULT. value is stored if non-NULL, otherwise the zero-extended
+ * loaded value is returned.
+ */
+static LLVMValueRef emit_guest_access(EmitterContext* ctx, LLVMValueRef address,
+                                      uint8_t size, LLVMValueRef value) {
+    LLVMBuilderRef builder = ctx->compiler->builder;
+    LLVMContextRef llvm_context = ctx->compiler->llvm_context;
+    LLVMTypeRef i64 = get_int64_type(ctx);
+    LLVMTypeRef access_type = LLVMIntTypeInContext(llvm_context, size * 8);
+    LLVMValueRef memory = LLVMGetParam(ctx->function, 1);
+    bool is_store = value != NULL;
+    
+    LLVMValueRef index = LLVMBuildLShr(builder, address, const_offset(ctx, MEMORY_PAGE_SHIFT), "");
+    index = LLVMBuildAnd(builder, index, const_offset(ctx, MEMORY_TLB_SIZE - 1), "tlb_index");
+    LLVMValueRef entry = LLVMBuildMul(builder, index, const_offset(ctx, sizeof(MemoryTLBEntry)), "");
+    entry = LLVMBuildAdd(builder, entry, const_offset(ctx, offsetof(Memory, tlb)), "");
+    entry = field_address(ctx, memory, entry, get_int8_type(ctx));
+    
+    size_t tag_offset = is_store ? offsetof(MemoryTLBEntry, write_tag) : offsetof(MemoryTLBEntry, read_tag);
+    LLVMValueRef tag = LLVMBuildLoad2(builder, i64, field_address(ctx, entry, const_offset(ctx, tag_offset), i64),
+                                      "tlb_tag");
+    set_access_class(ctx, tag, ACCESS_TLB);
+    /* Misaligned addresses keep low bits the tag never has */
+    LLVMValueRef masked = LLVMBuildAnd(builder, address,
+                                       const_offset(ctx, ~(MEMORY_PAGE_SIZE - 1) | (size - 1)), "");
+    
+    LLVMBasicBlockRef hit = LLVMAppendBasicBlockInContext(llvm_context, ctx->function, "tlb_hit");
+    LLVMBasicBlockRef miss = LLVMAppendBasicBlockInContext(llvm_context, ctx->function, "tlb_miss");
+    LLVMBasicBlockRef fault = LLVMAppendBasicBlockInContext(llvm_context, ctx->function, "fault");
+    LLVMBasicBlockRef done = LLVMAppendBasicBlockInContext(llvm_context, ctx->function, "access_done");
+    LLVMBuildCondBr(builder, LLVMBuildICmp(builder, LLVMIntEQ, tag, masked, "tlb_match"), hit, miss);
+    
+    LLVMPositionBuilderAtEnd(builder, hit);
+    LLVMValueRef addend = LLVMBuildLoad2(builder, i64,
+        field_address(ctx, entry, const_offset(ctx, offsetof(MemoryTLBEntry, addend)), i64), "tlb_addend");
+    set_access_class(ctx, addend, ACCESS_TLB);
+    LLVMValueRef host = LLVMBuildIntToPtr(builder, LLVMBuildAdd(builder, address, addend, ""),
+                                          LLVMPointerType(access_type, 0), "host");
+    LLVMValueRef hit_value = NULL;
+    if (is_store) {
+        LLVMValueRef stored = LLVMBuildStore(builder, LLVMBuildTrunc(builder, value, access_type, ""), host);
+        LLVMSetAlignment(stored, size);
+        set_access_class(ctx, stored, ACCESS_GUEST_MEMORY);
+    } else {
+        LLVMValueRef loaded = LLVMBuildLoad2(builder, access_type, host, "");
+        LLVMSetAlignment(loaded, size);
+        set_access_class(ctx, loaded, ACCESS_GUEST_MEMORY);
+        hit_value = LLVMBuildZExt(builder, loaded, i64, "");
+    }
+    LLVMBuildBr(builder, done);
+    
+    LLVMPositionBuilderAtEnd(builder, miss);
+    LLVMValueRef slow_path = get_slow_path_function(ctx, is_store);
+    LLVMValueRef args[] = {
+        memory,
+        address,
+        const_offset(ctx, size),
+        is_store ? value : get_load_slot(ctx)
+    };
+    LLVMValueRef ok = build_runtime_call(ctx, slow_path, args, 4);
+    LLVMValueRef miss_value = is_store ? NULL : LLVMBuildLoad2(builder, i64, get_load_slot(ctx), "");
+    LLVMBuildCondBr(builder, LLVMBuildIsNotNull(builder, ok, ""), done, fault);
+    
+    LLVMPositionBuilderAtEnd(builder, fault);
+    emitter_write_back_registers(ctx);
+    LLVMBuildRet(builder, const_offset(ctx, ctx->pc | BLOCK_FAULT));
+    
+    LLVMPositionBuilderAtEnd(builder, done);
+    ctx->current_block = done;
+    if (is_store) return value;
+    
+    LLVMValueRef result = LLVMBuildPhi(builder, i64, "loaded");
+    LLVMValueRef values[] = { hit_value, miss_value };
+    LLVMBasicBlockRef blocks[] = { hit, miss };
+    LLVMAddIncoming(result, values, blocks, 2);
+    return result;
+}
+
+/* SIMD&FP registers move through the low and high 64-bit halves; a Q
+ * register is two 8-byte accesses.
+ */
+static void emit_vector_transfer(EmitterContext* ctx, uint8_t reg, uint8_t size, bool is_store,
+                                 LLVMValueRef address) {
+    LLVMBuilderRef builder = ctx->compiler->builder;
+    LLVMTypeRef halves_type = LLVMVectorType(get_int64_type(ctx), 2);
+    uint8_t part_size = size > 8 ? 8 : size;
+    size_t parts = size > 8 ? 2 : 1;
+    
+    if (is_store) {
+        LLVMValueRef halves = LLVMBuildBitCast(builder, emitter_get_vector(ctx, reg), halves_type, "");
+        for (size_t i = 0; i < parts; i++) {
+            LLVMValueRef part = LLVMBuildExtractElement(builder, halves, const_offset(ctx, i), "");
+            LLVMValueRef part_address = LLVMBuildAdd(builder, address, const_offset(ctx, i * 8), "");
+            emit_guest_access(ctx, part_address, part_size, part);
+        }
+        return;
+    }
+    
+    /* Loads clear the rest of the register */
+    LLVMValueRef halves = LLVMConstNull(halves_type);
+    for (size_t i = 0; i < parts; i++) {
+        LLVMValueRef part_address = LLVMBuildAdd(builder, address, const_offset(ctx, i * 8), "");
+        LLVMValueRef part = emit_guest_access(ctx, part_address, part_size, NULL);
+        halves = LLVMBuildInsertElement(builder, halves, part, const_offset(ctx, i), "");
+    }
+    emitter_set_vector(ctx, reg, halves);
+}
+
+/* A loaded value of size bytes, sign-extended by LDRS* and LDPSW */
+static LLVMValueRef extend_loaded(EmitterContext* ctx, const Instruction* inst, LLVMValueRef value, uint8_t size) {
+    LLVMBuilderRef builder = ctx->compiler->builder;
+    if (inst->opcode != 0x46 && inst->opcode != 0x47 && inst->opcode != 0x4A) return value;
+    
+    LLVMValueRef narrow = LLVMBuildTrunc(builder, value, LLVMIntTypeInContext(ctx->compiler->llvm_context, size * 8), "");
+    if (inst->opcode == 0x47) {
+        return LLVMBuildZExt(builder, LLVMBuildSExt(builder, narrow, get_int32_type(ctx), ""), get_int64_type(ctx), "");
+    }
+    return LLVMBuildSExt(builder, narrow, get_int64_type(ctx), "");
+}
+
+bool emitter_emit_memory(EmitterContext* context, const Instruction* inst) {
+    if (!context || !inst) return false;
+    
+    Operand mem = instruction_get_operand(inst, 0);
+    if (mem.type != OP_MEMORY || inst->opcode < 0x40 || inst->opcode > 0x4E) return false;
+    
+    /* The base may be SP; the index and transfer registers 31 are XZR */
+    LLVMBuilderRef builder = context->compiler->builder;
+    LLVMValueRef base = NULL;
+    LLVMValueRef address;
+    LLVMValueRef updated = NULL;
+    if (mem.value.mem.mode == ADDR_LITERAL) {
+        address = const_offset(context, context->pc + (int64_t)mem.value.mem.offset);
+    } else {
+        base = read_operand(context, mem.value.mem.base_reg, true);
+        LLVMValueRef offset = mem.value.mem.index_reg != 0xFF
+            ? extended_register(context, mem.value.mem.index_reg, mem.value.mem.extend, mem.value.mem.shift_amount)
+            : LLVMConstInt(get_int64_type(context), (int64_t)mem.value.mem.offset, true);
+        updated = LLVMBuildAdd(builder, base, offset, "address");
+        address = mem.value.mem.mode == ADDR_POST_INDEX ? base : updated;
+    }
+    uint8_t size = instruction_get_access_size(inst);
+    LLVMValueRef second_address = NULL;
+    if (inst->opcode >= 0x48 && inst->opcode <= 0x4C) {
+        second_address = LLVMBuildAdd(builder, address, const_offset(context, size), "");
+    }
+    uint8_t second_reg = instruction_get_register(inst, 1);
+    LLVMValueRef loaded[2] = { NULL, NULL };
+    
+    /* Every access happens before any register changes: if one faults,
+     * the block leaves with the state from before the instruction
+     */
+    switch (inst->opcode) {
+        case 0x42: case 0x43: case 0x44: case 0x45:
+            emit_vector_transfer(context, inst->dest_reg, size, inst->opcode & 1, address);
+            break;
+        case 0x4B:
+        case 0x4C:
+            emit_vector_transfer(context, inst->dest_reg, size, inst->opcode == 0x4C, address);
+            emit_vector_transfer(context, second_reg, size, inst->opcode == 0x4C, second_address);
+            break;
+        case 0x41:
+        case 0x4E:
+            emit_guest_access(context, address, size, read_operand(context, inst->dest_reg, false));
+            break;
+        case 0x49:
+            emit_guest_access(context, address, size, read_operand(context, inst->dest_reg, false));
+            emit_guest_access(context, second_address, size, read_operand(context, second_reg, false));
+            break;
+        case 0x48:
+        case 0x4A:
+            /* Loaded even if the result is dead, since the access may fault */
+            loaded[0] = extend_loaded(context, inst, emit_guest_access(context, address, size, NULL), size);
+            loaded[1] = extend_loaded(context, inst, emit_guest_access(context, second_address, size, NULL), size);
+            break;
+        default:
+            loaded[0] = extend_loaded(context, inst, emit_guest_access(context, address, size, NULL), size);
+            break;
+    }
+    
+    /* Writeback comes first, so a load into the base register wins */
+    if (base && mem.value.mem.mode != ADDR_OFFSET) {
+        write_result(context, mem.value.mem.base_reg, updated, true, true);
+    }
+    /* A single guest thread holds the exclusive monitor, so STXR succeeds */
+    if (inst->opcode == 0x4E) {
+        write_result(context, second_reg, const_offset(context, 0), true, false);
+    }
+    if (loaded[0] && !context->liveness.dead_result) {
+        write_result(context, inst->dest_reg, loaded[0], true, false);
+        if (loaded[1]) write_result(context, second_reg, loaded[1], true, false);
+    }
+    return true;
+}
+
+/* A V register as lanes of size bytes, integer or floating point */
+static LLVMValueRef get_lanes(EmitterContext* ctx, uint8_t reg, uint8_t size, bool is_float) {
+    LLVMContextRef llvm_context = ctx->compiler->llvm_context;
+    LLVMTypeRef element = LLVMIntTypeInContext(llvm_context, size * 8);
+    if (is_float) {
+        element = size == 8 ? LLVMDoubleTypeInContext(llvm_context) : LLVMFloatTypeInContext(llvm_context);
+    }
+    return LLVMBuildBitCast(ctx->compiler->builder, emitter_get_vector(ctx, reg),
+                            LLVMVectorType(element, 16 / size), "");
+}
+
+static LLVMValueRef const_lanes(EmitterContext* ctx, const unsigned* lanes, unsigned count) {
+    LLVMValueRef values[16];
+    for (unsigned i = 0; i < count; i++) {
+        values[i] = LLVMConstInt(get_int32_type(ctx), lanes[i], false);
+    }
+    return LLVMConstVector(values, count);
+}
+
+/* 64-bit (.8B, .4H, .2S) results clear the upper half of the register */
+static void set_lanes(EmitterContext* ctx, uint8_t reg, LLVMValueRef value, uint8_t vector_size) {
+    if (vector_size == 8) {
+        LLVMBuilderRef builder = ctx->compiler->builder;
+        LLVMTypeRef halves_type = LLVMVectorType(get_int64_type(ctx), 2);
+        static const unsigned low_half[] = { 0, 2 };
+        value = LLVMBuildShuffleVector(builder, LLVMBuildBitCast(builder, value, halves_type, ""),
+                                       LLVMConstNull(halves_type), const_lanes(ctx, low_half, 2), "");
+    }
+    emitter_set_vector(ctx, reg, value);
+}
+
+/* Result lane i of a permute, as a shufflevector index: the second
+ * operand's lanes follow the first's 16 / size lanes. Only the first
+ * active lanes (8 or 16 bytes' worth) take part.
+ */
+static unsigned permute_source(uint8_t opcode, unsigned i, unsigned active, unsigned total, unsigned index) {
+    unsigned second = (i & 1) ? total : 0;
+    unsigned j;
+    switch (opcode) {
+        case 0x60: return i / 2 + second;                       /* ZIP1 */
+        case 0x61: return active / 2 + i / 2 + second;          /* ZIP2 */
+        case 0x64: return (i & ~1U) + second;                   /* TRN1 */
+        case 0x65: return (i | 1) + second;                     /* TRN2 */
+        case 0x62: j = 2 * i; break;                            /* UZP1 */
+        case 0x63: j = 2 * i + 1; break;                        /* UZP2 */
+        default: j = index + i; break;                          /* EXT */
+    }
+    return j < active ? j : total + j - active;
+}
+
+static LLVMValueRef emit_permute(EmitterContext* ctx, const Instruction* inst) {
+    uint8_t size = instruction_get_element_size(inst);
+    unsigned total = 16 / size;
+    unsigned active = instruction_get_vector_size(inst) / size;
+    unsigned index = inst->opcode == 0x66 ? (unsigned)instruction_get_immediate(inst, 2) : 0;
+    
+    unsigned lanes[16];
+    for (unsigned i = 0; i < total; i++) {
+        lanes[i] = i < active ? permute_source(inst->opcode, i, active, total, index) : 0;
+    }
+    return LLVMBuildShuffleVector(ctx->compiler->builder,
+                                  get_lanes(ctx, instruction_get_register(inst, 0), size, false),
+                                  get_lanes(ctx, instruction_get_register(inst, 1), size, false),
+                                  const_lanes(ctx, lanes, total), "permute");
+}
+
+bool emitter_emit_vector(EmitterContext* context, const Instruction* inst) {
+    if (!context || !inst) return false;
+    
+    LLVMBuilderRef builder = context->compiler->builder;
+    uint8_t size = instruction_get_element_size(inst);
+    uint8_t rn = instruction_get_register(inst, 0);
+    uint8_t rm = instruction_get_register(inst, 1);
+    uint64_t imm = instruction_get_immediate(inst, 1);
+    LLVMTypeRef lane_type = LLVMIntTypeInContext(context->compiler->llvm_context, size * 8);
+    bool is_float = inst->opcode >= 0x5A && inst->opcode <= 0x5D;
+    LLVMValueRef result;
+    
+    if (inst->opcode >= 0x50 && inst->opcode <= 0x5D) {
+        LLVMValueRef a = get_lanes(context, rn, size, is_float);
+        LLVMValueRef b = get_lanes(context, rm, size, is_float);
+        switch (inst->opcode) {
+            case 0x50: result = LLVMBuildAdd(builder, a, b, "vadd"); break;
+            case 0x51: result = LLVMBuildSub(builder, a, b, "vsub"); break;
+            case 0x52: result = LLVMBuildMul(builder, a, b, "vmul"); break;
+            case 0x53: result = LLVMBuildAnd(builder, a, b, "vand"); break;
+            case 0x54: result = LLVMBuildAnd(builder, a, LLVMBuildNot(builder, b, ""), "vbic"); break;
+            case 0x55: result = LLVMBuildOr(builder, a, b, "vorr"); break;
+            case 0x56: result = LLVMBuildXor(builder, a, b, "veor"); break;
+            case 0x57:
+            case 0x58:
+            case 0x59: {
+                /* Compares set each lane to all ones or zero */
+                LLVMIntPredicate predicate = inst->opcode == 0x57 ? LLVMIntEQ
+                                           : inst->opcode == 0x58 ? LLVMIntSGT : LLVMIntUGT;
+                result = LLVMBuildSExt(builder, LLVMBuildICmp(builder, predicate, a, b, ""),
+                                       LLVMTypeOf(a), "vcmp");
+                break;
+            }
+            case 0x5A: result = LLVMBuildFAdd(builder, a, b, "vfadd"); break;
+            case 0x5B: result = LLVMBuildFSub(builder, a, b, "vfsub"); break;
+            case 0x5C: result = LLVMBuildFMul(builder, a, b, "vfmul"); break;
+            default: result = LLVMBuildFDiv(builder, a, b, "vfdiv"); break;
+        }
+        set_lanes(context, inst->dest_reg, result, instruction_get_vector_size(inst));
+        return true;
+    }
+    
+    switch (inst->opcode) {
+        case 0x60: case 0x61: case 0x62: case 0x63: case 0x64: case 0x65: case 0x66:
+            result = emit_permute(context, inst);
+            break;
+            
+        case 0x67: {
+            /* DUP: splat the low lane bits of Xn */
+            LLVMValueRef value = LLVMBuildTrunc(builder, read_operand(context, rn, false), lane_type, "");
+            LLVMTypeRef type = LLVMVectorType(lane_type, 16 / size);
+            result = LLVMBuildInsertElement(builder, LLVMGetUndef(type), value, const_offset(context, 0), "");
+            result = LLVMBuildShuffleVector(builder, result, LLVMGetUndef(type),
+                                            LLVMConstNull(LLVMVectorType(get_int32_type(context), 16 / size)),
+                                            "vdup");
+            break;
+        }
+            
+        case 0x68: {
+            /* UMOV: lane to general register, zero-extended */
+            if (context->liveness.dead_result) return true;
+            LLVMValueRef lane = LLVMBuildExtractElement(builder, get_lanes(context, rn, size, false),
+                                                        const_offset(context, imm), "");
+            write_result(context, inst->dest_reg, LLVMBuildZExt(builder, lane, get_int64_type(context), "umov"),
+                         true, false);
+            return true;
+        }
+            
+        case 0x69: {
+            /* INS: replaces one lane and keeps the others, whatever the width */
+            LLVMValueRef value = LLVMBuildTrunc(builder, read_operand(context, rn, false), lane_type, "");
+            result = LLVMBuildInsertElement(builder, get_lanes(context, inst->dest_reg, size, false), value,
+                                            const_offset(context, imm), "vins");
+            emitter_set_vector(context, inst->dest_reg, result);
+            return true;
+        }
+            
+        case 0x6A:
+        case 0x6B:
+        case 0x6C: {
+            LLVMValueRef a = get_lanes(context, rn, size, false);
+            unsigned bits = size * 8;
+            /* A right shift by the full lane width is valid here but not in LLVM */
+            if (inst->opcode == 0x6B && imm == bits) {
+                result = LLVMConstNull(LLVMTypeOf(a));
+                break;
+            }
+            if (inst->opcode == 0x6C && imm == bits) imm = bits - 1;
+            
+            LLVMValueRef amounts[16];
+            for (unsigned i = 0; i < 16 / size; i++) {
+                amounts[i] = LLVMConstInt(lane_type, imm, false);
+            }
+            LLVMValueRef amount = LLVMConstVector(amounts, 16 / size);
+            if (inst->opcode == 0x6A) {
+                result = LLVMBuildShl(builder, a, amount, "vshl");
+            } else if (inst->opcode == 0x6B) {
+                result = LLVMBuildLShr(builder, a, amount, "vushr");
+            } else {
+                result = LLVMBuildAShr(builder, a, amount, "vsshr");
+            }
+            break;
+        }
+            
+        default:
+            return false;
+    }
+    
+    set_lanes(context, inst->dest_reg, result, instruction_get_vector_size(inst));
+    return true;
+}
+
+/* Scalar S and D registers are the low lane of a V register; writes clear the rest */
+static LLVMValueRef get_fp_register(EmitterContext* ctx, uint8_t reg, uint8_t size, bool is_float) {
+    return LLVMBuildExtractElement(ctx->compiler->builder, get_lanes(ctx, reg, size, is_float),
+                                   const_offset(ctx, 0), "");
+}
+
+static void set_fp_register(EmitterContext* ctx, uint8_t reg, LLVMValueRef value, uint8_t size) {
+    LLVMValueRef lanes = LLVMConstNull(LLVMVectorType(LLVMTypeOf(value), 16 / size));
+    emitter_set_vector(ctx, reg, LLVMBuildInsertElement(ctx->compiler->builder, lanes, value,
+                                                        const_offset(ctx, 0), ""));
+}
+
+static LLVMValueRef fp_control_address(EmitterContext* ctx, size_t offset) {
+    return field_address(ctx, LLVMGetParam(ctx->function, 0), const_offset(ctx, offset), get_int32_type(ctx));
+}
+
+/* Round to nearest, no flush-to-zero and no default NaN. FPCR is read
+ * once, in the entry block, until an MSR writes it; from then on each
+ * operation reads it where it runs.
+ */
+static LLVMValueRef get_fpcr_default(EmitterContext* ctx) {
+    if (ctx->fpcr_default && !ctx->fpcr_written) return ctx->fpcr_default;
+    
+    LLVMBuilderRef builder = ctx->compiler->builder;
+    LLVMTypeRef i32 = get_int32_type(ctx);
+    LLVMBasicBlockRef current = LLVMGetInsertBlock(builder);
+    if (!ctx->fpcr_written) LLVMPositionBuilderBefore(builder, ctx->register_load_point);
+    LLVMValueRef fpcr = LLVMBuildLoad2(builder, i32, fp_control_address(ctx, offsetof(RegisterFile, fpcr)), "fpcr");
+    set_access_class(ctx, fpcr, ACCESS_GUEST_FP_CONTROL);
+    LLVMValueRef exact = LLVMBuildAnd(builder, fpcr, LLVMConstInt(i32, FPCR_EXACT_MASK, false), "");
+    LLVMValueRef is_default = LLVMBuildICmp(builder, LLVMIntEQ, exact, LLVMConstNull(i32), "fpcr_default");
+    if (ctx->fpcr_written) return is_default;
+    ctx->fpcr_default = is_default;
+    LLVMPositionBuilderAtEnd(builder, current);
+    return ctx->fpcr_default;
+}
+
+/* fpu_exact_*: (RegisterFile*, op, a, b, c), or (RegisterFile*, value) for FCVT */
+static LLVMValueRef get_exact_function(EmitterContext* ctx, FPUOperation op,
+                                       LLVMTypeRef operand_type, LLVMTypeRef result_type) {
+    bool is_double = LLVMGetTypeKind(operand_type) == LLVMDoubleTypeKind;
+    const char* name = is_double ? "fpu_exact_double" : "fpu_exact_float";
+    if (op == FPU_CONVERT) name = is_double ? "fpu_exact_narrow" : "fpu_exact_widen";
+    LLVMValueRef func = LLVMGetNamedFunction(ctx->compiler->module, name);
+    if (func) return func;
+    
+    LLVMTypeRef param_types[] = {
+        LLVMPointerType(get_int8_type(ctx), 0),
+        get_int64_type(ctx),
+        operand_type,
+        operand_type,
+        operand_type
+    };
+    if (op == FPU_CONVERT) param_types[1] = operand_type;
+    LLVMTypeRef func_type = LLVMFunctionType(result_type, param_types, op == FPU_CONVERT ? 2 : 5, false);
+    return LLVMAddFunction(ctx->compiler->module, name, func_type);
+}
+
+/* An operation whose result depends on FPCR. The fast path is the native
+ * LLVM operation and leaves FPSR alone; the exact path calls into fpu.c.
+ * b and c may be NULL when op does not use them.
+ */
+static LLVMValueRef emit_fp_operation(EmitterContext* ctx, FPUOperation op, LLVMValueRef a,
+                                      LLVMValueRef b, LLVMValueRef c, LLVMTypeRef result_type) {
+    LLVMBuilderRef builder = ctx->compiler->builder;
+    LLVMContextRef llvm_context = ctx->compiler->llvm_context;
+    LLVMBasicBlockRef fast = LLVMAppendBasicBlockInContext(llvm_context, ctx->function, "fp_fast");
+    LLVMBasicBlockRef exact = LLVMAppendBasicBlockInContext(llvm_context, ctx->function, "fp_exact");
+    LLVMBasicBlockRef done = LLVMAppendBasicBlockInContext(llvm_context, ctx->function, "fp_done");
+    LLVMBuildCondBr(builder, get_fpcr_default(ctx), fast, exact);
+    
+    LLVMPositionBuilderAtEnd(builder, fast);
+    LLVMValueRef fast_value;
+    LLVMValueRef args[] = { a, b, c };
+    switch (op) {
+        case FPU_ADD: fast_value = LLVMBuildFAdd(builder, a, b, "fadd"); break;
+        case FPU_SUB: fast_value = LLVMBuildFSub(builder, a, b, "fsub"); break;
+        case FPU_MUL: fast_value = LLVMBuildFMul(builder, a, b, "fmul"); break;
+        case FPU_DIV: fast_value = LLVMBuildFDiv(builder, a, b, "fdiv"); break;
+        case FPU_FMA: fast_value = call_intrinsic(ctx, "llvm.fma", args, 3); break;
+        case FPU_SQRT: fast_value = call_intrinsic(ctx, "llvm.sqrt", args, 1); break;
+        default:
+            fast_value = LLVMGetTypeKind(result_type) == LLVMDoubleTypeKind
+                ? LLVMBuildFPExt(builder, a, result_type, "fcvt")
+                : LLVMBuildFPTrunc(builder, a, result_type, "fcvt");
+            break;
+    }
+    LLVMBuildBr(builder, done);
+    
+    LLVMPositionBuilderAtEnd(builder, exact);
+    LLVMValueRef func = get_exact_function(ctx, op, LLVMTypeOf(a), result_type);
+    LLVMValueRef zero = LLVMConstNull(LLVMTypeOf(a));
+    LLVMValueRef call_args[] = {
+        LLVMGetParam(ctx->function, 0),
+        const_offset(ctx, op),
+        a,
+        b ? b : zero,
+        c ? c : zero
+    };
+    if (op == FPU_CONVERT) call_args[1] = a;
+    LLVMValueRef exact_value = build_runtime_call(ctx, func, call_args, op == FPU_CONVERT ? 2 : 5);
+    LLVMBuildBr(builder, done);
+    
+    LLVMPositionBuilderAtEnd(builder, done);
+    ctx->current_block = done;
+    LLVMValueRef result = LLVMBuildPhi(builder, result_type, "fp_result");
+    LLVMValueRef values[] = { fast_value, exact_value };
+    LLVMBasicBlockRef blocks[] = { fast, exact };
+    LLVMAddIncoming(result, values, blocks, 2);
+    return result;
+}
+
+/* FCMP: unordered is C and V, equal Z and C, less N, greater C alone */
+static void emit_fp_compare(EmitterContext* ctx, LLVMValueRef a, LLVMValueRef b) {
+    LLVMBuilderRef builder = ctx->compiler->builder;
+    LLVMTypeRef i64 = get_int64_type(ctx);
+    const struct { LLVMRealPredicate predicate; unsigned bit; } flags[] = {
+        { LLVMRealOLT, NZCV_N },
+        { LLVMRealOEQ, NZCV_Z },
+        { LLVMRealUGE, NZCV_C },
+        { LLVMRealUNO, NZCV_V },
+    };
+    
+    LLVMValueRef nzcv = LLVMConstInt(i64, 0, false);
+    for (size_t i = 0; i < sizeof(flags) / sizeof(flags[0]); i++) {
+        LLVMValueRef flag = LLVMBuildZExt(builder, LLVMBuildFCmp(builder, flags[i].predicate, a, b, ""), i64, "");
+        flag = LLVMBuildShl(builder, flag, LLVMConstInt(i64, flags[i].bit, false), "");
+        nzcv = LLVMBuildOr(builder, nzcv, flag, "");
+    }
+    emitter_update_flags(ctx, FLAGS_IN_REGISTER, NULL, NULL, NULL, true);
+    emitter_set_register(ctx, ARM64_REG_NZCV, nzcv);
+}
+
+bool emitter_emit_float(EmitterContext* context, const Instruction* inst) {
+    if (!context || !inst) return false;
+    
+    LLVMBuilderRef builder = context->compiler->builder;
+    uint8_t size = instruction_get_element_size(inst);
+    uint8_t rn = instruction_get_register(inst, 0);
+    uint8_t rm = instruction_get_register(inst, 1);
+    LLVMTypeRef type = size == 8 ? LLVMDoubleTypeInContext(context->compiler->llvm_context)
+                                 : LLVMFloatTypeInContext(context->compiler->llvm_context);
+    LLVMValueRef result;
+    
+    switch (inst->opcode) {
+        case 0x70: case 0x71: case 0x72: case 0x73: {
+            static const FPUOperation ops[] = { FPU_ADD, FPU_SUB, FPU_MUL, FPU_DIV };
+            result = emit_fp_operation(context, ops[inst->opcode - 0x70], get_fp_register(context, rn, size, true),
+                                       get_fp_register(context, rm, size, true), NULL, type);
+            break;
+        }
+            
+        case 0x74: case 0x75: case 0x76: case 0x77: {
+            /* Ra +/- Rn * Rm, and FNMADD/FNMSUB negate Ra; negation is exact */
+            LLVMValueRef n = get_fp_register(context, rn, size, true);
+            LLVMValueRef addend = get_fp_register(context, instruction_get_register(inst, 2), size, true);
+            if (inst->opcode == 0x75 || inst->opcode == 0x76) n = LLVMBuildFNeg(builder, n, "");
+            if (inst->opcode >= 0x76) addend = LLVMBuildFNeg(builder, addend, "");
+            result = emit_fp_operation(context, FPU_FMA, n, get_fp_register(context, rm, size, true), addend, type);
+            break;
+        }
+            
+        case 0x78: result = get_fp_register(context, rn, size, true); break;
+        case 0x79: {
+            LLVMValueRef value = get_fp_register(context, rn, size, true);
+            result = call_intrinsic(context, "llvm.fabs", &value, 1);
+            break;
+        }
+        case 0x7A: result = LLVMBuildFNeg(builder, get_fp_register(context, rn, size, true), "fneg"); break;
+        case 0x7B:
+            result = emit_fp_operation(context, FPU_SQRT, get_fp_register(context, rn, size, true), NULL, NULL, type);
+            break;
+            
+        case 0x7C: {
+            uint8_t target = (uint8_t)instruction_get_immediate(inst, 1);
+            LLVMTypeRef target_type = target == 8 ? LLVMDoubleTypeInContext(context->compiler->llvm_context)
+                                                  : LLVMFloatTypeInContext(context->compiler->llvm_context);
+            result = emit_fp_operation(context, FPU_CONVERT, get_fp_register(context, rn, size, true),
+                                       NULL, NULL, target_type);
+            set_fp_register(context, inst->dest_reg, result, target);
+            return true;
+        }
+            
+        case 0x7D: {
+            /* FZ is not applied to the operands; FCMPE's signalling is not modelled */
+            if (context->liveness.dead_flags) return true;
+            LLVMValueRef b = instruction_get_operand_type(inst, 1) == OP_IMMEDIATE ? LLVMConstReal(type, 0.0)
+                                                                    : get_fp_register(context, rm, size, true);
+            emit_fp_compare(context, get_fp_register(context, rn, size, true), b);
+            return true;
+        }
+            
+        case 0x7E:
+            /* FMOV to a general register: the bits, zero-extended */
+            if (context->liveness.dead_result) return true;
+            write_result(context, inst->dest_reg,
+                         LLVMBuildZExt(builder, get_fp_register(context, rn, size, false), get_int64_type(context), ""),
+                         true, false);
+            return true;
+            
+        case 0x7F: {
+            LLVMTypeRef bits = LLVMIntTypeInContext(context->compiler->llvm_context, size * 8);
+            result = LLVMBuildTrunc(builder, read_operand(context, rn, false), bits, "");
+            break;
+        }
+            
+        default:
+            return false;
+    }
+    
+    set_fp_register(context, inst->dest_reg, result, size);
+    return true;
+}
+
+static bool writes_fpcr(const Instruction* inst) {
+    return inst->type == INST_SYSTEM && inst->opcode == 0x82 && instruction_get_immediate(inst, 1) == SYSREG_FPCR;
+}
+
+/* MRS and MSR of NZCV, FPCR and FPSR; everything else decoded as a
+ * system instruction is a NOP. FPCR and FPSR stay in the register file,
+ * where the exact FP path reads and updates them.
+ */
+bool emitter_emit_system(EmitterContext* context, const Instruction* inst) {
+    if (!context || !inst) return false;
+    
+    LLVMBuilderRef builder = context->compiler->builder;
+    LLVMTypeRef i64 = get_int64_type(context);
+    switch (inst->opcode) {
+        case 0x80:
+            return true;
+            
+        case 0x81: {
+            if (context->liveness.dead_result) return true;
+            uint64_t sysreg = instruction_get_immediate(inst, 0);
+            LLVMValueRef value;
+            if (sysreg == SYSREG_NZCV) {
+                value = context->flags.op == FLAGS_IN_REGISTER ? emitter_get_register(context, ARM64_REG_NZCV)
+                                                               : packed_flags(context);
+            } else {
+                size_t offset = sysreg == SYSREG_FPCR ? offsetof(RegisterFile, fpcr) : offsetof(RegisterFile, fpsr);
+                value = LLVMBuildLoad2(builder, get_int32_type(context), fp_control_address(context, offset), "");
+                set_access_class(context, value, ACCESS_GUEST_FP_CONTROL);
+            }
+            write_result(context, inst->dest_reg, to_int64(context, value), true, false);
+            return true;
+        }
+            
+        case 0x82: {
+            uint64_t sysreg = instruction_get_immediate(inst, 1);
+            LLVMValueRef value = read_operand(context, instruction_get_register(inst, 0), false);
+            if (sysreg == SYSREG_NZCV) {
+                if (context->liveness.dead_flags) return true;
+                emitter_update_flags(context, FLAGS_IN_REGISTER, NULL, NULL, NULL, true);
+                emitter_set_register(context, ARM64_REG_NZCV,
+                                     LLVMBuildAnd(builder, value, LLVMConstInt(i64, 0xF0000000ULL, false), "nzcv"));
+                return true;
+            }
+            size_t offset = sysreg == SYSREG_FPCR ? offsetof(RegisterFile, fpcr) : offsetof(RegisterFile, fpsr);
+            LLVMValueRef store = LLVMBuildStore(builder, LLVMBuildTrunc(builder, value, get_int32_type(context), ""),
+                                                fp_control_address(context, offset));
+            set_access_class(context, store, ACCESS_GUEST_FP_CONTROL);
+            if (sysreg == SYSREG_FPCR) context->fpcr_written = true;
+            return true;
+        }
+            
+        default:
+            return false;
+    }
+}
+
+static void set_link_register(EmitterContext* ctx, uint64_t return_pc) {
+    emitter_set_register(ctx, 30, LLVMConstInt(get_int64_type(ctx), return_pc, false));
+}
+
+static bool add_exit_target(EmitterContext* ctx, uint64_t target_pc) {
+    if (ctx->exit_count == ctx->exit_capacity) {
+        size_t capacity = ctx->exit_capacity ? ctx->exit_capacity * 2 : 4;
+        uint64_t* targets = (uint64_t*)realloc(ctx->exit_targets, capacity * sizeof(uint64_t));
+        if (!targets) return false;
+        ctx->exit_targets = targets;
+        ctx->exit_capacity = capacity;
+    }
+    ctx->exit_targets[ctx->exit_count++] = target_pc;
+    return true;
+}
+
+/* Tail-calls successor's code as successor(registers, memory, successor) */
+static void emit_chain_call(EmitterContext* ctx, LLVMValueRef successor) {
+    LLVMBuilderRef builder = ctx->compiler->builder;
+    LLVMValueRef code = load_pointer_field(ctx, successor, offsetof(JITBlock, code), "code");
+    code = LLVMBuildBitCast(builder, code, LLVMPointerType(ctx->function_type, 0), "");
+    LLVMValueRef args[] = {
+        LLVMGetParam(ctx->function, 0),
+        LLVMGetParam(ctx->function, 1),
+        successor
+    };
+    LLVMValueRef result = LLVMBuildCall2(builder, ctx->function_type, code, args, 3, "");
+    LLVMSetTailCall(result, true);
+    LLVMBuildRet(builder, result);
+}
+
+/* &self->exits[index], as an i8 pointer */
+static LLVMValueRef exit_address(EmitterContext* ctx, size_t index) {
+    LLVMValueRef exits = load_pointer_field(ctx, LLVMGetParam(ctx->function, 2),
+                                            offsetof(JITBlock, exits), "exits");
+    return field_address(ctx, exits, const_offset(ctx, index * sizeof(BlockExit)), get_int8_type(ctx));
+}
+
+/* exit->target, published by the linker */
+static LLVMValueRef load_exit_target(EmitterContext* ctx, LLVMValueRef exit) {
+    LLVMValueRef successor = load_pointer_field(ctx, exit, offsetof(BlockExit, target), "successor");
+    LLVMSetOrdering(successor, LLVMAtomicOrderingMonotonic);
+    LLVMSetAlignment(successor, sizeof(void*));
+    return successor;
+}
+
+bool emitter_emit_exit(EmitterContext* context, uint64_t target_pc) {
+    if (!context) return false;
+    
+    size_t index = context->exit_count;
+    if (!add_exit_target(context, target_pc)) return false;
+    emitter_write_back_registers(context);
+    
+    LLVMBuilderRef builder = context->compiler->builder;
+    LLVMContextRef llvm_context = context->compiler->llvm_context;
+    
+    /* successor = self->exits[index].target */
+    LLVMValueRef successor = load_exit_target(context, exit_address(context, index));
+    
+    LLVMBasicBlockRef chain = LLVMAppendBasicBlockInContext(llvm_context, context->function, "chain");
+    LLVMBasicBlockRef dispatch = LLVMAppendBasicBlockInContext(llvm_context, context->function, "dispatch");
+    LLVMValueRef linked = LLVMBuildIsNotNull(builder, successor, "linked");
+    LLVMBuildCondBr(builder, linked, chain, dispatch);
+    
+    LLVMPositionBuilderAtEnd(builder, chain);
+    emit_chain_call(context, successor);
+    
+    LLVMPositionBuilderAtEnd(builder, dispatch);
+    LLVMBuildRet(builder, LLVMConstInt(get_int64_type(context), target_pc, false));
+    
+    return true;
+}
+
+/* Address of self->context->return_stack.<offset> */
+static LLVMValueRef return_stack_field(EmitterContext* ctx, LLVMValueRef jit,
+                                       LLVMValueRef offset, LLVMTypeRef type) {
+    LLVMValueRef base = const_offset(ctx, offsetof(JITContext, return_stack));
+    offset = LLVMBuildAdd(ctx->compiler->builder, base, offset, "");
+    return field_address(ctx, jit, offset, type);
+}
+
+static LLVMValueRef return_stack_entry(EmitterContext* ctx, LLVMValueRef jit,
+                                       LLVMValueRef top, size_t field, LLVMTypeRef type) {
+    LLVMBuilderRef builder = ctx->compiler->builder;
+    LLVMValueRef slot = LLVMBuildAnd(builder, top, const_offset(ctx, RETURN_STACK_SIZE - 1), "slot");
+    LLVMValueRef offset = LLVMBuildMul(builder, slot, const_offset(ctx, sizeof(ReturnStackEntry)), "");
+    offset = LLVMBuildAdd(builder, offset,
+                          const_offset(ctx, offsetof(ReturnStack, entries) + field), "");
+    return return_stack_field(ctx, jit, offset, type);
+}
+
+/* Pushes return_pc with a new exit to it, which the linker keeps pointed
+ * at the return site's translation.
+ */
+static bool emit_return_push(EmitterContext* ctx, uint64_t return_pc) {
+    size_t index = ctx->exit_count;
+    if (!add_exit_target(ctx, return_pc)) return false;
+    
+    LLVMBuilderRef builder = ctx->compiler->builder;
+    LLVMTypeRef ptr_type = LLVMPointerType(get_int8_type(ctx), 0);
+    LLVMValueRef jit = load_pointer_field(ctx, LLVMGetParam(ctx->function, 2),
+                                          offsetof(JITBlock, context), "jit");
+    
+    LLVMValueRef top_address = return_stack_field(ctx, jit, const_offset(ctx, offsetof(ReturnStack, top)),
+                                                  get_int64_type(ctx));
+    LLVMValueRef top = LLVMBuildLoad2(builder, get_int64_type(ctx), top_address, "ras_top");
+    LLVMBuildStore(builder, LLVMConstInt(get_int64_type(ctx), return_pc, false),
+                   return_stack_entry(ctx, jit, top, offsetof(ReturnStackEntry, pc), get_int64_type(ctx)));
+    LLVMBuildStore(builder, exit_address(ctx, index),
+                   return_stack_entry(ctx, jit, top, offsetof(ReturnStackEntry, exit), ptr_type));
+    LLVMBuildStore(builder, LLVMBuildAdd(builder, top, const_offset(ctx, 1), ""), top_address);
+    return true;
+}
+
+static LLVMValueRef get_resolve_function(EmitterContext* ctx) {
+    LLVMValueRef func = LLVMGetNamedFunction(ctx->compiler->module, "jit_resolve_indirect");
+    if (func) return func;
+    
+    LLVMTypeRef ptr_type = LLVMPointerType(get_int8_type(ctx), 0);
+    LLVMTypeRef param_types[] = { ptr_type, get_int64_type(ctx), get_int64_type(ctx) };
+    LLVMTypeRef func_type = LLVMFunctionType(ptr_type, param_types, 3, false);
+    return LLVMAddFunction(ctx->compiler->module, "jit_resolve_indirect", func_type);
+}
+
+/* Leaves through a BR/BLR/RET site. RET first tries the return stack; then
+ * the site's own exit serves as a monomorphic inline cache, and a miss asks
+ * the resolver, which retargets the exit. Whatever is found is chained to
+ * directly; otherwise the target PC goes back to the dispatcher.
+ */
+static bool emit_indirect_exit(EmitterContext* ctx, LLVMValueRef target, bool is_return) {
+    size_t index = ctx->exit_count;
+    if (!add_exit_target(ctx, BLOCK_EXIT_INDIRECT)) return false;
+    emitter_write_back_registers(ctx);
+    
+    LLVMBuilderRef builder = ctx->compiler->builder;
+    LLVMContextRef llvm_context = ctx->compiler->llvm_context;
+    LLVMTypeRef ptr_type = LLVMPointerType(get_int8_type(ctx), 0);
+    LLVMValueRef self = LLVMGetParam(ctx->function, 2);
+    
+    LLVMBasicBlockRef site = LLVMGetInsertBlock(builder);
+    LLVMBasicBlockRef ic_check = LLVMAppendBasicBlockInContext(llvm_context, ctx->function, "ic_check");
+    LLVMBasicBlockRef ic_hit = LLVMAppendBasicBlockInContext(llvm_context, ctx->function, "ic_hit");
+    LLVMBasicBlockRef resolve = LLVMAppendBasicBlockInContext(llvm_context, ctx->function, "resolve");
+    LLVMBasicBlockRef chain = LLVMAppendBasicBlockInContext(llvm_context, ctx->function, "chain");
+    LLVMBasicBlockRef dispatch = LLVMAppendBasicBlockInContext(llvm_context, ctx->function, "dispatch");
+    
+    LLVMPositionBuilderAtEnd(builder, chain);
+    LLVMValueRef successor = LLVMBuildPhi(builder, ptr_type, "successor");
+    LLVMPositionBuilderAtEnd(builder, site);
+    
+    if (is_return) {
+        LLVMBasicBlockRef ras_hit = LLVMAppendBasicBlockInContext(llvm_context, ctx->function, "ras_hit");
+        LLVMBasicBlockRef ras_linked = LLVMAppendBasicBlockInContext(llvm_context, ctx->function, "ras_linked");
+        
+        LLVMValueRef jit = load_pointer_field(ctx, self, offsetof(JITBlock, context), "jit");
+        LLVMValueRef top_address = return_stack_field(ctx, jit, const_offset(ctx, offsetof(ReturnStack, top)),
+                                                      get_int64_type(ctx));
+        LLVMValueRef top = LLVMBuildLoad2(builder, get_int64_type(ctx), top_address, "ras_top");
+        top = LLVMBuildSub(builder, top, const_offset(ctx, 1), "");
+        LLVMBuildStore(builder, top, top_address);
+        LLVMValueRef predicted = LLVMBuildLoad2(builder, get_int64_type(ctx),
+            return_stack_entry(ctx, jit, top, offsetof(ReturnStackEntry, pc), get_int64_type(ctx)), "ras_pc");
+        LLVMValueRef exit = LLVMBuildLoad2(builder, ptr_type,
+            return_stack_entry(ctx, jit, top, offsetof(ReturnStackEntry, exit), ptr_type), "ras_exit");
+        LLVMValueRef hit = LLVMBuildAnd(builder,
+                                        LLVMBuildICmp(builder, LLVMIntEQ, predicted, target, ""),
+                                        LLVMBuildIsNotNull(builder, exit, ""), "ras_match");
+        LLVMBuildCondBr(builder, hit, ras_hit, ic_check);
+        
+        LLVMPositionBuilderAtEnd(builder, ras_hit);
+        LLVMValueRef predicted_block = load_exit_target(ctx, exit);
+        LLVMBuildCondBr(builder, LLVMBuildIsNotNull(builder, predicted_block, ""), ras_linked, ic_check);
+        
+        LLVMPositionBuilderAtEnd(builder, ras_linked);
+        LLVMBuildBr(builder, chain);
+        LLVMAddIncoming(successor, &predicted_block, &ras_linked, 1);
+    } else {
+        LLVMBuildBr(builder, ic_check);
+    }
+    
+    /* Inline cache: self->exits[index] holds the last target seen here */
+    LLVMPositionBuilderAtEnd(builder, ic_check);
+    LLVMValueRef exit = exit_address(ctx, index);
+    LLVMValueRef cached_pc = LLVMBuildLoad2(builder, get_int64_type(ctx),
+        field_address(ctx, exit, const_offset(ctx, offsetof(BlockExit, target_pc)), get_int64_type(ctx)),
+        "cached_pc");
+    LLVMBuildCondBr(builder, LLVMBuildICmp(builder, LLVMIntEQ, cached_pc, target, "ic_match"),
+                    ic_hit, resolve);
+    
+    LLVMPositionBuilderAtEnd(builder, ic_hit);
+    LLVMValueRef cached_block = load_exit_target(ctx, exit);
+    LLVMBuildCondBr(builder, LLVMBuildIsNotNull(builder, cached_block, ""), chain, resolve);
+    LLVMAddIncoming(successor, &cached_block, &ic_hit, 1);
+    
+    LLVMPositionBuilderAtEnd(builder, resolve);
+    LLVMValueRef resolver = get_resolve_function(ctx);
+    LLVMValueRef args[] = { self, const_offset(ctx, index), target };
+    LLVMValueRef resolved = LLVMBuildCall2(builder, LLVMGlobalGetValueType(resolver), resolver,
+                                           args, 3, "resolved");
+    LLVMBuildCondBr(builder, LLVMBuildIsNotNull(builder, resolved, ""), chain, dispatch);
+    LLVMAddIncoming(successor, &resolved, &resolve, 1);
+    
+    LLVMPositionBuilderAtEnd(builder, chain);
+    emit_chain_call(ctx, successor);
+    
+    LLVMPositionBuilderAtEnd(builder, dispatch);
+    LLVMBuildRet(builder, target);
+    return true;
+}
+
+/* Whether a conditional branch is taken: B.cond's condition, CBZ and CBNZ
+ * on a W or X register, or TBZ and TBNZ on one bit
+ */
+static LLVMValueRef branch_condition(EmitterContext* ctx, const Instruction* inst) {
+    LLVMBuilderRef builder = ctx->compiler->builder;
+    if (inst->opcode == 0x22) return emitter_get_condition_value(ctx, inst->condition);
+    
+    LLVMValueRef value = read_operand(ctx, instruction_get_register(inst, 1), false);
+    if (inst->opcode == 0x27 || inst->opcode == 0x28) {
+        value = to_width(ctx, value, instruction_is_64bit(inst));
+    } else {
+        uint64_t bit = 1ULL << instruction_get_immediate(inst, 2);
+        value = LLVMBuildAnd(builder, value, LLVMConstInt(get_int64_type(ctx), bit, false), "");
+    }
+    LLVMIntPredicate predicate = (inst->opcode == 0x27 || inst->opcode == 0x29) ? LLVMIntEQ : LLVMIntNE;
+    return LLVMBuildICmp(builder, predicate, value, LLVMConstNull(LLVMTypeOf(value)), "cond");
+}
+
+bool emitter_emit_branch(EmitterContext* context, const Instruction* inst) {
+    if (!context || !inst) return false;
+    
+    LLVMBuilderRef builder = context->compiler->builder;
+    uint64_t target = instruction_get_branch_target(inst, context->pc);
+    uint64_t next_pc = context->pc + 4;
+    
+    switch (inst->opcode) {
+        case 0x20:
+            return emitter_emit_exit(context, target);
+            
+        case 0x22:
+        case 0x27: case 0x28: case 0x29: case 0x2A: {
+            LLVMValueRef condition = branch_condition(context, inst);
+            if (!condition) return false;
+            
+            LLVMBasicBlockRef taken = LLVMAppendBasicBlockInContext(context->compiler->llvm_context,
+                                                                    context->function, "taken");
+            LLVMBasicBlockRef not_taken = LLVMAppendBasicBlockInContext(context->compiler->llvm_context,
+                                                                        context->function, "not_taken");
+            LLVMBuildCondBr(builder, condition, taken, not_taken);
+            
+            LLVMPositionBuilderAtEnd(builder, taken);
+            if (!emitter_emit_exit(context, target)) return false;
+            
+            LLVMPositionBuilderAtEnd(builder, not_taken);
+            return emitter_emit_exit(context, next_pc);
+        }
+            
+        case 0x25:
+            set_link_register(context, next_pc);
+            if (!emit_return_push(context, next_pc)) return false;
+            return emitter_emit_exit(context, target);
+            
+        case 0x23:
+        case 0x24:
+        case 0x26: {
+            /* Read Xn before BLR overwrites X30 */
+            LLVMValueRef target_value = read_operand(context, instruction_get_register(inst, 0), false);
+            if (inst->opcode == 0x26) {
+                set_link_register(context, next_pc);
+                if (!emit_return_push(context, next_pc)) return false;
+            }
+            return emit_indirect_exit(context, target_value, inst->opcode == 0x24);
+        }
+            
+        default:
+            return false;
+    }
+}
+
+bool emitter_emit_trace_branch(EmitterContext* context, const Instruction* inst, uint64_t next_pc) {
+    if (!context || !inst) return false;
+    
+    LLVMBuilderRef builder = context->compiler->builder;
+    uint64_t target = instruction_get_branch_target(inst, context->pc);
+    uint64_t fallthrough = context->pc + 4;
+    
+    switch (inst->opcode) {
+        case 0x20:
+            return next_pc == target;
+            
+        case 0x22:
+        case 0x27: case 0x28: case 0x29: case 0x2A: {
+            if (target == fallthrough) return next_pc == target;
+            if (next_pc != target && next_pc != fallthrough) return false;
+            
+            LLVMValueRef condition = branch_condition(context, inst);
+            if (!condition) return false;
+            
+            LLVMBasicBlockRef on_trace = LLVMAppendBasicBlockInContext(context->compiler->llvm_context,
+                                                                       context->function, "on_trace");
+            LLVMBasicBlockRef side_exit = LLVMAppendBasicBlockInContext(context->compiler->llvm_context,
+                                                                        context->function, "side_exit");
+            if (next_pc == target) {
+                LLVMBuildCondBr(builder, condition, on_trace, side_exit);
+            } else {
+                LLVMBuildCondBr(builder, condition, side_exit, on_trace);
+            }
+            
+            LLVMPositionBuilderAtEnd(builder, side_exit);
+            emitter_emit_side_exit(context, next_pc == target ? fallthrough : target);
+            
+            LLVMPositionBuilderAtEnd(builder, on_trace);
+            context->current_block = on_trace;
+            return true;
+        }
+            
+        case 0x25:
+            if (next_pc != target) return false;
+            set_link_register(context, fallthrough);
+            return emit_return_push(context, fallthrough);
+            
+        default:
+            return false;
+    }
+}
+
+void emitter_emit_side_exit(EmitterContext* context, uint64_t target_pc) {
+    if (!context) return;
+    emitter_write_back_registers(context);
+    LLVMBuildRet(context->compiler->builder, LLVMConstInt(get_int64_type(context), target_pc, false));
+}
+
+/* V registers the instructions may write: all but UMOV, FCMP and FMOV to
+ * a general register write their destination, and LDP both of its own
+ */
+static uint32_t vectors_written(const Instruction* insts, size_t count) {
+    uint32_t written = 0;
+    for (size_t i = 0; i < count; i++) {
+        const Instruction* inst = &insts[i];
+        bool writes = (inst->type == INST_VECTOR && inst->opcode != 0x68) ||
+                      (inst->type == INST_FLOAT && inst->opcode != 0x7D && inst->opcode != 0x7E) ||
+                      (inst->type == INST_LOAD_STORE &&
+                       (inst->opcode == 0x42 || inst->opcode == 0x44 || inst->opcode == 0x4B));
+        if (writes) written |= 1U << (inst->dest_reg & 31);
+        if (inst->type == INST_LOAD_STORE && inst->opcode == 0x4B) {
+            written |= 1U << (instruction_get_register(inst, 1) & 31);
+        }
+    }
+    return written;
+}
+
+bool emitter_begin_loop(EmitterContext* context, const Instruction* body, size_t count) {
+    if (!context || !body || !count || context->loop_header) return false;
+    
+    /* A register the body writes needs a phi only if an iteration can
+     * observe the previous one's value: read it, or leave, before writing
+     * it again. NZCV is carried packed.
+     */
+    uint64_t carried = 0;
+    for (size_t i = 0; i < count; i++) {
+        for (uint8_t reg = 0; reg < ARM64_REG_PC; reg++) {
+            if (instruction_modifies_register(&body[i], reg)) carried |= 1ULL << reg;
+        }
+        if (body[i].sets_flags) carried |= 1ULL << ARM64_REG_NZCV;
+    }
+    carried &= liveness_live_in(body, count);
+    uint32_t vectors = vectors_written(body, count);
+    /* FPCR written anywhere in the body is stale at the top of the next iteration */
+    for (size_t i = 0; i < count; i++) {
+        if (writes_fpcr(&body[i])) context->fpcr_written = true;
+    }
+    
+    LLVMValueRef entry_values[ARM64_NUM_REGS] = { NULL };
+    for (uint8_t reg = 0; reg < ARM64_NUM_REGS; reg++) {
+        if (!(carried & (1ULL << reg))) continue;
+        if (reg == ARM64_REG_NZCV && context->flags.op != FLAGS_IN_REGISTER) {
+            entry_values[reg] = packed_flags(context);
+        } else {
+            entry_values[reg] = emitter_get_register(context, reg);
+        }
+    }
+    LLVMValueRef entry_vectors[ARM64_NUM_VECTOR_REGS] = { NULL };
+    for (uint8_t reg = 0; reg < ARM64_NUM_VECTOR_REGS; reg++) {
+        if (vectors & (1U << reg)) entry_vectors[reg] = emitter_get_vector(context, reg);
+    }
+    
+    LLVMBuilderRef builder = context->compiler->builder;
+    LLVMBasicBlockRef preheader = LLVMGetInsertBlock(builder);
+    LLVMBasicBlockRef header = LLVMAppendBasicBlockInContext(context->compiler->llvm_context,
+                                                             context->function, "loop");
+    LLVMBuildBr(builder, header);
+    LLVMPositionBuilderAtEnd(builder, header);
+    
+    for (uint8_t reg = 0; reg < ARM64_NUM_REGS; reg++) {
+        if (!entry_values[reg]) continue;
+        LLVMValueRef phi = LLVMBuildPhi(builder, get_int64_type(context), "loop_reg");
+        LLVMAddIncoming(phi, &entry_values[reg], &preheader, 1);
+        context->loop_phis[reg] = phi;
+        emitter_set_register(context, reg, phi);
+    }
+    if (entry_values[ARM64_REG_NZCV]) context->flags.op = FLAGS_IN_REGISTER;
+    for (uint8_t reg = 0; reg < ARM64_NUM_VECTOR_REGS; reg++) {
+        if (!entry_vectors[reg]) continue;
+        LLVMValueRef phi = LLVMBuildPhi(builder, get_vector_type(context), "loop_vreg");
+        LLVMAddIncoming(phi, &entry_vectors[reg], &preheader, 1);
+        context->loop_vector_phis[reg] = phi;
+        context->vector_registers[reg] = phi;
+        context->dirty_vectors |= 1U << reg;
+    }
+    
+    context->loop_header = header;
+    context->loop_pc = context->pc;
+    context->current_block = header;
+    return true;
+}
+
+bool emitter_emit_loop_branch(EmitterContext* context, const Instruction* inst) {
+    if (!context || !inst || !context->loop_header) return false;
+    if (inst->opcode != 0x20 && !instruction_is_conditional_branch(inst)) return false;
+    if (instruction_get_branch_target(inst, context->pc) != context->loop_pc) return false;
+    
+    LLVMBuilderRef builder = context->compiler->builder;
+    LLVMValueRef condition = NULL;
+    if (inst->opcode != 0x20) {
+        condition = branch_condition(context, inst);
+        if (!condition) return false;
+    }
+    
+    if (context->loop_phis[ARM64_REG_NZCV] && context->flags.op != FLAGS_IN_REGISTER) {
+        emitter_set_register(context, ARM64_REG_NZCV, packed_flags(context));
+        context->flags.op = FLAGS_IN_REGISTER;
+    }
+    
+    LLVMBasicBlockRef latch = LLVMGetInsertBlock(builder);
+    for (uint8_t reg = 0; reg < ARM64_NUM_REGS; reg++) {
+        if (context->loop_phis[reg]) {
+            LLVMAddIncoming(context->loop_phis[reg], &context->register_values[reg], &latch, 1);
+        }
+    }
+    for (uint8_t reg = 0; reg < ARM64_NUM_VECTOR_REGS; reg++) {
+        if (context->loop_vector_phis[reg]) {
+            LLVMAddIncoming(context->loop_vector_phis[reg], &context->vector_registers[reg], &latch, 1);
+        }
+    }
+    
+    LLVMBasicBlockRef header = context->loop_header;
+    context->loop_header = NULL;
+    memset(context->loop_phis, 0, sizeof(context->loop_phis));
+    memset(context->loop_vector_phis, 0, sizeof(context->loop_vector_phis));
+    
+    if (inst->opcode == 0x20) {
+        LLVMBuildBr(builder, header);
+        return true;
+    }
+    
+    LLVMBasicBlockRef loop_exit = LLVMAppendBasicBlockInContext(context->compiler->llvm_context,
+                                                                context->function, "loop_exit");
+    LLVMBuildCondBr(builder, condition, header, loop_exit);
+    LLVMPositionBuilderAtEnd(builder, loop_exit);
+    context->current_block = loop_exit;
+    return emitter_emit_exit(context, context->pc + 4);
+}
+
+LLVMValueRef emitter_create_entry_block(EmitterContext* context) {
+    if (!context) return NULL;
+    
+    /* block(registers, memory, self), see BlockFunction */
+    LLVMTypeRef param_types[] = {
+        LLVMPointerType(get_int8_type(context), 0),
+        LLVMPointerType(get_int8_type(context), 0),
+        LLVMPointerType(get_int8_type(context), 0)
+    };
+    
+    context->function_type = LLVMFunctionType(get_int64_type(context),
+                                              param_types, 3, false);
+    
+    context->function = LLVMAddFunction(context->compiler->module, "block", context->function_type);
+    /* The register file and the Memory are reached only through these
+     * arguments while the block runs. self is not: a chain call may pass
+     * the block itself as its successor.
+     */
+    unsigned no_alias = LLVMGetEnumAttributeKindForName("noalias", strlen("noalias"));
+    for (unsigned i = 1; i <= 2; i++) {
+        LLVMAddAttributeAtIndex(context->function, i,
+                                LLVMCreateEnumAttribute(context->compiler->llvm_context, no_alias, 0));
+    }
+    context->current_block = LLVMAppendBasicBlockInContext(context->compiler->llvm_context,
+                                                           context->function, "entry");
+    LLVMPositionBuilderAtEnd(context->compiler->builder, context->current_block);
+
+    /* self->referenced = 1, the code cache's clock bit */
+    LLVMBuilderRef builder = context->compiler->builder;
+    LLVMValueRef index = LLVMConstInt(get_int64_type(context), offsetof(JITBlock, referenced), false);
+    LLVMValueRef field = LLVMBuildGEP2(builder, get_int8_type(context),
+                                       LLVMGetParam(context->function, 2), &index, 1, "referenced");
+    context->register_load_point = LLVMBuildStore(builder, LLVMConstInt(get_int8_type(context), 1, false), field);
+
+    return context->function;
+}
+
+void emitter_create_exit_block(EmitterContext* context) {
+    if (!context) return;
+    
+    /* A block that ends without a branch falls through to context->pc */
+    LLVMBasicBlockRef current = LLVMGetInsertBlock(context->compiler->builder);
+    if (current && !LLVMGetBasicBlockTerminator(current)) {
+        emitter_emit_exit(context, context->pc);
+    }
+}
+
+bool emitter_emit_instruction(EmitterContext* context, const Instruction* inst) {
+    if (!context || !inst) return false;
+    
+    switch (inst->type) {
+        case INST_ARITHMETIC:
+            return emitter_emit_arithmetic(context, inst);
+        case INST_LOGICAL:
+            return emitter_emit_logical(context, inst);
+        case INST_LOAD_STORE:
+            return emitter_emit_memory(context, inst);
+        case INST_BRANCH:
+            return emitter_emit_branch(context, inst);
+        case INST_MOVE:
+            return emitter_emit_move(context, inst);
+        case INST_SYSTEM:
+            return emitter_emit_system(context, inst);
+        case INST_VECTOR:
+            return emitter_emit_vector(context, inst);
+        case INST_FLOAT:
+            return emitter_emit_float(context, inst);
+        default:
+            return false;
+    }
+}
+
+LLVMValueRef emitter_finalize_block(EmitterContext* context) {
+    if (!context) return NULL;
+    
+    emitter_create_exit_block(context);
+    
+    LLVMBasicBlockRef current = LLVMGetInsertBlock(context->compiler->builder);
+    if (!current || !LLVMGetBasicBlockTerminator(current)) return NULL;
+    return context->function;
 } 
\ No newline at end of file
@@ -0,0 +1,125 @@
+#include "fpu.h"
+#include <fenv.h>
+#include <math.h>
+
+/* Operands and results go through volatiles so the compiler cannot move
+ * the arithmetic across the rounding mode changes around it.
+ */
+
+static int host_rounding(uint32_t fpcr) {
+    switch ((fpcr & FPCR_RMODE_MASK) >> FPCR_RMODE_SHIFT) {
+        case 0: return FE_TONEAREST;
+        case 1: return FE_UPWARD;
+        case 2: return FE_DOWNWARD;
+        default: return FE_TOWARDZERO;
+    }
+}
+
+static void enter_guest_mode(const RegisterFile* regs) {
+    feclearexcept(FE_ALL_EXCEPT);
+    fesetround(host_rounding(regs->fpcr));
+}
+
+/* Back to the host default, with the raised exceptions folded into FPSR.
+ * A result flushed to zero reports underflow rather than inexact.
+ */
+static void leave_guest_mode(RegisterFile* regs, bool flushed) {
+    int raised = fetestexcept(FE_ALL_EXCEPT);
+    fesetround(FE_TONEAREST);
+    if (flushed) raised = (raised & ~FE_INEXACT) | FE_UNDERFLOW;
+
+    if (raised & FE_INVALID) regs->fpsr |= FPSR_IOC;
+    if (raised & FE_DIVBYZERO) regs->fpsr |= FPSR_DZC;
+    if (raised & FE_OVERFLOW) regs->fpsr |= FPSR_OFC;
+    if (raised & FE_UNDERFLOW) regs->fpsr |= FPSR_UFC;
+    if (raised & FE_INEXACT) regs->fpsr |= FPSR_IXC;
+}
+
+static bool flushes(const RegisterFile* regs, int class) {
+    return (regs->fpcr & FPCR_FZ) && class == FP_SUBNORMAL;
+}
+
+static double flush_input_double(RegisterFile* regs, double value) {
+    if (!flushes(regs, fpclassify(value))) return value;
+    regs->fpsr |= FPSR_IDC;
+    return copysign(0.0, value);
+}
+
+static float flush_input_float(RegisterFile* regs, float value) {
+    if (!flushes(regs, fpclassify(value))) return value;
+    regs->fpsr |= FPSR_IDC;
+    return copysignf(0.0f, value);
+}
+
+double fpu_exact_double(RegisterFile* regs, uint64_t op, double a, double b, double c) {
+    volatile double x = flush_input_double(regs, a);
+    volatile double y = flush_input_double(regs, b);
+    volatile double z = flush_input_double(regs, c);
+    volatile double result;
+
+    enter_guest_mode(regs);
+    switch (op) {
+        case FPU_ADD: result = x + y; break;
+        case FPU_SUB: result = x - y; break;
+        case FPU_MUL: result = x * y; break;
+        case FPU_DIV: result = x / y; break;
+        case FPU_FMA: result = fma(x, y, z); break;
+        default: result = sqrt(x); break;
+    }
+    bool flushed = flushes(regs, fpclassify(result));
+    if (flushed) result = copysign(0.0, result);
+    leave_guest_mode(regs, flushed);
+
+    if ((regs->fpcr & FPCR_DN) && isnan(result)) return NAN;
+    return result;
+}
+
+float fpu_exact_float(RegisterFile* regs, uint64_t op, float a, float b, float c) {
+    volatile float x = flush_input_float(regs, a);
+    volatile float y = flush_input_float(regs, b);
+    volatile float z = flush_input_float(regs, c);
+    volatile float result;
+
+    enter_guest_mode(regs);
+    switch (op) {
+        case FPU_ADD: result = x + y; break;
+        case FPU_SUB: result = x - y; break;
+        case FPU_MUL: result = x * y; break;
+        case FPU_DIV: result = x / y; break;
+        case FPU_FMA: result = fmaf(x, y, z); break;
+        default: result = sqrtf(x); break;
+    }
+    bool flushed = flushes(regs, fpclassify(result));
+    if (flushed) result = copysignf(0.0f, result);
+    leave_guest_mode(regs, flushed);
+
+    if ((regs->fpcr & FPCR_DN) && isnan(result)) return NAN;
+    return result;
+}
+
+float fpu_exact_narrow(RegisterFile* regs, double value) {
+    volatile double x = flush_input_double(regs, value);
+    volatile float result;
+
+    enter_guest_mode(regs);
+    result = (float)x;
+    bool flushed = flushes(regs, fpclassify(result));
+    if (flushed) result = copysignf(0.0f, result);
+    leave_guest_mode(regs, flushed);
+
+    if ((regs->fpcr & FPCR_DN) && isnan(result)) return NAN;
+    return result;
+}
+
+/* Exact in every rounding mode; only FZ and DN apply */
+double fpu_exact_widen(RegisterFile* regs, float value) {
+    volatile float x = flush_input_float(regs, value);
+    volatile double result;
+
+    enter_guest_mode(regs);
+    result = x;
+    leave_guest_mode(regs, false);
+
+    if ((regs->fpcr & FPCR_DN) && isnan(result)) return NAN;
+    return result;
+}
@@ -1,167 +1,589 @@
-#include "instruction.h"
-#include <string.h>
-#include <stdio.h>
-
-void instruction_init(Instruction* inst) {
-    if (!inst) return;
-    memset(inst, 0, sizeof(Instruction));
-}
-
-void instruction_set_operand(Instruction* inst, uint8_t index, Operand op) {
-    if (!inst || index >= 4) return;
-    inst->operands[index] = op;
-    if (index >= inst->operand_count) {
-        inst->operand_count = index + 1;
-    }
-}
-
-const char* instruction_to_string(const Instruction* inst, char* buffer, size_t size) {
-    if (!inst || !buffer || !size) return NULL;
-    
-    const char* type_str;
-    switch (inst->type) {
-        case INST_ARITHMETIC: type_str = "ARITH"; break;
-        case INST_LOGICAL:    type_str = "LOGIC"; break;
-        case INST_MOVE:       type_str = "MOVE"; break;
-        case INST_BRANCH:     type_str = "BRANCH"; break;
-        case INST_LOAD_STORE: type_str = "MEM"; break;
-        case INST_SYSTEM:     type_str = "SYS"; break;
-        case INST_FLOAT:      type_str = "FLOAT"; break;
-        case INST_VECTOR:     type_str = "VECTOR"; break;
-        default:             type_str = "UNKNOWN"; break;
-    }
-    
-    int written = snprintf(buffer, size, "%s [%02X] ", type_str, inst->opcode);
-    if (written < 0 || written >= size) return buffer;
-    
-    if (inst->dest_reg != 0xFF) {
-        written += snprintf(buffer + written, size - written, "dst=X%d ", inst->dest_reg);
-        if (written < 0 || written >= size) return buffer;
-    }
-    
-    for (uint8_t i = 0; i < inst->operand_count; i++) {
-        const Operand* op = &inst->operands[i];
-        switch (op->type) {
-            case OP_IMMEDIATE:
-                written += snprintf(buffer + written, size - written, "#0x%lx", op->value.immediate);
-                break;
-            case OP_REGISTER:
-                written += snprintf(buffer + written, size - written, "X%d", op->value.reg);
-                break;
-            case OP_MEMORY:
-                written += snprintf(buffer + written, size - written, "[X%d, #%d]", 
-                                 op->value.mem.base_reg, op->value.mem.offset);
-                break;
-            case OP_SHIFT:
-                written += snprintf(buffer + written, size - written, "LSL #%d", 
-                                 op->value.mem.shift_amount);
-                break;
-            case OP_EXTEND:
-                written += snprintf(buffer + written, size - written, "EXTEND");
-                break;
-            default:
-                written += snprintf(buffer + written, size - written, "???");
-                break;
-        }
-        
-        if (i < inst->operand_count - 1) {
-            written += snprintf(buffer + written, size - written, ", ");
-        }
-        
-        if (written < 0 || written >= size) break;
-    }
-    
-    if (inst->sets_flags) {
-        written += snprintf(buffer + written, size - written, " [FLAGS]");
-    }
-    
-    return buffer;
-}
-
-bool instruction_is_branch(const Instruction* inst) {
-    return inst && inst->type == INST_BRANCH;
-}
-
-bool instruction_is_memory_access(const Instruction* inst) {
-    return inst && inst->type == INST_LOAD_STORE;
-}
-
-uint64_t instruction_get_branch_target(const Instruction* inst, uint64_t pc) {
-    if (!inst || inst->type != INST_BRANCH || inst->operand_count < 1) {
-        return 0;
-    }
-    
-    const Operand* target = &inst->operands[0];
-    switch (target->type) {
-        case OP_IMMEDIATE:
-            return pc + target->value.immediate;
-        case OP_REGISTER:
-            return 0;
-        default:
-            return 0;
-    }
-}
-
-bool instruction_modifies_register(const Instruction* inst, uint8_t reg) {
-    if (!inst) return false;
-    if (inst->dest_reg == reg) return true;
-    
-    switch (inst->type) {
-        case INST_LOAD_STORE:
-            if (inst->operand_count >= 1 && 
-                inst->operands[0].type == OP_MEMORY &&
-                inst->operands[0].value.mem.base_reg == reg) {
-                return true;
-            }
-            break;
-            
-        case INST_BRANCH:
-            if (reg == 30 && inst->opcode == 0x25) {
-                return true;
-            }
-            break;
-            
-        default:
-            break;
-    }
-    
-    return false;
-}
-
-bool instruction_reads_register(const Instruction* inst, uint8_t reg) {
-    if (!inst) return false;
-    
-    for (uint8_t i = 0; i < inst->operand_count; i++) {
-        const Operand* op = &inst->operands[i];
-        switch (op->type) {
-            case OP_REGISTER:
-                if (op->value.reg == reg) return true;
-                break;
-                
-            case OP_MEMORY:
-                if (op->value.mem.base_reg == reg ||
-                    op->value.mem.index_reg == reg) {
-                    return true;
-                }
-                break;
-                
-            default:
-                break;
-        }
-    }
-    
-    return false;
-}
-
-bool instruction_can_be_reordered(const Instruction* inst) {
-    if (!inst) return false;
-    
-    switch (inst->type) {
-        case INST_BRANCH:
-        case INST_SYSTEM:
-        case INST_LOAD_STORE:
-            return false;
-        default:
-            return true;
-    }
+#include "instruction.h"
+#include <string.h>
+#include <stdio.h>
+
+void instruction_init(Instruction* inst) {
+    if (!inst) return;
+    memset(inst, 0, sizeof(Instruction));
+}
+
+/* How an operand is stored; the wide and bit mask kinds are immediates
+ * kept in the shared slot
+ */
+enum {
+    KIND_NONE,
+    KIND_IMMEDIATE,     /* field: the value */
+    KIND_REGISTER,      /* field: the register */
+    KIND_MEMORY,        /* field: base, mode << 5, has index << 7; slot: offset or index */
+    KIND_SHIFT,         /* field: type << 6 | amount */
+    KIND_EXTEND,        /* field: option << 3 | amount */
+    KIND_WIDE,          /* field: shift, inverted << 6, unsigned << 7; slot: value */
+    KIND_BIT_MASK       /* slot: N:immr:imms */
+};
+
+#define WIDE_INVERTED 0x40
+#define WIDE_UNSIGNED 0x80
+#define MEMORY_HAS_INDEX 0x80
+
+static unsigned operand_kind(const Instruction* inst, uint8_t index) {
+    return (inst->operand_kinds >> (index * 3)) & 7;
+}
+
+static void set_kind(Instruction* inst, uint8_t index, unsigned kind) {
+    inst->operand_kinds = (inst->operand_kinds & ~(7U << (index * 3))) | kind << (index * 3);
+}
+
+static bool uses_slot(unsigned kind) {
+    return kind == KIND_MEMORY || kind == KIND_WIDE || kind == KIND_BIT_MASK;
+}
+
+bool instruction_decode_bit_mask(uint32_t n, uint32_t imms, uint32_t immr, bool is_64bit, uint64_t* mask) {
+    uint32_t combined = n << 6 | (~imms & 0x3F);
+    unsigned length = 6;
+    while (length > 0 && !(combined & (1U << length))) length--;
+    if (length == 0 || (!is_64bit && n)) return false;
+
+    unsigned element = 1U << length;
+    uint32_t levels = element - 1;
+    uint32_t s = imms & levels, r = immr & levels;
+    if (s == levels) return false;
+
+    uint64_t ones = (1ULL << (s + 1)) - 1;
+    uint64_t element_mask = element == 64 ? UINT64_MAX : (1ULL << element) - 1;
+    uint64_t rotated = r ? ((ones >> r) | (ones << (element - r))) & element_mask : ones;
+    uint64_t result = 0;
+    for (unsigned i = 0; i < 64; i += element) result |= rotated << i;
+    *mask = is_64bit ? result : result & 0xFFFFFFFFULL;
+    return true;
+}
+
+/* N:immr:imms of a 64-bit logical immediate: the smallest element the
+ * value repeats, rotated left until its run of ones starts at bit 0
+ */
+static bool encode_bit_mask(uint64_t value, uint32_t* encoding) {
+    if (value == 0 || value == UINT64_MAX) return false;
+
+    unsigned element = 64;
+    while (element > 2) {
+        unsigned half = element / 2;
+        uint64_t half_mask = (1ULL << half) - 1;
+        if ((value & half_mask) != ((value >> half) & half_mask)) break;
+        element = half;
+    }
+    uint64_t element_mask = element == 64 ? UINT64_MAX : (1ULL << element) - 1;
+    uint64_t bits = value & element_mask;
+    unsigned ones = __builtin_popcountll(bits);
+    uint64_t run = (1ULL << ones) - 1;
+
+    for (unsigned r = 0; r < element; r++) {
+        uint64_t rotated = r ? ((bits << r) | (bits >> (element - r))) & element_mask : bits;
+        if (rotated != run) continue;
+        uint32_t imms = (~(element * 2 - 1) & 0x3F) | (ones - 1);
+        *encoding = (element == 64) << 12 | r << 6 | imms;
+        return true;
+    }
+    return false;
+}
+
+/* value as a 32-bit slot, sign or zero extended, shifted left and maybe
+ * inverted; MOVZ, MOVN, MOVK and ADRP values all have this form
+ */
+static bool encode_wide(uint64_t value, int32_t* slot, uint8_t* field) {
+    for (unsigned shift = 0; shift < 64; shift++) {
+        for (int inverted = 0; inverted < 2; inverted++) {
+            uint64_t v = inverted ? ~value : value;
+            if (v & ((1ULL << shift) - 1)) continue;
+            uint8_t flags = shift | (inverted ? WIDE_INVERTED : 0);
+            int64_t high = (int64_t)v >> shift;
+            if (high == (int32_t)high) {
+                *slot = (int32_t)high;
+                *field = flags;
+                return true;
+            }
+            if ((v >> shift) <= UINT32_MAX) {
+                *slot = (int32_t)(uint32_t)(v >> shift);
+                *field = flags | WIDE_UNSIGNED;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+static bool pack_operand(Instruction* inst, uint8_t index, Operand op, unsigned* kind) {
+    uint8_t* field = &inst->operand_fields[index];
+    switch (op.type) {
+        case OP_NONE:
+            *kind = KIND_NONE;
+            return true;
+        case OP_REGISTER:
+            *kind = KIND_REGISTER;
+            *field = op.value.reg;
+            return true;
+        case OP_SHIFT:
+            if (op.value.shift.type > 3 || op.value.shift.amount > 63) return false;
+            *kind = KIND_SHIFT;
+            *field = op.value.shift.type << 6 | op.value.shift.amount;
+            return true;
+        case OP_EXTEND:
+            if (op.value.shift.type > 7 || op.value.shift.amount > 7) return false;
+            *kind = KIND_EXTEND;
+            *field = op.value.shift.type << 3 | op.value.shift.amount;
+            return true;
+        case OP_IMMEDIATE: {
+            uint64_t value = op.value.immediate;
+            if (value <= 0xFF) {
+                *kind = KIND_IMMEDIATE;
+                *field = (uint8_t)value;
+                return true;
+            }
+            uint32_t encoding;
+            if (encode_wide(value, &inst->imm, field)) {
+                *kind = KIND_WIDE;
+            } else if (encode_bit_mask(value, &encoding)) {
+                *kind = KIND_BIT_MASK;
+                inst->imm = (int32_t)encoding;
+            } else {
+                return false;
+            }
+            return true;
+        }
+        case OP_MEMORY: {
+            uint8_t base = op.value.mem.base_reg, index_reg = op.value.mem.index_reg;
+            AddressingMode mode = (AddressingMode)op.value.mem.mode;
+            bool has_index = index_reg != 0xFF;
+            if (mode > ADDR_LITERAL || (mode != ADDR_LITERAL && base > 31) ||
+                (has_index && (op.value.mem.offset || index_reg > 31))) {
+                return false;
+            }
+            *kind = KIND_MEMORY;
+            *field = (mode == ADDR_LITERAL ? 0 : base) | mode << 5 | (has_index ? MEMORY_HAS_INDEX : 0);
+            inst->imm = has_index ? index_reg | op.value.mem.extend << 8 | op.value.mem.shift_amount << 16
+                                  : op.value.mem.offset;
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+bool instruction_set_operand(Instruction* inst, uint8_t index, Operand op) {
+    if (!inst || index >= INSTRUCTION_MAX_OPERANDS) return false;
+
+    /* Only one operand may use the shared slot */
+    for (uint8_t i = 0; i < INSTRUCTION_MAX_OPERANDS; i++) {
+        if (i != index && uses_slot(operand_kind(inst, i)) &&
+            (op.type == OP_MEMORY || (op.type == OP_IMMEDIATE && op.value.immediate > 0xFF))) {
+            return false;
+        }
+    }
+
+    unsigned kind;
+    if (!pack_operand(inst, index, op, &kind)) return false;
+    set_kind(inst, index, kind);
+    if (index >= inst->operand_count) {
+        inst->operand_count = index + 1;
+    }
+    return true;
+}
+
+Operand instruction_get_operand(const Instruction* inst, uint8_t index) {
+    Operand op = { .type = OP_NONE };
+    if (!inst || index >= INSTRUCTION_MAX_OPERANDS) return op;
+
+    uint8_t field = inst->operand_fields[index];
+    switch (operand_kind(inst, index)) {
+        case KIND_REGISTER:
+            op.type = OP_REGISTER;
+            op.value.reg = field;
+            break;
+        case KIND_SHIFT:
+            op.type = OP_SHIFT;
+            op.value.shift.type = field >> 6;
+            op.value.shift.amount = field & 0x3F;
+            break;
+        case KIND_EXTEND:
+            op.type = OP_EXTEND;
+            op.value.shift.type = field >> 3;
+            op.value.shift.amount = field & 7;
+            break;
+        case KIND_IMMEDIATE:
+        case KIND_WIDE:
+        case KIND_BIT_MASK:
+            op.type = OP_IMMEDIATE;
+            op.value.immediate = instruction_get_immediate(inst, index);
+            break;
+        case KIND_MEMORY:
+            op.type = OP_MEMORY;
+            op.value.mem.mode = (field >> 5) & 3;
+            op.value.mem.base_reg = op.value.mem.mode == ADDR_LITERAL ? 0xFF : field & 0x1F;
+            op.value.mem.index_reg = 0xFF;
+            if (field & MEMORY_HAS_INDEX) {
+                op.value.mem.index_reg = inst->imm & 0xFF;
+                op.value.mem.extend = (inst->imm >> 8) & 0xFF;
+                op.value.mem.shift_amount = (inst->imm >> 16) & 0xFF;
+            } else {
+                op.value.mem.offset = inst->imm;
+            }
+            break;
+        default:
+            break;
+    }
+    return op;
+}
+
+OperandType instruction_get_operand_type(const Instruction* inst, uint8_t index) {
+    if (!inst || index >= INSTRUCTION_MAX_OPERANDS) return OP_NONE;
+    switch (operand_kind(inst, index)) {
+        case KIND_IMMEDIATE:
+        case KIND_WIDE:
+        case KIND_BIT_MASK:
+            return OP_IMMEDIATE;
+        case KIND_REGISTER: return OP_REGISTER;
+        case KIND_MEMORY:   return OP_MEMORY;
+        case KIND_SHIFT:    return OP_SHIFT;
+        case KIND_EXTEND:   return OP_EXTEND;
+        default:            return OP_NONE;
+    }
+}
+
+/* 0xFF if the operand is not a register */
+uint8_t instruction_get_register(const Instruction* inst, uint8_t index) {
+    if (!inst || index >= INSTRUCTION_MAX_OPERANDS || operand_kind(inst, index) != KIND_REGISTER) {
+        return 0xFF;
+    }
+    return inst->operand_fields[index];
+}
+
+/* 0 if the operand is not an immediate */
+uint64_t instruction_get_immediate(const Instruction* inst, uint8_t index) {
+    if (!inst || index >= INSTRUCTION_MAX_OPERANDS) return 0;
+
+    uint8_t field = inst->operand_fields[index];
+    switch (operand_kind(inst, index)) {
+        case KIND_IMMEDIATE:
+            return field;
+        case KIND_WIDE: {
+            uint64_t value = (field & WIDE_UNSIGNED) ? (uint64_t)(uint32_t)inst->imm
+                                                     : (uint64_t)(int64_t)inst->imm;
+            value <<= field & 0x3F;
+            return (field & WIDE_INVERTED) ? ~value : value;
+        }
+        case KIND_BIT_MASK: {
+            uint64_t mask = 0;
+            uint32_t encoding = (uint32_t)inst->imm;
+            instruction_decode_bit_mask(encoding >> 12, encoding & 0x3F, (encoding >> 6) & 0x3F, true, &mask);
+            return mask;
+        }
+        default:
+            return 0;
+    }
+}
+
+uint8_t instruction_get_element_size(const Instruction* inst) {
+    if (!inst || !inst->element_shift) return 0;
+    return 1U << (inst->element_shift - 1);
+}
+
+void instruction_set_element_size(Instruction* inst, uint8_t size) {
+    if (!inst) return;
+    uint8_t shift = 0;
+    while (size >> shift > 1) shift++;
+    inst->element_shift = size ? shift + 1 : 0;
+}
+
+const char* instruction_to_string(const Instruction* inst, char* buffer, size_t size) {
+    if (!inst || !buffer || !size) return NULL;
+    
+    const char* type_str;
+    switch (inst->type) {
+        case INST_ARITHMETIC: type_str = "ARITH"; break;
+        case INST_LOGICAL:    type_str = "LOGIC"; break;
+        case INST_MOVE:       type_str = "MOVE"; break;
+        case INST_BRANCH:     type_str = "BRANCH"; break;
+        case INST_LOAD_STORE: type_str = "MEM"; break;
+        case INST_SYSTEM:     type_str = "SYS"; break;
+        case INST_FLOAT:      type_str = "FLOAT"; break;
+        case INST_VECTOR:     type_str = "VECTOR"; break;
+        default:             type_str = "UNKNOWN"; break;
+    }
+    
+    int written = snprintf(buffer, size, "%s [%02X] ", type_str, inst->opcode);
+    if (written < 0 || written >= size) return buffer;
+    
+    if (inst->dest_reg != 0xFF) {
+        written += snprintf(buffer + written, size - written, "dst=X%d ", inst->dest_reg);
+        if (written < 0 || written >= size) return buffer;
+    }
+    
+    for (uint8_t i = 0; i < inst->operand_count; i++) {
+        Operand op = instruction_get_operand(inst, i);
+        switch (op.type) {
+            case OP_IMMEDIATE:
+                written += snprintf(buffer + written, size - written, "#0x%lx", op.value.immediate);
+                break;
+            case OP_REGISTER:
+                written += snprintf(buffer + written, size - written, "X%d", op.value.reg);
+                break;
+            case OP_MEMORY:
+                written += snprintf(buffer + written, size - written, "[X%d, #%d]", 
+                                 op.value.mem.base_reg, op.value.mem.offset);
+                break;
+            case OP_SHIFT: {
+                static const char* const shifts[] = { "LSL", "LSR", "ASR", "ROR" };
+                written += snprintf(buffer + written, size - written, "%s #%d",
+                                 shifts[op.value.shift.type & 3], op.value.shift.amount);
+                break;
+            }
+            case OP_EXTEND: {
+                static const char* const extends[] = { "UXTB", "UXTH", "UXTW", "UXTX",
+                                                       "SXTB", "SXTH", "SXTW", "SXTX" };
+                written += snprintf(buffer + written, size - written, "%s #%d",
+                                 extends[op.value.shift.type & 7], op.value.shift.amount);
+                break;
+            }
+            default:
+                written += snprintf(buffer + written, size - written, "???");
+                break;
+        }
+        
+        if (i < inst->operand_count - 1) {
+            written += snprintf(buffer + written, size - written, ", ");
+        }
+        
+        if (written < 0 || written >= size) break;
+    }
+    
+    if (inst->sets_flags) {
+        written += snprintf(buffer + written, size - written, " [FLAGS]");
+    }
+    
+    return buffer;
+}
+
+bool instruction_is_branch(const Instruction* inst) {
+    return inst && inst->type == INST_BRANCH;
+}
+
+bool instruction_is_conditional_branch(const Instruction* inst) {
+    if (!instruction_is_branch(inst)) return false;
+    return inst->opcode == 0x22 || (inst->opcode >= 0x27 && inst->opcode <= 0x2A);
+}
+
+bool instruction_is_indirect_branch(const Instruction* inst) {
+    return instruction_is_branch(inst) && instruction_get_operand_type(inst, 0) == OP_REGISTER;
+}
+
+bool instruction_is_memory_access(const Instruction* inst) {
+    return inst && inst->type == INST_LOAD_STORE;
+}
+
+uint64_t instruction_get_branch_target(const Instruction* inst, uint64_t pc) {
+    if (!inst || inst->type != INST_BRANCH || inst->operand_count < 1) {
+        return 0;
+    }
+    
+    if (instruction_get_operand_type(inst, 0) != OP_IMMEDIATE) return 0;
+    return pc + instruction_get_immediate(inst, 0);
+}
+
+/* Operand width of data-processing instructions (the sf bit) */
+bool instruction_is_64bit(const Instruction* inst) {
+    if (!inst) return false;
+    if (inst->type == INST_LOAD_STORE) {
+        return instruction_get_access_size(inst) == 8;
+    }
+    /* Addresses and system registers are always 64 bits */
+    if ((inst->type == INST_MOVE && (inst->opcode == 0x33 || inst->opcode == 0x34)) ||
+        inst->type == INST_SYSTEM) {
+        return true;
+    }
+    return (inst->raw >> 31) & 1;
+}
+
+/* Bytes transferred per register by a load or store */
+uint8_t instruction_get_access_size(const Instruction* inst) {
+    if (!inst || inst->type != INST_LOAD_STORE) return 0;
+    /* LD1 and ST1 move the whole register; element_size is their lane width */
+    if (inst->opcode == 0x44 || inst->opcode == 0x45) {
+        return instruction_get_vector_size(inst);
+    }
+    return instruction_get_element_size(inst);
+}
+
+uint8_t instruction_get_vector_size(const Instruction* inst) {
+    if (!inst) return 0;
+    return ((inst->raw >> 30) & 1) ? 16 : 8;
+}
+
+/* ADD and SUB (immediate or extended register) and logical immediates
+ * without S name SP with register 31 rather than XZR
+ */
+static bool dest_may_be_sp(const Instruction* inst) {
+    if (inst->sets_flags || inst->operand_count < 2) return false;
+    if (inst->type == INST_ARITHMETIC && inst->opcode <= 0x01) {
+        return instruction_get_operand_type(inst, 1) == OP_IMMEDIATE ||
+               instruction_get_operand_type(inst, 2) == OP_EXTEND;
+    }
+    return inst->type == INST_LOGICAL && inst->opcode <= 0x12 &&
+           instruction_get_operand_type(inst, 1) == OP_IMMEDIATE;
+}
+
+static bool is_general_load(const Instruction* inst) {
+    switch (inst->opcode) {
+        case 0x40: case 0x46: case 0x47: case 0x48: case 0x4A: case 0x4D:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static bool writes_back_base(const Operand* mem) {
+    return mem->type == OP_MEMORY &&
+           (mem->value.mem.mode == ADDR_PRE_INDEX || mem->value.mem.mode == ADDR_POST_INDEX);
+}
+
+/* Whether dest_reg is written; register 31 is SP only where
+ * dest_may_be_sp says so, and XZR, which discards the result, elsewhere.
+ */
+static bool writes_dest_reg(const Instruction* inst) {
+    switch (inst->type) {
+        case INST_ARITHMETIC:
+        case INST_LOGICAL:
+            /* CCMN and CCMP only set flags */
+            if (inst->dest_reg == 0xFF) return false;
+            return inst->dest_reg != 31 || dest_may_be_sp(inst);
+        case INST_MOVE:
+            return inst->dest_reg != 31;
+        case INST_LOAD_STORE:
+            return is_general_load(inst) && inst->dest_reg != 31;
+        case INST_SYSTEM:
+            return inst->opcode == 0x81 && inst->dest_reg != 31;
+        case INST_VECTOR:
+            /* Only UMOV targets a general register; the rest write V registers */
+            return inst->opcode == 0x68 && inst->dest_reg != 31;
+        case INST_FLOAT:
+            /* FMOV to a general register */
+            return inst->opcode == 0x7E && inst->dest_reg != 31;
+        default:
+            return false;
+    }
+}
+
+bool instruction_modifies_register(const Instruction* inst, uint8_t reg) {
+    if (!inst) return false;
+    if (inst->dest_reg == reg && writes_dest_reg(inst)) return true;
+    
+    switch (inst->type) {
+        case INST_LOAD_STORE: {
+            Operand mem = instruction_get_operand(inst, 0);
+            if (writes_back_base(&mem) && mem.value.mem.base_reg == reg) {
+                return true;
+            }
+            /* The second register of LDP and LDPSW, and the status of STXR */
+            if ((inst->opcode == 0x48 || inst->opcode == 0x4A || inst->opcode == 0x4E) &&
+                instruction_get_register(inst, 1) == reg && reg != 31) {
+                return true;
+            }
+            break;
+        }
+            
+        case INST_BRANCH:
+            if (reg == 30 && (inst->opcode == 0x25 || inst->opcode == 0x26)) {
+                return true;
+            }
+            break;
+            
+        default:
+            break;
+    }
+    
+    return false;
+}
+
+bool instruction_reads_register(const Instruction* inst, uint8_t reg) {
+    if (!inst) return false;
+    
+    /* Stores keep the value register in dest_reg; only the address
+     * registers of the others are general registers
+     */
+    if (inst->type == INST_LOAD_STORE) {
+        Operand mem = instruction_get_operand(inst, 0);
+        if (mem.value.mem.mode != ADDR_LITERAL && mem.value.mem.base_reg == reg) return true;
+        if (mem.value.mem.index_reg == reg) return true;
+        switch (inst->opcode) {
+            case 0x41:
+            case 0x4E:
+                return inst->dest_reg == reg;
+            case 0x49:
+                return inst->dest_reg == reg || instruction_get_register(inst, 1) == reg;
+            default:
+                return false;
+        }
+    }
+    
+    /* MOVK and BFM keep the destination bits they do not insert */
+    if ((inst->type == INST_MOVE && inst->opcode == 0x32) ||
+        (inst->type == INST_LOGICAL && inst->opcode == 0x1B)) {
+        if (inst->dest_reg == reg) return true;
+    }
+    
+    /* Vector operands are V registers, except the source of DUP and INS */
+    if (inst->type == INST_VECTOR) {
+        return (inst->opcode == 0x67 || inst->opcode == 0x69) && instruction_get_register(inst, 0) == reg;
+    }
+    /* Likewise FP operands, except the source of FMOV from a general register */
+    if (inst->type == INST_FLOAT) {
+        return inst->opcode == 0x7F && instruction_get_register(inst, 0) == reg;
+    }
+    
+    for (uint8_t i = 0; i < inst->operand_count; i++) {
+        Operand op = instruction_get_operand(inst, i);
+        switch (op.type) {
+            case OP_REGISTER:
+                if (op.value.reg == reg) return true;
+                break;
+                
+            case OP_MEMORY:
+                if (op.value.mem.base_reg == reg ||
+                    op.value.mem.index_reg == reg) {
+                    return true;
+                }
+                break;
+                
+            default:
+                break;
+        }
+    }
+    
+    return false;
+}
+
+bool instruction_reads_flags(const Instruction* inst) {
+    if (!inst) return false;
+    switch (inst->type) {
+        case INST_BRANCH:
+            return inst->opcode == 0x22;
+        case INST_ARITHMETIC:
+            return inst->opcode >= 0x02 && inst->opcode <= 0x05;
+        case INST_MOVE:
+            return inst->opcode >= 0x35 && inst->opcode <= 0x38;
+        case INST_SYSTEM:
+            return inst->opcode == 0x81 && instruction_get_immediate(inst, 0) == SYSREG_NZCV;
+        default:
+            return false;
+    }
+}
+
+bool instruction_can_be_reordered(const Instruction* inst) {
+    if (!inst) return false;
+    
+    switch (inst->type) {
+        case INST_BRANCH:
+        case INST_SYSTEM:
+        case INST_LOAD_STORE:
+            return false;
+        default:
+            return true;
+    }
 } 
\ No newline at end of file
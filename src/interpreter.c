@@ -0,0 +1,238 @@
+#include "interpreter.h"
+#include "memory.h"
+#include "registers.h"
+
+/* Register 31 is SP where the encoding allows it and XZR everywhere else */
+static uint64_t read_reg(const RegisterFile* regs, uint8_t reg, bool sp_allowed) {
+    if (reg == 31 && !sp_allowed) return 0;
+    return regs->x[reg];
+}
+
+static void write_reg(RegisterFile* regs, uint8_t reg, uint64_t value, bool sp_allowed) {
+    if (reg == 31 && !sp_allowed) return;
+    regs->x[reg] = value;
+}
+
+static uint64_t add_with_carry(uint64_t x, uint64_t y, bool carry_in, bool is_64bit,
+                               bool update_flags, RegisterFile* regs) {
+    uint64_t mask = is_64bit ? UINT64_MAX : 0xFFFFFFFFULL;
+    unsigned top = is_64bit ? 63 : 31;
+
+    x &= mask;
+    y &= mask;
+    uint64_t result = (x + y + (carry_in ? 1 : 0)) & mask;
+
+    if (update_flags) {
+        bool carry = carry_in ? result <= x : result < x;
+        bool overflow = (((x ^ result) & (y ^ result)) >> top) & 1;
+        registers_set_flags(regs, (result >> top) & 1, result == 0, carry, overflow);
+    }
+    return result;
+}
+
+static InterpreterResult execute_arithmetic(RegisterFile* regs, const Instruction* inst) {
+    bool is_64bit = instruction_is_64bit(inst);
+    bool immediate = instruction_get_operand_type(inst, 1) == OP_IMMEDIATE;
+
+    /* The immediate forms accept SP as source and, without S, as destination */
+    uint64_t op1 = read_reg(regs, instruction_get_register(inst, 0), immediate);
+    uint64_t op2 = immediate ? instruction_get_immediate(inst, 1)
+                             : read_reg(regs, instruction_get_register(inst, 1), false);
+
+    uint64_t result;
+    switch (inst->opcode) {
+        case 0x00:
+            result = add_with_carry(op1, op2, false, is_64bit, inst->sets_flags, regs);
+            break;
+        case 0x01:
+            result = add_with_carry(op1, ~op2, true, is_64bit, inst->sets_flags, regs);
+            break;
+        default:
+            return INTERP_ERROR_UNSUPPORTED;
+    }
+
+    write_reg(regs, inst->dest_reg, result, immediate && !inst->sets_flags);
+    return INTERP_SUCCESS;
+}
+
+static InterpreterResult execute_logical(RegisterFile* regs, const Instruction* inst) {
+    bool is_64bit = instruction_is_64bit(inst);
+    bool immediate = instruction_get_operand_type(inst, 1) == OP_IMMEDIATE;
+    uint64_t op1 = read_reg(regs, instruction_get_register(inst, 0), false);
+    uint64_t op2 = immediate
+                 ? instruction_get_immediate(inst, 1)
+                 : read_reg(regs, instruction_get_register(inst, 1), false);
+
+    uint64_t result;
+    switch (inst->opcode) {
+        case 0x10: result = op1 & op2; break;
+        case 0x11: result = op1 | op2; break;
+        case 0x12: result = op1 ^ op2; break;
+        default:
+            return INTERP_ERROR_UNSUPPORTED;
+    }
+
+    if (!is_64bit) result &= 0xFFFFFFFFULL;
+    if (inst->sets_flags) {
+        unsigned top = is_64bit ? 63 : 31;
+        registers_set_flags(regs, (result >> top) & 1, result == 0, false, false);
+    }
+
+    /* Logical immediates without S may write SP */
+    write_reg(regs, inst->dest_reg, result, immediate && !inst->sets_flags);
+    return INTERP_SUCCESS;
+}
+
+static InterpreterResult execute_memory(RegisterFile* regs, Memory* memory, const Instruction* inst) {
+    Operand mem = instruction_get_operand(inst, 0);
+    uint64_t address = read_reg(regs, mem.value.mem.base_reg, true) + (int64_t)mem.value.mem.offset;
+    uint8_t size = instruction_get_access_size(inst);
+    bool ok;
+
+    switch (inst->opcode) {
+        case 0x40: {
+            uint64_t value = 0;
+            switch (size) {
+                case 1: { uint8_t v;  ok = memory_read8(memory, address, &v);  value = v; break; }
+                case 2: { uint16_t v; ok = memory_read16(memory, address, &v); value = v; break; }
+                case 4: { uint32_t v; ok = memory_read32(memory, address, &v); value = v; break; }
+                default: ok = memory_read64(memory, address, &value); break;
+            }
+            if (!ok) return INTERP_ERROR_MEMORY_FAULT;
+            write_reg(regs, inst->dest_reg, value, false);
+            return INTERP_SUCCESS;
+        }
+        case 0x41: {
+            uint64_t value = read_reg(regs, inst->dest_reg, false);
+            switch (size) {
+                case 1: ok = memory_write8(memory, address, (uint8_t)value); break;
+                case 2: ok = memory_write16(memory, address, (uint16_t)value); break;
+                case 4: ok = memory_write32(memory, address, (uint32_t)value); break;
+                default: ok = memory_write64(memory, address, value); break;
+            }
+            return ok ? INTERP_SUCCESS : INTERP_ERROR_MEMORY_FAULT;
+        }
+        default:
+            return INTERP_ERROR_UNSUPPORTED;
+    }
+}
+
+static InterpreterResult execute_branch(RegisterFile* regs, const Instruction* inst,
+                                        uint64_t pc, uint64_t* next_pc) {
+    uint64_t target = instruction_get_branch_target(inst, pc);
+
+    switch (inst->opcode) {
+        case 0x20:
+            *next_pc = target;
+            return INTERP_SUCCESS;
+        case 0x22:
+            *next_pc = interpreter_condition_holds(regs, inst->condition) ? target : pc + 4;
+            return INTERP_SUCCESS;
+        case 0x25:
+            regs->x[30] = pc + 4;
+            *next_pc = target;
+            return INTERP_SUCCESS;
+        case 0x23:
+        case 0x24:
+            *next_pc = read_reg(regs, instruction_get_register(inst, 0), false);
+            return INTERP_SUCCESS;
+        case 0x26:
+            /* Read the target first: BLR X30 branches to the old X30 */
+            *next_pc = read_reg(regs, instruction_get_register(inst, 0), false);
+            regs->x[30] = pc + 4;
+            return INTERP_SUCCESS;
+        default:
+            return INTERP_ERROR_UNSUPPORTED;
+    }
+}
+
+bool interpreter_condition_holds(const RegisterFile* regs, uint8_t condition) {
+    if (!regs) return false;
+
+    bool n = registers_get_flag_n(regs);
+    bool z = registers_get_flag_z(regs);
+    bool c = registers_get_flag_c(regs);
+    bool v = registers_get_flag_v(regs);
+    bool result;
+
+    switch ((condition >> 1) & 7) {
+        case 0: result = z; break;
+        case 1: result = c; break;
+        case 2: result = n; break;
+        case 3: result = v; break;
+        case 4: result = c && !z; break;
+        case 5: result = n == v; break;
+        case 6: result = n == v && !z; break;
+        default: return true;
+    }
+
+    return (condition & 1) ? !result : result;
+}
+
+bool interpreter_can_execute(const Instruction* inst) {
+    if (!inst) return false;
+
+    switch (inst->type) {
+        /* ADD, SUB, AND, ORR and EOR without a shifted or extended operand */
+        case INST_ARITHMETIC:
+            return (inst->opcode == 0x00 || inst->opcode == 0x01) && inst->operand_count == 2;
+        case INST_LOGICAL:
+            return inst->opcode >= 0x10 && inst->opcode <= 0x12 && inst->operand_count == 2;
+        /* LDR and STR of a general register at base plus immediate */
+        case INST_LOAD_STORE: {
+            Operand mem = instruction_get_operand(inst, 0);
+            return (inst->opcode == 0x40 || inst->opcode == 0x41) &&
+                   mem.value.mem.mode == ADDR_OFFSET && mem.value.mem.index_reg == 0xFF;
+        }
+        case INST_BRANCH:
+            switch (inst->opcode) {
+                case 0x20: case 0x22: case 0x23: case 0x24: case 0x25: case 0x26:
+                    return true;
+                default:
+                    return false;
+            }
+        default:
+            return false;
+    }
+}
+
+InterpreterResult interpreter_execute(RegisterFile* regs, Memory* memory,
+                                      const Instruction* inst, uint64_t pc, uint64_t* next_pc) {
+    if (!regs || !memory || !inst || !next_pc) return INTERP_ERROR_NULL_PARAM;
+
+    *next_pc = pc + 4;
+    switch (inst->type) {
+        case INST_ARITHMETIC:
+            return execute_arithmetic(regs, inst);
+        case INST_LOGICAL:
+            return execute_logical(regs, inst);
+        case INST_LOAD_STORE:
+            return execute_memory(regs, memory, inst);
+        case INST_BRANCH:
+            return execute_branch(regs, inst, pc, next_pc);
+        default:
+            return INTERP_ERROR_UNSUPPORTED;
+    }
+}
+
+InterpreterResult interpreter_execute_block(RegisterFile* regs, Memory* memory,
+                                            const Instruction* insts, size_t count,
+                                            uint64_t address, uint64_t* next_pc) {
+    if (!regs || !memory || !insts || !next_pc) return INTERP_ERROR_NULL_PARAM;
+
+    uint64_t pc = address;
+    for (size_t i = 0; i < count; i++) {
+        InterpreterResult result = interpreter_execute(regs, memory, &insts[i], pc, next_pc);
+        if (result != INTERP_SUCCESS) {
+            *next_pc = pc;
+            return result;
+        }
+        if (instruction_is_branch(&insts[i])) {
+            return INTERP_SUCCESS;
+        }
+        pc = *next_pc;
+    }
+
+    *next_pc = pc;
+    return INTERP_SUCCESS;
+}
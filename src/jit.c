@@ -1,208 +1,1189 @@
-#include "jit.h"
-#include "decoder.h"
-#include "emitter.h"
-#include "memory.h"
-#include "registers.h"
-#include <stdlib.h>
-#include <string.h>
-
-#define MAX_BLOCK_SIZE 1024
-#define INITIAL_CACHE_SIZE 1024
-
-typedef struct {
-    uint64_t address;
-    void* code;
-} CacheEntry;
-
-static void initialize_llvm(void) {
-    static bool initialized = false;
-    if (!initialized) {
-        LLVMInitializeCore(LLVMGetGlobalPassRegistry());
-        LLVMLinkInMCJIT();
-        LLVMInitializeNativeTarget();
-        LLVMInitializeNativeAsmPrinter();
-        initialized = true;
-    }
-}
-
-JITContext* jit_create(Memory* memory, RegisterFile* registers) {
-    if (!memory || !registers) return NULL;
-    
-    initialize_llvm();
-    
-    JITContext* ctx = (JITContext*)calloc(1, sizeof(JITContext));
-    if (!ctx) return NULL;
-    
-    ctx->llvm_context = LLVMContextCreate();
-    ctx->module = LLVMModuleCreateWithNameInContext("jit_module", ctx->llvm_context);
-    ctx->builder = LLVMCreateBuilderInContext(ctx->llvm_context);
-    
-    char* error = NULL;
-    LLVMMCJITCompilerOptions options;
-    LLVMInitializeMCJITCompilerOptions(&options, sizeof(options));
-    if (LLVMCreateMCJITCompilerForModule(&ctx->engine, ctx->module, &options,
-                                        sizeof(options), &error) != 0) {
-        fprintf(stderr, "Failed to create JIT: %s\n", error);
-        LLVMDisposeMessage(error);
-        jit_destroy(ctx);
-        return NULL;
-    }
-    
-    ctx->pass_manager = LLVMCreatePassManager();
-    ctx->compiled_blocks = (void**)calloc(INITIAL_CACHE_SIZE, sizeof(void*));
-    if (!ctx->compiled_blocks) {
-        jit_destroy(ctx);
-        return NULL;
-    }
-    ctx->cache_size = INITIAL_CACHE_SIZE;
-    ctx->memory = memory;
-    ctx->registers = registers;
-    
-    return ctx;
-}
-
-void jit_destroy(JITContext* context) {
-    if (!context) return;
-    
-    if (context->compiled_blocks) {
-        for (size_t i = 0; i < context->cache_size; i++) {
-            if (context->compiled_blocks[i]) {
-                context->compiled_blocks[i] = NULL;
-            }
-        }
-        free(context->compiled_blocks);
-    }
-    
-    if (context->pass_manager) LLVMDisposePassManager(context->pass_manager);
-    if (context->builder) LLVMDisposeBuilder(context->builder);
-    if (context->engine) LLVMDisposeExecutionEngine(context->engine);
-    if (context->llvm_context) LLVMContextDispose(context->llvm_context);
-    
-    free(context);
-}
-
-void jit_add_basic_optimizations(JITContext* context) {
-    if (!context || !context->pass_manager) return;
-    
-    LLVMAddPromoteMemoryToRegisterPass(context->pass_manager);
-    LLVMAddInstructionCombiningPass(context->pass_manager);
-    LLVMAddReassociatePass(context->pass_manager);
-    LLVMAddGVNPass(context->pass_manager);
-    LLVMAddCFGSimplificationPass(context->pass_manager);
-}
-
-void jit_optimize_block(JITContext* context, LLVMValueRef function) {
-    if (!context || !function) return;
-    LLVMRunPassManager(context->pass_manager, function);
-}
-
-static bool compile_block(JITContext* context, uint64_t address,
-                        DecoderContext* decoder, EmitterContext* emitter) {
-    if (!emitter_create_entry_block(emitter)) {
-        return false;
-    }
-    
-    Instruction inst;
-    size_t count = 0;
-    bool success = true;
-    
-    while (count < MAX_BLOCK_SIZE) {
-        if (!decoder_decode_at(decoder, address + count * 4, &inst)) {
-            break;
-        }
-        
-        if (!emitter_emit_instruction(emitter, &inst)) {
-            success = false;
-            break;
-        }
-        
-        count++;
-        
-        if (instruction_is_branch(&inst)) {
-            break;
-        }
-    }
-    
-    if (!success || count == 0) {
-        return false;
-    }
-    
-    LLVMValueRef function = emitter_finalize_block(emitter);
-    if (!function) {
-        return false;
-    }
-    
-    jit_optimize_block(context, function);
-    
-    char* error = NULL;
-    if (LLVMVerifyFunction(function, LLVMPrintMessageAction, &error) != 0) {
-        fprintf(stderr, "Function verification failed: %s\n", error);
-        LLVMDisposeMessage(error);
-        return false;
-    }
-    
-    return true;
-}
-
-void* jit_compile_block(JITContext* context, uint64_t address) {
-    if (!context || !context->memory) return NULL;
-    
-    void* cached = jit_get_cached_block(context, address);
-    if (cached) return cached;
-    
-    uint8_t* code_ptr = (uint8_t*)context->memory + address;
-    size_t size = context->memory->total_mapped_size - address;
-    
-    DecoderContext* decoder = decoder_create(code_ptr, size);
-    EmitterContext* emitter = emitter_create(context);
-    
-    if (!decoder || !emitter) {
-        decoder_destroy(decoder);
-        emitter_destroy(emitter);
-        return NULL;
-    }
-    
-    bool success = compile_block(context, address, decoder, emitter);
-    void* function_ptr = NULL;
-    
-    if (success) {
-        function_ptr = LLVMGetPointerToGlobal(context->engine, emitter->function);
-        if (function_ptr) {
-            jit_cache_compiled_block(context, address, function_ptr);
-        }
-    }
-    
-    decoder_destroy(decoder);
-    emitter_destroy(emitter);
-    
-    return function_ptr;
-}
-
-bool jit_execute_block(JITContext* context, void* block) {
-    if (!context || !block) return false;
-    
-    typedef uint64_t (*BlockFunction)(void* cpu_state, void* memory_context);
-    BlockFunction func = (BlockFunction)block;
-    uint64_t next_pc = func(context->registers, context->memory);
-    registers_set_pc(context->registers, next_pc);
-    
-    return true;
-}
-
-void jit_cache_compiled_block(JITContext* context, uint64_t address, void* block) {
-    if (!context || !block) return;
-    size_t index = (address / 4) % context->cache_size;
-    context->compiled_blocks[index] = block;
-}
-
-void* jit_get_cached_block(JITContext* context, uint64_t address) {
-    if (!context) return NULL;
-    size_t index = (address / 4) % context->cache_size;
-    return context->compiled_blocks[index];
-}
-
-void jit_invalidate_cache(JITContext* context, uint64_t address) {
-    if (!context) return;
-    size_t index = (address / 4) % context->cache_size;
-    context->compiled_blocks[index] = NULL;
-} 
\ No newline at end of file
+#include "jit.h"
+#include "compile_queue.h"
+#include "emitter.h"
+#include "fpu.h"
+#include "interpreter.h"
+#include "liveness.h"
+#include "memory.h"
+#include "registers.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MAX_BLOCK_SIZE 1024
+#define INITIAL_CACHE_SIZE 1024
+#define DEFAULT_TIER_THRESHOLD 50
+#define DEFAULT_FIRST_OPT_LEVEL BLOCK_OPT_FAST
+#define DEFAULT_HOT_OPT_LEVEL BLOCK_OPT_FULL
+#define MAX_DEFAULT_WORKERS 4
+#define SYMBOL_POOL_SWEEP_INTERVAL 256
+
+#define MAX_TRACE_INSTRUCTIONS 256
+#define MAX_TRACE_BLOCKS 8
+#define TRACE_MIN_SAMPLES 8
+#define TRACE_BIAS_PERCENT 90
+
+static void initialize_llvm(void) {
+    static bool initialized = false;
+    if (!initialized) {
+        LLVMInitializeCore(LLVMGetGlobalPassRegistry());
+        LLVMInitializeNativeTarget();
+        LLVMInitializeNativeAsmPrinter();
+        initialized = true;
+    }
+}
+
+static void report_llvm_error(const char* what, LLVMErrorRef error) {
+    char* message = LLVMGetErrorMessage(error);
+    fprintf(stderr, "%s: %s\n", what, message);
+    LLVMDisposeErrorMessage(message);
+}
+
+/* Runtime functions called by emitted code, resolved as absolute symbols
+ * unless the helper bitcode defines them
+ */
+static const struct {
+    const char* name;
+    uintptr_t address;
+} runtime_symbols[] = {
+    { "memory_load_slow",  (uintptr_t)memory_load_slow },
+    { "memory_store_slow", (uintptr_t)memory_store_slow },
+    { "jit_resolve_indirect", (uintptr_t)jit_resolve_indirect },
+    { "fpu_exact_double",  (uintptr_t)fpu_exact_double },
+    { "fpu_exact_float",   (uintptr_t)fpu_exact_float },
+    { "fpu_exact_narrow",  (uintptr_t)fpu_exact_narrow },
+    { "fpu_exact_widen",   (uintptr_t)fpu_exact_widen },
+};
+
+#define RUNTIME_SYMBOL_COUNT (sizeof(runtime_symbols) / sizeof(runtime_symbols[0]))
+
+static bool define_runtime_symbols(JITCompiler* compiler) {
+    LLVMJITCSymbolMapPair pairs[RUNTIME_SYMBOL_COUNT];
+    for (size_t i = 0; i < RUNTIME_SYMBOL_COUNT; i++) {
+        pairs[i].Name = LLVMOrcLLJITMangleAndIntern(compiler->lljit, runtime_symbols[i].name);
+        pairs[i].Sym.Address = runtime_symbols[i].address;
+        pairs[i].Sym.Flags.GenericFlags = LLVMJITSymbolGenericFlagsExported |
+                                          LLVMJITSymbolGenericFlagsCallable;
+        pairs[i].Sym.Flags.TargetFlags = 0;
+    }
+    
+    LLVMOrcMaterializationUnitRef symbols = LLVMOrcAbsoluteSymbols(pairs, RUNTIME_SYMBOL_COUNT);
+    LLVMErrorRef error = LLVMOrcJITDylibDefine(LLVMOrcLLJITGetMainJITDylib(compiler->lljit), symbols);
+    if (error) {
+        report_llvm_error("Failed to define runtime symbols", error);
+        LLVMOrcDisposeMaterializationUnit(symbols);
+        return false;
+    }
+    
+    /* Helpers inlined from bitcode call libc and libm directly */
+    LLVMOrcDefinitionGeneratorRef generator = NULL;
+    error = LLVMOrcCreateDynamicLibrarySearchGeneratorForProcess(
+        &generator, LLVMOrcLLJITGetGlobalPrefix(compiler->lljit), NULL, NULL);
+    if (error) {
+        report_llvm_error("Failed to search process symbols", error);
+        return false;
+    }
+    LLVMOrcJITDylibAddGenerator(LLVMOrcLLJITGetMainJITDylib(compiler->lljit), generator);
+    return true;
+}
+
+JITCompiler* jit_compiler_create(TranslationCache* cache) {
+    initialize_llvm();
+    
+    JITCompiler* compiler = (JITCompiler*)calloc(1, sizeof(JITCompiler));
+    if (!compiler) return NULL;
+    
+    compiler->llvm_context = LLVMContextCreate();
+    compiler->builder = LLVMCreateBuilderInContext(compiler->llvm_context);
+    compiler->translation_cache = cache;
+    
+    LLVMErrorRef error = LLVMOrcCreateLLJIT(&compiler->lljit, NULL);
+    if (error) {
+        report_llvm_error("Failed to create JIT", error);
+        compiler->lljit = NULL;
+        jit_compiler_destroy(compiler);
+        return NULL;
+    }
+    
+    /* Objects are produced here rather than inside the LLJIT so they can
+     * be written to the translation cache before being linked.
+     */
+    const char* triple = LLVMOrcLLJITGetTripleString(compiler->lljit);
+    LLVMTargetRef target = NULL;
+    char* message = NULL;
+    if (LLVMGetTargetFromTriple(triple, &target, &message) != 0) {
+        fprintf(stderr, "Failed to find target %s: %s\n", triple, message);
+        LLVMDisposeMessage(message);
+        jit_compiler_destroy(compiler);
+        return NULL;
+    }
+    
+    static const LLVMCodeGenOptLevel codegen_levels[BLOCK_OPT_LEVELS] = {
+        LLVMCodeGenLevelNone,
+        LLVMCodeGenLevelLess,
+        LLVMCodeGenLevelDefault
+    };
+    char* cpu = LLVMGetHostCPUName();
+    char* features = LLVMGetHostCPUFeatures();
+    bool created = true;
+    for (size_t level = 0; level < BLOCK_OPT_LEVELS; level++) {
+        compiler->target_machines[level] = LLVMCreateTargetMachine(target, triple, cpu, features,
+                                                                   codegen_levels[level],
+                                                                   LLVMRelocDefault, LLVMCodeModelDefault);
+        created &= compiler->target_machines[level] != NULL;
+    }
+    LLVMDisposeMessage(cpu);
+    LLVMDisposeMessage(features);
+    
+    if (!created || !define_runtime_symbols(compiler)) {
+        jit_compiler_destroy(compiler);
+        return NULL;
+    }
+    
+    return compiler;
+}
+
+void jit_compiler_destroy(JITCompiler* compiler) {
+    if (!compiler) return;
+    
+    if (compiler->builder) LLVMDisposeBuilder(compiler->builder);
+    if (compiler->lljit) {
+        LLVMErrorRef error = LLVMOrcDisposeLLJIT(compiler->lljit);
+        if (error) report_llvm_error("Failed to dispose JIT", error);
+    }
+    for (size_t level = 0; level < BLOCK_OPT_LEVELS; level++) {
+        if (compiler->target_machines[level]) LLVMDisposeTargetMachine(compiler->target_machines[level]);
+    }
+    if (compiler->helper_inliner) LLVMDisposePassManager(compiler->helper_inliner);
+    if (compiler->helpers) LLVMDisposeModule(compiler->helpers);
+    if (compiler->llvm_context) LLVMContextDispose(compiler->llvm_context);
+    
+    free(compiler);
+}
+
+bool jit_compiler_load_helpers(JITCompiler* compiler, LLVMMemoryBufferRef bitcode) {
+    if (!compiler || !bitcode || compiler->helpers) return false;
+    
+    LLVMModuleRef helpers = NULL;
+    char* error = NULL;
+    if (LLVMParseBitcodeInContext(compiler->llvm_context, bitcode, &helpers, &error) != 0) {
+        fprintf(stderr, "Failed to parse helper bitcode: %s\n", error ? error : "unknown error");
+        LLVMDisposeMessage(error);
+        return false;
+    }
+    /* Built by the host compiler for this machine; use the JIT's spelling of it */
+    LLVMSetTarget(helpers, LLVMOrcLLJITGetTripleString(compiler->lljit));
+    LLVMSetDataLayout(helpers, LLVMOrcLLJITGetDataLayoutStr(compiler->lljit));
+    
+    unsigned always_inline = LLVMGetEnumAttributeKindForName("alwaysinline", strlen("alwaysinline"));
+    unsigned no_inline = LLVMGetEnumAttributeKindForName("noinline", strlen("noinline"));
+    for (size_t i = 0; i < RUNTIME_SYMBOL_COUNT; i++) {
+        LLVMValueRef func = LLVMGetNamedFunction(helpers, runtime_symbols[i].name);
+        if (!func || LLVMIsDeclaration(func)) continue;
+        LLVMRemoveEnumAttributeAtIndex(func, LLVMAttributeFunctionIndex, no_inline);
+        LLVMAddAttributeAtIndex(func, LLVMAttributeFunctionIndex,
+                                LLVMCreateEnumAttribute(compiler->llvm_context, always_inline, 0));
+    }
+    
+    compiler->helpers = helpers;
+    compiler->helper_inliner = LLVMCreatePassManager();
+    LLVMAddAlwaysInlinerPass(compiler->helper_inliner);
+    LLVMAddGlobalDCEPass(compiler->helper_inliner);
+    return true;
+}
+
+/* Linked before anything is emitted, so the emitter calls the definitions */
+static bool link_helpers(JITCompiler* compiler) {
+    if (!compiler->helpers) return true;
+    if (LLVMLinkModules2(compiler->module, LLVMCloneModule(compiler->helpers))) {
+        fprintf(stderr, "Failed to link helper bitcode\n");
+        return false;
+    }
+    
+    /* The object must export nothing but the block */
+    for (LLVMValueRef func = LLVMGetFirstFunction(compiler->module); func; func = LLVMGetNextFunction(func)) {
+        if (!LLVMIsDeclaration(func)) LLVMSetLinkage(func, LLVMInternalLinkage);
+    }
+    for (LLVMValueRef global = LLVMGetFirstGlobal(compiler->module); global; global = LLVMGetNextGlobal(global)) {
+        if (!LLVMIsDeclaration(global)) LLVMSetLinkage(global, LLVMInternalLinkage);
+    }
+    return true;
+}
+
+static size_t default_worker_count(void) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus <= 2) return 1;
+    return cpus - 1 > MAX_DEFAULT_WORKERS ? MAX_DEFAULT_WORKERS : (size_t)(cpus - 1);
+}
+
+/* Stores into pages holding decoded code land here, possibly from inside
+ * translated code; invalidated blocks are only retired, so the running
+ * block stays valid until it returns to the dispatcher.
+ */
+static void handle_code_write(void* opaque, uint64_t address, size_t size) {
+    jit_invalidate_range((JITContext*)opaque, address, size);
+}
+
+static void index_range(JITContext* context, JITBlock* block, uint64_t address, uint64_t size) {
+    uint64_t page = address & ~(MEMORY_PAGE_SIZE - 1);
+    for (; page < address + size; page += MEMORY_PAGE_SIZE) {
+        if (!block_add_page(block, page)) continue;
+        page_index_add(context->page_index, page, block);
+        memory_mark_code(context->memory, page, MEMORY_PAGE_SIZE);
+    }
+}
+
+/* Registers every page the block was built from; safe to repeat */
+static void index_block(JITContext* context, JITBlock* block) {
+    index_range(context, block, block->address, block->size);
+    for (size_t i = 0; block->trace && i < block->trace->count; i++) {
+        index_range(context, block, block->trace->pcs[i], 4);
+    }
+}
+
+static void unindex_block(JITContext* context, JITBlock* block) {
+    for (size_t i = 0; i < block->page_count; i++) {
+        if (page_index_remove(context->page_index, block->pages[i], block) &&
+            !decode_cache_contains(context->decode_cache, block->pages[i])) {
+            memory_clear_code(context->memory, block->pages[i], MEMORY_PAGE_SIZE);
+        }
+    }
+    free(block->pages);
+    block->pages = NULL;
+    block->page_count = 0;
+}
+
+JITContext* jit_create(Memory* memory, RegisterFile* registers) {
+    if (!memory || !registers) return NULL;
+    
+    initialize_llvm();
+    
+    JITContext* ctx = (JITContext*)calloc(1, sizeof(JITContext));
+    if (!ctx) return NULL;
+    
+    ctx->block_cache = block_cache_create(INITIAL_CACHE_SIZE);
+    ctx->exit_lists = block_cache_create(INITIAL_CACHE_SIZE);
+    ctx->code_cache = code_cache_create(0);
+    ctx->page_index = page_index_create();
+    ctx->decode_cache = decode_cache_create(memory);
+    if (!ctx->block_cache || !ctx->exit_lists || !ctx->code_cache || !ctx->page_index ||
+        !ctx->decode_cache) {
+        jit_destroy(ctx);
+        return NULL;
+    }
+    ctx->memory = memory;
+    memory_set_code_write_handler(memory, handle_code_write, ctx);
+    ctx->registers = registers;
+    ctx->tier_threshold = DEFAULT_TIER_THRESHOLD;
+    ctx->first_opt_level = DEFAULT_FIRST_OPT_LEVEL;
+    ctx->hot_opt_level = DEFAULT_HOT_OPT_LEVEL;
+    ctx->worker_count = default_worker_count();
+    
+    return ctx;
+}
+
+static void destroy_block(JITBlock* block) {
+    compile_job_destroy(block->compile_job);
+    jit_release_code(block);
+    block_destroy(block);
+}
+
+static void reclaim_retired_blocks(JITContext* context) {
+    bool freed = false;
+    JITBlock** link = &context->retired_blocks;
+    while (*link) {
+        JITBlock* block = *link;
+        /* A worker may still be reading the block's instructions */
+        if (block->compile_job && !compile_queue_is_done(block->compile_job)) {
+            link = &block->next_retired;
+            continue;
+        }
+        *link = block->next_retired;
+        destroy_block(block);
+        freed = true;
+    }
+    
+    /* Return stack entries may point at exits of the freed blocks */
+    if (freed) {
+        memset(context->return_stack.entries, 0, sizeof(context->return_stack.entries));
+    }
+}
+
+static void destroy_cached_block(uint64_t address, void* block, void* opaque) {
+    (void)address;
+    unindex_block((JITContext*)opaque, (JITBlock*)block);
+    destroy_block((JITBlock*)block);
+}
+
+void jit_destroy(JITContext* context) {
+    if (!context) return;
+    
+    /* Stop the workers so no job still reads a block, then release the
+     * blocks' code before the compilers that own it go away.
+     */
+    compile_queue_shutdown(context->compile_queue);
+    
+    block_cache_foreach(context->block_cache, destroy_cached_block, context);
+    block_cache_destroy(context->block_cache);
+    block_cache_destroy(context->exit_lists);
+    code_cache_destroy(context->code_cache);
+    page_index_destroy(context->page_index);
+    decode_cache_destroy(context->decode_cache);
+    reclaim_retired_blocks(context);
+    
+    compile_queue_destroy(context->compile_queue);
+    jit_compiler_destroy(context->compiler);
+    translation_cache_close(context->translation_cache);
+    if (context->helper_bitcode) LLVMDisposeMemoryBuffer(context->helper_bitcode);
+    if (context->memory && context->memory->code_write_opaque == context) {
+        memory_set_code_write_handler(context->memory, NULL, NULL);
+    }
+    free(context);
+}
+
+/* New pass manager pipelines, indexed by BlockOptLevel */
+static const char* const opt_pipelines[BLOCK_OPT_LEVELS] = {
+    NULL,
+    "function(mem2reg,instcombine,simplifycfg)",
+    "default<O2>"
+};
+
+bool jit_optimize_module(JITCompiler* compiler, BlockOptLevel level) {
+    if (!compiler || !compiler->module || level >= BLOCK_OPT_LEVELS) return false;
+    if (!opt_pipelines[level]) return true;
+    
+    LLVMPassBuilderOptionsRef options = LLVMCreatePassBuilderOptions();
+    if (level == BLOCK_OPT_FULL) {
+        LLVMPassBuilderOptionsSetLoopVectorization(options, true);
+        LLVMPassBuilderOptionsSetSLPVectorization(options, true);
+    }
+    LLVMErrorRef error = LLVMRunPasses(compiler->module, opt_pipelines[level],
+                                       compiler->target_machines[level], options);
+    LLVMDisposePassBuilderOptions(options);
+    if (error) {
+        report_llvm_error("Failed to optimize block", error);
+        return false;
+    }
+    return true;
+}
+
+/* Index of the instruction a closing B or B.cond jumps back to, making the
+ * run a native loop; count if it does not end in one
+ */
+static size_t find_loop_start(const JITBlock* block, const Instruction* insts, size_t count) {
+    if (!count) return count;
+    const Instruction* last = &insts[count - 1];
+    if (last->type != INST_BRANCH || (last->opcode != 0x20 && !instruction_is_conditional_branch(last))) {
+        return count;
+    }
+    
+    const BlockTrace* trace = block->trace;
+    uint64_t last_pc = trace ? trace->pcs[count - 1] : block->address + (count - 1) * 4;
+    uint64_t target = instruction_get_branch_target(last, last_pc);
+    for (size_t i = 0; i < count; i++) {
+        if ((trace ? trace->pcs[i] : block->address + i * 4) == target) return i;
+    }
+    return count;
+}
+
+static bool compile_block(JITCompiler* compiler, const JITBlock* block, EmitterContext* emitter) {
+    if (!emitter_create_entry_block(emitter)) {
+        return false;
+    }
+    
+    const BlockTrace* trace = block->trace;
+    const Instruction* insts = trace ? trace->instructions : block->instructions;
+    size_t count = trace ? trace->count : block->instruction_count;
+    
+    /* Dead register and flag results are skipped rather than emitted */
+    InstructionLiveness* liveness = (InstructionLiveness*)calloc(count, sizeof(InstructionLiveness));
+    if (!liveness) return false;
+    liveness_analyze(insts, count, liveness);
+    
+    size_t loop_start = find_loop_start(block, insts, count);
+    bool emitted = true;
+    for (size_t i = 0; i < count && emitted; i++) {
+        const Instruction* inst = &insts[i];
+        emitter->pc = trace ? trace->pcs[i] : block->address + i * 4;
+        emitter->liveness = liveness[i];
+        
+        if (i == loop_start && !emitter_begin_loop(emitter, inst, count - i)) {
+            emitted = false;
+        } else if (loop_start < count && i + 1 == count) {
+            emitted = emitter_emit_loop_branch(emitter, inst);
+        } else if (trace && i + 1 < count && instruction_is_branch(inst)) {
+            emitted = emitter_emit_trace_branch(emitter, inst, trace->pcs[i + 1]);
+        } else {
+            emitted = emitter_emit_instruction(emitter, inst);
+        }
+    }
+    free(liveness);
+    if (!emitted) return false;
+    
+    emitter->pc = (trace ? trace->pcs[count - 1] : block->address + (count - 1) * 4) + 4;
+    LLVMValueRef function = emitter_finalize_block(emitter);
+    if (!function) {
+        return false;
+    }
+    
+    /* Helpers are inlined first so the optimizer sees through them */
+    if (compiler->helper_inliner) LLVMRunPassManager(compiler->helper_inliner, compiler->module);
+    if (!jit_optimize_module(compiler, block->opt_level)) return false;
+    
+    if (LLVMVerifyFunction(function, LLVMPrintMessageAction) != 0) {
+        fprintf(stderr, "Function verification failed at 0x%lx\n", block->address);
+        return false;
+    }
+    
+    return true;
+}
+
+static void release_tracker(LLVMOrcResourceTrackerRef tracker) {
+    LLVMErrorRef error = LLVMOrcResourceTrackerRemove(tracker);
+    if (error) report_llvm_error("Failed to release block code", error);
+    LLVMOrcReleaseResourceTracker(tracker);
+}
+
+/* Links object into the LLJIT under a new tracker; takes ownership of it */
+static bool add_object(JITCompiler* compiler, LLVMMemoryBufferRef object,
+                       const char* symbol, CompileResult* result) {
+    LLVMOrcJITDylibRef dylib = LLVMOrcLLJITGetMainJITDylib(compiler->lljit);
+    LLVMOrcResourceTrackerRef tracker = LLVMOrcJITDylibCreateResourceTracker(dylib);
+    
+    size_t size = LLVMGetBufferSize(object);
+    LLVMOrcExecutorAddress address = 0;
+    LLVMErrorRef error = LLVMOrcLLJITAddObjectFileWithRT(compiler->lljit, tracker, object);
+    if (!error) error = LLVMOrcLLJITLookup(compiler->lljit, &address, symbol);
+    
+    if (error) {
+        report_llvm_error("Failed to link block", error);
+        release_tracker(tracker);
+        return false;
+    }
+    
+    result->code = (void*)(uintptr_t)address;
+    result->tracker = tracker;
+    result->code_size = size;
+    return true;
+}
+
+static bool load_cached_block(JITCompiler* compiler, const JITBlock* block, CompileResult* result) {
+    TranslationCacheEntry* entry = translation_cache_load(compiler->translation_cache,
+                                                          block->cache_key, block->address);
+    if (!entry) return false;
+    
+    const BlockTrace* trace = block->trace;
+    if (!translation_cache_validate(compiler->translation_cache, entry,
+                                    trace ? trace->instructions : block->instructions,
+                                    trace ? trace->pcs : NULL,
+                                    trace ? trace->count : block->instruction_count)) {
+        translation_cache_release(entry);
+        return false;
+    }
+    
+    uint64_t* exits = NULL;
+    if (entry->exit_count) {
+        exits = (uint64_t*)malloc(entry->exit_count * sizeof(uint64_t));
+        if (!exits) {
+            translation_cache_release(entry);
+            return false;
+        }
+        memcpy(exits, entry->exit_targets, entry->exit_count * sizeof(uint64_t));
+    }
+    
+    /* The buffer borrows the mapping; linking copies the sections out, so
+     * the mapping can go once the lookup has materialized the block.
+     */
+    LLVMMemoryBufferRef object = LLVMCreateMemoryBufferWithMemoryRange(
+        (const char*)entry->object, entry->object_size, entry->symbol, false);
+    bool loaded = add_object(compiler, object, entry->symbol, result);
+    
+    if (loaded) {
+        result->exit_targets = exits;
+        result->exit_count = entry->exit_count;
+    } else {
+        free(exits);
+    }
+    translation_cache_release(entry);
+    return loaded;
+}
+
+static bool emit_block(JITCompiler* compiler, const JITBlock* block, CompileResult* result) {
+    EmitterContext* emitter = emitter_create(compiler);
+    if (!emitter) return false;
+    
+    char name[64];
+    snprintf(name, sizeof(name), "block_%lx_%lx_%lu", block->address, block->cache_key,
+             compiler->compiled_count++);
+    compiler->module = LLVMModuleCreateWithNameInContext(name, compiler->llvm_context);
+    LLVMSetTarget(compiler->module, LLVMOrcLLJITGetTripleString(compiler->lljit));
+    LLVMSetDataLayout(compiler->module, LLVMOrcLLJITGetDataLayoutStr(compiler->lljit));
+    
+    bool success = link_helpers(compiler) && compile_block(compiler, block, emitter);
+    
+    LLVMMemoryBufferRef object = NULL;
+    if (success) {
+        LLVMSetValueName2(emitter->function, name, strlen(name));
+        char* message = NULL;
+        LLVMTargetMachineRef machine = compiler->target_machines[block->opt_level];
+        if (LLVMTargetMachineEmitToMemoryBuffer(machine, compiler->module, LLVMObjectFile,
+                                                &message, &object) != 0) {
+            fprintf(stderr, "Failed to emit block at 0x%lx: %s\n", block->address, message);
+            LLVMDisposeMessage(message);
+            object = NULL;
+        }
+    }
+    LLVMDisposeModule(compiler->module);
+    compiler->module = NULL;
+    
+    if (object && compiler->translation_cache) {
+        const BlockTrace* trace = block->trace;
+        translation_cache_store(compiler->translation_cache, block->cache_key, block->address,
+                                trace ? trace->instructions : block->instructions,
+                                trace ? trace->pcs : NULL,
+                                trace ? trace->count : block->instruction_count,
+                                emitter->exit_targets, emitter->exit_count, name,
+                                LLVMGetBufferStart(object), LLVMGetBufferSize(object));
+    }
+    
+    if (object && add_object(compiler, object, name, result)) {
+        result->exit_targets = emitter->exit_targets;
+        result->exit_count = emitter->exit_count;
+        emitter->exit_targets = NULL;
+    }
+    emitter_destroy(emitter);
+    return result->code != NULL;
+}
+
+bool jit_compiler_compile(JITCompiler* compiler, const JITBlock* block, CompileResult* result) {
+    if (!compiler || !block || !result) return false;
+    memset(result, 0, sizeof(*result));
+    
+    /* Every block interns a fresh symbol name; drop the released ones */
+    if (compiler->compiled_count % SYMBOL_POOL_SWEEP_INTERVAL == 0) {
+        LLVMOrcExecutionSessionRef session = LLVMOrcLLJITGetExecutionSession(compiler->lljit);
+        LLVMOrcSymbolStringPoolClearDeadEntries(LLVMOrcExecutionSessionGetSymbolStringPool(session));
+    }
+    
+    /* A cached object whose symbol is still live here (the same code
+     * loaded twice) fails to link; compiling it afresh gives a new name.
+     */
+    if (compiler->translation_cache && load_cached_block(compiler, block, result)) {
+        compiler->compiled_count++;
+        return true;
+    }
+    return emit_block(compiler, block, result);
+}
+
+void jit_compile_result_free(CompileResult* result) {
+    if (!result) return;
+    if (result->tracker) release_tracker(result->tracker);
+    free(result->exit_targets);
+    memset(result, 0, sizeof(*result));
+}
+
+void jit_release_code(JITBlock* block) {
+    if (!block || !block->code_tracker) return;
+    release_tracker(block->code_tracker);
+    block->code_tracker = NULL;
+    block->code = NULL;
+}
+
+static bool decode_block(JITContext* context, JITBlock* block) {
+    Instruction* insts = (Instruction*)malloc(MAX_BLOCK_SIZE * sizeof(Instruction));
+    if (!insts) return false;
+    
+    size_t count = decode_cache_fetch_block(context->decode_cache, block->address, insts, MAX_BLOCK_SIZE);
+    if (count == 0) {
+        free(insts);
+        return false;
+    }
+    
+    Instruction* shrunk = (Instruction*)realloc(insts, count * sizeof(Instruction));
+    block->instructions = shrunk ? shrunk : insts;
+    block->instruction_count = count;
+    block->size = count * 4;
+    return true;
+}
+
+/* Compilers are created on first use so the worker count can still be
+ * changed after jit_create.
+ */
+static bool ensure_compilers(JITContext* context) {
+    if (context->compile_queue || context->compiler) return true;
+    
+    if (context->worker_count > 0) {
+        context->compile_queue = compile_queue_create(context->worker_count,
+                                                      context->translation_cache,
+                                                      context->helper_bitcode);
+        if (context->compile_queue) return true;
+        fprintf(stderr, "Failed to start compile workers, compiling synchronously\n");
+    }
+    context->compiler = jit_compiler_create(context->translation_cache);
+    if (context->compiler && context->helper_bitcode) {
+        jit_compiler_load_helpers(context->compiler, context->helper_bitcode);
+    }
+    return context->compiler != NULL;
+}
+
+/* Evicted blocks leave the translation table just like invalidated ones:
+ * they are unlinked now and their code is released with the other retired
+ * blocks once no translated code is running. If they run again they start
+ * over in the interpreter.
+ */
+static void evict_code(JITContext* context, size_t incoming) {
+    while (code_cache_needs_space(context->code_cache, incoming)) {
+        JITBlock* victim = code_cache_evict(context->code_cache);
+        jit_invalidate_cache(context, victim->address);
+    }
+}
+
+static void track_code(JITContext* context, JITBlock* block) {
+    evict_code(context, block->code_size);
+    code_cache_insert(context->code_cache, block);
+}
+
+static bool install_compiled_code(JITContext* context, JITBlock* block, CompileResult* result) {
+    if (!result->code || !block_set_exits(block, result->exit_targets, result->exit_count)) {
+        if (block->trace) {
+            /* The superblock reached code the emitter cannot handle; the
+             * block on its own may still compile on the next attempt.
+             */
+            block_trace_destroy(block->trace);
+            block->trace = NULL;
+            return false;
+        }
+        /* Stay in the interpreter rather than retrying on every execution */
+        block->promotion_failed = true;
+        return false;
+    }
+    
+    block->code = result->code;
+    block->code_tracker = result->tracker;
+    block->code_size = result->code_size;
+    block->tier = BLOCK_TIER_JIT;
+    result->tracker = NULL;
+    
+    /* Blocks promoted in place are already cached; link them now */
+    if (jit_get_cached_block(context, block->address) == block) {
+        track_code(context, block);
+        block_register_exits(block, context->exit_lists, context->block_cache);
+        block_link_incoming(block, context->exit_lists);
+    }
+    return true;
+}
+
+static bool finish_compile_job(JITContext* context, JITBlock* block) {
+    CompileJob* job = block->compile_job;
+    block->compile_job = NULL;
+    
+    bool installed = install_compiled_code(context, block, &job->result);
+    compile_job_destroy(job);
+    return installed;
+}
+
+/* The successor a trace should continue with after block: fall-through,
+ * B/BL targets, and the side of a conditional branch the profile strongly
+ * favours.
+ */
+static bool trace_successor(const JITBlock* block, uint64_t* next) {
+    const Instruction* last = &block->instructions[block->instruction_count - 1];
+    uint64_t last_pc = block->address + (block->instruction_count - 1) * 4;
+    
+    if (!instruction_is_branch(last)) {
+        *next = last_pc + 4;
+        return true;
+    }
+    
+    uint64_t target = instruction_get_branch_target(last, last_pc);
+    switch (last->opcode) {
+        case 0x20:
+        case 0x25:
+            *next = target;
+            return true;
+        case 0x22: case 0x27: case 0x28: case 0x29: case 0x2A: {
+            uint64_t samples = block->branch_taken + block->branch_not_taken;
+            if (samples < TRACE_MIN_SAMPLES) return false;
+            if (block->branch_taken * 100 >= samples * TRACE_BIAS_PERCENT) {
+                *next = target;
+                return true;
+            }
+            if (block->branch_not_taken * 100 >= samples * TRACE_BIAS_PERCENT) {
+                *next = last_pc + 4;
+                return true;
+            }
+            return false;
+        }
+        default:
+            return false;
+    }
+}
+
+static void form_trace(JITContext* context, JITBlock* head) {
+    if (head->trace_formed) return;
+    head->trace_formed = true;
+    
+    BlockTrace* trace = block_trace_create(MAX_TRACE_INSTRUCTIONS);
+    if (!trace) return;
+    if (!block_trace_append(trace, head->instructions, head->instruction_count, head->address)) {
+        block_trace_destroy(trace);
+        return;
+    }
+    
+    const JITBlock* current = head;
+    JITBlock* scratch = NULL;
+    uint64_t next;
+    while (trace->block_count < MAX_TRACE_BLOCKS && trace_successor(current, &next)) {
+        /* Superblocks have a single entry, so stop rather than loop back */
+        if (block_trace_contains(trace, next)) break;
+        
+        JITBlock* successor = jit_get_cached_block(context, next);
+        if (!successor) {
+            /* Not run yet: decode it just for its instructions */
+            block_destroy(scratch);
+            scratch = block_create(next);
+            if (!scratch || !decode_block(context, scratch)) break;
+            successor = scratch;
+        }
+        if (!block_trace_append(trace, successor->instructions, successor->instruction_count, next)) break;
+        current = successor;
+    }
+    block_destroy(scratch);
+    
+    if (trace->block_count < 2) {
+        block_trace_destroy(trace);
+        return;
+    }
+    head->trace = trace;
+    
+    /* A store into any block of the trace must now invalidate the head */
+    if (jit_get_cached_block(context, head->address) == head) {
+        index_block(context, head);
+    }
+}
+
+/* Persistent cache key of the block compiled at level. The pipeline and
+ * the helpers inlined into the block change its object as much as the
+ * guest code does.
+ */
+static uint64_t block_cache_key(const JITContext* context, const JITBlock* block, BlockOptLevel level) {
+    uint64_t key = translation_cache_key(context->translation_cache, block->address,
+                                         block->instructions, block->instruction_count);
+    uint32_t level_id = (uint32_t)level;
+    key = translation_cache_hash(&level_id, sizeof(level_id), key);
+    return translation_cache_hash(&context->helper_hash, sizeof(context->helper_hash), key);
+}
+
+/* Forms the block's trace and picks the pipeline for it. Blocks compiled
+ * before the interpreter has profiled them get the first tier's; hot ones,
+ * and loops, whose time goes into their iterations, get the hot tier's.
+ */
+static void prepare_compile(JITContext* context, JITBlock* block) {
+    form_trace(context, block);
+    
+    const BlockTrace* trace = block->trace;
+    const Instruction* insts = trace ? trace->instructions : block->instructions;
+    size_t count = trace ? trace->count : block->instruction_count;
+    bool profiled = block->warm_started ||
+                    (context->tier_threshold > 0 && block->execution_count >= context->tier_threshold);
+    bool loops = find_loop_start(block, insts, count) < count;
+    block->opt_level = profiled || loops ? context->hot_opt_level : context->first_opt_level;
+    if (context->translation_cache) {
+        block->cache_key = block_cache_key(context, block, block->opt_level);
+    }
+}
+
+static bool read_code_word(JITContext* context, uint64_t pc, uint32_t* word) {
+    MemoryRegion* region = memory_find_region(context->memory, pc);
+    if (!region || !(region->permissions & PERM_EXEC) || pc + 4 > region->start + region->size) return false;
+    memcpy(word, region->data + (pc - region->start), sizeof(*word));
+    return true;
+}
+
+/* Warm start: rebuild the trace a cached object was compiled from, if the
+ * guest code it covers is still the same. Returns false for stale entries.
+ */
+static bool restore_cached_trace(JITContext* context, JITBlock* block) {
+    TranslationCache* cache = context->translation_cache;
+    TranslationCacheEntry* entry = translation_cache_load(cache, block->cache_key, block->address);
+    if (!entry) return false;
+    
+    size_t count = entry->instruction_count;
+    bool valid = count <= MAX_TRACE_INSTRUCTIONS;
+    bool spans_blocks = count != block->instruction_count;
+    for (size_t i = 0; valid && i < count; i++) {
+        uint32_t word;
+        valid = read_code_word(context, entry->pcs[i], &word) && word == entry->words[i];
+        spans_blocks |= entry->pcs[i] != block->address + i * 4;
+    }
+    
+    BlockTrace* trace = NULL;
+    if (valid && spans_blocks) {
+        trace = block_trace_create(count);
+        for (size_t i = 0; trace && i < count; i++) {
+            /* The words were checked against memory above */
+            const Instruction* inst = decode_cache_fetch(context->decode_cache, entry->pcs[i]);
+            if (!inst) {
+                valid = false;
+                break;
+            }
+            block_trace_append(trace, inst, 1, entry->pcs[i]);
+        }
+        if (trace) {
+            trace->block_count = 1;
+            for (size_t i = 1; i < trace->count; i++) {
+                if (trace->pcs[i] != trace->pcs[i - 1] + 4) trace->block_count++;
+            }
+        }
+        valid = valid && trace;
+    }
+    translation_cache_release(entry);
+    
+    if (!valid) {
+        block_trace_destroy(trace);
+        translation_cache_reject(cache);
+        return false;
+    }
+    block->trace = trace;
+    block->trace_formed = true;
+    return true;
+}
+
+bool jit_promote_block(JITContext* context, JITBlock* block) {
+    if (!context || !block) return false;
+    if (block->code) return true;
+    if (block->promotion_failed || !ensure_compilers(context)) return false;
+    
+    bool installed;
+    if (context->compile_queue) {
+        if (!block->compile_job) {
+            prepare_compile(context, block);
+            block->compile_job = compile_queue_submit(context->compile_queue, block, true);
+            if (!block->compile_job) return false;
+        }
+        compile_queue_wait(context->compile_queue, block->compile_job);
+        installed = finish_compile_job(context, block);
+    } else {
+        prepare_compile(context, block);
+        CompileResult result;
+        jit_compiler_compile(context->compiler, block, &result);
+        installed = install_compiled_code(context, block, &result);
+        jit_compile_result_free(&result);
+    }
+    
+    /* A failed superblock leaves the block to be retried on its own */
+    if (!installed && !block->promotion_failed) {
+        return jit_promote_block(context, block);
+    }
+    return installed;
+}
+
+/* Hot blocks are compiled in the background while the interpreter keeps
+ * running them; without workers this falls back to a synchronous compile.
+ */
+static void request_promotion(JITContext* context, JITBlock* block) {
+    if (block->compile_job || block->promotion_failed) return;
+    if (!ensure_compilers(context)) return;
+    
+    if (context->compile_queue) {
+        prepare_compile(context, block);
+        block->compile_job = compile_queue_submit(context->compile_queue, block, false);
+    } else {
+        jit_promote_block(context, block);
+    }
+}
+
+static bool block_is_interpretable(const JITBlock* block) {
+    for (size_t i = 0; i < block->instruction_count; i++) {
+        if (!interpreter_can_execute(&block->instructions[i])) return false;
+    }
+    return true;
+}
+
+JITBlock* jit_compile_block(JITContext* context, uint64_t address) {
+    if (!context || !context->memory) return NULL;
+    
+    JITBlock* cached = jit_get_cached_block(context, address);
+    if (cached) return cached;
+    
+    JITBlock* block = block_create(address);
+    if (!block) return NULL;
+    block->context = context;
+    
+    if (!decode_block(context, block)) {
+        block_destroy(block);
+        return NULL;
+    }
+    
+    /* Only hot-tier code is worth skipping the interpreter for; first-tier
+     * objects are loaded when the block is compiled at that tier again
+     */
+    if (context->translation_cache) {
+        block->cache_key = block_cache_key(context, block, context->hot_opt_level);
+        block->warm_started = translation_cache_contains(context->translation_cache, block->cache_key) &&
+                              restore_cached_trace(context, block);
+    }
+    
+    /* New blocks start in the interpreter; only blocks it cannot run
+     * (or every block, with a zero threshold) are compiled up front.
+     * Blocks with code on disk skip straight to it, since loading is cheap.
+     */
+    if (context->tier_threshold == 0 || block->warm_started || !block_is_interpretable(block)) {
+        if (!jit_promote_block(context, block)) {
+            block_destroy(block);
+            return NULL;
+        }
+    }
+    
+    jit_cache_compiled_block(context, address, block);
+    return block;
+}
+
+bool jit_execute_block(JITContext* context, JITBlock* block) {
+    if (!context || !block) return false;
+    
+    if (!block->code) {
+        if (block->compile_job) {
+            if (compile_queue_is_done(block->compile_job)) {
+                finish_compile_job(context, block);
+            }
+        } else if (++block->execution_count >= context->tier_threshold) {
+            request_promotion(context, block);
+        }
+    }
+    
+    uint64_t next_pc;
+    if (block->code) {
+        BlockFunction func = (BlockFunction)block->code;
+        next_pc = func(context->registers, context->memory, block);
+        if (next_pc & BLOCK_FAULT) {
+            registers_set_pc(context->registers, next_pc & ~BLOCK_FAULT);
+            return false;
+        }
+    } else {
+        InterpreterResult result = interpreter_execute_block(context->registers, context->memory,
+                                                             block->instructions, block->instruction_count,
+                                                             block->address, &next_pc);
+        if (result != INTERP_SUCCESS) {
+            registers_set_pc(context->registers, next_pc);
+            return false;
+        }
+        
+        /* Branch profile for trace formation */
+        const Instruction* last = &block->instructions[block->instruction_count - 1];
+        if (instruction_is_conditional_branch(last)) {
+            if (next_pc == block->address + block->size) {
+                block->branch_not_taken++;
+            } else {
+                block->branch_taken++;
+            }
+        }
+    }
+    registers_set_pc(context->registers, next_pc);
+    
+    /* No translated code is on the stack here, so blocks invalidated
+     * while it ran can finally be released.
+     */
+    reclaim_retired_blocks(context);
+    
+    return true;
+}
+
+void jit_set_tier_threshold(JITContext* context, uint64_t threshold) {
+    if (!context) return;
+    context->tier_threshold = threshold;
+}
+
+void jit_set_opt_levels(JITContext* context, BlockOptLevel first, BlockOptLevel hot) {
+    if (!context || first >= BLOCK_OPT_LEVELS || hot >= BLOCK_OPT_LEVELS) return;
+    context->first_opt_level = first;
+    context->hot_opt_level = hot;
+}
+
+void jit_set_code_budget(JITContext* context, size_t bytes) {
+    if (!context) return;
+    code_cache_set_budget(context->code_cache, bytes);
+    evict_code(context, 0);
+}
+
+bool jit_set_worker_count(JITContext* context, size_t count) {
+    if (!context || context->compile_queue || context->compiler) return false;
+    context->worker_count = count;
+    return true;
+}
+
+/* Anything other than the guest code that changes the objects we produce:
+ * the host target and the JIT build itself, so a rebuilt emulator never
+ * picks up objects from an older code generator.
+ */
+static uint64_t compute_options_hash(void) {
+    char* triple = LLVMGetDefaultTargetTriple();
+    char* cpu = LLVMGetHostCPUName();
+    char* features = LLVMGetHostCPUFeatures();
+    
+    uint64_t hash = translation_cache_hash(triple, strlen(triple), TRANSLATION_CACHE_VERSION);
+    hash = translation_cache_hash(cpu, strlen(cpu), hash);
+    hash = translation_cache_hash(features, strlen(features), hash);
+    LLVMDisposeMessage(triple);
+    LLVMDisposeMessage(cpu);
+    LLVMDisposeMessage(features);
+    
+    FILE* exe = fopen("/proc/self/exe", "rb");
+    if (exe) {
+        uint8_t buffer[65536];
+        size_t read;
+        while ((read = fread(buffer, 1, sizeof(buffer), exe)) > 0) {
+            hash = translation_cache_hash(buffer, read, hash);
+        }
+        fclose(exe);
+    } else {
+        const char* build = __DATE__ " " __TIME__;
+        hash = translation_cache_hash(build, strlen(build), hash);
+    }
+    return hash;
+}
+
+bool jit_set_cache_directory(JITContext* context, const char* directory) {
+    if (!context || context->compile_queue || context->compiler) return false;
+    
+    TranslationCache* cache = translation_cache_open(directory, compute_options_hash());
+    if (!cache) return false;
+    
+    translation_cache_close(context->translation_cache);
+    context->translation_cache = cache;
+    return true;
+}
+
+bool jit_set_helper_bitcode(JITContext* context, const char* path) {
+    if (!context || !path || context->compile_queue || context->compiler) return false;
+    
+    LLVMMemoryBufferRef bitcode = NULL;
+    char* message = NULL;
+    if (LLVMCreateMemoryBufferWithContentsOfFile(path, &bitcode, &message) != 0) {
+        fprintf(stderr, "Failed to read %s: %s\n", path, message);
+        LLVMDisposeMessage(message);
+        return false;
+    }
+    
+    /* Reject bad bitcode now rather than in every compiler */
+    JITCompiler* probe = jit_compiler_create(NULL);
+    bool valid = probe && jit_compiler_load_helpers(probe, bitcode);
+    jit_compiler_destroy(probe);
+    if (!valid) {
+        LLVMDisposeMemoryBuffer(bitcode);
+        return false;
+    }
+    
+    if (context->helper_bitcode) LLVMDisposeMemoryBuffer(context->helper_bitcode);
+    context->helper_bitcode = bitcode;
+    context->helper_hash = translation_cache_hash(LLVMGetBufferStart(bitcode), LLVMGetBufferSize(bitcode), 0);
+    return true;
+}
+
+void jit_cache_compiled_block(JITContext* context, uint64_t address, JITBlock* block) {
+    if (!context || !block) return;
+    if (!block_cache_insert(context->block_cache, address, block)) return;
+    index_block(context, block);
+    if (!block->code) return;
+    
+    track_code(context, block);
+    
+    /* Chain this block to successors that already have code, then
+     * point every exit waiting on this address at it.
+     */
+    block_register_exits(block, context->exit_lists, context->block_cache);
+    block_link_incoming(block, context->exit_lists);
+}
+
+JITBlock* jit_get_cached_block(JITContext* context, uint64_t address) {
+    if (!context) return NULL;
+    return (JITBlock*)block_cache_lookup(context->block_cache, address);
+}
+
+void jit_invalidate_cache(JITContext* context, uint64_t address) {
+    if (!context) return;
+    
+    block_unlink_incoming(address, context->exit_lists);
+    
+    JITBlock* block = (JITBlock*)block_cache_remove(context->block_cache, address);
+    if (!block) return;
+    
+    block_unregister_exits(block, context->exit_lists);
+    code_cache_remove(context->code_cache, block);
+    unindex_block(context, block);
+    compile_queue_cancel(block->compile_job);
+    block->next_retired = context->retired_blocks;
+    context->retired_blocks = block;
+}
+
+JITBlock* jit_resolve_indirect(JITBlock* self, uint64_t exit_index, uint64_t target_pc) {
+    JITContext* context = self ? self->context : NULL;
+    if (!context || exit_index >= self->exit_count) return NULL;
+    
+    BlockExit* exit = &self->exits[exit_index];
+    JITBlock* target = jit_get_cached_block(context, target_pc);
+    context->indirect_stats.resolves++;
+    
+    /* A retired block is still finishing its run; its exits stay unregistered */
+    if (exit->target_pc != target_pc && jit_get_cached_block(context, self->address) == self) {
+        if (block_retarget_exit(exit, target_pc, target, context->exit_lists)) {
+            context->indirect_stats.retargets++;
+        }
+    }
+    
+    if (!target || !target->code) return NULL;
+    context->indirect_stats.linked++;
+    return target;
+}
+
+void jit_get_indirect_stats(const JITContext* context, IndirectBranchStats* stats) {
+    if (!context || !stats) return;
+    *stats = context->indirect_stats;
+}
+
+void jit_print_indirect_stats(const JITContext* context) {
+    if (!context) return;
+    
+    const IndirectBranchStats* stats = &context->indirect_stats;
+    printf("Indirect Branches:\n");
+    printf("Resolves: %lu  Retargets: %lu  Linked: %lu\n",
+           stats->resolves, stats->retargets, stats->linked);
+}
+
+void jit_invalidate_range(JITContext* context, uint64_t address, uint64_t size) {
+    if (!context || !size) return;
+    
+    decode_cache_invalidate(context->decode_cache, address, size);
+    
+    uint64_t page = address & ~(MEMORY_PAGE_SIZE - 1);
+    for (; page < address + size; page += MEMORY_PAGE_SIZE) {
+        /* Invalidation removes the block from this list, so rescan from i */
+        const PageBlocks* entry;
+        size_t i = 0;
+        while ((entry = page_index_lookup(context->page_index, page)) && i < entry->count) {
+            JITBlock* block = entry->blocks[i];
+            if (!block_overlaps(block, address, size)) {
+                i++;
+            } else if (jit_get_cached_block(context, block->address) == block) {
+                jit_invalidate_cache(context, block->address);
+            } else {
+                unindex_block(context, block);
+            }
+        }
+        /* Pages only the decode cache held lose their mark here */
+        if (!page_index_lookup(context->page_index, page)) {
+            memory_clear_code(context->memory, page, MEMORY_PAGE_SIZE);
+        }
+    }
+}
+
+void jit_get_decode_stats(const JITContext* context, DecodeCacheStats* stats) {
+    if (!context) return;
+    decode_cache_get_stats(context->decode_cache, stats);
+}
+
+void jit_get_cache_stats(const JITContext* context, BlockCacheStats* stats) {
+    if (!context) return;
+    block_cache_get_stats(context->block_cache, stats);
+}
@@ -0,0 +1,52 @@
+#include "liveness.h"
+#include "registers.h"
+
+#define LIVE_ALL ((1ULL << ARM64_NUM_REGS) - 1)
+#define LIVE_FLAGS (1ULL << ARM64_REG_NZCV)
+
+static bool leaves_run(const Instruction* inst, bool last) {
+    if (last) return true;
+    if (!instruction_is_branch(inst)) return false;
+    return instruction_is_conditional_branch(inst) || instruction_is_indirect_branch(inst);
+}
+
+/* Fills out, if given, and returns what is live before the first instruction */
+static uint64_t analyze(const Instruction* insts, size_t count, InstructionLiveness* out) {
+    uint64_t live = LIVE_ALL;
+    for (size_t i = count; i-- > 0;) {
+        const Instruction* inst = &insts[i];
+        if (leaves_run(inst, i + 1 == count)) live = LIVE_ALL;
+        
+        uint64_t written = 0;
+        for (uint8_t reg = 0; reg < ARM64_REG_PC; reg++) {
+            if (instruction_modifies_register(inst, reg)) written |= 1ULL << reg;
+        }
+        if (out) {
+            out[i].dead_result = !(live & written);
+            out[i].dead_flags = inst->sets_flags && !(live & LIVE_FLAGS);
+        }
+        
+        /* Writes are killed before reads are added: add x0, x0, #1 reads x0 */
+        live &= ~written;
+        if (inst->sets_flags) live &= ~LIVE_FLAGS;
+        
+        for (uint8_t reg = 0; reg < ARM64_REG_PC; reg++) {
+            if (instruction_reads_register(inst, reg)) live |= 1ULL << reg;
+        }
+        if (instruction_reads_flags(inst)) live |= LIVE_FLAGS;
+        
+        /* A faulting access leaves with the state from before it */
+        if (inst->type == INST_LOAD_STORE) live = LIVE_ALL;
+    }
+    return live;
+}
+
+void liveness_analyze(const Instruction* insts, size_t count, InstructionLiveness* out) {
+    if (!insts || !out) return;
+    analyze(insts, count, out);
+}
+
+uint64_t liveness_live_in(const Instruction* insts, size_t count) {
+    if (!insts) return LIVE_ALL;
+    return analyze(insts, count, NULL);
+}
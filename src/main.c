@@ -1,206 +1,352 @@
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include <getopt.h>
-#include "jit.h"
-#include "memory.h"
-#include "registers.h"
-#include "profiling.h"
-
-static struct option long_options[] = {
-    {"input",     required_argument, 0, 'i'},
-    {"output",    required_argument, 0, 'o'},
-    {"debug",     no_argument,       0, 'd'},
-    {"profile",   no_argument,       0, 'p'},
-    {"help",      no_argument,       0, 'h'},
-    {0, 0, 0, 0}
-};
-
-typedef struct {
-    char* input_file;
-    char* output_file;
-    bool debug_mode;
-    bool profile_mode;
-} Config;
-
-static void print_usage(const char* program_name);
-static bool parse_arguments(int argc, char** argv, Config* config);
-static bool load_binary(const char* filename, Memory* memory, uint64_t* entry_point);
-static void cleanup(JITContext* jit, Memory* memory, RegisterFile* registers, ProfilingContext* profiling);
-
-int main(int argc, char** argv) {
-    Config config = {0};
-    uint64_t entry_point = 0;
-
-    if (!parse_arguments(argc, argv, &config)) {
-        return EXIT_FAILURE;
-    }
-
-    Memory* memory = memory_create();
-    RegisterFile* registers = registers_create();
-    ProfilingContext* profiling = profiling_create();
-
-    if (!memory || !registers || !profiling) {
-        fprintf(stderr, "Failed to initialize emulator components\n");
-        cleanup(NULL, memory, registers, profiling);
-        return EXIT_FAILURE;
-    }
-
-    if (!load_binary(config.input_file, memory, &entry_point)) {
-        fprintf(stderr, "Failed to load input file: %s\n", config.input_file);
-        cleanup(NULL, memory, registers, profiling);
-        return EXIT_FAILURE;
-    }
-
-    JITContext* jit = jit_create(memory, registers);
-    if (!jit) {
-        fprintf(stderr, "Failed to initialize JIT compiler\n");
-        cleanup(NULL, memory, registers, profiling);
-        return EXIT_FAILURE;
-    }
-
-    if (config.profile_mode) {
-        profiling_enable(profiling);
-        if (config.output_file) {
-            profiling_set_log_file(profiling, config.output_file);
-        }
-    }
-
-    registers_set_pc(registers, entry_point);
-
-    while (true) {
-        uint64_t pc = registers_get_pc(registers);
-        void* block = jit_get_cached_block(jit, pc);
-
-        if (!block) {
-            block = jit_compile_block(jit, pc);
-            if (!block) {
-                fprintf(stderr, "Failed to compile block at 0x%lx\n", pc);
-                break;
-            }
-        }
-
-        if (config.debug_mode) {
-            printf("Executing block at 0x%lx\n", pc);
-            registers_print_state(registers);
-        }
-
-        if (!jit_execute_block(jit, block)) {
-            fprintf(stderr, "Execution failed at 0x%lx\n", pc);
-            break;
-        }
-
-        if (registers_get_pc(registers) == 0) {
-            break;
-        }
-    }
-
-    if (config.profile_mode) {
-        profiling_print_stats(profiling);
-        if (config.output_file) {
-            profiling_export_json(profiling, config.output_file);
-        }
-    }
-
-    cleanup(jit, memory, registers, profiling);
-    free(config.input_file);
-    free(config.output_file);
-
-    return EXIT_SUCCESS;
-}
-
-static void print_usage(const char* program_name) {
-    printf("Usage: %s [options]\n", program_name);
-    printf("Options:\n");
-    printf("  -i, --input=FILE    Input ARM64 binary file\n");
-    printf("  -o, --output=FILE   Output file for profiling data\n");
-    printf("  -d, --debug         Enable debug mode\n");
-    printf("  -p, --profile       Enable profiling\n");
-    printf("  -h, --help          Display this help message\n");
-}
-
-static bool parse_arguments(int argc, char** argv, Config* config) {
-    int option_index = 0;
-    int c;
-
-    while ((c = getopt_long(argc, argv, "i:o:dph", long_options, &option_index)) != -1) {
-        switch (c) {
-            case 'i':
-                config->input_file = strdup(optarg);
-                break;
-            case 'o':
-                config->output_file = strdup(optarg);
-                break;
-            case 'd':
-                config->debug_mode = true;
-                break;
-            case 'p':
-                config->profile_mode = true;
-                break;
-            case 'h':
-                print_usage(argv[0]);
-                return false;
-            case '?':
-                return false;
-            default:
-                fprintf(stderr, "Unknown option: %c\n", c);
-                return false;
-        }
-    }
-
-    if (!config->input_file) {
-        fprintf(stderr, "Input file is required\n");
-        print_usage(argv[0]);
-        return false;
-    }
-
-    return true;
-}
-
-static bool load_binary(const char* filename, Memory* memory, uint64_t* entry_point) {
-    FILE* file = fopen(filename, "rb");
-    if (!file) {
-        return false;
-    }
-
-    fseek(file, 0, SEEK_END);
-    long size = ftell(file);
-    fseek(file, 0, SEEK_SET);
-
-    uint8_t* buffer = malloc(size);
-    if (!buffer) {
-        fclose(file);
-        return false;
-    }
-
-    if (fread(buffer, 1, size, file) != size) {
-        free(buffer);
-        fclose(file);
-        return false;
-    }
-
-    if (!memory_map(memory, 0x400000, size, PERM_READ | PERM_EXEC)) {
-        free(buffer);
-        fclose(file);
-        return false;
-    }
-
-    if (!memory_copy_to(memory, 0x400000, buffer, size)) {
-        free(buffer);
-        fclose(file);
-        return false;
-    }
-
-    *entry_point = 0x400000;
-
-    free(buffer);
-    fclose(file);
-    return true;
-}
-
-static void cleanup(JITContext* jit, Memory* memory, RegisterFile* registers, ProfilingContext* profiling) {
-    if (jit) jit_destroy(jit);
-    if (memory) memory_destroy(memory);
-    if (registers) registers_destroy(registers);
-    if (profiling) profiling_destroy(profiling);
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <getopt.h>
+#include "jit.h"
+#include "memory.h"
+#include "registers.h"
+#include "profiling.h"
+
+static struct option long_options[] = {
+    {"input",     required_argument, 0, 'i'},
+    {"output",    required_argument, 0, 'o'},
+    {"debug",     no_argument,       0, 'd'},
+    {"profile",   no_argument,       0, 'p'},
+    {"tier-threshold", required_argument, 0, 't'},
+    {"jit-threads", required_argument, 0, 'j'},
+    {"cache-dir", required_argument, 0, 'c'},
+    {"code-cache", required_argument, 0, 'm'},
+    {"helpers",   required_argument, 0, 'b'},
+    {"opt",       required_argument, 0, 'O'},
+    {"help",      no_argument,       0, 'h'},
+    {0, 0, 0, 0}
+};
+
+typedef struct {
+    char* input_file;
+    char* output_file;
+    bool debug_mode;
+    bool profile_mode;
+    bool tier_threshold_set;
+    uint64_t tier_threshold;
+    bool jit_threads_set;
+    uint64_t jit_threads;
+    char* cache_dir;
+    uint64_t code_budget;
+    char* helpers;
+    bool opt_levels_set;
+    BlockOptLevel first_opt_level;
+    BlockOptLevel hot_opt_level;
+} Config;
+
+static void print_usage(const char* program_name);
+static bool parse_arguments(int argc, char** argv, Config* config);
+static bool parse_size(const char* text, uint64_t* size);
+static bool parse_opt_levels(const char* text, Config* config);
+static bool load_binary(const char* filename, Memory* memory, uint64_t* entry_point);
+static void cleanup(JITContext* jit, Memory* memory, RegisterFile* registers, ProfilingContext* profiling);
+
+int main(int argc, char** argv) {
+    Config config = {0};
+    uint64_t entry_point = 0;
+
+    if (!parse_arguments(argc, argv, &config)) {
+        return EXIT_FAILURE;
+    }
+
+    Memory* memory = memory_create();
+    RegisterFile* registers = registers_create();
+    ProfilingContext* profiling = profiling_create();
+
+    if (!memory || !registers || !profiling) {
+        fprintf(stderr, "Failed to initialize emulator components\n");
+        cleanup(NULL, memory, registers, profiling);
+        return EXIT_FAILURE;
+    }
+
+    if (!load_binary(config.input_file, memory, &entry_point)) {
+        fprintf(stderr, "Failed to load input file: %s\n", config.input_file);
+        cleanup(NULL, memory, registers, profiling);
+        return EXIT_FAILURE;
+    }
+
+    JITContext* jit = jit_create(memory, registers);
+    if (!jit) {
+        fprintf(stderr, "Failed to initialize JIT compiler\n");
+        cleanup(NULL, memory, registers, profiling);
+        return EXIT_FAILURE;
+    }
+
+    if (config.tier_threshold_set) {
+        jit_set_tier_threshold(jit, config.tier_threshold);
+    }
+
+    if (config.jit_threads_set) {
+        jit_set_worker_count(jit, config.jit_threads);
+    }
+
+    if (config.opt_levels_set) {
+        jit_set_opt_levels(jit, config.first_opt_level, config.hot_opt_level);
+    }
+
+    if (config.code_budget) {
+        jit_set_code_budget(jit, config.code_budget);
+    }
+
+    if (config.cache_dir && !jit_set_cache_directory(jit, config.cache_dir)) {
+        fprintf(stderr, "Warning: translation cache disabled\n");
+    }
+
+    if (config.helpers && !jit_set_helper_bitcode(jit, config.helpers)) {
+        fprintf(stderr, "Warning: helpers will not be inlined\n");
+    }
+
+    if (config.profile_mode) {
+        profiling_enable(profiling);
+        if (config.output_file) {
+            profiling_set_log_file(profiling, config.output_file);
+        }
+    }
+
+    registers_set_pc(registers, entry_point);
+
+    while (true) {
+        uint64_t pc;
+        registers_get_pc(registers, &pc);
+        JITBlock* block = jit_get_cached_block(jit, pc);
+
+        if (!block) {
+            block = jit_compile_block(jit, pc);
+            if (!block) {
+                fprintf(stderr, "Failed to compile block at 0x%lx\n", pc);
+                break;
+            }
+        }
+
+        if (config.debug_mode) {
+            printf("Executing block at 0x%lx\n", pc);
+            registers_print_state(registers);
+        }
+
+        if (!jit_execute_block(jit, block)) {
+            fprintf(stderr, "Execution failed at 0x%lx\n", pc);
+            break;
+        }
+
+        registers_get_pc(registers, &pc);
+        if (pc == 0) {
+            break;
+        }
+    }
+
+    if (config.profile_mode) {
+        profiling_print_stats(profiling);
+        block_cache_print_stats(jit->block_cache);
+        code_cache_print_stats(jit->code_cache);
+        jit_print_indirect_stats(jit);
+        printf("Memory TLB misses: %lu\n", memory->tlb_misses);
+        translation_cache_print_stats(jit->translation_cache);
+        if (config.output_file) {
+            profiling_export_json(profiling, config.output_file);
+        }
+    }
+
+    cleanup(jit, memory, registers, profiling);
+    free(config.input_file);
+    free(config.output_file);
+    free(config.cache_dir);
+    free(config.helpers);
+
+    return EXIT_SUCCESS;
+}
+
+static void print_usage(const char* program_name) {
+    printf("Usage: %s [options]\n", program_name);
+    printf("Options:\n");
+    printf("  -i, --input=FILE    Input ARM64 binary file\n");
+    printf("  -o, --output=FILE   Output file for profiling data\n");
+    printf("  -d, --debug         Enable debug mode\n");
+    printf("  -p, --profile       Enable profiling\n");
+    printf("  -t, --tier-threshold=N\n");
+    printf("                      Interpret a block N times before JIT compiling it\n");
+    printf("                      (0 compiles every block on first use)\n");
+    printf("  -j, --jit-threads=N Compile hot blocks on N background threads\n");
+    printf("                      (0 compiles on the execution thread)\n");
+    printf("  -c, --cache-dir=DIR Reuse compiled blocks across runs from DIR\n");
+    printf("  -m, --code-cache=SIZE\n");
+    printf("                      Keep at most SIZE bytes of translated code, evicting\n");
+    printf("                      cold blocks (K, M and G suffixes; default unlimited)\n");
+    printf("  -b, --helpers=FILE  Inline runtime helpers from bitcode FILE (make helpers)\n");
+    printf("  -O, --opt=FIRST[,HOT]\n");
+    printf("                      Optimize blocks compiled on first use with FIRST and\n");
+    printf("                      hot blocks and loops with HOT: none, fast or full\n");
+    printf("                      (default fast,full)\n");
+    printf("  -h, --help          Display this help message\n");
+}
+
+static bool parse_arguments(int argc, char** argv, Config* config) {
+    int option_index = 0;
+    int c;
+
+    while ((c = getopt_long(argc, argv, "i:o:dpt:j:c:m:b:O:h", long_options, &option_index)) != -1) {
+        switch (c) {
+            case 'i':
+                config->input_file = strdup(optarg);
+                break;
+            case 'o':
+                config->output_file = strdup(optarg);
+                break;
+            case 'd':
+                config->debug_mode = true;
+                break;
+            case 'p':
+                config->profile_mode = true;
+                break;
+            case 't': {
+                char* end = NULL;
+                config->tier_threshold = strtoull(optarg, &end, 0);
+                if (!end || *end != '\0') {
+                    fprintf(stderr, "Invalid tier threshold: %s\n", optarg);
+                    return false;
+                }
+                config->tier_threshold_set = true;
+                break;
+            }
+            case 'j': {
+                char* end = NULL;
+                config->jit_threads = strtoull(optarg, &end, 0);
+                if (!end || *end != '\0' || config->jit_threads > 64) {
+                    fprintf(stderr, "Invalid JIT thread count: %s\n", optarg);
+                    return false;
+                }
+                config->jit_threads_set = true;
+                break;
+            }
+            case 'c':
+                config->cache_dir = strdup(optarg);
+                break;
+            case 'm':
+                if (!parse_size(optarg, &config->code_budget) || config->code_budget == 0) {
+                    fprintf(stderr, "Invalid code cache size: %s\n", optarg);
+                    return false;
+                }
+                break;
+            case 'b':
+                config->helpers = strdup(optarg);
+                break;
+            case 'O':
+                if (!parse_opt_levels(optarg, config)) {
+                    fprintf(stderr, "Invalid optimization levels: %s\n", optarg);
+                    return false;
+                }
+                break;
+            case 'h':
+                print_usage(argv[0]);
+                return false;
+            case '?':
+                return false;
+            default:
+                fprintf(stderr, "Unknown option: %c\n", c);
+                return false;
+        }
+    }
+
+    if (!config->input_file) {
+        fprintf(stderr, "Input file is required\n");
+        print_usage(argv[0]);
+        return false;
+    }
+
+    return true;
+}
+
+static bool parse_size(const char* text, uint64_t* size) {
+    char* end = NULL;
+    errno = 0;
+    uint64_t value = strtoull(text, &end, 0);
+    if (!end || end == text || errno == ERANGE || strchr(text, '-')) return false;
+
+    unsigned shift = 0;
+    switch (*end) {
+        case 'K': case 'k': shift = 10; end++; break;
+        case 'M': case 'm': shift = 20; end++; break;
+        case 'G': case 'g': shift = 30; end++; break;
+        default: break;
+    }
+    if (*end != '\0' || value > UINT64_MAX >> shift) return false;
+
+    *size = value << shift;
+    return true;
+}
+
+static bool parse_opt_level(const char* name, size_t length, BlockOptLevel* level) {
+    static const char* const names[BLOCK_OPT_LEVELS] = { "none", "fast", "full" };
+    for (size_t i = 0; i < BLOCK_OPT_LEVELS; i++) {
+        if (strlen(names[i]) == length && strncmp(name, names[i], length) == 0) {
+            *level = (BlockOptLevel)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+/* FIRST[,HOT]; a single level applies to both tiers */
+static bool parse_opt_levels(const char* text, Config* config) {
+    const char* comma = strchr(text, ',');
+    size_t first_length = comma ? (size_t)(comma - text) : strlen(text);
+    if (!parse_opt_level(text, first_length, &config->first_opt_level)) return false;
+    config->hot_opt_level = config->first_opt_level;
+    if (comma && !parse_opt_level(comma + 1, strlen(comma + 1), &config->hot_opt_level)) return false;
+    config->opt_levels_set = true;
+    return true;
+}
+
+static bool load_binary(const char* filename, Memory* memory, uint64_t* entry_point) {
+    FILE* file = fopen(filename, "rb");
+    if (!file) {
+        return false;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    uint8_t* buffer = malloc(size);
+    if (!buffer) {
+        fclose(file);
+        return false;
+    }
+
+    if (fread(buffer, 1, size, file) != size) {
+        free(buffer);
+        fclose(file);
+        return false;
+    }
+
+    if (!memory_map(memory, 0x400000, size, PERM_READ | PERM_WRITE)) {
+        free(buffer);
+        fclose(file);
+        return false;
+    }
+
+    if (!memory_copy_to(memory, 0x400000, buffer, size) ||
+        !memory_protect(memory, 0x400000, size, PERM_READ | PERM_EXEC)) {
+        free(buffer);
+        fclose(file);
+        return false;
+    }
+
+    *entry_point = 0x400000;
+
+    free(buffer);
+    fclose(file);
+    return true;
+}
+
+static void cleanup(JITContext* jit, Memory* memory, RegisterFile* registers, ProfilingContext* profiling) {
+    if (jit) jit_destroy(jit);
+    if (memory) memory_destroy(memory);
+    if (registers) registers_destroy(registers);
+    if (profiling) profiling_destroy(profiling);
 }
\ No newline at end of file
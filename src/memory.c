@@ -1,285 +1,405 @@
-#include "memory.h"
-#include <stdlib.h>
-#include <string.h>
-#include <stdio.h>
-
-Memory* memory_create(void) {
-    Memory* mem = (Memory*)calloc(1, sizeof(Memory));
-    if (mem) {
-        mem->regions = NULL;
-        mem->total_mapped_size = 0;
-        mem->little_endian = true;
-    }
-    return mem;
-}
-
-void memory_destroy(Memory* mem) {
-    if (!mem) return;
-    
-    MemoryRegion* current = mem->regions;
-    while (current) {
-        MemoryRegion* next = current->next;
-        free(current->data);
-        free(current);
-        current = next;
-    }
-    free(mem);
-}
-
-static MemoryRegion* create_region(uint64_t start, size_t size, MemoryPermissions perms) {
-    MemoryRegion* region = (MemoryRegion*)calloc(1, sizeof(MemoryRegion));
-    if (!region) return NULL;
-    
-    region->data = (uint8_t*)calloc(1, size);
-    if (!region->data) {
-        free(region);
-        return NULL;
-    }
-    
-    region->start = start;
-    region->size = size;
-    region->permissions = perms;
-    region->next = NULL;
-    return region;
-}
-
-bool memory_map(Memory* mem, uint64_t address, size_t size, MemoryPermissions perms) {
-    if (!mem || !size) return false;
-    if (memory_is_mapped(mem, address, size)) return false;
-    
-    MemoryRegion* new_region = create_region(address, size, perms);
-    if (!new_region) return false;
-    
-    if (!mem->regions || mem->regions->start > address) {
-        new_region->next = mem->regions;
-        mem->regions = new_region;
-    } else {
-        MemoryRegion* current = mem->regions;
-        while (current->next && current->next->start < address) {
-            current = current->next;
-        }
-        new_region->next = current->next;
-        current->next = new_region;
-    }
-    
-    mem->total_mapped_size += size;
-    return true;
-}
-
-bool memory_unmap(Memory* mem, uint64_t address, size_t size) {
-    if (!mem || !size) return false;
-    
-    MemoryRegion* current = mem->regions;
-    MemoryRegion* prev = NULL;
-    
-    while (current) {
-        if (current->start == address && current->size == size) {
-            if (prev) {
-                prev->next = current->next;
-            } else {
-                mem->regions = current->next;
-            }
-            mem->total_mapped_size -= size;
-            free(current->data);
-            free(current);
-            return true;
-        }
-        prev = current;
-        current = current->next;
-    }
-    return false;
-}
-
-MemoryRegion* memory_find_region(Memory* mem, uint64_t address) {
-    if (!mem) return NULL;
-    
-    MemoryRegion* current = mem->regions;
-    while (current) {
-        if (address >= current->start && address < (current->start + current->size)) {
-            return current;
-        }
-        current = current->next;
-    }
-    return NULL;
-}
-
-bool memory_protect(Memory* mem, uint64_t address, size_t size, MemoryPermissions perms) {
-    MemoryRegion* region = memory_find_region(mem, address);
-    if (!region || (address + size) > (region->start + region->size)) {
-        return false;
-    }
-    region->permissions = perms;
-    return true;
-}
-
-static bool check_access(const MemoryRegion* region, MemoryPermissions required_perms) {
-    return (region->permissions & required_perms) == required_perms;
-}
-
-bool memory_read8(Memory* mem, uint64_t address, uint8_t* value) {
-    MemoryRegion* region = memory_find_region(mem, address);
-    if (!region || !check_access(region, PERM_READ)) return false;
-    
-    size_t offset = address - region->start;
-    *value = region->data[offset];
-    return true;
-}
-
-bool memory_write8(Memory* mem, uint64_t address, uint8_t value) {
-    MemoryRegion* region = memory_find_region(mem, address);
-    if (!region || !check_access(region, PERM_WRITE)) return false;
-    
-    size_t offset = address - region->start;
-    region->data[offset] = value;
-    return true;
-}
-
-bool memory_read16(Memory* mem, uint64_t address, uint16_t* value) {
-    uint8_t bytes[2];
-    for (int i = 0; i < 2; i++) {
-        if (!memory_read8(mem, address + i, &bytes[i])) return false;
-    }
-    
-    if (mem->little_endian) {
-        *value = (uint16_t)bytes[0] | ((uint16_t)bytes[1] << 8);
-    } else {
-        *value = (uint16_t)bytes[1] | ((uint16_t)bytes[0] << 8);
-    }
-    return true;
-}
-
-bool memory_write16(Memory* mem, uint64_t address, uint16_t value) {
-    uint8_t bytes[2];
-    if (mem->little_endian) {
-        bytes[0] = value & 0xFF;
-        bytes[1] = (value >> 8) & 0xFF;
-    } else {
-        bytes[0] = (value >> 8) & 0xFF;
-        bytes[1] = value & 0xFF;
-    }
-    
-    for (int i = 0; i < 2; i++) {
-        if (!memory_write8(mem, address + i, bytes[i])) return false;
-    }
-    return true;
-}
-
-bool memory_read32(Memory* mem, uint64_t address, uint32_t* value) {
-    uint16_t words[2];
-    for (int i = 0; i < 2; i++) {
-        if (!memory_read16(mem, address + i * 2, &words[i])) return false;
-    }
-    
-    if (mem->little_endian) {
-        *value = (uint32_t)words[0] | ((uint32_t)words[1] << 16);
-    } else {
-        *value = (uint32_t)words[1] | ((uint32_t)words[0] << 16);
-    }
-    return true;
-}
-
-bool memory_write32(Memory* mem, uint64_t address, uint32_t value) {
-    uint16_t words[2];
-    if (mem->little_endian) {
-        words[0] = value & 0xFFFF;
-        words[1] = (value >> 16) & 0xFFFF;
-    } else {
-        words[0] = (value >> 16) & 0xFFFF;
-        words[1] = value & 0xFFFF;
-    }
-    
-    for (int i = 0; i < 2; i++) {
-        if (!memory_write16(mem, address + i * 2, words[i])) return false;
-    }
-    return true;
-}
-
-bool memory_read64(Memory* mem, uint64_t address, uint64_t* value) {
-    uint32_t dwords[2];
-    for (int i = 0; i < 2; i++) {
-        if (!memory_read32(mem, address + i * 4, &dwords[i])) return false;
-    }
-    
-    if (mem->little_endian) {
-        *value = (uint64_t)dwords[0] | ((uint64_t)dwords[1] << 32);
-    } else {
-        *value = (uint64_t)dwords[1] | ((uint64_t)dwords[0] << 32);
-    }
-    return true;
-}
-
-bool memory_write64(Memory* mem, uint64_t address, uint64_t value) {
-    uint32_t dwords[2];
-    if (mem->little_endian) {
-        dwords[0] = value & 0xFFFFFFFF;
-        dwords[1] = (value >> 32) & 0xFFFFFFFF;
-    } else {
-        dwords[0] = (value >> 32) & 0xFFFFFFFF;
-        dwords[1] = value & 0xFFFFFFFF;
-    }
-    
-    for (int i = 0; i < 2; i++) {
-        if (!memory_write32(mem, address + i * 4, dwords[i])) return false;
-    }
-    return true;
-}
-
-bool memory_copy_to(Memory* mem, uint64_t address, const void* data, size_t size) {
-    const uint8_t* src = (const uint8_t*)data;
-    for (size_t i = 0; i < size; i++) {
-        if (!memory_write8(mem, address + i, src[i])) return false;
-    }
-    return true;
-}
-
-bool memory_copy_from(Memory* mem, uint64_t address, void* data, size_t size) {
-    uint8_t* dst = (uint8_t*)data;
-    for (size_t i = 0; i < size; i++) {
-        if (!memory_read8(mem, address + i, &dst[i])) return false;
-    }
-    return true;
-}
-
-bool memory_is_mapped(Memory* mem, uint64_t address, size_t size) {
-    if (!mem || !size) return false;
-    
-    MemoryRegion* current = mem->regions;
-    while (current) {
-        if (address >= current->start && (address + size) <= (current->start + current->size)) {
-            return true;
-        }
-        current = current->next;
-    }
-    return false;
-}
-
-size_t memory_get_mapped_size(const Memory* mem) {
-    return mem ? mem->total_mapped_size : 0;
-}
-
-void memory_print_regions(const Memory* mem) {
-    if (!mem) return;
-    
-    printf("Memory Regions:\n");
-    MemoryRegion* current = mem->regions;
-    while (current) {
-        printf("0x%016lx - 0x%016lx (%zu bytes) [%c%c%c]\n",
-               current->start,
-               current->start + current->size,
-               current->size,
-               (current->permissions & PERM_READ) ? 'R' : '-',
-               (current->permissions & PERM_WRITE) ? 'W' : '-',
-               (current->permissions & PERM_EXEC) ? 'X' : '-');
-        current = current->next;
-    }
-}
-
-bool memory_validate_access(const Memory* mem, uint64_t address, size_t size, MemoryPermissions required_perms) {
-    if (!mem || !size) return false;
-    
-    MemoryRegion* region = memory_find_region((Memory*)mem, address);
-    if (!region || (address + size) > (region->start + region->size)) {
-        return false;
-    }
-    return check_access(region, required_perms);
+#include "memory.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+Memory* memory_create(void) {
+    Memory* mem = (Memory*)calloc(1, sizeof(Memory));
+    if (mem) {
+        mem->regions = NULL;
+        mem->total_mapped_size = 0;
+        mem->little_endian = true;
+        memory_tlb_flush(mem);
+    }
+    return mem;
+}
+
+void memory_destroy(Memory* mem) {
+    if (!mem) return;
+    
+    MemoryRegion* current = mem->regions;
+    while (current) {
+        MemoryRegion* next = current->next;
+        free(current->code_pages);
+        free(current->data);
+        free(current);
+        current = next;
+    }
+    free(mem);
+}
+
+static MemoryRegion* create_region(uint64_t start, size_t size, MemoryPermissions perms) {
+    MemoryRegion* region = (MemoryRegion*)calloc(1, sizeof(MemoryRegion));
+    if (!region) return NULL;
+    
+    region->data = (uint8_t*)calloc(1, size);
+    if (!region->data) {
+        free(region);
+        return NULL;
+    }
+    
+    region->start = start;
+    region->size = size;
+    region->permissions = perms;
+    region->next = NULL;
+    return region;
+}
+
+bool memory_map(Memory* mem, uint64_t address, size_t size, MemoryPermissions perms) {
+    if (!mem || !size) return false;
+    if (memory_is_mapped(mem, address, size)) return false;
+    
+    MemoryRegion* new_region = create_region(address, size, perms);
+    if (!new_region) return false;
+    
+    if (!mem->regions || mem->regions->start > address) {
+        new_region->next = mem->regions;
+        mem->regions = new_region;
+    } else {
+        MemoryRegion* current = mem->regions;
+        while (current->next && current->next->start < address) {
+            current = current->next;
+        }
+        new_region->next = current->next;
+        current->next = new_region;
+    }
+    
+    mem->total_mapped_size += size;
+    return true;
+}
+
+bool memory_unmap(Memory* mem, uint64_t address, size_t size) {
+    if (!mem || !size) return false;
+    
+    MemoryRegion* current = mem->regions;
+    MemoryRegion* prev = NULL;
+    
+    while (current) {
+        if (current->start == address && current->size == size) {
+            /* Translations of unmapped code are as stale as overwritten ones */
+            if (current->code_pages && mem->code_write_handler) {
+                mem->code_write_handler(mem->code_write_opaque, address, size);
+            }
+            if (prev) {
+                prev->next = current->next;
+            } else {
+                mem->regions = current->next;
+            }
+            mem->total_mapped_size -= size;
+            memory_tlb_flush(mem);
+            free(current->code_pages);
+            free(current->data);
+            free(current);
+            return true;
+        }
+        prev = current;
+        current = current->next;
+    }
+    return false;
+}
+
+MemoryRegion* memory_find_region(Memory* mem, uint64_t address) {
+    if (!mem) return NULL;
+    
+    MemoryRegion* current = mem->regions;
+    while (current) {
+        if (address >= current->start && address < (current->start + current->size)) {
+            return current;
+        }
+        current = current->next;
+    }
+    return NULL;
+}
+
+bool memory_protect(Memory* mem, uint64_t address, size_t size, MemoryPermissions perms) {
+    MemoryRegion* region = memory_find_region(mem, address);
+    if (!region || (address + size) > (region->start + region->size)) {
+        return false;
+    }
+    region->permissions = perms;
+    memory_tlb_flush(mem);
+    return true;
+}
+
+static bool check_access(const MemoryRegion* region, MemoryPermissions required_perms) {
+    return (region->permissions & required_perms) == required_perms;
+}
+
+static size_t region_page(const MemoryRegion* region, uint64_t address) {
+    return (address >> MEMORY_PAGE_SHIFT) - (region->start >> MEMORY_PAGE_SHIFT);
+}
+
+static size_t region_page_count(const MemoryRegion* region) {
+    return region_page(region, region->start + region->size - 1) + 1;
+}
+
+void memory_tlb_flush(Memory* mem) {
+    if (!mem) return;
+    for (size_t i = 0; i < MEMORY_TLB_SIZE; i++) {
+        mem->tlb[i].read_tag = MEMORY_TLB_INVALID;
+        mem->tlb[i].write_tag = MEMORY_TLB_INVALID;
+    }
+}
+
+static MemoryTLBEntry* tlb_entry(Memory* mem, uint64_t address) {
+    return &mem->tlb[(address >> MEMORY_PAGE_SHIFT) & (MEMORY_TLB_SIZE - 1)];
+}
+
+static void tlb_fill(Memory* mem, uint64_t address) {
+    uint64_t page = address & ~(MEMORY_PAGE_SIZE - 1);
+    MemoryRegion* region = memory_find_region(mem, page);
+    /* Hits are plain host accesses, so the page must be wholly in data */
+    if (!mem->little_endian || !region || page + MEMORY_PAGE_SIZE > region->start + region->size) {
+        return;
+    }
+    
+    bool code = region->code_pages && region->code_pages[region_page(region, page)];
+    MemoryTLBEntry* entry = tlb_entry(mem, page);
+    entry->read_tag = check_access(region, PERM_READ) ? page : MEMORY_TLB_INVALID;
+    entry->write_tag = check_access(region, PERM_WRITE) && !code ? page : MEMORY_TLB_INVALID;
+    entry->addend = (uintptr_t)region->data - (uintptr_t)region->start;
+}
+
+bool memory_read8(Memory* mem, uint64_t address, uint8_t* value) {
+    MemoryRegion* region = memory_find_region(mem, address);
+    if (!region || !check_access(region, PERM_READ)) return false;
+    
+    size_t offset = address - region->start;
+    *value = region->data[offset];
+    return true;
+}
+
+/* Stores the bytes in order up to the first fault. A store that touches
+ * code is reported once for everything it wrote, not per byte: the
+ * handler invalidates translations, which is far from free.
+ */
+static bool write_bytes(Memory* mem, uint64_t address, const uint8_t* bytes, size_t size) {
+    size_t written = 0;
+    bool code = false;
+    while (written < size) {
+        uint64_t at = address + written;
+        MemoryRegion* region = memory_find_region(mem, at);
+        if (!region || !check_access(region, PERM_WRITE)) break;
+        
+        size_t chunk = region->start + region->size - at;
+        if (chunk > size - written) chunk = size - written;
+        memcpy(region->data + (at - region->start), bytes + written, chunk);
+        if (region->code_pages) {
+            size_t last = region_page(region, at + chunk - 1);
+            for (size_t page = region_page(region, at); page <= last; page++) {
+                code |= region->code_pages[page];
+            }
+        }
+        written += chunk;
+    }
+    
+    if (code && mem->code_write_handler) {
+        mem->code_write_handler(mem->code_write_opaque, address, written);
+    }
+    return written == size;
+}
+
+/* Splits value into size bytes in guest byte order */
+static void encode_bytes(const Memory* mem, uint64_t value, size_t size, uint8_t* bytes) {
+    for (size_t i = 0; i < size; i++) {
+        size_t byte = mem->little_endian ? i : size - 1 - i;
+        bytes[i] = (uint8_t)(value >> (8 * byte));
+    }
+}
+
+bool memory_write8(Memory* mem, uint64_t address, uint8_t value) {
+    return write_bytes(mem, address, &value, 1);
+}
+
+bool memory_read16(Memory* mem, uint64_t address, uint16_t* value) {
+    uint8_t bytes[2];
+    for (int i = 0; i < 2; i++) {
+        if (!memory_read8(mem, address + i, &bytes[i])) return false;
+    }
+    
+    if (mem->little_endian) {
+        *value = (uint16_t)bytes[0] | ((uint16_t)bytes[1] << 8);
+    } else {
+        *value = (uint16_t)bytes[1] | ((uint16_t)bytes[0] << 8);
+    }
+    return true;
+}
+
+bool memory_write16(Memory* mem, uint64_t address, uint16_t value) {
+    uint8_t bytes[2];
+    encode_bytes(mem, value, sizeof(bytes), bytes);
+    return write_bytes(mem, address, bytes, sizeof(bytes));
+}
+
+bool memory_read32(Memory* mem, uint64_t address, uint32_t* value) {
+    uint16_t words[2];
+    for (int i = 0; i < 2; i++) {
+        if (!memory_read16(mem, address + i * 2, &words[i])) return false;
+    }
+    
+    if (mem->little_endian) {
+        *value = (uint32_t)words[0] | ((uint32_t)words[1] << 16);
+    } else {
+        *value = (uint32_t)words[1] | ((uint32_t)words[0] << 16);
+    }
+    return true;
+}
+
+bool memory_write32(Memory* mem, uint64_t address, uint32_t value) {
+    uint8_t bytes[4];
+    encode_bytes(mem, value, sizeof(bytes), bytes);
+    return write_bytes(mem, address, bytes, sizeof(bytes));
+}
+
+bool memory_read64(Memory* mem, uint64_t address, uint64_t* value) {
+    uint32_t dwords[2];
+    for (int i = 0; i < 2; i++) {
+        if (!memory_read32(mem, address + i * 4, &dwords[i])) return false;
+    }
+    
+    if (mem->little_endian) {
+        *value = (uint64_t)dwords[0] | ((uint64_t)dwords[1] << 32);
+    } else {
+        *value = (uint64_t)dwords[1] | ((uint64_t)dwords[0] << 32);
+    }
+    return true;
+}
+
+bool memory_write64(Memory* mem, uint64_t address, uint64_t value) {
+    uint8_t bytes[8];
+    encode_bytes(mem, value, sizeof(bytes), bytes);
+    return write_bytes(mem, address, bytes, sizeof(bytes));
+}
+
+bool memory_load_slow(Memory* mem, uint64_t address, uint64_t size, uint64_t* value) {
+    bool ok;
+    switch (size) {
+        case 1: { uint8_t v = 0;  ok = memory_read8(mem, address, &v);  *value = v; break; }
+        case 2: { uint16_t v = 0; ok = memory_read16(mem, address, &v); *value = v; break; }
+        case 4: { uint32_t v = 0; ok = memory_read32(mem, address, &v); *value = v; break; }
+        default: ok = memory_read64(mem, address, value); break;
+    }
+    mem->tlb_misses++;
+    if (ok) tlb_fill(mem, address);
+    return ok;
+}
+
+bool memory_store_slow(Memory* mem, uint64_t address, uint64_t size, uint64_t value) {
+    bool ok;
+    switch (size) {
+        case 1: ok = memory_write8(mem, address, (uint8_t)value); break;
+        case 2: ok = memory_write16(mem, address, (uint16_t)value); break;
+        case 4: ok = memory_write32(mem, address, (uint32_t)value); break;
+        default: ok = memory_write64(mem, address, value); break;
+    }
+    mem->tlb_misses++;
+    if (ok) tlb_fill(mem, address);
+    return ok;
+}
+
+bool memory_copy_to(Memory* mem, uint64_t address, const void* data, size_t size) {
+    return write_bytes(mem, address, (const uint8_t*)data, size);
+}
+
+bool memory_copy_from(Memory* mem, uint64_t address, void* data, size_t size) {
+    uint8_t* dst = (uint8_t*)data;
+    for (size_t i = 0; i < size; i++) {
+        if (!memory_read8(mem, address + i, &dst[i])) return false;
+    }
+    return true;
+}
+
+bool memory_is_mapped(Memory* mem, uint64_t address, size_t size) {
+    if (!mem || !size) return false;
+    
+    MemoryRegion* current = mem->regions;
+    while (current) {
+        if (address >= current->start && (address + size) <= (current->start + current->size)) {
+            return true;
+        }
+        current = current->next;
+    }
+    return false;
+}
+
+void memory_set_code_write_handler(Memory* mem, MemoryCodeWriteHandler handler, void* opaque) {
+    if (!mem) return;
+    mem->code_write_handler = handler;
+    mem->code_write_opaque = opaque;
+}
+
+bool memory_mark_code(Memory* mem, uint64_t address, size_t size) {
+    if (!mem || !size) return false;
+    
+    uint64_t end = address + size;
+    while (address < end) {
+        MemoryRegion* region = memory_find_region(mem, address);
+        if (!region) return false;
+        
+        if (!region->code_pages) {
+            region->code_pages = (uint8_t*)calloc(region_page_count(region), 1);
+            if (!region->code_pages) return false;
+        }
+        region->code_pages[region_page(region, address)] = 1;
+        
+        /* Later stores to the page must go through the write handler */
+        MemoryTLBEntry* entry = tlb_entry(mem, address);
+        if (entry->write_tag == (address & ~(MEMORY_PAGE_SIZE - 1))) {
+            entry->write_tag = MEMORY_TLB_INVALID;
+        }
+        
+        address = (address & ~(MEMORY_PAGE_SIZE - 1)) + MEMORY_PAGE_SIZE;
+    }
+    return true;
+}
+
+void memory_clear_code(Memory* mem, uint64_t address, size_t size) {
+    if (!mem || !size) return;
+    
+    uint64_t end = address + size;
+    for (MemoryRegion* region = mem->regions; region; region = region->next) {
+        if (!region->code_pages) continue;
+        uint64_t region_end = region->start + region->size;
+        if (end <= region->start || address >= region_end) continue;
+        
+        size_t first = region_page(region, address > region->start ? address : region->start);
+        size_t last = region_page(region, (end < region_end ? end : region_end) - 1);
+        memset(&region->code_pages[first], 0, last - first + 1);
+    }
+}
+
+bool memory_page_has_code(Memory* mem, uint64_t address) {
+    MemoryRegion* region = memory_find_region(mem, address);
+    return region && region->code_pages && region->code_pages[region_page(region, address)];
+}
+
+size_t memory_get_mapped_size(const Memory* mem) {
+    return mem ? mem->total_mapped_size : 0;
+}
+
+void memory_print_regions(const Memory* mem) {
+    if (!mem) return;
+    
+    printf("Memory Regions:\n");
+    MemoryRegion* current = mem->regions;
+    while (current) {
+        printf("0x%016lx - 0x%016lx (%zu bytes) [%c%c%c]\n",
+               current->start,
+               current->start + current->size,
+               current->size,
+               (current->permissions & PERM_READ) ? 'R' : '-',
+               (current->permissions & PERM_WRITE) ? 'W' : '-',
+               (current->permissions & PERM_EXEC) ? 'X' : '-');
+        current = current->next;
+    }
+}
+
+bool memory_validate_access(const Memory* mem, uint64_t address, size_t size, MemoryPermissions required_perms) {
+    if (!mem || !size) return false;
+    
+    MemoryRegion* region = memory_find_region((Memory*)mem, address);
+    if (!region || (address + size) > (region->start + region->size)) {
+        return false;
+    }
+    return check_access(region, required_perms);
 } 
\ No newline at end of file
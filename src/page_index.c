@@ -0,0 +1,83 @@
+#include "page_index.h"
+#include <stdlib.h>
+
+#define INITIAL_PAGE_COUNT 64
+
+PageIndex* page_index_create(void) {
+    PageIndex* index = (PageIndex*)calloc(1, sizeof(PageIndex));
+    if (!index) return NULL;
+
+    index->pages = block_cache_create(INITIAL_PAGE_COUNT);
+    if (!index->pages) {
+        free(index);
+        return NULL;
+    }
+    return index;
+}
+
+static void free_page(uint64_t page, void* value, void* opaque) {
+    (void)page;
+    (void)opaque;
+    PageBlocks* entry = (PageBlocks*)value;
+    free(entry->blocks);
+    free(entry);
+}
+
+void page_index_destroy(PageIndex* index) {
+    if (!index) return;
+    block_cache_foreach(index->pages, free_page, NULL);
+    block_cache_destroy(index->pages);
+    free(index);
+}
+
+bool page_index_add(PageIndex* index, uint64_t page, JITBlock* block) {
+    if (!index || !block) return false;
+
+    PageBlocks* entry = (PageBlocks*)block_cache_lookup(index->pages, page);
+    if (!entry) {
+        entry = (PageBlocks*)calloc(1, sizeof(PageBlocks));
+        if (!entry) return false;
+        if (!block_cache_insert(index->pages, page, entry)) {
+            free(entry);
+            return false;
+        }
+    }
+
+    if (entry->count == entry->capacity) {
+        size_t capacity = entry->capacity ? entry->capacity * 2 : 4;
+        JITBlock** blocks = (JITBlock**)realloc(entry->blocks, capacity * sizeof(JITBlock*));
+        if (!blocks) return false;
+        entry->blocks = blocks;
+        entry->capacity = capacity;
+    }
+    entry->blocks[entry->count++] = block;
+    return true;
+}
+
+bool page_index_remove(PageIndex* index, uint64_t page, JITBlock* block) {
+    if (!index) return false;
+
+    PageBlocks* entry = (PageBlocks*)block_cache_lookup(index->pages, page);
+    if (!entry) return true;
+
+    for (size_t i = 0; i < entry->count; i++) {
+        if (entry->blocks[i] == block) {
+            entry->blocks[i] = entry->blocks[--entry->count];
+            break;
+        }
+    }
+    if (entry->count) return false;
+
+    block_cache_remove(index->pages, page);
+    free_page(page, entry, NULL);
+    return true;
+}
+
+const PageBlocks* page_index_lookup(PageIndex* index, uint64_t page) {
+    if (!index) return NULL;
+    return (const PageBlocks*)block_cache_lookup(index->pages, page);
+}
+
+size_t page_index_page_count(const PageIndex* index) {
+    return index ? block_cache_count(index->pages) : 0;
+}
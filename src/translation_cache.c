@@ -0,0 +1,277 @@
+#include "translation_cache.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define FNV_OFFSET_BASIS 0xCBF29CE484222325ULL
+#define FNV_PRIME 0x100000001B3ULL
+
+static size_t align_up(size_t value, size_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+static void count_stat(uint64_t* counter) {
+    __atomic_fetch_add(counter, 1, __ATOMIC_RELAXED);
+}
+
+/* Offsets of each section of an entry file, following the header */
+typedef struct EntryLayout {
+    size_t pcs_offset;
+    size_t guest_offset;
+    size_t exits_offset;
+    size_t symbol_offset;
+    size_t object_offset;
+    size_t total_size;
+} EntryLayout;
+
+static EntryLayout compute_layout(size_t instruction_count, size_t exit_count,
+                                  size_t symbol_length, size_t object_size) {
+    EntryLayout layout;
+    layout.pcs_offset = sizeof(TranslationCacheHeader);
+    layout.guest_offset = layout.pcs_offset + instruction_count * sizeof(uint64_t);
+    layout.exits_offset = align_up(layout.guest_offset + instruction_count * sizeof(uint32_t), 8);
+    layout.symbol_offset = layout.exits_offset + exit_count * sizeof(uint64_t);
+    layout.object_offset = align_up(layout.symbol_offset + symbol_length + 1, 16);
+    layout.total_size = layout.object_offset + object_size;
+    return layout;
+}
+
+static void entry_path(const TranslationCache* cache, uint64_t key, char* path, size_t size) {
+    snprintf(path, size, "%s/%016lx.tc", cache->directory, key);
+}
+
+static bool make_directories(const char* directory) {
+    char* path = strdup(directory);
+    if (!path) return false;
+
+    for (char* p = path + 1; *p; p++) {
+        if (*p != '/') continue;
+        *p = '\0';
+        if (mkdir(path, 0755) != 0 && errno != EEXIST) {
+            free(path);
+            return false;
+        }
+        *p = '/';
+    }
+    bool ok = mkdir(path, 0755) == 0 || errno == EEXIST;
+    free(path);
+    return ok;
+}
+
+TranslationCache* translation_cache_open(const char* directory, uint64_t options_hash) {
+    if (!directory || !*directory) return NULL;
+    if (!make_directories(directory)) {
+        fprintf(stderr, "Cannot create translation cache directory %s\n", directory);
+        return NULL;
+    }
+
+    TranslationCache* cache = (TranslationCache*)calloc(1, sizeof(TranslationCache));
+    if (!cache) return NULL;
+
+    cache->directory = strdup(directory);
+    if (!cache->directory) {
+        free(cache);
+        return NULL;
+    }
+    cache->options_hash = options_hash;
+    return cache;
+}
+
+void translation_cache_close(TranslationCache* cache) {
+    if (!cache) return;
+    free(cache->directory);
+    free(cache);
+}
+
+uint64_t translation_cache_hash(const void* data, size_t size, uint64_t seed) {
+    const uint8_t* bytes = (const uint8_t*)data;
+    uint64_t hash = FNV_OFFSET_BASIS ^ seed;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+uint64_t translation_cache_key(const TranslationCache* cache, uint64_t address,
+                               const Instruction* insts, size_t count) {
+    if (!cache || !insts) return 0;
+
+    uint64_t hash = translation_cache_hash(&address, sizeof(address), cache->options_hash);
+    for (size_t i = 0; i < count; i++) {
+        hash = translation_cache_hash(&insts[i].raw, sizeof(insts[i].raw), hash);
+    }
+    return hash;
+}
+
+bool translation_cache_contains(const TranslationCache* cache, uint64_t key) {
+    if (!cache) return false;
+
+    char path[4096];
+    entry_path(cache, key, path, sizeof(path));
+    return access(path, R_OK) == 0;
+}
+
+static bool entry_matches(const TranslationCacheEntry* entry, const Instruction* insts,
+                          const uint64_t* pcs, size_t count) {
+    if (entry->instruction_count != count) return false;
+
+    for (size_t i = 0; i < count; i++) {
+        uint64_t pc = pcs ? pcs[i] : entry->address + i * 4;
+        if (entry->pcs[i] != pc || entry->words[i] != insts[i].raw) return false;
+    }
+    return true;
+}
+
+bool translation_cache_validate(TranslationCache* cache, const TranslationCacheEntry* entry,
+                                const Instruction* insts, const uint64_t* pcs, size_t count) {
+    if (!cache || !entry || !insts) return false;
+
+    bool valid = entry_matches(entry, insts, pcs, count);
+    count_stat(valid ? &cache->stats.hits : &cache->stats.rejected);
+    return valid;
+}
+
+void translation_cache_reject(TranslationCache* cache) {
+    if (cache) count_stat(&cache->stats.rejected);
+}
+
+TranslationCacheEntry* translation_cache_load(TranslationCache* cache, uint64_t key, uint64_t address) {
+    if (!cache) return NULL;
+
+    char path[4096];
+    entry_path(cache, key, path, sizeof(path));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        count_stat(&cache->stats.misses);
+        return NULL;
+    }
+
+    struct stat st;
+    void* mapping = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(TranslationCacheHeader)) {
+        mapping = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        count_stat(&cache->stats.rejected);
+        return NULL;
+    }
+
+    size_t size = st.st_size;
+    const TranslationCacheHeader* header = (const TranslationCacheHeader*)mapping;
+    EntryLayout layout = compute_layout(header->instruction_count, header->exit_count,
+                                        header->symbol_length, header->object_size);
+    const uint8_t* base = (const uint8_t*)mapping;
+
+    if (header->magic != TRANSLATION_CACHE_MAGIC || header->version != TRANSLATION_CACHE_VERSION ||
+        header->key != key || header->address != address ||
+        header->instruction_count == 0 || layout.total_size != size ||
+        base[layout.symbol_offset + header->symbol_length] != '\0') {
+        munmap(mapping, size);
+        count_stat(&cache->stats.rejected);
+        return NULL;
+    }
+
+    TranslationCacheEntry* entry = (TranslationCacheEntry*)calloc(1, sizeof(TranslationCacheEntry));
+    if (!entry) {
+        munmap(mapping, size);
+        return NULL;
+    }
+    entry->mapping = mapping;
+    entry->mapping_size = size;
+    entry->address = header->address;
+    entry->pcs = (const uint64_t*)(base + layout.pcs_offset);
+    entry->words = (const uint32_t*)(base + layout.guest_offset);
+    entry->instruction_count = header->instruction_count;
+    entry->exit_targets = (const uint64_t*)(base + layout.exits_offset);
+    entry->exit_count = header->exit_count;
+    entry->symbol = (const char*)(base + layout.symbol_offset);
+    entry->object = base + layout.object_offset;
+    entry->object_size = header->object_size;
+
+    return entry;
+}
+
+void translation_cache_release(TranslationCacheEntry* entry) {
+    if (!entry) return;
+    munmap(entry->mapping, entry->mapping_size);
+    free(entry);
+}
+
+bool translation_cache_store(TranslationCache* cache, uint64_t key, uint64_t address,
+                             const Instruction* insts, const uint64_t* pcs, size_t count,
+                             const uint64_t* exit_targets, size_t exit_count,
+                             const char* symbol, const void* object, size_t object_size) {
+    if (!cache || !insts || !symbol || !object || (exit_count && !exit_targets)) return false;
+
+    size_t symbol_length = strlen(symbol);
+    EntryLayout layout = compute_layout(count, exit_count, symbol_length, object_size);
+    uint8_t* buffer = (uint8_t*)calloc(1, layout.total_size);
+    if (!buffer) return false;
+
+    TranslationCacheHeader* header = (TranslationCacheHeader*)buffer;
+    header->magic = TRANSLATION_CACHE_MAGIC;
+    header->version = TRANSLATION_CACHE_VERSION;
+    header->key = key;
+    header->address = address;
+    header->instruction_count = (uint32_t)count;
+    header->exit_count = (uint32_t)exit_count;
+    header->symbol_length = (uint32_t)symbol_length;
+    header->object_size = (uint32_t)object_size;
+
+    uint64_t* stored_pcs = (uint64_t*)(buffer + layout.pcs_offset);
+    uint32_t* words = (uint32_t*)(buffer + layout.guest_offset);
+    for (size_t i = 0; i < count; i++) {
+        stored_pcs[i] = pcs ? pcs[i] : address + i * 4;
+        words[i] = insts[i].raw;
+    }
+    if (exit_count) {
+        memcpy(buffer + layout.exits_offset, exit_targets, exit_count * sizeof(uint64_t));
+    }
+    memcpy(buffer + layout.symbol_offset, symbol, symbol_length);
+    memcpy(buffer + layout.object_offset, object, object_size);
+
+    char path[4096];
+    char temp_path[4096 + 64];
+    entry_path(cache, key, path, sizeof(path));
+    static uint64_t temp_counter = 0;
+    snprintf(temp_path, sizeof(temp_path), "%s.%d.%lu.tmp", path, (int)getpid(),
+             __atomic_fetch_add(&temp_counter, 1, __ATOMIC_RELAXED));
+
+    bool ok = false;
+    FILE* file = fopen(temp_path, "wb");
+    if (file) {
+        ok = fwrite(buffer, 1, layout.total_size, file) == layout.total_size;
+        ok = fclose(file) == 0 && ok;
+        ok = ok && rename(temp_path, path) == 0;
+        if (!ok) unlink(temp_path);
+    }
+    free(buffer);
+
+    if (ok) count_stat(&cache->stats.stores);
+    return ok;
+}
+
+void translation_cache_get_stats(const TranslationCache* cache, TranslationCacheStats* stats) {
+    if (!cache || !stats) return;
+    stats->hits = __atomic_load_n(&cache->stats.hits, __ATOMIC_RELAXED);
+    stats->misses = __atomic_load_n(&cache->stats.misses, __ATOMIC_RELAXED);
+    stats->stores = __atomic_load_n(&cache->stats.stores, __ATOMIC_RELAXED);
+    stats->rejected = __atomic_load_n(&cache->stats.rejected, __ATOMIC_RELAXED);
+}
+
+void translation_cache_print_stats(const TranslationCache* cache) {
+    if (!cache) return;
+
+    TranslationCacheStats stats;
+    translation_cache_get_stats(cache, &stats);
+    printf("Persistent Cache (%s):\n", cache->directory);
+    printf("Hits: %lu  Misses: %lu  Stores: %lu  Rejected: %lu\n",
+           stats.hits, stats.misses, stats.stores, stats.rejected);
+}
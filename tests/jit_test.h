@@ -0,0 +1,92 @@
+#ifndef JIT_TEST_H
+#define JIT_TEST_H
+
+#include <assert.h>
+#include "../include/jit.h"
+#include "../include/memory.h"
+#include "../include/registers.h"
+
+/* Fixture for the suites that compile and run guest code on a JITContext
+ * with no background workers. Memory holds one page of code at
+ * JIT_TEST_CODE, two data pages at JIT_TEST_DATA, and a block area for
+ * suites that compile many small blocks one after another; the
+ * JIT_TEST_EXIT they branch to is never mapped, so they do not chain.
+ */
+
+#define JIT_TEST_CODE 0x1000
+#define JIT_TEST_DATA 0x4000
+#define JIT_TEST_DATA_SIZE 0x2000
+#define JIT_TEST_BLOCKS 0x10000
+#define JIT_TEST_BLOCKS_SIZE 0x40000
+#define JIT_TEST_EXIT (JIT_TEST_BLOCKS + JIT_TEST_BLOCKS_SIZE)
+
+typedef struct JitTest {
+    RegisterFile* regs;
+    Memory* memory;
+    JITContext* jit;
+    uint64_t next_block;    /* next free address in the block area */
+} JitTest;
+
+/* Copies count words of code (none if code is NULL) to JIT_TEST_CODE */
+static inline void jit_test_setup(JitTest* t, const uint32_t* code, size_t count, uint64_t threshold) {
+    t->regs = registers_create();
+    t->memory = memory_create();
+    assert(memory_map(t->memory, JIT_TEST_CODE, 0x1000, PERM_READ | PERM_WRITE | PERM_EXEC));
+    assert(memory_map(t->memory, JIT_TEST_DATA, JIT_TEST_DATA_SIZE, PERM_READ | PERM_WRITE));
+    assert(memory_map(t->memory, JIT_TEST_BLOCKS, JIT_TEST_BLOCKS_SIZE, PERM_READ | PERM_WRITE | PERM_EXEC));
+    if (code) assert(memory_copy_to(t->memory, JIT_TEST_CODE, code, count * 4));
+    t->jit = jit_create(t->memory, t->regs);
+    assert(jit_set_worker_count(t->jit, 0));
+    jit_set_tier_threshold(t->jit, threshold);
+    t->next_block = JIT_TEST_BLOCKS;
+}
+
+static inline void jit_test_teardown(JitTest* t) {
+    jit_destroy(t->jit);
+    registers_destroy(t->regs);
+    memory_destroy(t->memory);
+}
+
+static inline uint64_t jit_test_pc(JitTest* t) {
+    uint64_t value = 0;
+    assert(registers_get_pc(t->regs, &value) == REG_SUCCESS);
+    return value;
+}
+
+/* The block at JIT_TEST_CODE, which must have machine code */
+static inline JITBlock* jit_test_compile(JitTest* t) {
+    JITBlock* block = jit_compile_block(t->jit, JIT_TEST_CODE);
+    assert(block != NULL && block->code != NULL);
+    return block;
+}
+
+static inline JITBlock* jit_test_run(JitTest* t) {
+    JITBlock* block = jit_test_compile(t);
+    assert(jit_execute_block(t->jit, block));
+    return block;
+}
+
+/* Compiles "words; b JIT_TEST_EXIT" at the next free address of the block area */
+static inline JITBlock* jit_test_compile_next(JitTest* t, const uint32_t* words, size_t count) {
+    uint64_t address = t->next_block;
+    assert(address + (count + 1) * 4 <= JIT_TEST_EXIT);
+    assert(memory_copy_to(t->memory, address, words, count * 4));
+    uint32_t branch = 0x14000000 | (uint32_t)((JIT_TEST_EXIT - (address + count * 4)) / 4);
+    assert(memory_copy_to(t->memory, address + count * 4, &branch, 4));
+    t->next_block += (count + 1) * 4;
+
+    JITBlock* block = jit_compile_block(t->jit, address);
+    assert(block != NULL && block->code != NULL);
+    return block;
+}
+
+/* The pointer a load or store addresses, with bitcasts and GEPs stripped */
+static inline LLVMValueRef jit_test_access_base(LLVMValueRef inst) {
+    LLVMValueRef address = LLVMGetOperand(inst, LLVMIsAStoreInst(inst) ? 1 : 0);
+    while (LLVMIsABitCastInst(address) || LLVMIsAGetElementPtrInst(address)) {
+        address = LLVMGetOperand(address, 0);
+    }
+    return address;
+}
+
+#endif // JIT_TEST_H
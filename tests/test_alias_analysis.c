@@ -0,0 +1,121 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "../include/emitter.h"
+#include "../include/jit.h"
+#include "../include/decoder.h"
+#include "../include/registers.h"
+#include "jit_test.h"
+
+static const uint32_t code[] = {
+    0xF9400020,     /* 0x1000: ldr x0, [x1] */
+    0xF9000440,     /* 0x1004: str x0, [x2, #8] */
+    0xB1000403,     /* 0x1008: adds x3, x0, #1 */
+    0x1E622820,     /* 0x100c: fadd d0, d1, d2 */
+    0x14000002,     /* 0x1010: b +8 */
+};
+
+#define CODE_COUNT (sizeof(code) / sizeof(code[0]))
+
+/* The type name of the access's !tbaa tag, or NULL if it has none */
+static const char* access_class(LLVMValueRef inst) {
+    LLVMValueRef tag = LLVMGetMetadata(inst, LLVMGetMDKindID("tbaa", 4));
+    if (!tag) return NULL;
+    assert(LLVMGetMDNodeNumOperands(tag) == 3);
+    LLVMValueRef tag_ops[3];
+    LLVMGetMDNodeOperands(tag, tag_ops);
+
+    LLVMValueRef type_ops[3];
+    assert(LLVMGetMDNodeNumOperands(tag_ops[0]) == 3);
+    LLVMGetMDNodeOperands(tag_ops[0], type_ops);
+    unsigned length;
+    return LLVMGetMDString(type_ops[0], &length);
+}
+
+static bool has_attribute(LLVMValueRef function, unsigned index, const char* name) {
+    unsigned kind = LLVMGetEnumAttributeKindForName(name, strlen(name));
+    return LLVMGetEnumAttributeAtIndex(function, index, kind) != NULL;
+}
+
+static void test_access_classes() {
+    JITCompiler* compiler = jit_compiler_create(NULL);
+    assert(compiler != NULL);
+    compiler->module = LLVMModuleCreateWithNameInContext("alias", compiler->llvm_context);
+
+    EmitterContext* emitter = emitter_create(compiler);
+    assert(emitter_create_entry_block(emitter) != NULL);
+
+    DecoderContext* decoder = decoder_create((const uint8_t*)code, sizeof(code));
+    for (size_t i = 0; i < CODE_COUNT; i++) {
+        Instruction inst;
+        assert(decoder_decode_next(decoder, &inst) == DECODER_SUCCESS);
+        emitter->pc = 0x1000 + i * 4;
+        assert(emitter_emit_instruction(emitter, &inst));
+    }
+    decoder_destroy(decoder);
+    LLVMValueRef function = emitter_finalize_block(emitter);
+    assert(function != NULL);
+
+    /* registers and memory are noalias; self may be its own successor */
+    assert(has_attribute(function, 1, "noalias"));
+    assert(has_attribute(function, 2, "noalias"));
+    assert(!has_attribute(function, 3, "noalias"));
+
+    LLVMValueRef registers = LLVMGetParam(function, 0);
+    LLVMValueRef memory = LLVMGetParam(function, 1);
+    size_t gprs = 0, vector_loads = 0, vector_stores = 0, flags = 0, fpcr = 0, tlb = 0, guest = 0;
+    for (LLVMBasicBlockRef bb = LLVMGetFirstBasicBlock(function); bb; bb = LLVMGetNextBasicBlock(bb)) {
+        for (LLVMValueRef inst = LLVMGetFirstInstruction(bb); inst; inst = LLVMGetNextInstruction(inst)) {
+            if (!LLVMIsALoadInst(inst) && !LLVMIsAStoreInst(inst)) continue;
+            LLVMValueRef base = jit_test_access_base(inst);
+            const char* class = access_class(inst);
+
+            if (base == registers) {
+                assert(class != NULL);
+                if (strcmp(class, "guest register") == 0) {
+                    gprs++;
+                } else if (strcmp(class, "guest vector register") == 0) {
+                    if (LLVMIsALoadInst(inst)) vector_loads++;
+                    else vector_stores++;
+                } else if (strcmp(class, "guest flags") == 0) {
+                    assert(LLVMIsAStoreInst(inst));
+                    flags++;
+                } else {
+                    assert(strcmp(class, "guest fp control") == 0);
+                    fpcr++;
+                }
+            } else if (base == memory) {
+                assert(class != NULL && strcmp(class, "soft tlb") == 0);
+                tlb++;
+            } else if (LLVMIsAIntToPtrInst(base)) {
+                assert(class != NULL && strcmp(class, "guest memory") == 0);
+                guest++;
+            } else {
+                assert(class == NULL);
+            }
+        }
+    }
+    /* x1, x2 and x0 loaded; x0 and x3 stored */
+    assert(gprs == 5);
+    assert(vector_loads == 2 && vector_stores == 1);
+    assert(flags == 1);
+    assert(fpcr == 1);
+    /* Tag and addend for each of the two accesses */
+    assert(tlb == 4);
+    assert(guest == 2);
+
+    emitter_destroy(emitter);
+    LLVMDisposeModule(compiler->module);
+    compiler->module = NULL;
+    jit_compiler_destroy(compiler);
+}
+
+int main() {
+    printf("Running alias analysis tests...\n");
+
+    test_access_classes();
+
+    printf("All alias analysis tests passed!\n");
+    return 0;
+}
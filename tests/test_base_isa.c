@@ -0,0 +1,216 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "jit_test.h"
+
+static void test_moves_and_bitfields() {
+    const uint32_t code[] = {
+        0xD2A24680,     /* 0x1000: movz x0, #0x1234, lsl #16 */
+        0xF28ACF00,     /* 0x1004: movk x0, #0x5678 */
+        0x12800001,     /* 0x1008: movn w1, #0 */
+        0xD3442C02,     /* 0x100c: ubfx x2, x0, #4, #8 */
+        0x93401C23,     /* 0x1010: sxtb x3, w1 */
+        0xB3783C04,     /* 0x1014: bfi x4, x0, #8, #16 */
+        0x93C14005,     /* 0x1018: extr x5, x0, x1, #16 */
+        0x5AC00806,     /* 0x101c: rev w6, w0 */
+        0xDAC01007,     /* 0x1020: clz x7, x0 */
+        0xDAC01428,     /* 0x1024: cls x8, x1 */
+        0x5AC00009,     /* 0x1028: rbit w9, w0 */
+        0xDAC0040A,     /* 0x102c: rev16 x10, x0 */
+        0x14000100,     /* 0x1030: b 0x1430 */
+    };
+    JitTest t;
+    jit_test_setup(&t, code, 13, 0);
+    t.regs->x[1] = 0x123456789ULL;
+    t.regs->x[4] = 0xAAAAAAAAAAAAAAAAULL;
+    jit_test_run(&t);
+
+    assert(jit_test_pc(&t) == 0x1430);
+    assert(t.regs->x[0] == 0x12345678);
+    assert(t.regs->x[1] == 0xFFFFFFFF);
+    assert(t.regs->x[2] == 0x67);
+    assert(t.regs->x[3] == UINT64_MAX);
+    assert(t.regs->x[4] == 0xAAAAAAAAAA5678AAULL);
+    assert(t.regs->x[5] == 0x567800000000FFFFULL);
+    assert(t.regs->x[6] == 0x78563412);
+    assert(t.regs->x[7] == 35);
+    assert(t.regs->x[8] == 31);
+    assert(t.regs->x[9] == 0x1E6A2C48);
+    assert(t.regs->x[10] == 0x34127856);
+
+    jit_test_teardown(&t);
+}
+
+static void test_arithmetic() {
+    const uint32_t code[] = {
+        0xAB020004,     /* 0x1000: adds x4, x0, x2 */
+        0x9A030025,     /* 0x1004: adc x5, x1, x3 */
+        0x9AC808E6,     /* 0x1008: udiv x6, x7, x8 */
+        0x9ACB0D49,     /* 0x100c: sdiv x9, x10, x11 */
+        0x9B0B1D4C,     /* 0x1010: madd x12, x10, x11, x7 */
+        0x9BC07C0D,     /* 0x1014: umulh x13, x0, x0 */
+        0x0B0B114E,     /* 0x1018: add w14, w10, w11, lsl #4 */
+        0x8B2B4FEF,     /* 0x101c: add x15, sp, w11, uxtw #3 */
+        0xEB0B015F,     /* 0x1020: cmp x10, x11 */
+        0x9A8BB150,     /* 0x1024: csel x16, x10, x11, lt */
+        0xF1001D7F,     /* 0x1028: cmp x11, #7 */
+        0xFA450942,     /* 0x102c: ccmp x10, #5, #2, eq */
+        0x14000100,     /* 0x1030: b 0x1430 */
+    };
+    JitTest t;
+    jit_test_setup(&t, code, 13, 0);
+    t.regs->x[0] = UINT64_MAX;
+    t.regs->x[1] = 5;
+    t.regs->x[2] = 1;
+    t.regs->x[3] = 7;
+    t.regs->x[7] = 1000;
+    t.regs->x[10] = (uint64_t)-100;
+    t.regs->x[11] = 7;
+    t.regs->x[ARM64_REG_SP] = 0x8000;
+    jit_test_run(&t);
+
+    /* x1:x0 + x3:x2 carries into the high half */
+    assert(t.regs->x[4] == 0 && t.regs->x[5] == 13);
+    assert(t.regs->x[6] == 0);
+    assert(t.regs->x[9] == (uint64_t)-14);
+    assert(t.regs->x[12] == 300);
+    assert(t.regs->x[13] == 0xFFFFFFFFFFFFFFFEULL);
+    assert(t.regs->x[14] == 12);
+    assert(t.regs->x[15] == 0x8000 + 56);
+    assert(t.regs->x[16] == (uint64_t)-100);
+    /* x11 == 7, so ccmp compares x10 with 5: negative, no borrow */
+    assert(t.regs->x[ARM64_REG_NZCV] == 0xA0000000);
+
+    jit_test_teardown(&t);
+}
+
+static void test_division_edge_cases() {
+    const uint32_t code[] = {
+        0xD2F00001,     /* 0x1000: mov x1, #0x8000000000000000 */
+        0x92800002,     /* 0x1004: mov x2, #-1 */
+        0x9AC20C23,     /* 0x1008: sdiv x3, x1, x2 */
+        0x1ADF0845,     /* 0x100c: udiv w5, w2, wzr */
+        0x14000100,     /* 0x1010: b 0x1410 */
+    };
+    JitTest t;
+    jit_test_setup(&t, code, 5, 0);
+    t.regs->x[5] = 99;
+    jit_test_run(&t);
+
+    assert(t.regs->x[3] == 0x8000000000000000ULL);
+    assert(t.regs->x[5] == 0);
+
+    jit_test_teardown(&t);
+}
+
+static void test_register_offset_loop() {
+    const uint32_t code[] = {
+        0xB8A27823,     /* 0x1000: ldrsw x3, [x1, x2, lsl #2] */
+        0x8B030000,     /* 0x1004: add x0, x0, x3 */
+        0x91000442,     /* 0x1008: add x2, x2, #1 */
+        0xD1000484,     /* 0x100c: sub x4, x4, #1 */
+        0xB5FFFF84,     /* 0x1010: cbnz x4, 0x1000 */
+    };
+    JitTest t;
+    jit_test_setup(&t, code, 5, 0);
+    const int32_t words[] = { 5, -3, 10, -20, 7 };
+    assert(memory_copy_to(t.memory, JIT_TEST_DATA, words, sizeof(words)));
+    t.regs->x[1] = JIT_TEST_DATA;
+    t.regs->x[4] = 5;
+    JITBlock* block = jit_test_run(&t);
+
+    /* CBNZ closes a native loop; the only exit is the fall-through */
+    assert(block->exit_count == 1);
+    assert(jit_test_pc(&t) == 0x1014);
+    assert(t.regs->x[0] == (uint64_t)-1);
+    assert(t.regs->x[2] == 5);
+    assert(t.regs->x[3] == 7);
+
+    jit_test_teardown(&t);
+}
+
+static void test_addressing_modes() {
+    const uint32_t code[] = {
+        0xA9BF07E0,     /* 0x1000: stp x0, x1, [sp, #-16]! */
+        0xA8C10FE2,     /* 0x1004: ldp x2, x3, [sp], #16 */
+        0x58000124,     /* 0x1008: ldr x4, 0x102c */
+        0x10000105,     /* 0x100c: adr x5, 0x102c */
+        0x90000006,     /* 0x1010: adrp x6, 0x1000 */
+        0x38408507,     /* 0x1014: ldrb w7, [x8], #8 */
+        0xC85F7D09,     /* 0x1018: ldxr x9, [x8] */
+        0xC80A7D01,     /* 0x101c: stxr w10, x1, [x8] */
+        0xB6F80040,     /* 0x1020: tbz x0, #63, 0x1028 */
+        0x14000100,     /* 0x1024: b 0x1424 */
+        0x14000100,     /* 0x1028: b 0x1428 */
+        0x55667788,     /* 0x102c: .quad 0x1122334455667788 */
+        0x11223344,
+    };
+    JitTest t;
+    jit_test_setup(&t, code, 13, 0);
+    const uint64_t data[] = { 0x5A, 0xFEEDFACE };
+    assert(memory_copy_to(t.memory, JIT_TEST_DATA, data, sizeof(data)));
+    t.regs->x[0] = 0x1111;
+    t.regs->x[1] = 0x2222;
+    t.regs->x[8] = JIT_TEST_DATA;
+    t.regs->x[10] = 99;
+    t.regs->x[ARM64_REG_SP] = JIT_TEST_DATA + 0x100;
+    jit_test_run(&t);
+
+    assert(jit_test_pc(&t) == 0x1028);
+    assert(t.regs->x[ARM64_REG_SP] == JIT_TEST_DATA + 0x100);
+    assert(t.regs->x[2] == 0x1111 && t.regs->x[3] == 0x2222);
+    assert(t.regs->x[4] == 0x1122334455667788ULL);
+    assert(t.regs->x[5] == 0x102C);
+    assert(t.regs->x[6] == 0x1000);
+    assert(t.regs->x[7] == 0x5A);
+    assert(t.regs->x[8] == JIT_TEST_DATA + 8);
+    assert(t.regs->x[9] == 0xFEEDFACE);
+    assert(t.regs->x[10] == 0);
+
+    uint64_t pair[2], stored;
+    assert(memory_copy_from(t.memory, JIT_TEST_DATA + 0xF0, pair, sizeof(pair)));
+    assert(pair[0] == 0x1111 && pair[1] == 0x2222);
+    assert(memory_copy_from(t.memory, JIT_TEST_DATA + 8, &stored, sizeof(stored)));
+    assert(stored == 0x2222);
+
+    jit_test_teardown(&t);
+}
+
+static void test_system_registers() {
+    const uint32_t code[] = {
+        0xD51B4200,     /* 0x1000: msr nzcv, x0 */
+        0x9A9F17E2,     /* 0x1004: cset x2, eq */
+        0xD53B4203,     /* 0x1008: mrs x3, nzcv */
+        0xD51B4405,     /* 0x100c: msr fpcr, x5 */
+        0xD53B4406,     /* 0x1010: mrs x6, fpcr */
+        0x14000100,     /* 0x1014: b 0x1414 */
+    };
+    JitTest t;
+    jit_test_setup(&t, code, 6, 0);
+    t.regs->x[0] = 0x6000000F;
+    t.regs->x[5] = 1U << 24;
+    jit_test_run(&t);
+
+    assert(t.regs->x[2] == 1);
+    assert(t.regs->x[3] == 0x60000000);
+    assert(t.regs->x[ARM64_REG_NZCV] == 0x60000000);
+    assert(t.regs->fpcr == 1U << 24);
+    assert(t.regs->x[6] == 1U << 24);
+
+    jit_test_teardown(&t);
+}
+
+int main() {
+    printf("Running base ISA tests...\n");
+
+    test_moves_and_bitfields();
+    test_arithmetic();
+    test_division_edge_cases();
+    test_register_offset_loop();
+    test_addressing_modes();
+    test_system_registers();
+
+    printf("All base ISA tests passed!\n");
+    return 0;
+}
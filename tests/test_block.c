@@ -0,0 +1,197 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include "../include/block.h"
+#include "../include/jit.h"
+#include "../include/decoder.h"
+#include "../include/memory.h"
+#include "../include/registers.h"
+
+static int fake_code;
+
+static JITBlock* make_block(uint64_t address, const uint64_t* targets, size_t count) {
+    JITBlock* block = block_create(address);
+    assert(block != NULL);
+    assert(block_set_exits(block, targets, count));
+    block->code = &fake_code;
+    return block;
+}
+
+static void test_block_creation() {
+    uint64_t targets[] = {0x400100, 0x400004};
+    JITBlock* block = make_block(0x400000, targets, 2);
+
+    assert(block->address == 0x400000);
+    assert(block->exit_count == 2);
+    assert(block->exits[0].target_pc == 0x400100);
+    assert(block->exits[1].target_pc == 0x400004);
+    assert(block->exits[0].owner == block);
+    assert(block->exits[0].target == NULL);
+
+    block_destroy(block);
+}
+
+static void test_link_to_existing_successor() {
+    BlockCache* blocks = block_cache_create(16);
+    BlockCache* exit_lists = block_cache_create(16);
+
+    JITBlock* successor = make_block(0x400100, NULL, 0);
+    block_cache_insert(blocks, successor->address, successor);
+
+    uint64_t targets[] = {0x400100, 0x400004};
+    JITBlock* block = make_block(0x400000, targets, 2);
+    block_cache_insert(blocks, block->address, block);
+    assert(block_register_exits(block, exit_lists, blocks));
+
+    assert(block->exits[0].target == successor);
+    assert(block->exits[1].target == NULL);
+
+    block_unregister_exits(block, exit_lists);
+    assert(block_cache_count(exit_lists) == 0);
+
+    block_destroy(block);
+    block_destroy(successor);
+    block_cache_destroy(blocks);
+    block_cache_destroy(exit_lists);
+}
+
+static void test_link_incoming_later() {
+    BlockCache* blocks = block_cache_create(16);
+    BlockCache* exit_lists = block_cache_create(16);
+
+    uint64_t targets[] = {0x400200};
+    JITBlock* first = make_block(0x400000, targets, 1);
+    JITBlock* second = make_block(0x400100, targets, 1);
+    assert(block_register_exits(first, exit_lists, blocks));
+    assert(block_register_exits(second, exit_lists, blocks));
+    assert(first->exits[0].target == NULL);
+
+    JITBlock* target = make_block(0x400200, NULL, 0);
+    block_cache_insert(blocks, target->address, target);
+    assert(block_link_incoming(target, exit_lists) == 2);
+    assert(first->exits[0].target == target);
+    assert(second->exits[0].target == target);
+
+    assert(block_unlink_incoming(0x400200, exit_lists) == 2);
+    assert(first->exits[0].target == NULL);
+    assert(second->exits[0].target == NULL);
+
+    /* Removing the list head must keep the remaining exit reachable */
+    block_unregister_exits(second, exit_lists);
+    assert(block_link_incoming(target, exit_lists) == 1);
+    assert(first->exits[0].target == target);
+    assert(second->exits[0].target == NULL);
+
+    block_unregister_exits(first, exit_lists);
+    assert(block_cache_count(exit_lists) == 0);
+
+    block_destroy(first);
+    block_destroy(second);
+    block_destroy(target);
+    block_cache_destroy(blocks);
+    block_cache_destroy(exit_lists);
+}
+
+static void test_self_loop() {
+    BlockCache* blocks = block_cache_create(16);
+    BlockCache* exit_lists = block_cache_create(16);
+
+    uint64_t targets[] = {0x400000, 0x400008};
+    JITBlock* block = make_block(0x400000, targets, 2);
+    block_cache_insert(blocks, block->address, block);
+    assert(block_register_exits(block, exit_lists, blocks));
+    assert(block->exits[0].target == block);
+    assert(block->exits[1].target == NULL);
+
+    block_unregister_exits(block, exit_lists);
+    assert(block->exits[0].target == NULL);
+
+    block_destroy(block);
+    block_cache_destroy(blocks);
+    block_cache_destroy(exit_lists);
+}
+
+static void test_trace_building() {
+    Instruction insts[3];
+    for (int i = 0; i < 3; i++) instruction_init(&insts[i]);
+
+    BlockTrace* trace = block_trace_create(4);
+    assert(trace != NULL);
+    assert(block_trace_append(trace, insts, 2, 0x1000));
+    assert(block_trace_append(trace, insts, 1, 0x2000));
+    assert(!block_trace_append(trace, insts, 2, 0x3000));
+
+    assert(trace->count == 3);
+    assert(trace->block_count == 2);
+    assert(trace->pcs[0] == 0x1000 && trace->pcs[1] == 0x1004 && trace->pcs[2] == 0x2000);
+    assert(block_trace_contains(trace, 0x1004));
+    assert(!block_trace_contains(trace, 0x1008));
+
+    block_trace_destroy(trace);
+}
+
+static void map_code(Memory* memory, uint64_t address, const uint32_t* words, size_t count) {
+    assert(memory_copy_to(memory, address, words, count * 4));
+}
+
+static void test_superblock() {
+    RegisterFile* regs = registers_create();
+    Memory* memory = memory_create();
+    assert(memory_map(memory, 0x1000, 0x1000, PERM_READ | PERM_WRITE));
+
+    uint32_t head[] = { 0x14000004 };        /* 0x1000: b 0x1010 */
+    uint32_t middle[] = { 0x94000004 };      /* 0x1010: bl 0x1020 */
+    uint32_t tail[] = { 0x14000C00 };        /* 0x1020: b 0x4020 */
+    uint32_t cond[] = { 0x54000080 };        /* 0x1100: b.eq 0x1110 */
+    map_code(memory, 0x1000, head, 1);
+    map_code(memory, 0x1010, middle, 1);
+    map_code(memory, 0x1020, tail, 1);
+    map_code(memory, 0x1100, cond, 1);
+    assert(memory_protect(memory, 0x1000, 0x1000, PERM_READ | PERM_EXEC));
+
+    JITContext* jit = jit_create(memory, regs);
+    assert(jit_set_worker_count(jit, 0));
+    jit_set_tier_threshold(jit, 2);
+
+    /* Interpreted B.cond blocks record which way they go */
+    JITBlock* branch = jit_compile_block(jit, 0x1100);
+    registers_set_flags(regs, false, true, false, false);
+    assert(jit_execute_block(jit, branch));
+    assert(branch->branch_taken == 1 && branch->branch_not_taken == 0);
+
+    /* The head is promoted with both successors folded into it */
+    JITBlock* block = jit_compile_block(jit, 0x1000);
+    assert(jit_execute_block(jit, block));
+    assert(block->code == NULL);
+    assert(jit_execute_block(jit, block));
+    assert(block->code != NULL);
+    assert(block->trace != NULL);
+    assert(block->trace->block_count == 3);
+    /* The folded BL still records its return site for the return stack */
+    assert(block->exit_count == 2);
+    assert(block->exits[0].target_pc == 0x1014 && block->exits[1].target_pc == 0x4020);
+    uint64_t link = 0;
+    assert(registers_get_x(regs, 30, &link) == REG_SUCCESS && link == 0x1014);
+
+    uint64_t pc = 0;
+    assert(registers_get_pc(regs, &pc) == REG_SUCCESS && pc == 0x4020);
+
+    jit_destroy(jit);
+    registers_destroy(regs);
+    memory_destroy(memory);
+}
+
+int main() {
+    printf("Running block chaining tests...\n");
+
+    test_block_creation();
+    test_link_to_existing_successor();
+    test_link_incoming_later();
+    test_self_loop();
+    test_trace_building();
+    test_superblock();
+
+    printf("All block chaining tests passed!\n");
+    return 0;
+}
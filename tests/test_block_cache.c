@@ -0,0 +1,123 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include "../include/block_cache.h"
+
+static void test_cache_creation() {
+    BlockCache* cache = block_cache_create(100);
+    assert(cache != NULL);
+    assert(cache->capacity == 128);
+    assert(block_cache_count(cache) == 0);
+    assert(block_cache_lookup(cache, 0x400000) == NULL);
+    block_cache_destroy(cache);
+}
+
+static void test_full_pc_keys() {
+    BlockCache* cache = block_cache_create(16);
+    int a, b;
+
+    /* These aliased in the old direct-mapped (address / 4) % 1024 array */
+    assert(block_cache_insert(cache, 0x400000, &a));
+    assert(block_cache_insert(cache, 0x401000, &b));
+
+    assert(block_cache_lookup(cache, 0x400000) == &a);
+    assert(block_cache_lookup(cache, 0x401000) == &b);
+    assert(block_cache_lookup(cache, 0x402000) == NULL);
+    assert(block_cache_count(cache) == 2);
+
+    assert(block_cache_insert(cache, 0x400000, &b));
+    assert(block_cache_lookup(cache, 0x400000) == &b);
+    assert(block_cache_count(cache) == 2);
+
+    assert(!block_cache_insert(cache, BLOCK_CACHE_EMPTY_KEY, &a));
+    block_cache_destroy(cache);
+}
+
+static void test_growth() {
+    BlockCache* cache = block_cache_create(16);
+
+    for (uint64_t i = 0; i < 50000; i++) {
+        assert(block_cache_insert(cache, 0x400000 + i * 0x1000, (void*)(uintptr_t)(i + 1)));
+    }
+    assert(block_cache_count(cache) == 50000);
+    assert(cache->count * 4 <= cache->capacity * 3);
+
+    for (uint64_t i = 0; i < 50000; i++) {
+        assert(block_cache_lookup(cache, 0x400000 + i * 0x1000) == (void*)(uintptr_t)(i + 1));
+    }
+
+    BlockCacheStats stats;
+    block_cache_get_stats(cache, &stats);
+    assert(stats.resizes > 0);
+    assert(stats.hits == 50000);
+    assert(stats.inserts == 50000);
+    block_cache_destroy(cache);
+}
+
+static void test_removal() {
+    BlockCache* cache = block_cache_create(16);
+
+    for (uint64_t i = 0; i < 1000; i++) {
+        block_cache_insert(cache, i * 4, (void*)(uintptr_t)(i + 1));
+    }
+
+    for (uint64_t i = 0; i < 1000; i += 2) {
+        assert(block_cache_remove(cache, i * 4) == (void*)(uintptr_t)(i + 1));
+    }
+    assert(block_cache_remove(cache, 0) == NULL);
+    assert(block_cache_count(cache) == 500);
+
+    /* Backward-shift deletion must keep every surviving run reachable */
+    for (uint64_t i = 0; i < 1000; i++) {
+        void* expected = (i % 2) ? (void*)(uintptr_t)(i + 1) : NULL;
+        assert(block_cache_lookup(cache, i * 4) == expected);
+    }
+
+    block_cache_clear(cache);
+    assert(block_cache_count(cache) == 0);
+    assert(block_cache_lookup(cache, 4) == NULL);
+    block_cache_destroy(cache);
+}
+
+static void count_visitor(uint64_t key, void* value, void* opaque) {
+    (void)key;
+    (void)value;
+    (*(size_t*)opaque)++;
+}
+
+static void test_foreach_and_stats() {
+    BlockCache* cache = block_cache_create(16);
+    for (uint64_t i = 0; i < 10; i++) {
+        block_cache_insert(cache, 0x1000 + i * 4, (void*)(uintptr_t)(i + 1));
+    }
+
+    size_t visited = 0;
+    block_cache_foreach(cache, count_visitor, &visited);
+    assert(visited == 10);
+
+    block_cache_reset_stats(cache);
+    block_cache_lookup(cache, 0x1000);
+    block_cache_lookup(cache, 0x9000);
+
+    BlockCacheStats stats;
+    block_cache_get_stats(cache, &stats);
+    assert(stats.lookups == 2);
+    assert(stats.hits == 1);
+    assert(stats.misses == 1);
+    assert(stats.total_probes >= stats.collisions);
+    block_cache_destroy(cache);
+}
+
+int main() {
+    printf("Running block cache tests...\n");
+
+    test_cache_creation();
+    test_full_pc_keys();
+    test_growth();
+    test_removal();
+    test_foreach_and_stats();
+
+    printf("All block cache tests passed!\n");
+    return 0;
+}
@@ -0,0 +1,157 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "../include/cfg.h"
+#include "../include/memory.h"
+
+static const uint32_t main_code[] = {
+    0x91000420,     /* 0x1000: add x0, x1, #1 */
+    0x940007FD,     /* 0x1004: bl 0x2ff8 */
+    0xB4000060,     /* 0x1008: cbz x0, 0x1014 */
+    0x91000800,     /* 0x100c: add x0, x0, #2 */
+    0x14000002,     /* 0x1010: b 0x1018 */
+    0x54FFFF81,     /* 0x1014: b.ne 0x1004 */
+    0xD65F03C0,     /* 0x1018: ret */
+};
+
+static const uint32_t func_code[] = {
+    0x91000400,     /* 0x2ff8: add x0, x0, #1 */
+    0x91000400,     /* 0x2ffc: add x0, x0, #1 */
+    0xD65F03C0,     /* 0x3000: ret */
+};
+
+static const uint32_t bad_code[] = {
+    0x91000400,     /* 0x4000: add x0, x0, #1 */
+    0xFFFFFFFF,     /* 0x4004: data */
+};
+
+static Memory* create_memory() {
+    Memory* memory = memory_create();
+    assert(memory_map(memory, 0x1000, 0x4000, PERM_READ | PERM_WRITE | PERM_EXEC));
+    assert(memory_map(memory, 0x8000, 0x1000, PERM_READ | PERM_WRITE));
+    assert(memory_copy_to(memory, 0x1000, main_code, sizeof(main_code)));
+    assert(memory_copy_to(memory, 0x2FF8, func_code, sizeof(func_code)));
+    assert(memory_copy_to(memory, 0x4000, bad_code, sizeof(bad_code)));
+    return memory;
+}
+
+static void expect_block(ControlFlowGraph* cfg, uint64_t address, uint32_t count, uint32_t flags,
+                         size_t successor_count) {
+    const CFGBlock* block = cfg_get_block(cfg, address);
+    assert(block != NULL);
+    assert(block->instruction_count == count);
+    assert(block->flags == flags);
+    assert(block->successor_count == successor_count);
+}
+
+static void expect_edge(ControlFlowGraph* cfg, uint64_t address, size_t index, uint64_t target, CFGEdgeKind kind) {
+    const CFGBlock* block = cfg_get_block(cfg, address);
+    assert(block->successors[index].target == target && block->successors[index].kind == kind);
+}
+
+static void test_discovery() {
+    Memory* memory = create_memory();
+    const uint64_t roots[] = { 0x1000, 0x4000, 0x8000 };
+    const size_t worker_counts[] = { 0, 1, 2, 4 };
+
+    for (size_t i = 0; i < sizeof(worker_counts) / sizeof(worker_counts[0]); i++) {
+        ControlFlowGraph* cfg = cfg_build(memory, roots, 3, worker_counts[i]);
+        assert(cfg != NULL);
+        assert(cfg_block_count(cfg) == 8);
+        assert(cfg->instruction_count == 11 && cfg->edge_count == 8);
+
+        /* The b.ne back to the bl splits the entry run */
+        expect_block(cfg, 0x1000, 1, CFG_BLOCK_FUNCTION, 1);
+        expect_edge(cfg, 0x1000, 0, 0x1004, CFG_EDGE_FALLTHROUGH);
+        expect_block(cfg, 0x1004, 1, 0, 2);
+        expect_edge(cfg, 0x1004, 0, 0x2FF8, CFG_EDGE_CALL);
+        expect_edge(cfg, 0x1004, 1, 0x1008, CFG_EDGE_FALLTHROUGH);
+        expect_block(cfg, 0x1008, 1, 0, 2);
+        expect_edge(cfg, 0x1008, 0, 0x1014, CFG_EDGE_BRANCH);
+        expect_block(cfg, 0x100C, 2, 0, 1);
+        expect_edge(cfg, 0x100C, 0, 0x1018, CFG_EDGE_BRANCH);
+        expect_block(cfg, 0x1014, 1, 0, 2);
+        expect_edge(cfg, 0x1014, 0, 0x1004, CFG_EDGE_BRANCH);
+        expect_block(cfg, 0x1018, 1, CFG_BLOCK_INDIRECT, 0);
+
+        /* Callees are functions, and blocks run across pages */
+        expect_block(cfg, 0x2FF8, 3, CFG_BLOCK_FUNCTION | CFG_BLOCK_INDIRECT, 0);
+        assert(cfg_get_block(cfg, 0x3000) == NULL);
+
+        expect_block(cfg, 0x4000, 1, CFG_BLOCK_FUNCTION | CFG_BLOCK_INVALID, 0);
+        assert(cfg_get_block(cfg, 0x8000) == NULL);
+        cfg_destroy(cfg);
+    }
+
+    ControlFlowGraph* cfg = cfg_build(memory, NULL, 0, 2);
+    assert(cfg != NULL && cfg_block_count(cfg) == 0);
+    cfg_destroy(cfg);
+    memory_destroy(memory);
+}
+
+#define LARGE_BASE 0x100000
+#define LARGE_SIZE (256 * MEMORY_PAGE_SIZE)
+#define LARGE_WORDS (LARGE_SIZE / 4)
+
+/* Adds with branches anywhere into the segment, so work crosses pages */
+static Memory* create_large_program() {
+    Memory* memory = memory_create();
+    assert(memory_map(memory, LARGE_BASE, LARGE_SIZE, PERM_READ | PERM_WRITE | PERM_EXEC));
+    uint32_t* code = (uint32_t*)malloc(LARGE_SIZE);
+    srand(3);
+    for (size_t i = 0; i < LARGE_WORDS; i++) {
+        int64_t offset = (int64_t)(rand() % LARGE_WORDS) - (int64_t)i;
+        switch (rand() % 12) {
+            case 0: code[i] = 0x14000000 | (offset & 0x3FFFFFF); break;                  /* b */
+            case 1: code[i] = 0x94000000 | (offset & 0x3FFFFFF); break;                  /* bl */
+            case 2: code[i] = 0x54000001 | ((offset & 0x7FFFF) << 5); break;             /* b.ne */
+            case 3: code[i] = 0xB4000000 | ((offset & 0x7FFFF) << 5); break;             /* cbz x0 */
+            case 4: code[i] = 0xD65F03C0; break;                                          /* ret */
+            default: code[i] = 0x91000400; break;                                         /* add */
+        }
+    }
+    assert(memory_copy_to(memory, LARGE_BASE, code, LARGE_SIZE));
+    free(code);
+    return memory;
+}
+
+static void compare_block(uint64_t address, void* value, void* opaque) {
+    const CFGBlock* block = (const CFGBlock*)value;
+    const CFGBlock* other = cfg_get_block((ControlFlowGraph*)opaque, address);
+    assert(other != NULL);
+    assert(other->instruction_count == block->instruction_count && other->flags == block->flags);
+    assert(other->successor_count == block->successor_count);
+    for (size_t i = 0; i < block->successor_count; i++) {
+        assert(other->successors[i].target == block->successors[i].target);
+        assert(other->successors[i].kind == block->successors[i].kind);
+    }
+}
+
+static void test_parallel_matches_serial() {
+    Memory* memory = create_large_program();
+    const uint64_t roots[] = { LARGE_BASE, LARGE_BASE + LARGE_SIZE / 2 };
+
+    ControlFlowGraph* serial = cfg_build(memory, roots, 2, 1);
+    ControlFlowGraph* parallel = cfg_build(memory, roots, 2, 4);
+    assert(serial != NULL && parallel != NULL);
+    assert(cfg_block_count(serial) > 1000);
+    assert(cfg_block_count(serial) == cfg_block_count(parallel));
+    assert(serial->instruction_count == parallel->instruction_count);
+    assert(serial->edge_count == parallel->edge_count);
+    cfg_foreach_block(serial, compare_block, parallel);
+
+    cfg_destroy(serial);
+    cfg_destroy(parallel);
+    memory_destroy(memory);
+}
+
+int main() {
+    printf("Running CFG tests...\n");
+
+    test_discovery();
+    test_parallel_matches_serial();
+
+    printf("All CFG tests passed!\n");
+    return 0;
+}
@@ -0,0 +1,170 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include "../include/code_cache.h"
+#include "../include/jit.h"
+#include "../include/memory.h"
+#include "../include/registers.h"
+
+static JITBlock* make_sized_block(uint64_t address, size_t code_size) {
+    JITBlock* block = block_create(address);
+    assert(block != NULL);
+    block->code_size = code_size;
+    return block;
+}
+
+static void test_accounting() {
+    CodeCache* cache = code_cache_create(0);
+    JITBlock* a = make_sized_block(0x1000, 100);
+    JITBlock* b = make_sized_block(0x2000, 50);
+
+    code_cache_insert(cache, a);
+    code_cache_insert(cache, b);
+    code_cache_insert(cache, a);
+    assert(cache->count == 2 && cache->used == 150);
+    assert(code_cache_contains(cache, a));
+
+    /* Unlimited caches never ask for space */
+    assert(!code_cache_needs_space(cache, 1 << 30));
+
+    code_cache_set_budget(cache, 200);
+    assert(!code_cache_needs_space(cache, 50));
+    assert(code_cache_needs_space(cache, 51));
+
+    code_cache_remove(cache, a);
+    code_cache_remove(cache, a);
+    assert(cache->count == 1 && cache->used == 50);
+    assert(!code_cache_contains(cache, a));
+    code_cache_remove(cache, b);
+    assert(cache->hand == NULL && cache->used == 0);
+
+    /* A lone block larger than the budget is still admitted */
+    assert(!code_cache_needs_space(cache, 1000));
+
+    CodeCacheStats stats;
+    code_cache_get_stats(cache, &stats);
+    assert(stats.insertions == 2);
+    assert(stats.peak_bytes == 150);
+
+    block_destroy(a);
+    block_destroy(b);
+    code_cache_destroy(cache);
+}
+
+static void test_clock_second_chance() {
+    CodeCache* cache = code_cache_create(300);
+    JITBlock* blocks[3];
+    for (int i = 0; i < 3; i++) {
+        blocks[i] = make_sized_block(0x1000 * (i + 1), 100);
+        code_cache_insert(cache, blocks[i]);
+    }
+
+    /* The oldest block was used since the hand last passed; the next is not */
+    blocks[0]->referenced = 1;
+    assert(code_cache_needs_space(cache, 100));
+    assert(code_cache_evict(cache) == blocks[1]);
+    assert(blocks[0]->referenced == 0);
+    assert(cache->count == 2 && cache->used == 200);
+
+    /* With every flag set the hand sweeps once and takes where it started */
+    blocks[0]->referenced = 1;
+    blocks[2]->referenced = 1;
+    JITBlock* victim = code_cache_evict(cache);
+    assert(victim == blocks[2]);
+    assert(code_cache_evict(cache) == blocks[0]);
+    assert(code_cache_evict(cache) == NULL);
+
+    CodeCacheStats stats;
+    code_cache_get_stats(cache, &stats);
+    assert(stats.evictions == 3);
+    assert(stats.evicted_bytes == 300);
+
+    for (int i = 0; i < 3; i++) block_destroy(blocks[i]);
+    code_cache_destroy(cache);
+}
+
+/* Runs the dispatcher from pc until it reaches end. Blocks are kept out of
+ * superblocks so that every one of them is compiled and chained on its own.
+ */
+static void run_until(JITContext* jit, RegisterFile* regs, uint64_t pc, uint64_t end) {
+    registers_set_pc(regs, pc);
+    while (pc != end) {
+        JITBlock* block = jit_get_cached_block(jit, pc);
+        if (!block) {
+            block = jit_compile_block(jit, pc);
+            assert(block != NULL);
+            block->trace_formed = true;
+        }
+        assert(jit_execute_block(jit, block));
+        assert(registers_get_pc(regs, &pc) == REG_SUCCESS);
+    }
+}
+
+static void test_budget_enforced() {
+    RegisterFile* regs = registers_create();
+    Memory* memory = memory_create();
+    assert(memory_map(memory, 0x1000, 0x1000, PERM_READ | PERM_WRITE));
+
+    /* Sixteen blocks, each a single b #0x40 to the next */
+    uint32_t branch = 0x14000010;
+    for (int i = 0; i < 16; i++) {
+        assert(memory_copy_to(memory, 0x1000 + i * 0x40, &branch, sizeof(branch)));
+    }
+    assert(memory_protect(memory, 0x1000, 0x1000, PERM_READ | PERM_EXEC));
+
+    JITContext* jit = jit_create(memory, regs);
+    assert(jit_set_worker_count(jit, 0));
+    jit_set_tier_threshold(jit, 1);
+
+    run_until(jit, regs, 0x1000, 0x1040);
+    JITBlock* first = jit_get_cached_block(jit, 0x1000);
+    assert(first != NULL && first->code != NULL && first->code_size > 0);
+    size_t block_size = first->code_size;
+    size_t budget = block_size * 4;
+    jit_set_code_budget(jit, budget);
+
+    for (int pass = 0; pass < 3; pass++) {
+        run_until(jit, regs, 0x1000, 0x1400);
+        assert(jit->code_cache->used <= budget);
+        assert(jit->code_cache->count <= 4);
+    }
+
+    CodeCacheStats stats;
+    code_cache_get_stats(jit->code_cache, &stats);
+    assert(stats.evictions > 0);
+    assert(stats.peak_bytes <= budget);
+
+    /* Evicted blocks are gone from the translation table and unlinked */
+    size_t cached = 0;
+    for (int i = 0; i < 16; i++) {
+        JITBlock* block = jit_get_cached_block(jit, 0x1000 + i * 0x40);
+        if (!block) continue;
+        cached++;
+        assert(code_cache_contains(jit->code_cache, block));
+        for (size_t e = 0; e < block->exit_count; e++) {
+            JITBlock* target = block->exits[e].target;
+            assert(!target || jit_get_cached_block(jit, target->address) == target);
+        }
+    }
+    assert(cached == jit->code_cache->count);
+
+    /* Shrinking the budget evicts right away */
+    jit_set_code_budget(jit, block_size);
+    assert(jit->code_cache->count <= 1);
+    run_until(jit, regs, 0x1000, 0x1400);
+
+    jit_destroy(jit);
+    registers_destroy(regs);
+    memory_destroy(memory);
+}
+
+int main() {
+    printf("Running code cache tests...\n");
+
+    test_accounting();
+    test_clock_second_chance();
+    test_budget_enforced();
+
+    printf("All code cache tests passed!\n");
+    return 0;
+}
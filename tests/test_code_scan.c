@@ -0,0 +1,139 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "../include/code_scan.h"
+#include "../include/decode_cache.h"
+#include "../include/decoder.h"
+#include "../include/memory.h"
+
+#define WORDS 4099      /* not a multiple of any vector width */
+#define BITMAP_WORDS ((WORDS + 63) / 64)
+
+static bool test_bit(const uint64_t* bitmap, size_t index) {
+    return (bitmap[index / 64] >> (index % 64)) & 1;
+}
+
+static bool decodes_to_branch(uint32_t word) {
+    DecoderContext decoder = { .code_buffer = (uint8_t*)&word, .buffer_size = sizeof(word) };
+    Instruction inst;
+    return decoder_decode_next(&decoder, &inst) == DECODER_SUCCESS && instruction_is_branch(&inst);
+}
+
+/* Random words salted with every branch class, so each bitmap word has hits */
+static void fill_code(uint32_t* code, size_t count) {
+    static const uint32_t branches[] = {
+        0x14000000, 0x94000000, 0x54000000, 0xB4000000, 0x35000000,
+        0x36000000, 0xB7000000, 0xD61F0000, 0xD63F0000, 0xD65F03C0,
+    };
+    for (size_t i = 0; i < count; i++) {
+        uint32_t word = ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+        if (rand() % 4 == 0) {
+            uint32_t base = branches[rand() % (sizeof(branches) / sizeof(branches[0]))];
+            word = base | (word & 0x00FFFFE0);
+            if ((base & 0xFE000000) == 0xD6000000) word = base | (word & 0x3E0);
+        }
+        code[i] = word;
+    }
+}
+
+static void test_levels_agree() {
+    uint32_t* code = (uint32_t*)malloc(WORDS * sizeof(uint32_t));
+    uint64_t branches[3][BITMAP_WORDS], targets[3][BITMAP_WORDS];
+    srand(7);
+    fill_code(code, WORDS);
+
+    CodeScanLevel host = code_scan_get_level();
+    for (int level = CODE_SCAN_SCALAR; level <= CODE_SCAN_AVX2; level++) {
+        code_scan_set_level((CodeScanLevel)level);
+        assert(code_scan_get_level() == (level < (int)host ? (CodeScanLevel)level : host));
+        code_scan((const uint8_t*)code, WORDS, branches[level], targets[level]);
+    }
+    code_scan_set_level(CODE_SCAN_AVX2);
+
+    assert(memcmp(branches[0], branches[1], sizeof(branches[0])) == 0);
+    assert(memcmp(branches[0], branches[2], sizeof(branches[0])) == 0);
+    assert(memcmp(targets[0], targets[1], sizeof(targets[0])) == 0);
+    assert(memcmp(targets[0], targets[2], sizeof(targets[0])) == 0);
+
+    /* Unaligned starts and short tails take the scalar path for the rest */
+    code_scan((const uint8_t*)code + 4, 13, branches[1], NULL);
+    for (size_t i = 0; i < 13; i++) {
+        assert(test_bit(branches[1], i) == test_bit(branches[0], i + 1));
+    }
+    free(code);
+}
+
+/* The branch bitmap is exactly the decoder's idea of a branch */
+static void test_matches_decoder() {
+    uint32_t* code = (uint32_t*)malloc(WORDS * sizeof(uint32_t));
+    uint64_t branches[BITMAP_WORDS];
+    srand(11);
+    fill_code(code, WORDS);
+    code[0] = 0xD67F0000;      /* BR's fourth opc value */
+    code[1] = 0xD65F0001;      /* RET with nonzero op4 */
+
+    code_scan((const uint8_t*)code, WORDS, branches, NULL);
+    for (size_t i = 0; i < WORDS; i++) {
+        assert(test_bit(branches, i) == decodes_to_branch(code[i]));
+    }
+    free(code);
+}
+
+static void test_targets() {
+    uint32_t code[64] = { 0 };
+    code[0] = 0x14000010;      /* b +0x40 */
+    code[4] = 0x54FFFFE1;      /* b.ne -4 */
+    code[8] = 0xB4000100;      /* cbz x0, +0x20 */
+    code[9] = 0x36080040;      /* tbz w0, #1, +8 */
+    code[20] = 0xD61F0000;     /* br x0 */
+    code[21] = 0x17FFFFE0;     /* b -0x80, outside the range */
+    code[22] = 0x14000100;     /* b +0x400, outside the range */
+
+    uint64_t branches[1], targets[1];
+    code_scan((const uint8_t*)code, 64, branches, targets);
+    assert(branches[0] == ((1ULL << 0) | (1ULL << 4) | (1ULL << 8) | (1ULL << 9) |
+                           (1ULL << 20) | (1ULL << 21) | (1ULL << 22)));
+    assert(targets[0] == ((1ULL << 3) | (1ULL << 11) | (1ULL << 16)));
+}
+
+/* Blocks end after a branch or before another block's branch target */
+static void test_block_boundaries() {
+    static const uint32_t code[] = {
+        0x91000420,     /* 0x1000: add x0, x1, #1 */
+        0x91000400,     /* 0x1004: loop: add x0, x0, #1 */
+        0xF1000421,     /* 0x1008: subs x1, x1, #1 */
+        0x54FFFFC1,     /* 0x100c: b.ne loop */
+        0xD65F03C0,     /* 0x1010: ret */
+    };
+    Memory* memory = memory_create();
+    assert(memory_map(memory, 0x1000, 0x2000, PERM_READ | PERM_WRITE | PERM_EXEC));
+    assert(memory_copy_to(memory, 0x1000, code, sizeof(code)));
+    assert(memory_copy_to(memory, 0x1FFC, code, 4));
+    assert(memory_copy_to(memory, 0x2000, &code[4], 4));
+    DecodeCache* cache = decode_cache_create(memory);
+    Instruction insts[16];
+
+    assert(decode_cache_fetch_block(cache, 0x1000, insts, 16) == 1);
+    assert(decode_cache_fetch_block(cache, 0x1004, insts, 16) == 3);
+    assert(insts[2].raw == code[3]);
+    assert(decode_cache_fetch_block(cache, 0x1010, insts, 16) == 1);
+
+    /* Code running off the end of a page continues on the next one */
+    assert(decode_cache_fetch_block(cache, 0x1FFC, insts, 16) == 2);
+
+    decode_cache_destroy(cache);
+    memory_destroy(memory);
+}
+
+int main() {
+    printf("Running code scan tests...\n");
+
+    test_levels_agree();
+    test_matches_decoder();
+    test_targets();
+    test_block_boundaries();
+
+    printf("All code scan tests passed!\n");
+    return 0;
+}
@@ -0,0 +1,157 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <unistd.h>
+#include "../include/compile_queue.h"
+#include "../include/decoder.h"
+#include "../include/memory.h"
+#include "../include/registers.h"
+
+/* Single-instruction block: b #offset */
+static JITBlock* make_branch_block(uint64_t address, int32_t offset) {
+    uint32_t raw = 0x14000000 | ((uint32_t)(offset / 4) & 0x03FFFFFF);
+    JITBlock* block = block_create(address);
+    assert(block != NULL);
+
+    DecoderContext* decoder = decoder_create((const uint8_t*)&raw, sizeof(raw));
+    block->instructions = (Instruction*)calloc(1, sizeof(Instruction));
+    assert(decoder_decode_next(decoder, block->instructions) == DECODER_SUCCESS);
+    decoder_destroy(decoder);
+
+    block->instruction_count = 1;
+    block->size = 4;
+    return block;
+}
+
+static void test_compile_in_background() {
+    RegisterFile* regs = registers_create();
+    Memory* memory = memory_create();
+    CompileQueue* queue = compile_queue_create(2, NULL, NULL);
+    assert(queue != NULL);
+    assert(queue->worker_count == 2);
+
+    JITBlock* blocks[8];
+    CompileJob* jobs[8];
+    for (int i = 0; i < 8; i++) {
+        blocks[i] = make_branch_block(0x1000 + i * 0x100, 0x40);
+        jobs[i] = compile_queue_submit(queue, blocks[i], false);
+        assert(jobs[i] != NULL);
+    }
+
+    for (int i = 0; i < 8; i++) {
+        compile_queue_wait(queue, jobs[i]);
+        assert(compile_queue_is_done(jobs[i]));
+        assert(jobs[i]->result.code != NULL);
+        assert(jobs[i]->result.exit_count == 1);
+        assert(jobs[i]->result.exit_targets[0] == blocks[i]->address + 0x40);
+
+        /* Unlinked exits return the successor PC to the caller */
+        assert(block_set_exits(blocks[i], jobs[i]->result.exit_targets, 1));
+        BlockFunction func = (BlockFunction)jobs[i]->result.code;
+        assert(func(regs, memory, blocks[i]) == blocks[i]->address + 0x40);
+    }
+    assert(queue->completed == 8);
+
+    /* Jobs own their code, which must go before the compilers do */
+    for (int i = 0; i < 8; i++) {
+        compile_job_destroy(jobs[i]);
+        block_destroy(blocks[i]);
+    }
+    compile_queue_destroy(queue);
+    registers_destroy(regs);
+    memory_destroy(memory);
+}
+
+static void test_cancel() {
+    CompileQueue* queue = compile_queue_create(1, NULL, NULL);
+    JITBlock* block = make_branch_block(0x2000, 8);
+
+    CompileJob* job = compile_queue_submit(queue, block, true);
+    compile_queue_cancel(job);
+    compile_queue_wait(queue, job);
+    assert(compile_queue_is_done(job));
+
+    compile_job_destroy(job);
+    block_destroy(block);
+    compile_queue_destroy(queue);
+
+    assert(compile_queue_create(0, NULL, NULL) == NULL);
+}
+
+static void test_release_code() {
+    RegisterFile* regs = registers_create();
+    Memory* memory = memory_create();
+    JITCompiler* compiler = jit_compiler_create(NULL);
+    assert(compiler != NULL);
+
+    /* Every block owns its code, so compile/release cycles do not pile up */
+    for (int i = 0; i < 200; i++) {
+        JITBlock* block = make_branch_block(0x3000, 12);
+        CompileResult result;
+        assert(jit_compiler_compile(compiler, block, &result));
+        assert(result.tracker != NULL);
+
+        block->code = result.code;
+        block->code_tracker = result.tracker;
+        result.tracker = NULL;
+        assert(block_set_exits(block, result.exit_targets, result.exit_count));
+        jit_compile_result_free(&result);
+
+        assert(((BlockFunction)block->code)(regs, memory, block) == 0x300C);
+        jit_release_code(block);
+        assert(block->code == NULL && block->code_tracker == NULL);
+        block_destroy(block);
+    }
+
+    jit_compiler_destroy(compiler);
+    registers_destroy(regs);
+    memory_destroy(memory);
+}
+
+static void test_async_promotion() {
+    RegisterFile* regs = registers_create();
+    Memory* memory = memory_create();
+    uint32_t code[2] = { 0x14000002, 0xD503201F };   /* b #8; nop */
+
+    assert(memory_map(memory, 0x1000, 0x1000, PERM_READ | PERM_WRITE));
+    assert(memory_copy_to(memory, 0x1000, code, sizeof(code)));
+    assert(memory_protect(memory, 0x1000, 0x1000, PERM_READ | PERM_EXEC));
+
+    JITContext* jit = jit_create(memory, regs);
+    assert(jit_set_worker_count(jit, 1));
+    jit_set_tier_threshold(jit, 1);
+
+    JITBlock* block = jit_compile_block(jit, 0x1000);
+    assert(block != NULL && block->code == NULL);
+
+    /* The interpreter keeps running the block until the worker publishes */
+    uint64_t pc = 0;
+    for (int i = 0; i < 10000 && !block->code; i++) {
+        assert(jit_execute_block(jit, block));
+        assert(registers_get_pc(regs, &pc) == REG_SUCCESS && pc == 0x1008);
+        usleep(100);
+    }
+    assert(block->code != NULL);
+    assert(block->tier == BLOCK_TIER_JIT);
+    assert(!jit_set_worker_count(jit, 2));
+
+    assert(jit_execute_block(jit, block));
+    assert(registers_get_pc(regs, &pc) == REG_SUCCESS && pc == 0x1008);
+
+    jit_destroy(jit);
+    registers_destroy(regs);
+    memory_destroy(memory);
+}
+
+int main() {
+    printf("Running compile queue tests...\n");
+
+    test_compile_in_background();
+    test_cancel();
+    test_release_code();
+    test_async_promotion();
+
+    printf("All compile queue tests passed!\n");
+    return 0;
+}
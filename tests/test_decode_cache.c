@@ -0,0 +1,134 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include "../include/decode_cache.h"
+#include "../include/jit.h"
+#include "../include/memory.h"
+#include "../include/registers.h"
+
+#define CODE 0x1000
+
+static const uint32_t code[] = {
+    0x91000420,     /* 0x1000: add x0, x1, #1 */
+    0x91000800,     /* 0x1004: add x0, x0, #2 */
+    0x14000100,     /* 0x1008: b 0x1408 */
+    0xFFFFFFFF,     /* 0x100c: data */
+};
+
+static Memory* create_memory() {
+    Memory* memory = memory_create();
+    assert(memory_map(memory, CODE, 0x2000, PERM_READ | PERM_WRITE | PERM_EXEC));
+    assert(memory_map(memory, 0x8000, 0x1000, PERM_READ | PERM_WRITE));
+    assert(memory_copy_to(memory, CODE, code, sizeof(code)));
+    return memory;
+}
+
+static void test_fetch() {
+    Memory* memory = create_memory();
+    DecodeCache* cache = decode_cache_create(memory);
+    DecodeCacheStats stats;
+
+    const Instruction* inst = decode_cache_fetch(cache, CODE + 4);
+    assert(inst != NULL && inst->raw == code[1] && inst->opcode == 0x00);
+    assert(decode_cache_fetch(cache, CODE + 4) == inst);
+    assert(decode_cache_fetch(cache, CODE + 0xC) == NULL);
+    assert(decode_cache_fetch(cache, CODE + 0xC) == NULL);
+    assert(decode_cache_fetch(cache, CODE + 2) == NULL);
+    assert(decode_cache_fetch(cache, 0x8000) == NULL);
+    assert(decode_cache_fetch(cache, 0x9000) == NULL);
+
+    decode_cache_get_stats(cache, &stats);
+    assert(stats.decoded == 2 && stats.reused == 2);
+    assert(decode_cache_page_count(cache) == 1);
+    assert(decode_cache_contains(cache, CODE));
+    assert(memory_page_has_code(memory, CODE));
+
+    /* Blocks stop after the branch and reuse the slots already filled */
+    Instruction insts[8];
+    assert(decode_cache_fetch_block(cache, CODE, insts, 8) == 3);
+    assert(insts[2].opcode == 0x20);
+    assert(decode_cache_fetch_block(cache, CODE, insts, 2) == 2);
+    decode_cache_get_stats(cache, &stats);
+    assert(stats.decoded == 4 && stats.reused == 5);
+
+    decode_cache_invalidate(cache, CODE + 0x800, 4);
+    assert(!decode_cache_contains(cache, CODE));
+    decode_cache_invalidate(cache, CODE, 4);
+    decode_cache_get_stats(cache, &stats);
+    assert(stats.invalidations == 1);
+
+    decode_cache_destroy(cache);
+    memory_destroy(memory);
+}
+
+static void test_recompile_reuses_decode() {
+    Memory* memory = create_memory();
+    RegisterFile* regs = registers_create();
+    JITContext* jit = jit_create(memory, regs);
+    assert(jit_set_worker_count(jit, 0));
+    jit_set_tier_threshold(jit, 0);
+    DecodeCacheStats stats;
+
+    JITBlock* block = jit_compile_block(jit, CODE);
+    assert(block != NULL && block->instruction_count == 3);
+    jit_get_decode_stats(jit, &stats);
+    uint64_t decoded = stats.decoded;
+    assert(decoded >= 3);
+
+    /* Eviction drops the translation but not the decoded page */
+    jit_invalidate_cache(jit, CODE);
+    assert(memory_page_has_code(memory, CODE));
+    block = jit_compile_block(jit, CODE);
+    assert(block != NULL && block->instruction_count == 3);
+    jit_get_decode_stats(jit, &stats);
+    assert(stats.decoded == decoded && stats.reused >= 3);
+
+    regs->x[1] = 10;
+    assert(jit_execute_block(jit, block));
+    assert(regs->x[0] == 13);
+
+    jit_destroy(jit);
+    registers_destroy(regs);
+    memory_destroy(memory);
+}
+
+static void test_store_invalidates_page() {
+    Memory* memory = create_memory();
+    RegisterFile* regs = registers_create();
+    JITContext* jit = jit_create(memory, regs);
+    assert(jit_set_worker_count(jit, 0));
+    jit_set_tier_threshold(jit, 0);
+    DecodeCacheStats stats;
+
+    JITBlock* block = jit_compile_block(jit, CODE);
+    assert(block != NULL);
+    jit_invalidate_cache(jit, CODE);
+
+    /* add x0, x0, #2 becomes add x0, x0, #5 */
+    assert(memory_write32(memory, CODE + 4, 0x91001400));
+    jit_get_decode_stats(jit, &stats);
+    assert(stats.invalidations == 1);
+    assert(!decode_cache_contains(jit->decode_cache, CODE));
+    assert(!memory_page_has_code(memory, CODE));
+
+    block = jit_compile_block(jit, CODE);
+    assert(block != NULL);
+    regs->x[1] = 10;
+    assert(jit_execute_block(jit, block));
+    assert(regs->x[0] == 16);
+
+    jit_destroy(jit);
+    registers_destroy(regs);
+    memory_destroy(memory);
+}
+
+int main() {
+    printf("Running decode cache tests...\n");
+
+    test_fetch();
+    test_recompile_reuses_decode();
+    test_store_invalidates_page();
+
+    printf("All decode cache tests passed!\n");
+    return 0;
+}
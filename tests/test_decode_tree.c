@@ -0,0 +1,240 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include "../include/decoder.h"
+
+static const struct { uint32_t mask, value; } encodings[] = {
+#define ENCODING(mask, value, decode) { mask, value },
+#include "../include/a64_encodings.h"
+#undef ENCODING
+};
+
+static Instruction decode_word(uint32_t raw) {
+    Instruction inst;
+    DecoderContext* decoder = decoder_create((const uint8_t*)&raw, sizeof(raw));
+    assert(decoder != NULL);
+    assert(decoder_decode_next(decoder, &inst) == DECODER_SUCCESS);
+    assert(decoder->pc == 4);
+    decoder_destroy(decoder);
+    return inst;
+}
+
+static bool decodes(uint32_t raw) {
+    Instruction inst;
+    DecoderContext* decoder = decoder_create((const uint8_t*)&raw, sizeof(raw));
+    assert(decoder != NULL);
+    DecoderError result = decoder_decode_next(decoder, &inst);
+    decoder_destroy(decoder);
+    return result == DECODER_SUCCESS;
+}
+
+static void expect(uint32_t raw, InstructionType type, uint8_t opcode, uint8_t dest) {
+    Instruction inst = decode_word(raw);
+    assert(inst.type == type);
+    assert(inst.opcode == opcode);
+    assert(inst.dest_reg == dest);
+}
+
+/* The tree must find exactly what a scan of the table finds */
+static void test_tree_matches_table() {
+    uint32_t state = 0x12345678;
+    for (int i = 0; i < 200000; i++) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        /* Half the words start from a table entry, to land in populated subtrees */
+        uint32_t raw = state;
+        if (i & 1) {
+            size_t entry = (state >> 7) % (sizeof(encodings) / sizeof(encodings[0]));
+            raw = encodings[entry].value | (state & ~encodings[entry].mask);
+        }
+
+        bool listed = false;
+        for (size_t j = 0; j < sizeof(encodings) / sizeof(encodings[0]); j++) {
+            if ((raw & encodings[j].mask) == encodings[j].value) listed = true;
+        }
+        assert(decoder_is_valid_instruction(raw) == listed);
+        if (!listed) assert(!decodes(raw));
+    }
+
+    for (size_t j = 0; j < sizeof(encodings) / sizeof(encodings[0]); j++) {
+        assert(decoder_is_valid_instruction(encodings[j].value));
+    }
+    assert(!decoder_is_valid_instruction(0x00000000));     /* udf #0 */
+    assert(!decoder_is_valid_instruction(0xD4000001));     /* svc #0 */
+}
+
+static void test_data_processing_immediate() {
+    Instruction inst = decode_word(0xD2A24680);            /* movz x0, #0x1234, lsl #16 */
+    assert(inst.type == INST_MOVE && inst.opcode == 0x30 && inst.dest_reg == 0);
+    assert(instruction_get_immediate(&inst, 0) == 0x12340000);
+
+    inst = decode_word(0xF28ACF00);                        /* movk x0, #0x5678 */
+    assert(inst.opcode == 0x32);
+    assert(instruction_get_immediate(&inst, 0) == 0x5678 && instruction_get_immediate(&inst, 1) == 0);
+
+    inst = decode_word(0x12800001);                        /* movn w1, #0 */
+    assert(inst.opcode == 0x31 && instruction_get_immediate(&inst, 0) == UINT64_MAX);
+
+    inst = decode_word(0xF0000002);                        /* adrp x2, #0x3000 */
+    assert(inst.opcode == 0x34 && instruction_get_immediate(&inst, 0) == 0x3000);
+
+    inst = decode_word(0x92401C20);                        /* and x0, x1, #0xff */
+    assert(inst.type == INST_LOGICAL && inst.opcode == 0x10);
+    assert(instruction_get_immediate(&inst, 1) == 0xFF);
+
+    inst = decode_word(0x3200CC62);                        /* orr w2, w3, #0x0f0f0f0f */
+    assert(inst.opcode == 0x11 && instruction_get_immediate(&inst, 1) == 0x0F0F0F0F);
+
+    inst = decode_word(0xD201F0A4);                        /* eor x4, x5, #0xaaaaaaaaaaaaaaaa */
+    assert(inst.opcode == 0x12 && instruction_get_immediate(&inst, 1) == 0xAAAAAAAAAAAAAAAAULL);
+
+    /* N = 1 is reserved for 32-bit logical immediates */
+    assert(!decodes(0x12401C20));
+
+    inst = decode_word(0xD3442C20);                        /* ubfx x0, x1, #4, #8 */
+    assert(inst.type == INST_LOGICAL && inst.opcode == 0x1C);
+    assert(instruction_get_immediate(&inst, 1) == 4 && instruction_get_immediate(&inst, 2) == 11);
+
+    inst = decode_word(0x93C830E6);                        /* extr x6, x7, x8, #12 */
+    assert(inst.opcode == 0x1D && instruction_get_register(&inst, 1) == 8 && instruction_get_immediate(&inst, 2) == 12);
+}
+
+static void test_data_processing_register() {
+    Instruction inst = decode_word(0x8B060CA4);            /* add x4, x5, x6, lsl #3 */
+    assert(inst.type == INST_ARITHMETIC && inst.opcode == 0x00 && inst.operand_count == 3);
+    assert(instruction_get_operand_type(&inst, 2) == OP_SHIFT);
+    assert(instruction_get_operand(&inst, 2).value.shift.type == SHIFT_LSL && instruction_get_operand(&inst, 2).value.shift.amount == 3);
+
+    inst = decode_word(0x8B2B4BEA);                        /* add x10, sp, w11, uxtw #2 */
+    assert(instruction_get_register(&inst, 0) == 31 && instruction_get_operand_type(&inst, 2) == OP_EXTEND);
+    assert(instruction_get_operand(&inst, 2).value.shift.type == 2 && instruction_get_operand(&inst, 2).value.shift.amount == 2);
+    assert(instruction_reads_register(&inst, 31));
+
+    /* No shift, no shift operand */
+    inst = decode_word(0xAB0E01AC);                        /* adds x12, x13, x14 */
+    assert(inst.operand_count == 2 && inst.sets_flags);
+
+    inst = decode_word(0x7A050083);                        /* sbcs w3, w4, w5 */
+    assert(inst.opcode == 0x03 && inst.sets_flags && instruction_reads_flags(&inst));
+
+    inst = decode_word(0xFA451824);                        /* ccmp x1, #5, #4, ne */
+    assert(inst.opcode == 0x05 && inst.condition == 1 && inst.dest_reg == 0xFF);
+    assert(instruction_get_operand_type(&inst, 1) == OP_IMMEDIATE && instruction_get_immediate(&inst, 1) == 5);
+    assert(instruction_get_immediate(&inst, 2) == 0x40000000);
+    assert(!instruction_modifies_register(&inst, 31));
+
+    expect(0x9B020C20, INST_ARITHMETIC, 0x06, 0);          /* madd x0, x1, x2, x3 */
+    expect(0x1B069CA4, INST_ARITHMETIC, 0x07, 4);          /* msub w4, w5, w6, w7 */
+    expect(0x9B227C20, INST_ARITHMETIC, 0x08, 0);          /* smull x0, w1, w2 */
+    expect(0x9BC57C83, INST_ARITHMETIC, 0x0D, 3);          /* umulh x3, x4, x5 */
+    expect(0x9AC20820, INST_ARITHMETIC, 0x0E, 0);          /* udiv x0, x1, x2 */
+    expect(0x1AC50C83, INST_ARITHMETIC, 0x0F, 3);          /* sdiv w3, w4, w5 */
+    expect(0x8A220020, INST_LOGICAL, 0x13, 0);             /* bic x0, x1, x2 */
+    expect(0x2A250083, INST_LOGICAL, 0x14, 3);             /* orn w3, w4, w5 */
+    expect(0x9AC22020, INST_LOGICAL, 0x16, 0);             /* lsl x0, x1, x2 */
+    expect(0x1AC52C83, INST_LOGICAL, 0x19, 3);             /* ror w3, w4, w5 */
+    expect(0xDAC00020, INST_MOVE, 0x39, 0);                /* rbit x0, x1 */
+    expect(0xDAC01128, INST_MOVE, 0x3B, 8);                /* clz x8, x9 */
+    expect(0x5AC0156A, INST_MOVE, 0x3C, 10);               /* cls w10, w11 */
+
+    inst = decode_word(0x5AC00462);                        /* rev16 w2, w3 */
+    assert(inst.opcode == 0x3A && instruction_get_element_size(&inst) == 2);
+    inst = decode_word(0xDAC00CE6);                        /* rev x6, x7 */
+    assert(inst.opcode == 0x3A && instruction_get_element_size(&inst) == 8);
+
+    inst = decode_word(0x9A82B020);                        /* csel x0, x1, x2, lt */
+    assert(inst.opcode == 0x35 && inst.condition == 0xB && instruction_reads_flags(&inst));
+    expect(0xDA8884E6, INST_MOVE, 0x38, 6);                /* csneg x6, x7, x8, hi */
+}
+
+static void test_branches_and_system() {
+    Instruction inst = decode_word(0xB4000080);            /* cbz x0, #16 */
+    assert(inst.opcode == 0x27 && instruction_is_conditional_branch(&inst));
+    assert(instruction_get_branch_target(&inst, 0x1000) == 0x1010);
+    assert(instruction_reads_register(&inst, 0));
+
+    inst = decode_word(0x35FFFFC1);                        /* cbnz w1, #-8 */
+    assert(inst.opcode == 0x28 && instruction_get_branch_target(&inst, 0x1000) == 0x0FF8);
+
+    inst = decode_word(0xB6400062);                        /* tbz x2, #40, #12 */
+    assert(inst.opcode == 0x29 && instruction_get_immediate(&inst, 2) == 40);
+    assert(instruction_get_branch_target(&inst, 0x1000) == 0x100C);
+
+    inst = decode_word(0xD503201F);                        /* nop */
+    assert(inst.type == INST_SYSTEM && inst.opcode == 0x80 && inst.dest_reg == 0xFF);
+    expect(0xD5033BBF, INST_SYSTEM, 0x80, 0xFF);           /* dmb ish */
+
+    inst = decode_word(0xD53B4200);                        /* mrs x0, nzcv */
+    assert(inst.opcode == 0x81 && instruction_get_immediate(&inst, 0) == SYSREG_NZCV);
+    assert(instruction_reads_flags(&inst) && instruction_modifies_register(&inst, 0));
+
+    inst = decode_word(0xD51B4401);                        /* msr fpcr, x1 */
+    assert(inst.opcode == 0x82 && instruction_get_immediate(&inst, 1) == SYSREG_FPCR);
+    assert(!inst.sets_flags && instruction_reads_register(&inst, 1));
+
+    /* Other system registers are not modelled */
+    assert(!decodes(0xD53BD040));                          /* mrs x0, tpidr_el0 */
+}
+
+static void test_loads_and_stores() {
+    Instruction inst = decode_word(0xF8627820);            /* ldr x0, [x1, x2, lsl #3] */
+    assert(inst.opcode == 0x40 && instruction_get_element_size(&inst) == 8);
+    assert(instruction_get_operand(&inst, 0).value.mem.index_reg == 2 && instruction_get_operand(&inst, 0).value.mem.shift_amount == 3);
+    assert(instruction_get_operand(&inst, 0).value.mem.extend == 3);
+
+    inst = decode_word(0xB865C883);                        /* ldr w3, [x4, w5, sxtw] */
+    assert(instruction_get_element_size(&inst) == 4 && instruction_get_operand(&inst, 0).value.mem.extend == 6);
+    assert(instruction_get_operand(&inst, 0).value.mem.shift_amount == 0);
+
+    inst = decode_word(0xB98008E6);                        /* ldrsw x6, [x7, #8] */
+    assert(inst.opcode == 0x46 && instruction_get_element_size(&inst) == 4 && instruction_get_operand(&inst, 0).value.mem.offset == 8);
+
+    inst = decode_word(0x38C01528);                        /* ldrsb w8, [x9], #1 */
+    assert(inst.opcode == 0x47 && instruction_get_operand(&inst, 0).value.mem.mode == ADDR_POST_INDEX);
+    assert(instruction_modifies_register(&inst, 9) && instruction_modifies_register(&inst, 8));
+
+    inst = decode_word(0x785FED6A);                        /* ldrh w10, [x11, #-2]! */
+    assert(instruction_get_operand(&inst, 0).value.mem.mode == ADDR_PRE_INDEX && instruction_get_operand(&inst, 0).value.mem.offset == -2);
+
+    inst = decode_word(0xF85F81AC);                        /* ldur x12, [x13, #-8] */
+    assert(instruction_get_operand(&inst, 0).value.mem.mode == ADDR_OFFSET && !instruction_modifies_register(&inst, 13));
+
+    inst = decode_word(0xA9BE0FE2);                        /* stp x2, x3, [sp, #-32]! */
+    assert(inst.opcode == 0x49 && instruction_get_operand(&inst, 0).value.mem.offset == -32);
+    assert(instruction_reads_register(&inst, 3) && !instruction_modifies_register(&inst, 3));
+    assert(instruction_modifies_register(&inst, 31));
+
+    inst = decode_word(0x68C114C4);                        /* ldpsw x4, x5, [x6], #8 */
+    assert(inst.opcode == 0x4A && instruction_get_element_size(&inst) == 4 && instruction_modifies_register(&inst, 5));
+
+    inst = decode_word(0xAD400440);                        /* ldp q0, q1, [x2] */
+    assert(inst.opcode == 0x4B && instruction_get_element_size(&inst) == 16 && instruction_get_register(&inst, 1) == 1);
+
+    inst = decode_word(0x58000120);                        /* ldr x0, #36 */
+    assert(instruction_get_operand(&inst, 0).value.mem.mode == ADDR_LITERAL && instruction_get_operand(&inst, 0).value.mem.offset == 36);
+    assert(!instruction_reads_register(&inst, 0));
+
+    inst = decode_word(0xC8037CA4);                        /* stxr w3, x4, [x5] */
+    assert(inst.opcode == 0x4E && instruction_modifies_register(&inst, 3));
+    assert(instruction_reads_register(&inst, 4));
+
+    expect(0xC85F7C41, INST_LOAD_STORE, 0x4D, 1);          /* ldxr x1, [x2] */
+    expect(0x88DFFCE6, INST_LOAD_STORE, 0x40, 6);          /* ldar w6, [x7] */
+    expect(0xC89FFD28, INST_LOAD_STORE, 0x41, 8);          /* stlr x8, [x9] */
+    expect(0xF9800000, INST_SYSTEM, 0x80, 0xFF);           /* prfm pldl1keep, [x0] */
+}
+
+int main() {
+    printf("Running decode tree tests...\n");
+
+    test_tree_matches_table();
+    test_data_processing_immediate();
+    test_data_processing_register();
+    test_branches_and_system();
+    test_loads_and_stores();
+
+    printf("All decode tree tests passed!\n");
+    return 0;
+}
@@ -0,0 +1,184 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include "../include/emitter.h"
+#include "../include/jit.h"
+#include "../include/decoder.h"
+#include "../include/interpreter.h"
+#include "../include/memory.h"
+#include "../include/registers.h"
+
+static const uint32_t producers[] = {
+    0xB1000402,     /* adds x2, x0, #1 */
+    0x31000402,     /* adds w2, w0, #1 */
+    0xF1000402,     /* subs x2, x0, #1 */
+    0x71000402,     /* subs w2, w0, #1 */
+};
+
+#define PRODUCER_COUNT (sizeof(producers) / sizeof(producers[0]))
+#define CONDITION_COUNT 15
+
+static const uint64_t values[] = {
+    0, 1, 2, 0x7FFFFFFF, 0x80000000, 0x80000001, 0xFFFFFFFF, 0x100000000,
+    0x7FFFFFFFFFFFFFFF, 0x8000000000000000, 0x8000000000000001, UINT64_MAX,
+};
+
+#define VALUE_COUNT (sizeof(values) / sizeof(values[0]))
+
+/* Each block is "producer; b.cond +8", or just "b.cond +8" for producer
+ * PRODUCER_COUNT, whose flags come from the register file.
+ */
+static uint64_t block_address(size_t producer, uint8_t condition) {
+    return 0x1000 + (producer * CONDITION_COUNT + condition) * 16;
+}
+
+static size_t build_block(uint32_t* words, size_t producer, uint8_t condition) {
+    size_t count = 0;
+    if (producer < PRODUCER_COUNT) words[count++] = producers[producer];
+    words[count++] = 0x54000040 | condition;
+    return count;
+}
+
+static void interpret(RegisterFile* regs, Memory* memory, const JITBlock* block, uint64_t* next_pc) {
+    assert(interpreter_execute_block(regs, memory, block->instructions, block->instruction_count,
+                                     block->address, next_pc) == INTERP_SUCCESS);
+}
+
+static void test_conditions_match_interpreter() {
+    RegisterFile* regs = registers_create();
+    RegisterFile* expected = registers_create();
+    Memory* memory = memory_create();
+    assert(memory_map(memory, 0x1000, 0x1000, PERM_READ | PERM_WRITE | PERM_EXEC));
+
+    for (size_t p = 0; p <= PRODUCER_COUNT; p++) {
+        for (uint8_t cond = 0; cond < CONDITION_COUNT; cond++) {
+            uint32_t words[2];
+            size_t count = build_block(words, p, cond);
+            assert(memory_copy_to(memory, block_address(p, cond), words, count * 4));
+        }
+    }
+
+    JITContext* jit = jit_create(memory, regs);
+    assert(jit_set_worker_count(jit, 0));
+    jit_set_tier_threshold(jit, 0);
+
+    for (size_t p = 0; p <= PRODUCER_COUNT; p++) {
+        for (uint8_t cond = 0; cond < CONDITION_COUNT; cond++) {
+            uint64_t address = block_address(p, cond);
+            JITBlock* block = jit_compile_block(jit, address);
+            assert(block != NULL && block->code != NULL);
+
+            for (size_t i = 0; i < VALUE_COUNT; i++) {
+                /* Incoming flags vary too, for the blocks that read them */
+                registers_reset(regs);
+                regs->x[0] = values[i];
+                regs->x[ARM64_REG_NZCV] = (uint64_t)(i & 0xF) << 28;
+                *expected = *regs;
+
+                uint64_t expected_pc;
+                interpret(expected, memory, block, &expected_pc);
+                assert(jit_execute_block(jit, block));
+
+                uint64_t pc = 0;
+                assert(registers_get_pc(regs, &pc) == REG_SUCCESS);
+                assert(pc == expected_pc);
+                assert(regs->x[2] == expected->x[2]);
+                assert(regs->x[ARM64_REG_NZCV] == expected->x[ARM64_REG_NZCV]);
+            }
+        }
+    }
+
+    jit_destroy(jit);
+    registers_destroy(regs);
+    registers_destroy(expected);
+    memory_destroy(memory);
+}
+
+static void test_countdown_loop() {
+    RegisterFile* regs = registers_create();
+    Memory* memory = memory_create();
+    assert(memory_map(memory, 0x1000, 0x1000, PERM_READ | PERM_WRITE | PERM_EXEC));
+
+    uint32_t code[] = {
+        0xF1000421,     /* 0x1000: subs x1, x1, #1 */
+        0x54FFFFE1,     /* 0x1004: b.ne 0x1000 */
+    };
+    assert(memory_copy_to(memory, 0x1000, code, sizeof(code)));
+
+    JITContext* jit = jit_create(memory, regs);
+    assert(jit_set_worker_count(jit, 0));
+    jit_set_tier_threshold(jit, 0);
+    regs->x[1] = 100;
+
+    JITBlock* block = jit_compile_block(jit, 0x1000);
+    assert(block != NULL && block->code != NULL);
+
+    /* The taken exit links back to the block itself */
+    assert(jit_execute_block(jit, block));
+    uint64_t pc = 0;
+    assert(registers_get_pc(regs, &pc) == REG_SUCCESS && pc == 0x1008);
+    assert(regs->x[1] == 0);
+    assert(registers_get_flag_z(regs) && registers_get_flag_c(regs));
+    assert(!registers_get_flag_n(regs) && !registers_get_flag_v(regs));
+
+    jit_destroy(jit);
+    registers_destroy(regs);
+    memory_destroy(memory);
+}
+
+static size_t count_compares(LLVMValueRef function) {
+    size_t count = 0;
+    for (LLVMBasicBlockRef bb = LLVMGetFirstBasicBlock(function); bb; bb = LLVMGetNextBasicBlock(bb)) {
+        for (LLVMValueRef inst = LLVMGetFirstInstruction(bb); inst; inst = LLVMGetNextInstruction(inst)) {
+            if (LLVMIsAICmpInst(inst)) count++;
+        }
+    }
+    return count;
+}
+
+static void test_overwritten_flags_are_free() {
+    JITCompiler* compiler = jit_compiler_create(NULL);
+    assert(compiler != NULL);
+    compiler->module = LLVMModuleCreateWithNameInContext("flags", compiler->llvm_context);
+
+    EmitterContext* emitter = emitter_create(compiler);
+    assert(emitter_create_entry_block(emitter) != NULL);
+
+    const uint32_t code[] = {
+        0xF1000421,     /* subs x1, x1, #1 */
+        0xF1000421,     /* subs x1, x1, #1 */
+        0xB1000442,     /* adds x2, x2, #1 */
+        0x14000400,     /* b +0x1000 */
+    };
+    DecoderContext* decoder = decoder_create((const uint8_t*)code, sizeof(code));
+    for (size_t i = 0; i < sizeof(code) / sizeof(code[0]); i++) {
+        Instruction inst;
+        assert(decoder_decode_next(decoder, &inst) == DECODER_SUCCESS);
+        emitter->pc = 0x1000 + i * 4;
+        assert(emitter_emit_instruction(emitter, &inst));
+    }
+    decoder_destroy(decoder);
+    LLVMValueRef function = emitter_finalize_block(emitter);
+    assert(function != NULL);
+
+    /* Only the ADDS flags are built, once, for the exit: N, Z, C and V.
+     * The exit's linked check is a pointer compare.
+     */
+    assert(count_compares(function) == 4 + 1);
+
+    emitter_destroy(emitter);
+    LLVMDisposeModule(compiler->module);
+    compiler->module = NULL;
+    jit_compiler_destroy(compiler);
+}
+
+int main() {
+    printf("Running flag tests...\n");
+
+    test_conditions_match_interpreter();
+    test_countdown_loop();
+    test_overwritten_flags_are_free();
+
+    printf("All flag tests passed!\n");
+    return 0;
+}
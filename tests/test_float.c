@@ -0,0 +1,356 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <fenv.h>
+#include <math.h>
+#include "../include/decoder.h"
+#include "../include/fpu.h"
+#include "jit_test.h"
+
+/* Blocks are compiled once and run under several FPCRs */
+static void execute(JitTest* t, JITBlock* block) {
+    assert(jit_execute_block(t->jit, block));
+    assert(jit_test_pc(t) == JIT_TEST_EXIT);
+}
+
+static void set_double(JitTest* t, unsigned reg, double value) {
+    memset(t->regs->v[reg], 0xAA, 16);
+    memcpy(t->regs->v[reg], &value, 8);
+}
+
+static void set_float(JitTest* t, unsigned reg, float value) {
+    memset(t->regs->v[reg], 0xAA, 16);
+    memcpy(t->regs->v[reg], &value, 4);
+}
+
+static uint64_t double_bits(double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, 8);
+    return bits;
+}
+
+static uint32_t float_bits(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, 4);
+    return bits;
+}
+
+/* The low size bytes of v0 hold expected, and the rest is clear */
+static void check_result(JitTest* t, const void* expected, unsigned size) {
+    static const uint8_t zero[16];
+    assert(memcmp(t->regs->v[0], expected, size) == 0);
+    assert(memcmp(t->regs->v[0] + size, zero, 16 - size) == 0);
+}
+
+static void check_double(JitTest* t, double expected) {
+    uint64_t bits = double_bits(expected);
+    if (isnan(expected)) {
+        double actual;
+        memcpy(&actual, t->regs->v[0], 8);
+        assert(isnan(actual));
+        memcpy(&bits, t->regs->v[0], 8);
+    }
+    check_result(t, &bits, 8);
+}
+
+static void check_float(JitTest* t, float expected) {
+    uint32_t bits = float_bits(expected);
+    if (isnan(expected)) {
+        float actual;
+        memcpy(&actual, t->regs->v[0], 4);
+        assert(isnan(actual));
+        memcpy(&bits, t->regs->v[0], 4);
+    }
+    check_result(t, &bits, 4);
+}
+
+/* op d0/s0, 1, 2 (and 3 for the three-source forms) */
+static uint32_t two_source(unsigned ftype, unsigned opcode) {
+    return 0x1E200800 | (ftype << 22) | (2 << 16) | (opcode << 12) | (1 << 5);
+}
+
+static uint32_t three_source(unsigned ftype, unsigned o1, unsigned o0) {
+    return 0x1F000000 | (ftype << 22) | (o1 << 21) | (2 << 16) | (o0 << 15) | (3 << 10) | (1 << 5);
+}
+
+static uint32_t one_source(unsigned ftype, unsigned opcode) {
+    return 0x1E204000 | (ftype << 22) | (opcode << 15) | (1 << 5);
+}
+
+static const double operands[] = {
+    0.0, -0.0, 1.0, -1.5, 3.0, 0.1, 1e300, -1e-300, 4.9e-324, 1e-40, INFINITY, -INFINITY, NAN,
+};
+
+#define OPERAND_COUNT (sizeof(operands) / sizeof(operands[0]))
+
+enum { FMUL, FDIV, FADD, FSUB };
+
+static double double_reference(int op, double a, double b) {
+    switch (op) {
+        case FMUL: return a * b;
+        case FDIV: return a / b;
+        case FADD: return a + b;
+        default: return a - b;
+    }
+}
+
+static float float_reference(int op, float a, float b) {
+    switch (op) {
+        case FMUL: return a * b;
+        case FDIV: return a / b;
+        case FADD: return a + b;
+        default: return a - b;
+    }
+}
+
+static void test_arithmetic(JitTest* t) {
+    for (int op = FMUL; op <= FSUB; op++) {
+        JITBlock* doubles = jit_test_compile_next(t, (uint32_t[]){ two_source(1, op) }, 1);
+        JITBlock* floats = jit_test_compile_next(t, (uint32_t[]){ two_source(0, op) }, 1);
+        for (size_t i = 0; i < OPERAND_COUNT; i++) {
+            for (size_t j = 0; j < OPERAND_COUNT; j++) {
+                set_double(t, 1, operands[i]);
+                set_double(t, 2, operands[j]);
+                execute(t, doubles);
+                check_double(t, double_reference(op, operands[i], operands[j]));
+
+                set_float(t, 1, (float)operands[i]);
+                set_float(t, 2, (float)operands[j]);
+                execute(t, floats);
+                check_float(t, float_reference(op, (float)operands[i], (float)operands[j]));
+            }
+        }
+    }
+
+    /* The fast path leaves FPSR alone */
+    assert(t->regs->fpsr == 0);
+}
+
+static void test_fused_and_unary(JitTest* t) {
+    JITBlock* fused[4];
+    for (unsigned form = 0; form < 4; form++) {
+        fused[form] = jit_test_compile_next(t, (uint32_t[]){ three_source(1, form >> 1, form & 1) }, 1);
+    }
+    for (size_t i = 0; i < OPERAND_COUNT; i++) {
+        double n = operands[i], m = 3.0, a = 0.1;
+        set_double(t, 1, n);
+        set_double(t, 2, m);
+        set_double(t, 3, a);
+        const double expected[4] = { fma(n, m, a), fma(-n, m, a), fma(-n, m, -a), fma(n, m, -a) };
+        for (unsigned form = 0; form < 4; form++) {
+            execute(t, fused[form]);
+            check_double(t, expected[form]);
+        }
+    }
+
+    JITBlock* fmov = jit_test_compile_next(t, (uint32_t[]){ one_source(0, 0) }, 1);
+    JITBlock* fabs_block = jit_test_compile_next(t, (uint32_t[]){ one_source(1, 1) }, 1);
+    JITBlock* fneg = jit_test_compile_next(t, (uint32_t[]){ one_source(0, 2) }, 1);
+    JITBlock* fsqrt = jit_test_compile_next(t, (uint32_t[]){ one_source(1, 3) }, 1);
+    JITBlock* widen = jit_test_compile_next(t, (uint32_t[]){ one_source(0, 5) }, 1);
+    JITBlock* narrow = jit_test_compile_next(t, (uint32_t[]){ one_source(1, 4) }, 1);
+    for (size_t i = 0; i < OPERAND_COUNT; i++) {
+        double value = operands[i];
+        set_float(t, 1, (float)value);
+        execute(t, fmov);
+        check_float(t, (float)value);
+        execute(t, fneg);
+        check_float(t, -(float)value);
+        execute(t, widen);
+        check_double(t, (double)(float)value);
+
+        set_double(t, 1, value);
+        execute(t, fabs_block);
+        check_double(t, fabs(value));
+        execute(t, fsqrt);
+        check_double(t, sqrt(value));
+        execute(t, narrow);
+        check_float(t, (float)value);
+    }
+}
+
+static void test_compare(JitTest* t) {
+    /* fcmp d1, d2; fcmp s1, #0.0 */
+    JITBlock* doubles = jit_test_compile_next(t, (uint32_t[]){ 0x1E622020 }, 1);
+    JITBlock* zero = jit_test_compile_next(t, (uint32_t[]){ 0x1E202028 }, 1);
+    for (size_t i = 0; i < OPERAND_COUNT; i++) {
+        for (size_t j = 0; j < OPERAND_COUNT; j++) {
+            double a = operands[i], b = operands[j];
+            uint64_t expected = isunordered(a, b) ? 0x3 : a == b ? 0x6 : a < b ? 0x8 : 0x2;
+            set_double(t, 1, a);
+            set_double(t, 2, b);
+            execute(t, doubles);
+            assert(t->regs->x[ARM64_REG_NZCV] == expected << 28);
+        }
+
+        float a = (float)operands[i];
+        uint64_t expected = isnan(a) ? 0x3 : a == 0.0f ? 0x6 : a < 0.0f ? 0x8 : 0x2;
+        set_float(t, 1, a);
+        execute(t, zero);
+        assert(t->regs->x[ARM64_REG_NZCV] == expected << 28);
+    }
+
+    /* fcmp d1, d2; b.mi +8: the flags feed the branch inside the block */
+    uint64_t address = t->next_block;
+    JITBlock* branch = jit_test_compile_next(t, (uint32_t[]){ 0x1E622020, 0x54000044 }, 2);
+    uint64_t pc = 0;
+    set_double(t, 1, -1.0);
+    set_double(t, 2, 2.0);
+    assert(jit_execute_block(t->jit, branch));
+    assert(registers_get_pc(t->regs, &pc) == REG_SUCCESS && pc == address + 12);
+    set_double(t, 1, NAN);
+    assert(jit_execute_block(t->jit, branch));
+    assert(registers_get_pc(t->regs, &pc) == REG_SUCCESS && pc == address + 8);
+}
+
+/* What the exact path should produce, computed by the host in mode */
+static double rounded_divide(int mode, double a, double b) {
+    volatile double x = a, y = b, result;
+    fesetround(mode);
+    result = x / y;
+    fesetround(FE_TONEAREST);
+    return result;
+}
+
+static float rounded_narrow(int mode, double a) {
+    volatile double x = a;
+    volatile float result;
+    fesetround(mode);
+    result = (float)x;
+    fesetround(FE_TONEAREST);
+    return result;
+}
+
+static void test_rounding_modes(JitTest* t) {
+    static const int modes[] = { FE_TONEAREST, FE_UPWARD, FE_DOWNWARD, FE_TOWARDZERO };
+    JITBlock* divide = jit_test_compile_next(t, (uint32_t[]){ two_source(1, FDIV) }, 1);
+    JITBlock* narrow = jit_test_compile_next(t, (uint32_t[]){ one_source(1, 4) }, 1);
+
+    for (uint32_t rmode = 0; rmode < 4; rmode++) {
+        t->regs->fpcr = rmode << FPCR_RMODE_SHIFT;
+        for (double sign = 1.0; sign >= -1.0; sign -= 2.0) {
+            t->regs->fpsr = 0;
+            set_double(t, 1, sign);
+            set_double(t, 2, 3.0);
+            execute(t, divide);
+            check_double(t, rounded_divide(modes[rmode], sign, 3.0));
+
+            set_double(t, 1, sign / 3.0);
+            execute(t, narrow);
+            check_float(t, rounded_narrow(modes[rmode], sign / 3.0));
+            /* Only the exact path records the inexact results */
+            assert(t->regs->fpsr == (rmode ? FPSR_IXC : 0));
+        }
+    }
+
+    /* Round toward zero visibly differs from round to nearest */
+    t->regs->fpcr = 3U << FPCR_RMODE_SHIFT;
+    set_double(t, 1, 5.0);
+    set_double(t, 2, 3.0);
+    execute(t, divide);
+    double truncated;
+    memcpy(&truncated, t->regs->v[0], 8);
+    assert(truncated < 5.0 / 3.0);
+    t->regs->fpcr = 0;
+}
+
+static void test_flush_to_zero_and_default_nan(JitTest* t) {
+    JITBlock* add = jit_test_compile_next(t, (uint32_t[]){ two_source(1, FADD) }, 1);
+    JITBlock* multiply = jit_test_compile_next(t, (uint32_t[]){ two_source(0, FMUL) }, 1);
+
+    /* Without FZ subnormals are kept */
+    set_double(t, 1, 4.9e-324);
+    set_double(t, 2, 0.0);
+    execute(t, add);
+    check_double(t, 4.9e-324);
+
+    t->regs->fpcr = FPCR_FZ;
+    t->regs->fpsr = 0;
+    execute(t, add);
+    check_double(t, 0.0);
+    assert(t->regs->fpsr & FPSR_IDC);
+
+    set_float(t, 1, -1e-20f);
+    set_float(t, 2, 1e-20f);
+    t->regs->fpsr = 0;
+    execute(t, multiply);
+    check_float(t, -0.0f);
+    assert(t->regs->fpsr == FPSR_UFC);
+
+    /* DN replaces a propagated NaN payload with the default NaN */
+    t->regs->fpcr = FPCR_DN;
+    uint64_t payload = 0x7FF8000000001234ULL;
+    memcpy(t->regs->v[1], &payload, 8);
+    set_double(t, 2, 1.0);
+    execute(t, add);
+    uint64_t bits;
+    memcpy(&bits, t->regs->v[0], 8);
+    assert(bits == 0x7FF8000000000000ULL);
+    t->regs->fpcr = 0;
+}
+
+static void test_general_register_moves(JitTest* t) {
+    /* fmov x0, d1; fmov w2, s3; fmov d4, x5; fmov s6, w7 */
+    JITBlock* block = jit_test_compile_next(t, (uint32_t[]){ 0x9E660020, 0x1E260062, 0x9E6700A4, 0x1E2700E6 }, 4);
+    set_double(t, 1, -2.5);
+    set_float(t, 3, 1.25f);
+    t->regs->x[2] = UINT64_MAX;
+    t->regs->x[5] = 0x400921FB54442D18ULL;
+    t->regs->x[7] = 0xFFFFFFFF3F800000ULL;
+    memset(t->regs->v[4], 0xAA, 16);
+    memset(t->regs->v[6], 0xAA, 16);
+    execute(t, block);
+
+    assert(t->regs->x[0] == double_bits(-2.5));
+    assert(t->regs->x[2] == float_bits(1.25f));
+    uint64_t d4;
+    uint32_t s6;
+    memcpy(&d4, t->regs->v[4], 8);
+    memcpy(&s6, t->regs->v[6], 4);
+    assert(d4 == 0x400921FB54442D18ULL && s6 == 0x3F800000);
+    assert(t->regs->v[4][8] == 0 && t->regs->v[6][4] == 0);
+}
+
+static void test_decode() {
+    const struct { uint32_t word; bool valid; uint8_t opcode; } cases[] = {
+        { 0x1E222820, true, 0x70 },     /* fadd s0, s1, s2 */
+        { 0x1E623820, true, 0x71 },     /* fsub d0, d1, d2 */
+        { 0x1F420C20, true, 0x74 },     /* fmadd d0, d1, d2, d3 */
+        { 0x1E22C020, true, 0x7C },     /* fcvt d0, s1 */
+        { 0x1E622030, true, 0x7D },     /* fcmpe d1, d2 */
+        { 0x9E660020, true, 0x7E },     /* fmov x0, d1 */
+        { 0x1EE22820, false, 0 },       /* fadd h0, h1, h2 */
+        { 0x1E224020, false, 0 },       /* fcvt s0, s1 */
+        { 0x9E260020, false, 0 },       /* fmov x0, s1 */
+        { 0x1E624820, false, 0 },       /* fmax d0, d1, d2 */
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        DecoderContext* decoder = decoder_create((const uint8_t*)&cases[i].word, 4);
+        Instruction inst;
+        DecoderError error = decoder_decode_next(decoder, &inst);
+        assert((error == DECODER_SUCCESS) == cases[i].valid);
+        if (cases[i].valid) {
+            assert(inst.type == INST_FLOAT && inst.opcode == cases[i].opcode);
+        }
+        decoder_destroy(decoder);
+    }
+}
+
+int main() {
+    printf("Running float tests...\n");
+
+    JitTest t;
+    jit_test_setup(&t, NULL, 0, 0);
+    test_arithmetic(&t);
+    test_fused_and_unary(&t);
+    test_compare(&t);
+    test_rounding_modes(&t);
+    test_flush_to_zero_and_default_nan(&t);
+    test_general_register_moves(&t);
+    jit_test_teardown(&t);
+    test_decode();
+
+    printf("All float tests passed!\n");
+    return 0;
+}
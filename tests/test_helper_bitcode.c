@@ -0,0 +1,215 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+#include "../include/jit.h"
+#include "../include/fpu.h"
+#include "../include/memory.h"
+#include "../include/registers.h"
+
+#define CODE 0x1000
+#define DATA 0x2000
+#define UNMAPPED 0x80000
+#define BUILT_HELPERS "build/helpers.bc"
+
+static char helpers_path[] = "/tmp/test_helpers_XXXXXX";
+
+static LLVMValueRef add_function(LLVMModuleRef module, const char* name, LLVMTypeRef result,
+                                 LLVMTypeRef* params, unsigned count) {
+    LLVMValueRef func = LLVMAddFunction(module, name, LLVMFunctionType(result, params, count, false));
+    LLVMAppendBasicBlockInContext(LLVMGetModuleContext(module), func, "entry");
+    return func;
+}
+
+/* Stands in for `make helpers`. The functions take struct pointers and
+ * return bool as i1, as clang emits them, and give away that they ran:
+ * the exact FP path answers 42 through a private function, and every
+ * slow-path load "succeeds" with 7.
+ */
+static void write_helpers(void) {
+    LLVMContextRef context = LLVMContextCreate();
+    LLVMModuleRef module = LLVMModuleCreateWithNameInContext("helpers", context);
+    LLVMBuilderRef builder = LLVMCreateBuilderInContext(context);
+    LLVMTypeRef f64 = LLVMDoubleTypeInContext(context);
+    LLVMTypeRef i64 = LLVMInt64TypeInContext(context);
+    LLVMTypeRef regs = LLVMPointerType(LLVMStructCreateNamed(context, "struct.RegisterFile"), 0);
+    LLVMTypeRef memory = LLVMPointerType(LLVMStructCreateNamed(context, "struct.Memory"), 0);
+
+    LLVMValueRef answer = add_function(module, "answer", f64, NULL, 0);
+    LLVMSetLinkage(answer, LLVMInternalLinkage);
+    LLVMPositionBuilderAtEnd(builder, LLVMGetEntryBasicBlock(answer));
+    LLVMBuildRet(builder, LLVMConstReal(f64, 40.0));
+
+    LLVMTypeRef fp_params[] = { regs, i64, f64, f64, f64 };
+    LLVMValueRef exact = add_function(module, "fpu_exact_double", f64, fp_params, 5);
+    unsigned no_inline = LLVMGetEnumAttributeKindForName("noinline", strlen("noinline"));
+    LLVMAddAttributeAtIndex(exact, LLVMAttributeFunctionIndex, LLVMCreateEnumAttribute(context, no_inline, 0));
+    LLVMPositionBuilderAtEnd(builder, LLVMGetEntryBasicBlock(exact));
+    LLVMValueRef forty = LLVMBuildCall2(builder, LLVMGlobalGetValueType(answer), answer, NULL, 0, "");
+    LLVMBuildRet(builder, LLVMBuildFAdd(builder, forty, LLVMConstReal(f64, 2.0), ""));
+
+    LLVMTypeRef load_params[] = { memory, i64, i64, LLVMPointerType(i64, 0) };
+    LLVMValueRef load = add_function(module, "memory_load_slow", LLVMInt1TypeInContext(context), load_params, 4);
+    LLVMPositionBuilderAtEnd(builder, LLVMGetEntryBasicBlock(load));
+    LLVMBuildStore(builder, LLVMConstInt(i64, 7, false), LLVMGetParam(load, 3));
+    LLVMBuildRet(builder, LLVMConstInt(LLVMInt1TypeInContext(context), 1, false));
+
+    int fd = mkstemp(helpers_path);
+    assert(fd >= 0);
+    close(fd);
+    assert(LLVMWriteBitcodeToFile(module, helpers_path) == 0);
+
+    LLVMDisposeBuilder(builder);
+    LLVMDisposeModule(module);
+    LLVMContextDispose(context);
+}
+
+static void test_helpers_replace_runtime_symbols() {
+    RegisterFile* regs = registers_create();
+    Memory* memory = memory_create();
+    assert(memory_map(memory, CODE, 0x1000, PERM_READ | PERM_WRITE | PERM_EXEC));
+
+    const uint32_t code[] = {
+        0x1E622820,     /* 0x1000: fadd d0, d1, d2 */
+        0xF9400023,     /* 0x1004: ldr x3, [x1] */
+        0x14000002,     /* 0x1008: b +8 */
+    };
+    assert(memory_copy_to(memory, CODE, code, sizeof(code)));
+
+    JITContext* jit = jit_create(memory, regs);
+    assert(jit_set_worker_count(jit, 0));
+    jit_set_tier_threshold(jit, 0);
+    assert(jit_set_helper_bitcode(jit, helpers_path));
+
+    double one = 1.0, two = 2.0;
+    memcpy(regs->v[1], &one, 8);
+    memcpy(regs->v[2], &two, 8);
+    regs->x[1] = UNMAPPED;
+    regs->fpcr = 3U << FPCR_RMODE_SHIFT;
+
+    JITBlock* block = jit_compile_block(jit, CODE);
+    assert(block != NULL && block->code != NULL);
+    assert(jit_execute_block(jit, block));
+
+    double result;
+    memcpy(&result, regs->v[0], 8);
+    assert(result == 42.0);
+    assert(regs->x[3] == 7);
+
+    /* The fast path does not involve the helper */
+    regs->fpcr = 0;
+    assert(jit_execute_block(jit, block));
+    memcpy(&result, regs->v[0], 8);
+    assert(result == 3.0);
+
+    /* Too late once blocks have been compiled */
+    assert(!jit_set_helper_bitcode(jit, helpers_path));
+
+    jit_destroy(jit);
+    registers_destroy(regs);
+    memory_destroy(memory);
+}
+
+/* The output of `make helpers`, compiled by clang from the runtime itself,
+ * must behave exactly like the runtime it replaces
+ */
+static void test_built_helpers() {
+    if (access(BUILT_HELPERS, R_OK) != 0) {
+        printf("  %s not built (make helpers needs clang), skipped\n", BUILT_HELPERS);
+        return;
+    }
+    RegisterFile* regs = registers_create();
+    Memory* memory = memory_create();
+    assert(memory_map(memory, CODE, 0x1000, PERM_READ | PERM_WRITE | PERM_EXEC));
+    assert(memory_map(memory, DATA, 0x1000, PERM_READ | PERM_WRITE));
+
+    const uint32_t code[] = {
+        0x1E622820,     /* 0x1000: fadd d0, d1, d2 */
+        0xF9400023,     /* 0x1004: ldr x3, [x1] */
+        0xF9000043,     /* 0x1008: str x3, [x2] */
+        0x14000002,     /* 0x100c: b +8 */
+    };
+    uint64_t value = 0x0123456789ABCDEFULL;
+    assert(memory_copy_to(memory, CODE, code, sizeof(code)));
+    assert(memory_copy_to(memory, DATA, &value, sizeof(value)));
+
+    JITContext* jit = jit_create(memory, regs);
+    assert(jit_set_worker_count(jit, 0));
+    jit_set_tier_threshold(jit, 0);
+    assert(jit_set_helper_bitcode(jit, BUILT_HELPERS));
+
+    /* Three quarters of an ulp: round to nearest gives 1 + ulp, towards zero 1 */
+    double one = 1.0, small = 0x3p-54;
+    memcpy(regs->v[1], &one, 8);
+    memcpy(regs->v[2], &small, 8);
+    regs->fpcr = 3U << FPCR_RMODE_SHIFT;
+    regs->x[1] = DATA;
+    regs->x[2] = DATA + 8;
+
+    /* First touches miss the TLB, so both accesses take the slow paths */
+    JITBlock* block = jit_compile_block(jit, CODE);
+    assert(block != NULL && block->code != NULL);
+    assert(jit_execute_block(jit, block));
+
+    double result;
+    memcpy(&result, regs->v[0], 8);
+    assert(result == 1.0);
+    assert(regs->x[3] == value);
+    uint64_t stored = 0;
+    assert(memory_read64(memory, DATA + 8, &stored) && stored == value);
+
+    regs->x[1] = UNMAPPED;
+    assert(!jit_execute_block(jit, block));
+
+    jit_destroy(jit);
+    registers_destroy(regs);
+    memory_destroy(memory);
+}
+
+static void test_without_helpers() {
+    RegisterFile* regs = registers_create();
+    Memory* memory = memory_create();
+    assert(memory_map(memory, CODE, 0x1000, PERM_READ | PERM_WRITE | PERM_EXEC));
+    const uint32_t code[] = {
+        0xF9400023,     /* 0x1000: ldr x3, [x1] */
+        0x14000002,     /* 0x1004: b +8 */
+    };
+    assert(memory_copy_to(memory, CODE, code, sizeof(code)));
+
+    JITContext* jit = jit_create(memory, regs);
+    assert(jit_set_worker_count(jit, 0));
+    jit_set_tier_threshold(jit, 0);
+
+    /* Neither a missing file nor something that is not bitcode is accepted */
+    assert(!jit_set_helper_bitcode(jit, "/nonexistent/helpers.bc"));
+    char bogus_path[] = "/tmp/test_helpers_XXXXXX";
+    int fd = mkstemp(bogus_path);
+    assert(fd >= 0 && write(fd, "not bitcode", 11) == 11);
+    close(fd);
+    assert(!jit_set_helper_bitcode(jit, bogus_path));
+    unlink(bogus_path);
+
+    /* The runtime's own slow path faults on the unmapped address */
+    regs->x[1] = UNMAPPED;
+    JITBlock* block = jit_compile_block(jit, CODE);
+    assert(block != NULL && block->code != NULL);
+    assert(!jit_execute_block(jit, block));
+
+    jit_destroy(jit);
+    registers_destroy(regs);
+    memory_destroy(memory);
+}
+
+int main() {
+    printf("Running helper bitcode tests...\n");
+
+    write_helpers();
+    test_helpers_replace_runtime_symbols();
+    test_built_helpers();
+    test_without_helpers();
+    unlink(helpers_path);
+
+    printf("All helper bitcode tests passed!\n");
+    return 0;
+}
@@ -0,0 +1,177 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include "../include/jit.h"
+#include "../include/decoder.h"
+#include "../include/interpreter.h"
+#include "../include/memory.h"
+#include "../include/registers.h"
+
+static DecoderError decode_word(uint32_t raw, Instruction* inst) {
+    DecoderContext* decoder = decoder_create((const uint8_t*)&raw, sizeof(raw));
+    assert(decoder != NULL);
+    DecoderError error = decoder_decode_next(decoder, inst);
+    decoder_destroy(decoder);
+    return error;
+}
+
+static void test_decode() {
+    Instruction inst;
+
+    assert(decode_word(0xD61F0020, &inst) == DECODER_SUCCESS);   /* br x1 */
+    assert(inst.type == INST_BRANCH && inst.opcode == 0x23);
+    assert(instruction_get_operand_type(&inst, 0) == OP_REGISTER && instruction_get_register(&inst, 0) == 1);
+    assert(instruction_is_indirect_branch(&inst));
+    assert(!instruction_modifies_register(&inst, 30));
+
+    assert(decode_word(0xD63F0040, &inst) == DECODER_SUCCESS);   /* blr x2 */
+    assert(inst.opcode == 0x26 && instruction_get_register(&inst, 0) == 2);
+    assert(instruction_modifies_register(&inst, 30));
+
+    assert(decode_word(0xD65F03C0, &inst) == DECODER_SUCCESS);   /* ret */
+    assert(inst.opcode == 0x24 && instruction_get_register(&inst, 0) == 30);
+
+    /* Direct branches keep their immediate targets */
+    assert(decode_word(0x94000004, &inst) == DECODER_SUCCESS);   /* bl +16 */
+    assert(!instruction_is_indirect_branch(&inst));
+
+    /* Pointer-authenticated returns are not plain RET */
+    assert(decode_word(0xD65F0BFF, &inst) != DECODER_SUCCESS || inst.opcode != 0x24);
+}
+
+static void test_interpreter() {
+    RegisterFile* regs = registers_create();
+    Memory* memory = memory_create();
+    Instruction inst;
+    uint64_t next_pc;
+
+    regs->x[2] = 0x3000;
+    assert(decode_word(0xD63F0040, &inst) == DECODER_SUCCESS);   /* blr x2 */
+    assert(interpreter_can_execute(&inst));
+    assert(interpreter_execute(regs, memory, &inst, 0x1000, &next_pc) == INTERP_SUCCESS);
+    assert(next_pc == 0x3000 && regs->x[30] == 0x1004);
+
+    /* blr x30 branches to the old link value */
+    regs->x[30] = 0x4000;
+    assert(decode_word(0xD63F03C0, &inst) == DECODER_SUCCESS);
+    assert(interpreter_execute(regs, memory, &inst, 0x2000, &next_pc) == INTERP_SUCCESS);
+    assert(next_pc == 0x4000 && regs->x[30] == 0x2004);
+
+    assert(decode_word(0xD65F03C0, &inst) == DECODER_SUCCESS);   /* ret */
+    assert(interpreter_execute(regs, memory, &inst, 0x4000, &next_pc) == INTERP_SUCCESS);
+    assert(next_pc == 0x2004);
+
+    regs->x[1] = 0x8000;
+    assert(decode_word(0xD61F0020, &inst) == DECODER_SUCCESS);   /* br x1 */
+    assert(interpreter_execute(regs, memory, &inst, 0x2004, &next_pc) == INTERP_SUCCESS);
+    assert(next_pc == 0x8000 && regs->x[30] == 0x2004);
+
+    registers_destroy(regs);
+    memory_destroy(memory);
+}
+
+static void map_word(Memory* memory, uint64_t address, uint32_t raw) {
+    assert(memory_copy_to(memory, address, &raw, sizeof(raw)));
+}
+
+/* Runs from pc until the guest reaches end; returns the number of dispatches */
+static size_t run_until(JITContext* jit, RegisterFile* regs, uint64_t pc, uint64_t end) {
+    size_t dispatches = 0;
+    while (pc != end) {
+        JITBlock* block = jit_get_cached_block(jit, pc);
+        if (!block) {
+            block = jit_compile_block(jit, pc);
+            assert(block != NULL);
+            block->trace_formed = true;
+        }
+        assert(jit_execute_block(jit, block));
+        assert(registers_get_pc(regs, &pc) == REG_SUCCESS);
+        dispatches++;
+    }
+    return dispatches;
+}
+
+static void test_compiled_call_and_return() {
+    RegisterFile* regs = registers_create();
+    Memory* memory = memory_create();
+    assert(memory_map(memory, 0x1000, 0x6000, PERM_READ | PERM_WRITE | PERM_EXEC));
+
+    map_word(memory, 0x1000, 0x94000400);   /* bl 0x2000 */
+    map_word(memory, 0x1004, 0x14000FFF);   /* b 0x5000 */
+    map_word(memory, 0x2000, 0xD65F03C0);   /* ret */
+    map_word(memory, 0x5000, 0xD61F0020);   /* br x1 */
+    map_word(memory, 0x6000, 0x14000400);   /* b 0x7000 */
+    map_word(memory, 0x6100, 0x140003C0);   /* b 0x7000 */
+
+    JITContext* jit = jit_create(memory, regs);
+    assert(jit_set_worker_count(jit, 0));
+    jit_set_tier_threshold(jit, 1);
+    registers_set_x(regs, 1, 0x6000);
+
+    run_until(jit, regs, 0x1000, 0x7000);
+    run_until(jit, regs, 0x1000, 0x7000);
+
+    /* Once everything is compiled, the call, the return and the jump all
+     * chain without going back to the dispatcher.
+     */
+    assert(run_until(jit, regs, 0x1000, 0x7000) == 1);
+    uint64_t link = 0;
+    assert(registers_get_x(regs, 30, &link) == REG_SUCCESS && link == 0x1004);
+
+    JITBlock* caller = jit_get_cached_block(jit, 0x1000);
+    JITBlock* callee = jit_get_cached_block(jit, 0x2000);
+    JITBlock* jump = jit_get_cached_block(jit, 0x5000);
+    assert(caller->code && callee->code && jump->code);
+
+    /* BL pushed its return site and RET popped it again */
+    assert(caller->exit_count == 2 && caller->exits[0].target_pc == 0x1004);
+    assert(callee->exit_count == 1 && callee->exits[0].indirect);
+    uint64_t top = jit->return_stack.top;
+    const ReturnStackEntry* entry = &jit->return_stack.entries[top % RETURN_STACK_SIZE];
+    assert(entry->pc == 0x1004 && entry->exit == &caller->exits[0]);
+    assert(run_until(jit, regs, 0x1000, 0x7000) == 1);
+    assert(jit->return_stack.top == top);
+
+    /* BR filled its inline cache with the one target it has seen */
+    BlockExit* site = &jump->exits[0];
+    assert(site->indirect && site->target_pc == 0x6000);
+    assert(site->target == jit_get_cached_block(jit, 0x6000));
+
+    IndirectBranchStats before, after;
+    jit_get_indirect_stats(jit, &before);
+    assert(run_until(jit, regs, 0x1000, 0x7000) == 1);
+    jit_get_indirect_stats(jit, &after);
+    assert(after.resolves == before.resolves);
+
+    /* A new target misses and moves the cache */
+    registers_set_x(regs, 1, 0x6100);
+    run_until(jit, regs, 0x1000, 0x7000);
+    run_until(jit, regs, 0x1000, 0x7000);
+    assert(site->target_pc == 0x6100);
+    assert(site->target == jit_get_cached_block(jit, 0x6100));
+    jit_get_indirect_stats(jit, &after);
+    assert(after.retargets == before.retargets + 1);
+    assert(run_until(jit, regs, 0x1000, 0x7000) == 1);
+
+    /* Dropping the target unlinks the site but keeps what it predicts */
+    jit_invalidate_cache(jit, 0x6100);
+    assert(site->target == NULL && site->target_pc == 0x6100);
+    run_until(jit, regs, 0x1000, 0x7000);
+    run_until(jit, regs, 0x1000, 0x7000);
+    assert(site->target == jit_get_cached_block(jit, 0x6100));
+
+    jit_destroy(jit);
+    registers_destroy(regs);
+    memory_destroy(memory);
+}
+
+int main() {
+    printf("Running indirect branch tests...\n");
+
+    test_decode();
+    test_interpreter();
+    test_compiled_call_and_return();
+
+    printf("All indirect branch tests passed!\n");
+    return 0;
+}
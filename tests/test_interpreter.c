@@ -0,0 +1,183 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include "../include/interpreter.h"
+#include "../include/decoder.h"
+#include "../include/memory.h"
+#include "../include/registers.h"
+
+static Instruction decode_word(uint32_t raw) {
+    Instruction inst;
+    DecoderContext* decoder = decoder_create((const uint8_t*)&raw, sizeof(raw));
+    assert(decoder != NULL);
+    assert(decoder_decode_next(decoder, &inst) == DECODER_SUCCESS);
+    decoder_destroy(decoder);
+    return inst;
+}
+
+static void run(RegisterFile* regs, Memory* memory, uint32_t raw, uint64_t pc, uint64_t* next_pc) {
+    Instruction inst = decode_word(raw);
+    assert(interpreter_can_execute(&inst));
+    assert(interpreter_execute(regs, memory, &inst, pc, next_pc) == INTERP_SUCCESS);
+}
+
+static void test_arithmetic() {
+    RegisterFile* regs = registers_create();
+    Memory* memory = memory_create();
+    uint64_t next_pc;
+
+    regs->x[1] = 40;
+    run(regs, memory, 0x91000820, 0x1000, &next_pc);   /* add x0, x1, #2 */
+    assert(regs->x[0] == 42);
+    assert(next_pc == 0x1004);
+
+    run(regs, memory, 0xD1400420, 0x1000, &next_pc);   /* sub x0, x1, #1, lsl #12 */
+    assert(regs->x[0] == (uint64_t)40 - 4096);
+
+    regs->x[ARM64_REG_SP] = 0x8000;
+    run(regs, memory, 0x910043FF, 0x1000, &next_pc);   /* add sp, sp, #16 */
+    assert(regs->x[ARM64_REG_SP] == 0x8010);
+
+    regs->x[2] = 0xFFFFFFFF;
+    run(regs, memory, 0x11000443, 0x1000, &next_pc);   /* add w3, w2, #1 */
+    assert(regs->x[3] == 0);
+
+    registers_destroy(regs);
+    memory_destroy(memory);
+}
+
+static void test_flags() {
+    RegisterFile* regs = registers_create();
+    Memory* memory = memory_create();
+    uint64_t next_pc;
+
+    regs->x[0] = 5;
+    run(regs, memory, 0xF100141F, 0x1000, &next_pc);   /* cmp x0, #5 */
+    assert(registers_get_flag_z(regs));
+    assert(registers_get_flag_c(regs));
+    assert(!registers_get_flag_n(regs));
+    assert(!registers_get_flag_v(regs));
+    assert(regs->x[ARM64_REG_SP] == 0);
+
+    run(regs, memory, 0xF100181F, 0x1000, &next_pc);   /* cmp x0, #6 */
+    assert(!registers_get_flag_z(regs));
+    assert(!registers_get_flag_c(regs));
+    assert(registers_get_flag_n(regs));
+
+    regs->x[0] = 0x7FFFFFFFFFFFFFFFULL;
+    run(regs, memory, 0xB100041F, 0x1000, &next_pc);   /* cmn x0, #1 */
+    assert(registers_get_flag_v(regs));
+    assert(registers_get_flag_n(regs));
+
+    assert(!interpreter_condition_holds(regs, 0xB));   /* lt: n == v here */
+    assert(interpreter_condition_holds(regs, 0xA));
+    registers_set_flags(regs, true, false, false, false);
+    assert(interpreter_condition_holds(regs, 0xB));
+    assert(!interpreter_condition_holds(regs, 0xA));
+    assert(interpreter_condition_holds(regs, 0xE));
+
+    registers_destroy(regs);
+    memory_destroy(memory);
+}
+
+static void test_memory() {
+    RegisterFile* regs = registers_create();
+    Memory* memory = memory_create();
+    uint64_t next_pc;
+
+    assert(memory_map(memory, 0x10000, 0x1000, PERM_READ | PERM_WRITE));
+    regs->x[1] = 0x10000;
+    regs->x[2] = 0x1122334455667788ULL;
+
+    run(regs, memory, 0xF9000422, 0x1000, &next_pc);   /* str x2, [x1, #8] */
+    run(regs, memory, 0xF9400423, 0x1000, &next_pc);   /* ldr x3, [x1, #8] */
+    assert(regs->x[3] == 0x1122334455667788ULL);
+
+    run(regs, memory, 0xB9400824, 0x1000, &next_pc);   /* ldr w4, [x1, #8] */
+    assert(regs->x[4] == 0x55667788ULL);
+
+    Instruction inst = decode_word(0xF9400423);
+    regs->x[1] = 0x90000;
+    assert(interpreter_execute(regs, memory, &inst, 0x1000, &next_pc) == INTERP_ERROR_MEMORY_FAULT);
+
+    registers_destroy(regs);
+    memory_destroy(memory);
+}
+
+static void test_branches() {
+    RegisterFile* regs = registers_create();
+    Memory* memory = memory_create();
+    uint64_t next_pc;
+
+    run(regs, memory, 0x14000004, 0x1000, &next_pc);   /* b #16 */
+    assert(next_pc == 0x1010);
+
+    run(regs, memory, 0x97FFFFFF, 0x1000, &next_pc);   /* bl #-4 */
+    assert(next_pc == 0x0FFC);
+    assert(regs->x[30] == 0x1004);
+
+    registers_set_flags(regs, false, true, false, false);
+    run(regs, memory, 0x54000080, 0x1000, &next_pc);   /* b.eq #16 */
+    assert(next_pc == 0x1010);
+    run(regs, memory, 0x54000081, 0x1000, &next_pc);   /* b.ne #16 */
+    assert(next_pc == 0x1004);
+
+    registers_destroy(regs);
+    memory_destroy(memory);
+}
+
+static void test_block_execution() {
+    RegisterFile* regs = registers_create();
+    Memory* memory = memory_create();
+    uint64_t next_pc;
+
+    Instruction insts[3] = {
+        decode_word(0x91000400),   /* add x0, x0, #1 */
+        decode_word(0xF101901F),   /* cmp x0, #100 */
+        decode_word(0x54FFFFC1)    /* b.ne #-8 */
+    };
+
+    uint64_t iterations = 0;
+    do {
+        assert(interpreter_execute_block(regs, memory, insts, 3, 0x1000, &next_pc) == INTERP_SUCCESS);
+        iterations++;
+    } while (next_pc == 0x1000);
+
+    assert(iterations == 100);
+    assert(regs->x[0] == 100);
+    assert(next_pc == 0x100C);
+
+    registers_destroy(regs);
+    memory_destroy(memory);
+}
+
+static void test_unsupported() {
+    RegisterFile* regs = registers_create();
+    Memory* memory = memory_create();
+    uint64_t next_pc;
+
+    Instruction inst;
+    instruction_init(&inst);
+    inst.type = INST_SYSTEM;
+    assert(!interpreter_can_execute(&inst));
+    assert(interpreter_execute(regs, memory, &inst, 0x1000, &next_pc) == INTERP_ERROR_UNSUPPORTED);
+    assert(interpreter_execute(NULL, memory, &inst, 0x1000, &next_pc) == INTERP_ERROR_NULL_PARAM);
+
+    registers_destroy(regs);
+    memory_destroy(memory);
+}
+
+int main() {
+    printf("Running interpreter tests...\n");
+
+    test_arithmetic();
+    test_flags();
+    test_memory();
+    test_branches();
+    test_block_execution();
+    test_unsupported();
+
+    printf("All interpreter tests passed!\n");
+    return 0;
+}
@@ -0,0 +1,186 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include "../include/liveness.h"
+#include "../include/emitter.h"
+#include "../include/jit.h"
+#include "../include/decoder.h"
+#include "../include/interpreter.h"
+#include "../include/memory.h"
+#include "../include/registers.h"
+
+static size_t decode_words(const uint32_t* words, size_t count, Instruction* insts) {
+    DecoderContext* decoder = decoder_create((const uint8_t*)words, count * 4);
+    assert(decoder != NULL);
+    for (size_t i = 0; i < count; i++) {
+        assert(decoder_decode_next(decoder, &insts[i]) == DECODER_SUCCESS);
+    }
+    decoder_destroy(decoder);
+    return count;
+}
+
+static void test_dead_results() {
+    const uint32_t code[] = {
+        0x91000420,     /* add x0, x1, #1   overwritten below */
+        0xF1000422,     /* subs x2, x1, #1  x2 reaches the exit, NZCV does not */
+        0x91000820,     /* add x0, x1, #2 */
+        0xF1000403,     /* subs x3, x0, #1 */
+        0x54000041,     /* b.ne +8 */
+    };
+    Instruction insts[5];
+    InstructionLiveness live[5];
+    liveness_analyze(insts, decode_words(code, 5, insts), live);
+
+    assert(live[0].dead_result && !live[0].dead_flags);
+    assert(!live[1].dead_result && live[1].dead_flags);
+    assert(!live[2].dead_result);
+    assert(!live[3].dead_result && !live[3].dead_flags);
+}
+
+static void test_register_31_and_stores() {
+    const uint32_t code[] = {
+        0x910043FF,     /* add sp, sp, #16 */
+        0xF100041F,     /* cmp x0, #1       writes XZR, not SP */
+        0x91000421,     /* add x1, x1, #1 */
+        0xF9000001,     /* str x1, [x0]     reads x1 */
+        0x91000041,     /* add x1, x2, #0 */
+        0x14000002,     /* b +8 */
+    };
+    Instruction insts[6];
+    InstructionLiveness live[6];
+    liveness_analyze(insts, decode_words(code, 6, insts), live);
+
+    assert(!live[0].dead_result);
+    assert(live[1].dead_result && !live[1].dead_flags);
+    assert(!live[2].dead_result);
+    assert(!live[4].dead_result);
+}
+
+static void test_side_exits_keep_state() {
+    /* A superblock body: the B.cond may leave, so x0 must be stored there */
+    const uint32_t code[] = {
+        0x91000420,     /* add x0, x1, #1 */
+        0xF100043F,     /* cmp x1, #1 */
+        0x54000041,     /* b.ne +8 */
+        0x91000820,     /* add x0, x1, #2 */
+        0x14000002,     /* b +8 */
+    };
+    Instruction insts[5];
+    InstructionLiveness live[5];
+    liveness_analyze(insts, decode_words(code, 5, insts), live);
+
+    assert(!live[0].dead_result);
+    assert(!live[1].dead_flags);
+}
+
+static size_t count_adds(LLVMValueRef function) {
+    size_t count = 0;
+    for (LLVMBasicBlockRef bb = LLVMGetFirstBasicBlock(function); bb; bb = LLVMGetNextBasicBlock(bb)) {
+        for (LLVMValueRef inst = LLVMGetFirstInstruction(bb); inst; inst = LLVMGetNextInstruction(inst)) {
+            if (LLVMGetInstructionOpcode(inst) == LLVMAdd) count++;
+        }
+    }
+    return count;
+}
+
+static void test_live_in() {
+    const uint32_t code[] = {
+        0x91000400,     /* add x0, x0, #1 */
+        0xF1000421,     /* subs x1, x1, #1  NZCV is set before anything reads it */
+        0x91000062,     /* add x2, x3, #0   x2 is written before anything reads it */
+        0x54FFFFA1,     /* b.ne -12 */
+    };
+    Instruction insts[4];
+    uint64_t live = liveness_live_in(insts, decode_words(code, 4, insts));
+
+    assert(live & (1ULL << 0) && live & (1ULL << 1) && live & (1ULL << 3));
+    assert(live & (1ULL << 4));
+    assert(!(live & (1ULL << 2)));
+    assert(!(live & (1ULL << ARM64_REG_NZCV)));
+
+    /* Everything is live before an access that may fault */
+    const uint32_t load_first[] = {
+        0xF9400023,     /* ldr x3, [x1] */
+        0xF1000421,     /* subs x1, x1, #1 */
+        0x54FFFFC1,     /* b.ne -8 */
+    };
+    live = liveness_live_in(insts, decode_words(load_first, 3, insts));
+    assert(live & (1ULL << 3));
+    assert(live & (1ULL << ARM64_REG_NZCV));
+}
+
+static void test_dead_code_not_emitted() {
+    RegisterFile* regs = registers_create();
+    RegisterFile* expected = registers_create();
+    Memory* memory = memory_create();
+    assert(memory_map(memory, 0x1000, 0x1000, PERM_READ | PERM_WRITE | PERM_EXEC));
+
+    const uint32_t code[] = {
+        0x91000420,     /* 0x1000: add x0, x1, #1 */
+        0xB1000420,     /* 0x1004: adds x0, x1, #1 */
+        0x91000820,     /* 0x1008: add x0, x1, #2 */
+        0x14000002,     /* 0x100c: b 0x1014 */
+    };
+    assert(memory_copy_to(memory, 0x1000, code, sizeof(code)));
+
+    JITCompiler* compiler = jit_compiler_create(NULL);
+    compiler->module = LLVMModuleCreateWithNameInContext("liveness", compiler->llvm_context);
+    EmitterContext* emitter = emitter_create(compiler);
+    assert(emitter_create_entry_block(emitter) != NULL);
+
+    Instruction insts[4];
+    InstructionLiveness live[4];
+    liveness_analyze(insts, decode_words(code, 4, insts), live);
+    for (size_t i = 0; i < 4; i++) {
+        emitter->pc = 0x1000 + i * 4;
+        emitter->liveness = live[i];
+        assert(emitter_emit_instruction(emitter, &insts[i]));
+    }
+    LLVMValueRef function = emitter_finalize_block(emitter);
+    assert(function != NULL);
+
+    /* The first add is gone; ADDS is kept only for its flags */
+    assert(count_adds(function) == 2);
+
+    emitter_destroy(emitter);
+    LLVMDisposeModule(compiler->module);
+    compiler->module = NULL;
+    jit_compiler_destroy(compiler);
+
+    /* And the translated block agrees with the interpreter */
+    JITContext* jit = jit_create(memory, regs);
+    assert(jit_set_worker_count(jit, 0));
+    jit_set_tier_threshold(jit, 0);
+    regs->x[1] = UINT64_MAX;
+    *expected = *regs;
+
+    JITBlock* block = jit_compile_block(jit, 0x1000);
+    assert(block != NULL && block->code != NULL);
+    uint64_t expected_pc;
+    assert(interpreter_execute_block(expected, memory, block->instructions, block->instruction_count,
+                                     block->address, &expected_pc) == INTERP_SUCCESS);
+    assert(jit_execute_block(jit, block));
+
+    uint64_t pc = 0;
+    assert(registers_get_pc(regs, &pc) == REG_SUCCESS && pc == expected_pc);
+    assert(regs->x[0] == expected->x[0] && regs->x[0] == 1);
+    assert(regs->x[ARM64_REG_NZCV] == expected->x[ARM64_REG_NZCV]);
+
+    jit_destroy(jit);
+    registers_destroy(regs);
+    registers_destroy(expected);
+    memory_destroy(memory);
+}
+
+int main() {
+    printf("Running liveness tests...\n");
+
+    test_dead_results();
+    test_register_31_and_stores();
+    test_side_exits_keep_state();
+    test_live_in();
+    test_dead_code_not_emitted();
+
+    printf("All liveness tests passed!\n");
+    return 0;
+}
@@ -0,0 +1,135 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "jit_test.h"
+
+#define SRC JIT_TEST_DATA
+#define DST (JIT_TEST_DATA + 0x1000)
+
+static void test_counting_loop() {
+    const uint32_t code[] = {
+        0x910190A5,     /* 0x1000: add x5, x5, #100 */
+        0x91000400,     /* 0x1004: add x0, x0, #1 */
+        0xF1000421,     /* 0x1008: subs x1, x1, #1 */
+        0x54FFFFC1,     /* 0x100c: b.ne 0x1004 */
+    };
+    JitTest t;
+    jit_test_setup(&t, code, 4, 0);
+    JITBlock* block = jit_test_compile(&t);
+
+    /* The back edge stays inside the block; the only exit is the fall-through */
+    assert(block->exit_count == 1);
+    assert(block->exits[0].target_pc == 0x1010);
+
+    t.regs->x[0] = 7;
+    t.regs->x[1] = 1000000;
+    assert(jit_execute_block(t.jit, block));
+    assert(jit_test_pc(&t) == 0x1010);
+    assert(t.regs->x[0] == 1000007);
+    assert(t.regs->x[1] == 0);
+    assert(t.regs->x[5] == 100);
+    assert(t.regs->x[ARM64_REG_NZCV] == 0x60000000);
+
+    jit_test_teardown(&t);
+}
+
+static const uint32_t copy_loop[] = {
+    0xF9400023,     /* 0x1000: ldr x3, [x1] */
+    0xF9000043,     /* 0x1004: str x3, [x2] */
+    0x91002021,     /* 0x1008: add x1, x1, #8 */
+    0x91002042,     /* 0x100c: add x2, x2, #8 */
+    0xF1000484,     /* 0x1010: subs x4, x4, #1 */
+    0x54FFFF61,     /* 0x1014: b.ne 0x1000 */
+};
+
+static void test_copy_loop() {
+    JitTest t;
+    jit_test_setup(&t, copy_loop, 6, 0);
+    JITBlock* block = jit_test_compile(&t);
+
+    uint64_t words[64];
+    for (size_t i = 0; i < 64; i++) words[i] = i * 0x0101010101010101ULL;
+    assert(memory_copy_to(t.memory, SRC, words, sizeof(words)));
+
+    t.regs->x[1] = SRC;
+    t.regs->x[2] = DST;
+    t.regs->x[4] = 64;
+    assert(jit_execute_block(t.jit, block));
+    assert(jit_test_pc(&t) == 0x1018);
+    assert(t.regs->x[1] == SRC + sizeof(words));
+    assert(t.regs->x[2] == DST + sizeof(words));
+    assert(t.regs->x[4] == 0);
+
+    uint64_t copied[64];
+    assert(memory_copy_from(t.memory, DST, copied, sizeof(copied)));
+    assert(memcmp(copied, words, sizeof(words)) == 0);
+
+    jit_test_teardown(&t);
+}
+
+static void test_fault_mid_loop() {
+    JitTest t;
+    jit_test_setup(&t, copy_loop, 6, 0);
+    JITBlock* block = jit_test_compile(&t);
+
+    uint64_t words[8] = { 10, 11, 12, 13, 14, 15, 16, 17 };
+    assert(memory_copy_to(t.memory, SRC, words, sizeof(words)));
+
+    /* The fourth store runs off the end of DST. Its iteration leaves with
+     * the state the previous three built up, NZCV included.
+     */
+    t.regs->x[1] = SRC;
+    t.regs->x[2] = DST + 0x1000 - 3 * 8;
+    t.regs->x[4] = 8;
+    t.regs->x[ARM64_REG_NZCV] = 0xF0000000;
+    assert(!jit_execute_block(t.jit, block));
+    assert(jit_test_pc(&t) == 0x1004);
+    assert(t.regs->x[1] == SRC + 3 * 8);
+    assert(t.regs->x[2] == DST + 0x1000);
+    assert(t.regs->x[3] == 13);
+    assert(t.regs->x[4] == 5);
+    assert(t.regs->x[ARM64_REG_NZCV] == 0x20000000);
+
+    uint64_t copied[3];
+    assert(memory_copy_from(t.memory, DST + 0x1000 - 3 * 8, copied, sizeof(copied)));
+    assert(copied[0] == 10 && copied[1] == 11 && copied[2] == 12);
+
+    jit_test_teardown(&t);
+}
+
+static void test_vector_accumulator() {
+    const uint32_t code[] = {
+        0x4EA18400,     /* 0x1000: add v0.4s, v0.4s, v1.4s */
+        0xF1000484,     /* 0x1004: subs x4, x4, #1 */
+        0x54FFFFC1,     /* 0x1008: b.ne 0x1000 */
+    };
+    JitTest t;
+    jit_test_setup(&t, code, 3, 0);
+    JITBlock* block = jit_test_compile(&t);
+
+    const uint32_t step[4] = { 1, 2, 3, 4 };
+    memset(t.regs->v[0], 0, 16);
+    memcpy(t.regs->v[1], step, 16);
+    t.regs->x[4] = 100;
+    assert(jit_execute_block(t.jit, block));
+
+    uint32_t sum[4];
+    memcpy(sum, t.regs->v[0], 16);
+    assert(sum[0] == 100 && sum[1] == 200 && sum[2] == 300 && sum[3] == 400);
+    assert(memcmp(t.regs->v[1], step, 16) == 0);
+
+    jit_test_teardown(&t);
+}
+
+int main() {
+    printf("Running loop tests...\n");
+
+    test_counting_loop();
+    test_copy_loop();
+    test_fault_mid_loop();
+    test_vector_accumulator();
+
+    printf("All loop tests passed!\n");
+    return 0;
+}
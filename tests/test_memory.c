@@ -1,160 +1,120 @@
-#include <stdio.h>
-#include <stdlib.h>
-#include <assert.h>
-#include <string.h>
-#include "../include/memory.h"
-
-static void test_memory_allocation() {
-    MemoryManager* mm = memory_manager_create();
-    assert(mm != NULL);
-    assert(mm->code_buffer != NULL);
-    assert(mm->code_size == 0);
-    assert(mm->code_capacity > 0);
-    memory_manager_destroy(mm);
-}
-
-static void test_code_buffer_expansion() {
-    MemoryManager* mm = memory_manager_create();
-    size_t initial_capacity = mm->code_capacity;
-    
-    uint8_t test_data[1024];
-    memset(test_data, 0x90, sizeof(test_data));
-    
-    for (int i = 0; i < 10; i++) {
-        bool success = memory_manager_append(mm, test_data, sizeof(test_data));
-        assert(success);
-    }
-    
-    assert(mm->code_capacity > initial_capacity);
-    assert(mm->code_size == 10 * sizeof(test_data));
-    
-    memory_manager_destroy(mm);
-}
-
-static void test_memory_protection() {
-    MemoryManager* mm = memory_manager_create();
-    uint8_t test_code[] = {
-        0x48, 0xC7, 0xC0, 0x2A, 0x00, 0x00, 0x00, 
-        0xC3                                        
-    };
-    
-    bool success = memory_manager_append(mm, test_code, sizeof(test_code));
-    assert(success);
-    
-    void* executable_buffer = memory_manager_make_executable(mm);
-    assert(executable_buffer != NULL);
-    
-    uint64_t (*func)(void) = (uint64_t (*)(void))executable_buffer;
-    uint64_t result = func();
-    assert(result == 42);
-    
-    memory_manager_destroy(mm);
-}
-
-static void test_memory_alignment() {
-    MemoryManager* mm = memory_manager_create();
-    
-    assert(((uintptr_t)mm->code_buffer % 16) == 0);
-    
-    uint8_t single_byte = 0x90;
-    memory_manager_append(mm, &single_byte, 1);
-    
-    void* aligned_ptr = memory_manager_allocate_aligned(mm, 64, 32);
-    assert(aligned_ptr != NULL);
-    assert(((uintptr_t)aligned_ptr % 32) == 0);
-    
-    memory_manager_destroy(mm);
-}
-
-static void test_memory_boundaries() {
-    MemoryManager* mm = memory_manager_create();
-    size_t initial_size = mm->code_size;
-    
-    bool success = memory_manager_append(mm, NULL, 10);
-    assert(!success);
-    assert(mm->code_size == initial_size);
-    
-    success = memory_manager_append(mm, (uint8_t*)"test", 0);
-    assert(success);
-    assert(mm->code_size == initial_size);
-    
-    void* ptr = memory_manager_allocate_aligned(mm, 0, 16);
-    assert(ptr == NULL);
-    
-    memory_manager_destroy(mm);
-}
-
-static void test_memory_read_write() {
-    MemoryManager* mm = memory_manager_create();
-    
-    uint8_t test_data[] = {0x12, 0x34, 0x56, 0x78, 0x9A, 0xBC, 0xDE, 0xF0};
-    bool success = memory_manager_append(mm, test_data, sizeof(test_data));
-    assert(success);
-    
-    assert(memcmp(mm->code_buffer, test_data, sizeof(test_data)) == 0);
-    
-    size_t offset = 4;
-    assert(memcmp(mm->code_buffer + offset, test_data + offset, sizeof(test_data) - offset) == 0);
-    
-    memory_manager_destroy(mm);
-}
-
-static void test_memory_reallocation() {
-    MemoryManager* mm = memory_manager_create();
-    size_t initial_capacity = mm->code_capacity;
-    
-    for (size_t i = 0; i < 1000; i++) {
-        uint8_t data = (uint8_t)i;
-        bool success = memory_manager_append(mm, &data, 1);
-        assert(success);
-    }
-    
-    assert(mm->code_capacity > initial_capacity);
-    assert(mm->code_size == 1000);
-    
-    for (size_t i = 0; i < 1000; i++) {
-        assert(mm->code_buffer[i] == (uint8_t)i);
-    }
-    
-    memory_manager_destroy(mm);
-}
-
-static void test_memory_large_allocations() {
-    MemoryManager* mm = memory_manager_create();
-    
-    void* ptr = memory_manager_allocate_aligned(mm, SIZE_MAX - 1000, 16);
-    assert(ptr == NULL);
-
-    size_t large_size = 1024 * 1024; 
-    uint8_t* large_buffer = malloc(large_size);
-    assert(large_buffer != NULL);
-    
-    for (size_t i = 0; i < large_size; i++) {
-        large_buffer[i] = (uint8_t)(i & 0xFF);
-    }
-    
-    bool success = memory_manager_append(mm, large_buffer, large_size);
-    assert(success);
-    assert(mm->code_size == large_size);
-    
-    assert(memcmp(mm->code_buffer, large_buffer, large_size) == 0);
-    
-    free(large_buffer);
-    memory_manager_destroy(mm);
-}
-
-int main() {
-    printf("Running memory manager tests...\n");
-    
-    test_memory_allocation();
-    test_code_buffer_expansion();
-    test_memory_protection();
-    test_memory_alignment();
-    test_memory_boundaries();
-    test_memory_read_write();
-    test_memory_reallocation();
-    test_memory_large_allocations();
-    
-    printf("All memory manager tests passed!\n");
-    return 0;
-} 
\ No newline at end of file
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "../include/memory.h"
+
+static void test_map_and_access() {
+    Memory* memory = memory_create();
+    assert(memory != NULL);
+    assert(memory_map(memory, 0x1000, 0x2000, PERM_READ | PERM_WRITE));
+    assert(!memory_map(memory, 0x2000, 0x1000, PERM_READ));
+    assert(memory_get_mapped_size(memory) == 0x2000);
+
+    uint64_t value;
+    assert(memory_write64(memory, 0x1008, 0x1122334455667788ULL));
+    assert(memory_read64(memory, 0x1008, &value) && value == 0x1122334455667788ULL);
+
+    uint32_t word;
+    assert(memory_read32(memory, 0x1008, &word) && word == 0x55667788);
+    uint8_t byte;
+    assert(memory_read8(memory, 0x100F, &byte) && byte == 0x11);
+
+    /* Accesses may straddle pages inside a region, but not leave it */
+    assert(memory_write32(memory, 0x1FFE, 0xAABBCCDD));
+    assert(memory_read32(memory, 0x1FFE, &word) && word == 0xAABBCCDD);
+    assert(!memory_read8(memory, 0x3000, &byte));
+    assert(!memory_write8(memory, 0x0FFF, 0));
+
+    memory_destroy(memory);
+}
+
+static void test_permissions() {
+    Memory* memory = memory_create();
+    assert(memory_map(memory, 0x4000, 0x1000, PERM_READ | PERM_WRITE));
+    assert(memory_write32(memory, 0x4000, 0xD503201F));
+
+    assert(memory_protect(memory, 0x4000, 0x1000, PERM_READ | PERM_EXEC));
+    assert(!memory_write32(memory, 0x4000, 0));
+    assert(memory_validate_access(memory, 0x4000, 4, PERM_EXEC));
+    assert(!memory_validate_access(memory, 0x4000, 4, PERM_WRITE));
+
+    uint32_t word;
+    assert(memory_read32(memory, 0x4000, &word) && word == 0xD503201F);
+
+    assert(memory_unmap(memory, 0x4000, 0x1000));
+    assert(!memory_is_mapped(memory, 0x4000, 4));
+    assert(!memory_read32(memory, 0x4000, &word));
+    memory_destroy(memory);
+}
+
+static void test_copy() {
+    Memory* memory = memory_create();
+    assert(memory_map(memory, 0x8000, 0x1000, PERM_READ | PERM_WRITE));
+
+    const char message[] = "guest memory";
+    char buffer[sizeof(message)];
+    assert(memory_copy_to(memory, 0x8100, message, sizeof(message)));
+    assert(memory_copy_from(memory, 0x8100, buffer, sizeof(buffer)));
+    assert(memcmp(buffer, message, sizeof(message)) == 0);
+    assert(!memory_copy_to(memory, 0x8FF8, message, sizeof(message)));
+    memory_destroy(memory);
+}
+
+typedef struct CodeWrites {
+    size_t count;
+    uint64_t address;
+    size_t size;
+} CodeWrites;
+
+static void record_code_write(void* opaque, uint64_t address, size_t size) {
+    CodeWrites* writes = (CodeWrites*)opaque;
+    writes->count++;
+    writes->address = address;
+    writes->size = size;
+}
+
+static void test_code_pages() {
+    Memory* memory = memory_create();
+    CodeWrites writes = { 0 };
+    assert(memory_map(memory, 0x1000, 0x2000, PERM_READ | PERM_WRITE | PERM_EXEC));
+    memory_set_code_write_handler(memory, record_code_write, &writes);
+
+    assert(memory_mark_code(memory, 0x1000, 4));
+    assert(memory_page_has_code(memory, 0x1FFC));
+    assert(!memory_page_has_code(memory, 0x2000));
+
+    assert(memory_write32(memory, 0x2000, 1));
+    assert(writes.count == 0);
+    assert(memory_write32(memory, 0x1004, 1));
+    assert(writes.count == 1 && writes.address == 0x1004 && writes.size == 4);
+
+    /* Each store is reported once, whole, even when it straddles pages */
+    writes.count = 0;
+    assert(memory_write64(memory, 0x1FFC, 2));
+    assert(writes.count == 1 && writes.address == 0x1FFC && writes.size == 8);
+    uint8_t block[64] = { 0 };
+    assert(memory_copy_to(memory, 0x1100, block, sizeof(block)));
+    assert(writes.count == 2 && writes.address == 0x1100 && writes.size == sizeof(block));
+    assert(memory_store_slow(memory, 0x1200, 8, 3));
+    assert(writes.count == 3 && writes.address == 0x1200 && writes.size == 8);
+
+    memory_clear_code(memory, 0x1000, 4);
+    assert(!memory_page_has_code(memory, 0x1000));
+    writes.count = 0;
+    assert(memory_write32(memory, 0x1004, 2));
+    assert(writes.count == 0);
+    memory_destroy(memory);
+}
+
+int main() {
+    printf("Running memory tests...\n");
+
+    test_map_and_access();
+    test_permissions();
+    test_copy();
+    test_code_pages();
+
+    printf("All memory tests passed!\n");
+    return 0;
+}
@@ -0,0 +1,180 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include "../include/jit.h"
+#include "../include/memory.h"
+#include "../include/registers.h"
+
+#define CODE 0x1000
+#define DATA 0x10000
+
+static void map_code(Memory* memory, uint64_t address, const uint32_t* words, size_t count) {
+    assert(memory_copy_to(memory, address, words, count * 4));
+}
+
+static JITBlock* compile(JITContext* jit, uint64_t address) {
+    JITBlock* block = jit_compile_block(jit, address);
+    assert(block != NULL && block->code != NULL);
+    return block;
+}
+
+static uint64_t pc_of(RegisterFile* regs) {
+    uint64_t pc = 0;
+    assert(registers_get_pc(regs, &pc) == REG_SUCCESS);
+    return pc;
+}
+
+static void test_loads_and_stores() {
+    RegisterFile* regs = registers_create();
+    Memory* memory = memory_create();
+    assert(memory_map(memory, CODE, 0x1000, PERM_READ | PERM_WRITE | PERM_EXEC));
+    assert(memory_map(memory, DATA, 0x1000, PERM_READ | PERM_WRITE));
+
+    const uint32_t code[] = {
+        0xF9400020,     /* ldr x0, [x1] */
+        0xB9400822,     /* ldr w2, [x1, #8] */
+        0xF9000820,     /* str x0, [x1, #16] */
+        0x39006022,     /* strb w2, [x1, #24] */
+        0x14000002,     /* b +8 */
+    };
+    map_code(memory, CODE, code, 5);
+    assert(memory_write64(memory, DATA, 0x1122334455667788ULL));
+    assert(memory_write64(memory, DATA + 8, 0xFFFFFFFFAABBCCDDULL));
+
+    JITContext* jit = jit_create(memory, regs);
+    assert(jit_set_worker_count(jit, 0));
+    jit_set_tier_threshold(jit, 0);
+    regs->x[1] = DATA;
+    regs->x[2] = 0x5555555555555555ULL;
+
+    JITBlock* block = compile(jit, CODE);
+    assert(jit_execute_block(jit, block));
+    assert(pc_of(regs) == CODE + 0x18);
+    assert(regs->x[0] == 0x1122334455667788ULL);
+    assert(regs->x[2] == 0xAABBCCDD);       /* W loads zero-extend */
+
+    uint64_t value = 0;
+    assert(memory_read64(memory, DATA + 16, &value) && value == 0x1122334455667788ULL);
+    uint8_t byte = 0;
+    assert(memory_read8(memory, DATA + 24, &byte) && byte == 0xDD);
+    assert(memory_read8(memory, DATA + 25, &byte) && byte == 0);
+
+    /* The first run filled the TLB; now every access hits inline */
+    uint64_t misses = memory->tlb_misses;
+    assert(misses > 0);
+    assert(memory_write64(memory, DATA, 42));
+    assert(jit_execute_block(jit, block));
+    assert(memory->tlb_misses == misses);
+    assert(regs->x[0] == 42);
+    assert(memory_read64(memory, DATA + 16, &value) && value == 42);
+
+    /* Misaligned addresses always take the slow path, and still work;
+     * only the byte store cannot be misaligned.
+     */
+    regs->x[1] = DATA + 0x101;
+    assert(memory_write64(memory, DATA + 0x101, 0x0102030405060708ULL));
+    assert(jit_execute_block(jit, block));
+    assert(regs->x[0] == 0x0102030405060708ULL);
+    assert(memory->tlb_misses == misses + 3);
+
+    jit_destroy(jit);
+    registers_destroy(regs);
+    memory_destroy(memory);
+}
+
+static void test_faults() {
+    RegisterFile* regs = registers_create();
+    Memory* memory = memory_create();
+    assert(memory_map(memory, CODE, 0x1000, PERM_READ | PERM_WRITE | PERM_EXEC));
+    assert(memory_map(memory, DATA, 0x1000, PERM_READ | PERM_WRITE));
+
+    const uint32_t code[] = {
+        0x91000400,     /* 0x1000: add x0, x0, #1   overwritten below, but not before the fault */
+        0xF9400062,     /* 0x1004: ldr x2, [x3] */
+        0x91001420,     /* 0x1008: add x0, x1, #5 */
+        0xF9000060,     /* 0x100c: str x0, [x3] */
+        0x14000002,     /* 0x1010: b +8 */
+    };
+    map_code(memory, CODE, code, 5);
+
+    JITContext* jit = jit_create(memory, regs);
+    assert(jit_set_worker_count(jit, 0));
+    jit_set_tier_threshold(jit, 0);
+    JITBlock* block = compile(jit, CODE);
+
+    regs->x[0] = 10;
+    regs->x[2] = 7;
+    regs->x[3] = 0x80000;
+    assert(!jit_execute_block(jit, block));
+    assert(pc_of(regs) == CODE + 4);
+    assert(regs->x[0] == 11 && regs->x[2] == 7);
+
+    /* Write-protecting the page drops its TLB entry */
+    regs->x[3] = DATA;
+    assert(jit_execute_block(jit, block));
+    assert(pc_of(regs) == CODE + 0x18);
+    assert(memory_protect(memory, DATA, 0x1000, PERM_READ));
+    regs->x[0] = 10;
+    assert(!jit_execute_block(jit, block));
+    assert(pc_of(regs) == CODE + 0xc);
+    assert(regs->x[0] == regs->x[1] + 5);
+
+    jit_destroy(jit);
+    registers_destroy(regs);
+    memory_destroy(memory);
+}
+
+static void test_stores_to_code() {
+    RegisterFile* regs = registers_create();
+    Memory* memory = memory_create();
+    assert(memory_map(memory, CODE, 0x2000, PERM_READ | PERM_WRITE | PERM_EXEC));
+
+    const uint32_t writer[] = {
+        0xB9000020,     /* 0x1000: str w0, [x1] */
+        0x14000002,     /* 0x1004: b +8 */
+    };
+    const uint32_t target[] = {
+        0x91000442,     /* 0x1800: add x2, x2, #1 */
+        0x14000002,     /* 0x1804: b +8 */
+    };
+    map_code(memory, CODE, writer, 2);
+    map_code(memory, CODE + 0x800, target, 2);
+
+    JITContext* jit = jit_create(memory, regs);
+    assert(jit_set_worker_count(jit, 0));
+    jit_set_tier_threshold(jit, 0);
+    JITBlock* block = compile(jit, CODE);
+    compile(jit, CODE + 0x800);
+
+    /* The page holds code, so the store leaves the TLB alone and goes
+     * through the write handler every time.
+     */
+    regs->x[0] = 0x91000842;        /* add x2, x2, #2 */
+    regs->x[1] = CODE + 0x800;
+    for (int run = 0; run < 2; run++) {
+        uint64_t misses = memory->tlb_misses;
+        assert(jit_execute_block(jit, block));
+        assert(memory->tlb_misses == misses + 1);
+        assert(jit_get_cached_block(jit, CODE + 0x800) == NULL);
+        compile(jit, CODE + 0x800);
+    }
+
+    regs->x[2] = 0;
+    assert(jit_execute_block(jit, jit_get_cached_block(jit, CODE + 0x800)));
+    assert(regs->x[2] == 2);
+
+    jit_destroy(jit);
+    registers_destroy(regs);
+    memory_destroy(memory);
+}
+
+int main() {
+    printf("Running memory access tests...\n");
+
+    test_loads_and_stores();
+    test_faults();
+    test_stores_to_code();
+
+    printf("All memory access tests passed!\n");
+    return 0;
+}
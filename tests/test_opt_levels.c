@@ -0,0 +1,117 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "jit_test.h"
+
+static const uint32_t straight_line[] = {
+    0x91000400,     /* 0x1000: add x0, x0, #1 */
+    0x91000400,     /* 0x1004: add x0, x0, #1 */
+    0x91000400,     /* 0x1008: add x0, x0, #1 */
+    0x91000400,     /* 0x100c: add x0, x0, #1 */
+    0x91000400,     /* 0x1010: add x0, x0, #1 */
+    0x91000400,     /* 0x1014: add x0, x0, #1 */
+    0x91000400,     /* 0x1018: add x0, x0, #1 */
+    0x91000400,     /* 0x101c: add x0, x0, #1 */
+    0x14000100,     /* 0x1020: b 0x1420 */
+};
+
+/* Copies x4 words from x1 to x2 */
+static const uint32_t copy_loop[] = {
+    0xF9400023,     /* 0x1000: ldr x3, [x1] */
+    0xF9000043,     /* 0x1004: str x3, [x2] */
+    0x91002021,     /* 0x1008: add x1, x1, #8 */
+    0x91002042,     /* 0x100c: add x2, x2, #8 */
+    0xF1000484,     /* 0x1010: subs x4, x4, #1 */
+    0x54FFFF61,     /* 0x1014: b.ne 0x1000 */
+};
+
+static void test_first_use_and_loops() {
+    JitTest t;
+    jit_test_setup(&t, straight_line, 9, 0);
+    JITBlock* block = jit_compile_block(t.jit, JIT_TEST_CODE);
+    assert(block != NULL && block->code != NULL);
+    assert(block->opt_level == BLOCK_OPT_FAST);
+    jit_test_teardown(&t);
+
+    /* A loop is hot code even on first use */
+    jit_test_setup(&t, copy_loop, 6, 0);
+    block = jit_compile_block(t.jit, JIT_TEST_CODE);
+    assert(block != NULL && block->code != NULL);
+    assert(block->opt_level == BLOCK_OPT_FULL);
+    jit_test_teardown(&t);
+}
+
+static void test_promoted_blocks_are_hot() {
+    JitTest t;
+    jit_test_setup(&t, straight_line, 9, 2);
+    jit_set_opt_levels(t.jit, BLOCK_OPT_NONE, BLOCK_OPT_FAST);
+    /* Out of range levels are ignored */
+    jit_set_opt_levels(t.jit, BLOCK_OPT_LEVELS, BLOCK_OPT_FULL);
+
+    JITBlock* block = jit_compile_block(t.jit, JIT_TEST_CODE);
+    assert(block != NULL && block->code == NULL);
+    assert(jit_execute_block(t.jit, block));
+    assert(block->code == NULL);
+    assert(jit_execute_block(t.jit, block));
+    assert(block->code != NULL);
+    assert(block->opt_level == BLOCK_OPT_FAST);
+    assert(t.regs->x[0] == 16);
+
+    jit_test_teardown(&t);
+}
+
+static size_t compiled_size(BlockOptLevel level) {
+    JitTest t;
+    jit_test_setup(&t, straight_line, 9, 0);
+    jit_set_opt_levels(t.jit, level, level);
+    JITBlock* block = jit_compile_block(t.jit, JIT_TEST_CODE);
+    assert(block != NULL && block->code != NULL && block->opt_level == level);
+
+    t.regs->x[0] = 100;
+    assert(jit_execute_block(t.jit, block));
+    assert(t.regs->x[0] == 108);
+    size_t size = block->code_size;
+    jit_test_teardown(&t);
+    return size;
+}
+
+static void test_levels_agree() {
+    /* Eight adds fold into one once instcombine has run */
+    assert(compiled_size(BLOCK_OPT_NONE) > compiled_size(BLOCK_OPT_FULL));
+
+    uint64_t words[100];
+    for (size_t i = 0; i < 100; i++) words[i] = i * i + 3;
+    for (int level = BLOCK_OPT_NONE; level < BLOCK_OPT_LEVELS; level++) {
+        JitTest t;
+        jit_test_setup(&t, copy_loop, 6, 0);
+        assert(memory_copy_to(t.memory, JIT_TEST_DATA, words, sizeof(words)));
+        jit_set_opt_levels(t.jit, (BlockOptLevel)level, (BlockOptLevel)level);
+        JITBlock* block = jit_compile_block(t.jit, JIT_TEST_CODE);
+        assert(block != NULL && block->code != NULL);
+
+        t.regs->x[1] = JIT_TEST_DATA;
+        t.regs->x[2] = JIT_TEST_DATA + sizeof(words);
+        t.regs->x[4] = 100;
+        assert(jit_execute_block(t.jit, block));
+        assert(t.regs->x[1] == JIT_TEST_DATA + sizeof(words));
+        assert(t.regs->x[2] == JIT_TEST_DATA + 2 * sizeof(words));
+        assert(t.regs->x[ARM64_REG_NZCV] == 0x60000000);
+
+        uint64_t copied[100];
+        assert(memory_copy_from(t.memory, JIT_TEST_DATA + sizeof(words), copied, sizeof(copied)));
+        assert(memcmp(copied, words, sizeof(words)) == 0);
+        jit_test_teardown(&t);
+    }
+}
+
+int main() {
+    printf("Running optimization level tests...\n");
+
+    test_first_use_and_loops();
+    test_promoted_blocks_are_hot();
+    test_levels_agree();
+
+    printf("All optimization level tests passed!\n");
+    return 0;
+}
@@ -0,0 +1,121 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include "../include/instruction.h"
+
+static Operand immediate(uint64_t value) {
+    Operand op = { .type = OP_IMMEDIATE, .value.immediate = value };
+    return op;
+}
+
+static void expect_immediate(uint64_t value) {
+    Instruction inst;
+    instruction_init(&inst);
+    assert(instruction_set_operand(&inst, 1, immediate(value)));
+    assert(inst.operand_count == 2);
+    assert(instruction_get_operand_type(&inst, 1) == OP_IMMEDIATE);
+    assert(instruction_get_immediate(&inst, 1) == value);
+    assert(instruction_get_operand(&inst, 1).value.immediate == value);
+}
+
+static void test_size() {
+    assert(sizeof(Instruction) <= 16);
+}
+
+static void test_immediates() {
+    expect_immediate(0);
+    expect_immediate(0xFF);
+    expect_immediate(0x1000);
+    expect_immediate((uint64_t)-4);                     /* backward branch */
+    expect_immediate(0xF0000000);                       /* CCMP's NZCV */
+    expect_immediate(0xFFFF000000000000ULL);            /* MOVZ, LSL #48 */
+    expect_immediate(0xEDCBFFFFFFFFFFFFULL);            /* MOVN, LSL #48 */
+    expect_immediate((uint64_t)-0x100000000LL);         /* ADRP at -4 GiB */
+    expect_immediate(0xFFFFF000ULL << 12);              /* ADRP near +4 GiB */
+    expect_immediate(UINT64_MAX);
+}
+
+/* Every 64-bit logical immediate the decoder can produce packs exactly */
+static void test_bit_masks() {
+    for (uint32_t encoding = 0; encoding < 0x2000; encoding++) {
+        uint64_t mask;
+        if (!instruction_decode_bit_mask(encoding >> 12, encoding & 0x3F, (encoding >> 6) & 0x3F, true, &mask)) {
+            continue;
+        }
+        expect_immediate(mask);
+    }
+}
+
+static void test_registers_and_shifts() {
+    Instruction inst;
+    instruction_init(&inst);
+    Operand reg = { .type = OP_REGISTER, .value.reg = 31 };
+    Operand shift = { .type = OP_SHIFT, .value.shift = { .type = SHIFT_ROR, .amount = 63 } };
+    Operand extend = { .type = OP_EXTEND, .value.shift = { .type = 7, .amount = 4 } };
+    assert(instruction_set_operand(&inst, 0, reg));
+    assert(instruction_set_operand(&inst, 1, shift));
+    assert(instruction_set_operand(&inst, 2, extend));
+    assert(inst.operand_count == 3);
+    assert(!instruction_set_operand(&inst, 3, reg));
+
+    assert(instruction_get_register(&inst, 0) == 31);
+    assert(instruction_get_register(&inst, 1) == 0xFF);
+    Operand op = instruction_get_operand(&inst, 1);
+    assert(op.type == OP_SHIFT && op.value.shift.type == SHIFT_ROR && op.value.shift.amount == 63);
+    op = instruction_get_operand(&inst, 2);
+    assert(op.type == OP_EXTEND && op.value.shift.type == 7 && op.value.shift.amount == 4);
+    assert(instruction_get_operand_type(&inst, 2) == OP_EXTEND);
+
+    instruction_set_element_size(&inst, 16);
+    assert(instruction_get_element_size(&inst) == 16);
+    instruction_set_element_size(&inst, 1);
+    assert(instruction_get_element_size(&inst) == 1);
+}
+
+static void test_memory() {
+    Instruction inst;
+    instruction_init(&inst);
+    Operand mem = {
+        .type = OP_MEMORY,
+        .value.mem = { .base_reg = 31, .offset = -512, .index_reg = 0xFF, .mode = ADDR_PRE_INDEX }
+    };
+    assert(instruction_set_operand(&inst, 0, mem));
+    Operand op = instruction_get_operand(&inst, 0);
+    assert(op.type == OP_MEMORY && op.value.mem.base_reg == 31 && op.value.mem.offset == -512);
+    assert(op.value.mem.index_reg == 0xFF && op.value.mem.mode == ADDR_PRE_INDEX);
+
+    /* The shared slot holds one wide value per instruction */
+    assert(!instruction_set_operand(&inst, 1, immediate(0x1000)));
+    assert(instruction_set_operand(&inst, 1, immediate(0x10)));
+
+    Operand indexed = {
+        .type = OP_MEMORY,
+        .value.mem = { .base_reg = 3, .index_reg = 7, .shift_amount = 3, .extend = 6, .mode = ADDR_OFFSET }
+    };
+    assert(instruction_set_operand(&inst, 0, indexed));
+    op = instruction_get_operand(&inst, 0);
+    assert(op.value.mem.base_reg == 3 && op.value.mem.index_reg == 7 && op.value.mem.offset == 0);
+    assert(op.value.mem.shift_amount == 3 && op.value.mem.extend == 6);
+
+    Operand literal = {
+        .type = OP_MEMORY,
+        .value.mem = { .base_reg = 0xFF, .offset = -0x100000, .index_reg = 0xFF, .mode = ADDR_LITERAL }
+    };
+    assert(instruction_set_operand(&inst, 0, literal));
+    op = instruction_get_operand(&inst, 0);
+    assert(op.value.mem.mode == ADDR_LITERAL && op.value.mem.base_reg == 0xFF);
+    assert(op.value.mem.offset == -0x100000);
+}
+
+int main() {
+    printf("Running packed instruction tests...\n");
+
+    test_size();
+    test_immediates();
+    test_bit_masks();
+    test_registers_and_shifts();
+    test_memory();
+
+    printf("All packed instruction tests passed!\n");
+    return 0;
+}
@@ -0,0 +1,198 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include "../include/page_index.h"
+#include "../include/jit.h"
+#include "../include/memory.h"
+#include "../include/registers.h"
+
+static void test_index() {
+    PageIndex* index = page_index_create();
+    JITBlock* a = block_create(0x1000);
+    JITBlock* b = block_create(0x1800);
+
+    assert(page_index_lookup(index, 0x1000) == NULL);
+    assert(page_index_add(index, 0x1000, a));
+    assert(page_index_add(index, 0x1000, b));
+    assert(page_index_add(index, 0x2000, b));
+    assert(page_index_page_count(index) == 2);
+
+    const PageBlocks* entry = page_index_lookup(index, 0x1000);
+    assert(entry != NULL && entry->count == 2);
+
+    assert(!page_index_remove(index, 0x1000, a));
+    assert(page_index_lookup(index, 0x1000)->blocks[0] == b);
+    assert(page_index_remove(index, 0x1000, b));
+    assert(page_index_lookup(index, 0x1000) == NULL);
+    assert(page_index_page_count(index) == 1);
+
+    /* Block bookkeeping of its own pages */
+    assert(block_add_page(b, 0x2000));
+    assert(!block_add_page(b, 0x2000));
+    assert(b->page_count == 1);
+
+    page_index_destroy(index);
+    block_destroy(a);
+    block_destroy(b);
+}
+
+static uint64_t writes_seen;
+static uint64_t last_write;
+
+static void count_write(void* opaque, uint64_t address, size_t size) {
+    (void)opaque;
+    (void)size;
+    writes_seen++;
+    last_write = address;
+}
+
+static void test_code_marks() {
+    Memory* memory = memory_create();
+    assert(memory_map(memory, 0x10000, 0x3000, PERM_READ | PERM_WRITE));
+    memory_set_code_write_handler(memory, count_write, NULL);
+
+    /* Nothing is marked yet, so stores take the plain path */
+    assert(memory_write64(memory, 0x10000, 1));
+    assert(writes_seen == 0);
+    assert(memory->regions->code_pages == NULL);
+
+    assert(memory_mark_code(memory, 0x11008, 4));
+    assert(memory_page_has_code(memory, 0x11FFF));
+    assert(!memory_page_has_code(memory, 0x10000));
+    assert(!memory_page_has_code(memory, 0x12000));
+
+    assert(memory_write32(memory, 0x12000, 1));
+    assert(writes_seen == 0);
+    assert(memory_write32(memory, 0x11100, 1));
+    assert(writes_seen == 1 && last_write == 0x11100);
+
+    /* Marks spanning a page boundary cover both pages */
+    assert(memory_mark_code(memory, 0x11FFC, 8));
+    assert(memory_page_has_code(memory, 0x12000));
+    memory_clear_code(memory, 0x11000, 0x2000);
+    assert(!memory_page_has_code(memory, 0x11000));
+    assert(!memory_page_has_code(memory, 0x12000));
+
+    assert(!memory_mark_code(memory, 0x80000, 4));
+
+    /* Unmapping code counts as overwriting it */
+    writes_seen = 0;
+    assert(memory_mark_code(memory, 0x10000, 4));
+    assert(memory_unmap(memory, 0x10000, 0x3000));
+    assert(writes_seen == 1 && last_write == 0x10000);
+
+    memory_destroy(memory);
+}
+
+static uint64_t run_block(JITContext* jit, RegisterFile* regs, uint64_t pc) {
+    JITBlock* block = jit_get_cached_block(jit, pc);
+    if (!block) block = jit_compile_block(jit, pc);
+    assert(block != NULL);
+    assert(jit_execute_block(jit, block));
+    assert(registers_get_pc(regs, &pc) == REG_SUCCESS);
+    return pc;
+}
+
+static void test_overwrite_invalidates(uint64_t threshold) {
+    RegisterFile* regs = registers_create();
+    Memory* memory = memory_create();
+    assert(memory_map(memory, 0x1000, 0x1000, PERM_READ | PERM_WRITE | PERM_EXEC));
+
+    uint32_t code[] = { 0x14000004 };                 /* 0x1000: b 0x1010 */
+    assert(memory_copy_to(memory, 0x1000, code, sizeof(code)));
+
+    JITContext* jit = jit_create(memory, regs);
+    assert(jit_set_worker_count(jit, 0));
+    jit_set_tier_threshold(jit, threshold);
+
+    assert(run_block(jit, regs, 0x1000) == 0x1010);
+    assert(jit_get_cached_block(jit, 0x1000) != NULL);
+    assert(memory_page_has_code(memory, 0x1000));
+
+    /* Data stores beside the block leave it alone */
+    assert(memory_write64(memory, 0x1800, 0));
+    assert(jit_get_cached_block(jit, 0x1000) != NULL);
+
+    assert(memory_write32(memory, 0x1000, 0x14000008));   /* b 0x1020 */
+    assert(jit_get_cached_block(jit, 0x1000) == NULL);
+    assert(!memory_page_has_code(memory, 0x1000));
+    assert(run_block(jit, regs, 0x1000) == 0x1020);
+
+    jit_destroy(jit);
+    assert(memory->code_write_handler == NULL);
+    registers_destroy(regs);
+    memory_destroy(memory);
+}
+
+static void test_interpreted_store_into_own_block() {
+    RegisterFile* regs = registers_create();
+    Memory* memory = memory_create();
+    assert(memory_map(memory, 0x1000, 0x1000, PERM_READ | PERM_WRITE | PERM_EXEC));
+
+    uint32_t code[] = {
+        0xF9000001,     /* 0x1000: str x1, [x0] */
+        0x14000003,     /* 0x1004: b 0x1010 */
+    };
+    assert(memory_copy_to(memory, 0x1000, code, sizeof(code)));
+
+    JITContext* jit = jit_create(memory, regs);
+    assert(jit_set_worker_count(jit, 0));
+    jit_set_tier_threshold(jit, 100);
+
+    /* The store lands inside the block that is running: it finishes, but
+     * it is not found again.
+     */
+    registers_set_x(regs, 0, 0x1000);
+    registers_set_x(regs, 1, 0);
+    assert(run_block(jit, regs, 0x1000) == 0x1010);
+    assert(jit_get_cached_block(jit, 0x1000) == NULL);
+
+    jit_destroy(jit);
+    registers_destroy(regs);
+    memory_destroy(memory);
+}
+
+static void test_superblock_invalidated_by_later_page() {
+    RegisterFile* regs = registers_create();
+    Memory* memory = memory_create();
+    assert(memory_map(memory, 0x1000, 0x2000, PERM_READ | PERM_WRITE | PERM_EXEC));
+
+    uint32_t head = 0x14000400;     /* 0x1000: b 0x2000 */
+    uint32_t tail = 0x14000400;     /* 0x2000: b 0x3000 */
+    assert(memory_copy_to(memory, 0x1000, &head, sizeof(head)));
+    assert(memory_copy_to(memory, 0x2000, &tail, sizeof(tail)));
+
+    JITContext* jit = jit_create(memory, regs);
+    assert(jit_set_worker_count(jit, 0));
+    jit_set_tier_threshold(jit, 1);
+
+    assert(run_block(jit, regs, 0x1000) == 0x3000);
+    JITBlock* block = jit_get_cached_block(jit, 0x1000);
+    assert(block != NULL && block->trace != NULL);
+    assert(memory_page_has_code(memory, 0x2000));
+
+    /* The second page was never run on its own, only folded into the head */
+    assert(jit_get_cached_block(jit, 0x2000) == NULL);
+    assert(memory_write32(memory, 0x2000, 0x14000800));   /* b 0x4000 */
+    assert(jit_get_cached_block(jit, 0x1000) == NULL);
+
+    assert(run_block(jit, regs, 0x1000) == 0x4000);
+
+    jit_destroy(jit);
+    registers_destroy(regs);
+    memory_destroy(memory);
+}
+
+int main() {
+    printf("Running page index tests...\n");
+
+    test_index();
+    test_code_marks();
+    test_overwrite_invalidates(100);
+    test_overwrite_invalidates(0);
+    test_interpreted_store_into_own_block();
+    test_superblock_invalidated_by_later_page();
+
+    printf("All page index tests passed!\n");
+    return 0;
+}
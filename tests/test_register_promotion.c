@@ -0,0 +1,114 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include "../include/emitter.h"
+#include "../include/jit.h"
+#include "../include/decoder.h"
+#include "../include/memory.h"
+#include "../include/registers.h"
+#include "jit_test.h"
+
+static const uint32_t code[] = {
+    0x91000400,     /* 0x1000: add x0, x0, #1 */
+    0x91000400,     /* 0x1004: add x0, x0, #1 */
+    0x11000441,     /* 0x1008: add w1, w2, #1 */
+    0x910003E6,     /* 0x100c: add x6, sp, #0 */
+    0xD1000803,     /* 0x1010: sub x3, x0, #2 */
+    0x140003FB,     /* 0x1014: b 0x2000 */
+};
+
+#define CODE_COUNT (sizeof(code) / sizeof(code[0]))
+
+/* Does the load or store address a slot of the block's RegisterFile? */
+static bool accesses_registers(LLVMValueRef inst, LLVMValueRef registers) {
+    return jit_test_access_base(inst) == registers;
+}
+
+static void test_emitted_accesses() {
+    JITCompiler* compiler = jit_compiler_create(NULL);
+    assert(compiler != NULL);
+    compiler->module = LLVMModuleCreateWithNameInContext("promotion", compiler->llvm_context);
+
+    EmitterContext* emitter = emitter_create(compiler);
+    assert(emitter_create_entry_block(emitter) != NULL);
+
+    DecoderContext* decoder = decoder_create((const uint8_t*)code, sizeof(code));
+    for (size_t i = 0; i < CODE_COUNT; i++) {
+        Instruction inst;
+        assert(decoder_decode_next(decoder, &inst) == DECODER_SUCCESS);
+        emitter->pc = 0x1000 + i * 4;
+        assert(emitter_emit_instruction(emitter, &inst));
+    }
+    decoder_destroy(decoder);
+    LLVMValueRef function = emitter_finalize_block(emitter);
+    assert(function != NULL);
+
+    /* x0, w2 and sp are each loaded once; only the four written
+     * registers are stored, once, on the way out.
+     */
+    LLVMValueRef registers = LLVMGetParam(function, 0);
+    size_t loads = 0, stores = 0;
+    for (LLVMBasicBlockRef bb = LLVMGetFirstBasicBlock(function); bb; bb = LLVMGetNextBasicBlock(bb)) {
+        for (LLVMValueRef inst = LLVMGetFirstInstruction(bb); inst; inst = LLVMGetNextInstruction(inst)) {
+            if (!LLVMIsALoadInst(inst) && !LLVMIsAStoreInst(inst)) continue;
+            if (!accesses_registers(inst, registers)) continue;
+            if (LLVMIsALoadInst(inst)) {
+                assert(LLVMGetInstructionParent(inst) == LLVMGetEntryBasicBlock(function));
+                loads++;
+            } else {
+                stores++;
+            }
+        }
+    }
+    assert(loads == 3);
+    assert(stores == 4);
+
+    emitter_destroy(emitter);
+    LLVMDisposeModule(compiler->module);
+    compiler->module = NULL;
+    jit_compiler_destroy(compiler);
+}
+
+static void test_compiled_results() {
+    RegisterFile* regs = registers_create();
+    Memory* memory = memory_create();
+    assert(memory_map(memory, 0x1000, 0x1000, PERM_READ | PERM_WRITE | PERM_EXEC));
+    assert(memory_copy_to(memory, 0x1000, code, sizeof(code)));
+
+    JITContext* jit = jit_create(memory, regs);
+    assert(jit_set_worker_count(jit, 0));
+    jit_set_tier_threshold(jit, 0);
+
+    regs->x[0] = 40;
+    regs->x[1] = 0x1234;
+    regs->x[2] = 0xFFFFFFFF;
+    regs->x[5] = 0x5555;
+    regs->x[ARM64_REG_SP] = 0x8000;
+
+    JITBlock* block = jit_compile_block(jit, 0x1000);
+    assert(block != NULL && block->code != NULL);
+    assert(jit_execute_block(jit, block));
+
+    uint64_t pc = 0;
+    assert(registers_get_pc(regs, &pc) == REG_SUCCESS && pc == 0x2000);
+    assert(regs->x[0] == 42);
+    assert(regs->x[1] == 0);            /* w1 wraps and clears the top half */
+    assert(regs->x[2] == 0xFFFFFFFF);
+    assert(regs->x[3] == 40);
+    assert(regs->x[5] == 0x5555);
+    assert(regs->x[6] == 0x8000);
+
+    jit_destroy(jit);
+    registers_destroy(regs);
+    memory_destroy(memory);
+}
+
+int main() {
+    printf("Running register promotion tests...\n");
+
+    test_emitted_accesses();
+    test_compiled_results();
+
+    printf("All register promotion tests passed!\n");
+    return 0;
+}
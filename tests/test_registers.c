@@ -1,167 +1,99 @@
-#include <stdio.h>
-#include <stdlib.h>
-#include <assert.h>
-#include <string.h>
-#include "../include/registers.h"
-
-static void test_register_encoding() {
-    assert(get_register_encoding(REG_RAX) == 0);
-    assert(get_register_encoding(REG_RCX) == 1);
-    assert(get_register_encoding(REG_RDX) == 2);
-    assert(get_register_encoding(REG_RBX) == 3);
-    assert(get_register_encoding(REG_RSP) == 4);
-    assert(get_register_encoding(REG_RBP) == 5);
-    assert(get_register_encoding(REG_RSI) == 6);
-    assert(get_register_encoding(REG_RDI) == 7);
-    assert(get_register_encoding(REG_R8) == 8);
-    assert(get_register_encoding(REG_R9) == 9);
-    assert(get_register_encoding(REG_R10) == 10);
-    assert(get_register_encoding(REG_R11) == 11);
-    assert(get_register_encoding(REG_R12) == 12);
-    assert(get_register_encoding(REG_R13) == 13);
-    assert(get_register_encoding(REG_R14) == 14);
-    assert(get_register_encoding(REG_R15) == 15);
-}
-
-static void test_register_types() {
-    assert(is_general_purpose_register(REG_RAX));
-    assert(is_general_purpose_register(REG_R15));
-    assert(!is_general_purpose_register(REG_XMM0));
-    assert(!is_general_purpose_register(REG_NONE));
-    
-    assert(is_xmm_register(REG_XMM0));
-    assert(is_xmm_register(REG_XMM15));
-    assert(!is_xmm_register(REG_RAX));
-    assert(!is_xmm_register(REG_NONE));
-}
-
-static void test_register_names() {
-    // Test register name conversion
-    assert(strcmp(get_register_name(REG_RAX), "rax") == 0);
-    assert(strcmp(get_register_name(REG_RCX), "rcx") == 0);
-    assert(strcmp(get_register_name(REG_R8), "r8") == 0);
-    assert(strcmp(get_register_name(REG_R15), "r15") == 0);
-    assert(strcmp(get_register_name(REG_XMM0), "xmm0") == 0);
-    assert(strcmp(get_register_name(REG_XMM15), "xmm15") == 0);
-    assert(strcmp(get_register_name(REG_NONE), "none") == 0);
-}
-
-static void test_register_sizes() {
-    assert(get_register_size(REG_RAX) == 8);
-    assert(get_register_size(REG_EAX) == 4);
-    assert(get_register_size(REG_AX) == 2);
-    assert(get_register_size(REG_AL) == 1);
-    assert(get_register_size(REG_XMM0) == 16);
-}
-
-static void test_register_variants() {
-    assert(get_register_8bit_low(REG_RAX) == REG_AL);
-    assert(get_register_8bit_high(REG_RAX) == REG_AH);
-    assert(get_register_16bit(REG_RAX) == REG_AX);
-    assert(get_register_32bit(REG_RAX) == REG_EAX);
-    assert(get_register_64bit(REG_EAX) == REG_RAX);
-    
-    assert(get_register_8bit_low(REG_R8) == REG_R8B);
-    assert(get_register_16bit(REG_R8) == REG_R8W);
-    assert(get_register_32bit(REG_R8) == REG_R8D);
-}
-
-static void test_register_preservation() {
-    assert(is_caller_saved(REG_RAX));
-    assert(is_caller_saved(REG_RCX));
-    assert(is_caller_saved(REG_RDX));
-    assert(!is_caller_saved(REG_RBX));
-    
-    assert(!is_callee_saved(REG_RAX));
-    assert(!is_callee_saved(REG_RCX));
-    assert(!is_callee_saved(REG_RDX));
-    assert(is_callee_saved(REG_RBX));
-    assert(is_callee_saved(REG_RBP));
-    assert(is_callee_saved(REG_R12));
-    assert(is_callee_saved(REG_R13));
-    assert(is_callee_saved(REG_R14));
-    assert(is_callee_saved(REG_R15));
-}
-
-static void test_register_allocation() {
-    RegisterAllocator* ra = register_allocator_create();
-    assert(ra != NULL);
-
-    Register reg1 = register_allocator_alloc(ra);
-    assert(is_general_purpose_register(reg1));
-    assert(!register_allocator_is_free(ra, reg1));
-    
-    Register reg2 = register_allocator_alloc(ra);
-    assert(reg1 != reg2);
-    assert(is_general_purpose_register(reg2));
-    assert(!register_allocator_is_free(ra, reg2));
-
-    register_allocator_free(ra, reg1);
-    assert(register_allocator_is_free(ra, reg1));
-    
-    Register reg3 = register_allocator_alloc(ra);
-    assert(reg3 == reg1);
-    
-    register_allocator_destroy(ra);
-}
-
-static void test_register_spilling() {
-    RegisterAllocator* ra = register_allocator_create();
-
-    Register allocated[MAX_GP_REGISTERS];
-    int count = 0;
-    
-    while (count < MAX_GP_REGISTERS) {
-        Register reg = register_allocator_alloc(ra);
-        if (reg == REG_NONE) break;
-        allocated[count++] = reg;
-    }
-    
-    assert(count == MAX_GP_REGISTERS);
-    
-    Register spilled = register_allocator_alloc_with_spill(ra);
-    assert(spilled != REG_NONE);
-    
-    for (int i = 0; i < count; i++) {
-        register_allocator_free(ra, allocated[i]);
-    }
-    register_allocator_free(ra, spilled);
-    
-    register_allocator_destroy(ra);
-}
-
-static void test_register_constraints() {
-    RegisterAllocator* ra = register_allocator_create();
-    
-    RegisterConstraint constraint = {
-        .allowed_registers = (1ULL << REG_RAX) | (1ULL << REG_RBX) | (1ULL << REG_RCX),
-        .preferred_register = REG_RAX
-    };
-    
-    Register reg = register_allocator_alloc_constrained(ra, &constraint);
-    assert(reg == REG_RAX);
-    
-    Register reg2 = register_allocator_alloc_constrained(ra, &constraint);
-    assert(reg2 == REG_RBX || reg2 == REG_RCX);
-    
-    register_allocator_free(ra, reg);
-    register_allocator_free(ra, reg2);
-    register_allocator_destroy(ra);
-}
-
-int main() {
-    printf("Running register tests...\n");
-    
-    test_register_encoding();
-    test_register_types();
-    test_register_names();
-    test_register_sizes();
-    test_register_variants();
-    test_register_preservation();
-    test_register_allocation();
-    test_register_spilling();
-    test_register_constraints();
-    
-    printf("All register tests passed!\n");
-    return 0;
-} 
\ No newline at end of file
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "../include/registers.h"
+
+static void test_general_purpose() {
+    RegisterFile* regs = registers_create();
+    assert(regs != NULL);
+
+    uint64_t value;
+    for (uint8_t reg = ARM64_REG_X0; reg <= ARM64_REG_X30; reg++) {
+        assert(registers_get_x(regs, reg, &value) == REG_SUCCESS && value == 0);
+        assert(registers_set_x(regs, reg, 0x100 + reg) == REG_SUCCESS);
+    }
+    assert(registers_get_x(regs, ARM64_REG_X30, &value) == REG_SUCCESS && value == 0x11E);
+
+    /* Register 31 is SP here, never a general-purpose register */
+    assert(registers_set_x(regs, ARM64_REG_X31, 1) == REG_ERROR_SP_AS_GPR);
+    assert(registers_get_x(regs, ARM64_NUM_REGS, &value) == REG_ERROR_INVALID_REG);
+    assert(registers_get_x(NULL, ARM64_REG_X0, &value) == REG_ERROR_NULL_PARAM);
+
+    registers_reset(regs);
+    assert(registers_get_x(regs, ARM64_REG_X5, &value) == REG_SUCCESS && value == 0);
+    registers_destroy(regs);
+}
+
+static void test_w_registers() {
+    RegisterFile* regs = registers_create();
+    uint32_t word;
+    uint64_t value;
+
+    assert(registers_set_x(regs, ARM64_REG_X1, 0xFFFFFFFFFFFFFFFFULL) == REG_SUCCESS);
+    assert(registers_get_w(regs, ARM64_REG_W1, &word) == REG_SUCCESS && word == 0xFFFFFFFF);
+    assert(registers_set_w(regs, ARM64_REG_W1, 0x12345678) == REG_SUCCESS);
+    assert(registers_get_x(regs, ARM64_REG_X1, &value) == REG_SUCCESS);
+    assert((uint32_t)value == 0x12345678);
+    registers_destroy(regs);
+}
+
+static void test_special_registers() {
+    RegisterFile* regs = registers_create();
+    uint64_t value;
+
+    assert(registers_set_pc(regs, 0x400000) == REG_SUCCESS);
+    assert(registers_get_pc(regs, &value) == REG_SUCCESS && value == 0x400000);
+    assert(registers_set_sp(regs, 0x7FFF0000) == REG_SUCCESS);
+    assert(registers_get_sp(regs, &value) == REG_SUCCESS && value == 0x7FFF0000);
+
+    registers_set_flags(regs, true, false, true, false);
+    assert(registers_get_flag_n(regs) && !registers_get_flag_z(regs));
+    assert(registers_get_flag_c(regs) && !registers_get_flag_v(regs));
+    assert(regs->x[ARM64_REG_NZCV] == 0xA0000000);
+    registers_destroy(regs);
+}
+
+static void test_vectors() {
+    RegisterFile* regs = registers_create();
+    uint8_t data[16], out[16];
+    for (int i = 0; i < 16; i++) data[i] = (uint8_t)i;
+
+    assert(registers_set_vector(regs, 31, data) == REG_SUCCESS);
+    assert(registers_get_vector(regs, 31, out) == REG_SUCCESS && memcmp(data, out, 16) == 0);
+    assert(registers_set_vector(regs, ARM64_NUM_VECTOR_REGS, data) == REG_ERROR_INVALID_VECTOR);
+
+    uint64_t lane;
+    assert(registers_get_vector_lane(regs, 31, 1, &lane) == REG_SUCCESS && lane == 0x0F0E0D0C0B0A0908ULL);
+    assert(registers_set_vector_lane(regs, 31, 0, 0) == REG_SUCCESS);
+    assert(registers_get_vector(regs, 31, out) == REG_SUCCESS && out[0] == 0 && out[8] == 8);
+    assert(registers_get_vector_lane(regs, 31, 2, &lane) == REG_ERROR_INVALID_REG);
+    registers_destroy(regs);
+}
+
+static void test_save_and_load() {
+    RegisterFile* regs = registers_create();
+    RegisterFile saved;
+    assert(registers_set_x(regs, ARM64_REG_X7, 77) == REG_SUCCESS);
+    regs->fpcr = 0x03C00000;
+    assert(registers_save_state(regs, &saved) == REG_SUCCESS);
+
+    registers_reset(regs);
+    assert(registers_load_state(regs, &saved) == REG_SUCCESS);
+    assert(regs->x[ARM64_REG_X7] == 77 && regs->fpcr == 0x03C00000);
+    assert(strcmp(registers_get_error_string(REG_ERROR_SP_AS_GPR), "Success") != 0);
+    registers_destroy(regs);
+}
+
+int main() {
+    printf("Running register tests...\n");
+
+    test_general_purpose();
+    test_w_registers();
+    test_special_registers();
+    test_vectors();
+    test_save_and_load();
+
+    printf("All register tests passed!\n");
+    return 0;
+}
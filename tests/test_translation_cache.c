@@ -0,0 +1,208 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <unistd.h>
+#include "../include/translation_cache.h"
+#include "../include/jit.h"
+#include "../include/decoder.h"
+#include "../include/memory.h"
+#include "../include/registers.h"
+
+static char cache_dir[] = "/tmp/test_translation_cache_XXXXXX";
+
+static void decode_words(const uint32_t* words, size_t count, Instruction* insts) {
+    DecoderContext* decoder = decoder_create((const uint8_t*)words, count * 4);
+    for (size_t i = 0; i < count; i++) {
+        assert(decoder_decode_next(decoder, &insts[i]) == DECODER_SUCCESS);
+    }
+    decoder_destroy(decoder);
+}
+
+static void test_keys() {
+    TranslationCache* cache = translation_cache_open(cache_dir, 1);
+    TranslationCache* other = translation_cache_open(cache_dir, 2);
+    uint32_t words[2] = { 0x91000400, 0x14000002 };   /* add x0, x0, #1; b #8 */
+    Instruction insts[2];
+    decode_words(words, 2, insts);
+
+    uint64_t key = translation_cache_key(cache, 0x1000, insts, 2);
+    assert(key == translation_cache_key(cache, 0x1000, insts, 2));
+    assert(key != translation_cache_key(cache, 0x2000, insts, 2));
+    assert(key != translation_cache_key(cache, 0x1000, insts, 1));
+    assert(key != translation_cache_key(other, 0x1000, insts, 2));
+
+    translation_cache_close(cache);
+    translation_cache_close(other);
+}
+
+static void test_store_and_load() {
+    TranslationCache* cache = translation_cache_open(cache_dir, 7);
+    uint32_t words[2] = { 0x91000400, 0x14000002 };
+    Instruction insts[2];
+    decode_words(words, 2, insts);
+
+    uint64_t key = translation_cache_key(cache, 0x1000, insts, 2);
+    uint64_t exits[2] = { 0x100C, 0x2000 };
+    const char object[] = "not really an object";
+
+    assert(!translation_cache_contains(cache, key));
+    assert(translation_cache_load(cache, key, 0x1000) == NULL);
+    assert(translation_cache_store(cache, key, 0x1000, insts, NULL, 2, exits, 2,
+                                   "block_1000", object, sizeof(object)));
+    assert(translation_cache_contains(cache, key));
+
+    TranslationCacheEntry* entry = translation_cache_load(cache, key, 0x1000);
+    assert(entry != NULL);
+    assert(translation_cache_validate(cache, entry, insts, NULL, 2));
+    assert(entry->pcs[0] == 0x1000 && entry->pcs[1] == 0x1004);
+    assert(entry->exit_count == 2);
+    assert(entry->exit_targets[0] == 0x100C && entry->exit_targets[1] == 0x2000);
+    assert(strcmp(entry->symbol, "block_1000") == 0);
+    assert(entry->object_size == sizeof(object));
+    assert(memcmp(entry->object, object, sizeof(object)) == 0);
+
+    /* Same key, different code or address: never hand back the object */
+    Instruction changed[2];
+    memcpy(changed, insts, sizeof(insts));
+    changed[1].raw ^= 1;
+    assert(!translation_cache_validate(cache, entry, changed, NULL, 2));
+    translation_cache_release(entry);
+    assert(translation_cache_load(cache, key, 0x2000) == NULL);
+
+    /* Truncated files are rejected */
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/%016lx.tc", cache_dir, key);
+    assert(truncate(path, 40) == 0);
+    assert(translation_cache_load(cache, key, 0x1000) == NULL);
+
+    TranslationCacheStats stats;
+    translation_cache_get_stats(cache, &stats);
+    assert(stats.hits == 1);
+    assert(stats.misses == 1);
+    assert(stats.stores == 1);
+    assert(stats.rejected == 3);
+
+    translation_cache_close(cache);
+}
+
+static void test_trace_entry() {
+    TranslationCache* cache = translation_cache_open(cache_dir, 9);
+    uint32_t words[2] = { 0x14000100, 0x91000400 };   /* b #0x400; add x0, x0, #1 */
+    Instruction insts[2];
+    decode_words(words, 2, insts);
+
+    /* A superblock's second instruction lives at the branch target */
+    uint64_t pcs[2] = { 0x1000, 0x1400 };
+    uint64_t key = translation_cache_key(cache, 0x1000, insts, 1);
+    const char object[] = "trace";
+    assert(translation_cache_store(cache, key, 0x1000, insts, pcs, 2, NULL, 0,
+                                   "trace_1000", object, sizeof(object)));
+
+    TranslationCacheEntry* entry = translation_cache_load(cache, key, 0x1000);
+    assert(entry != NULL);
+    assert(entry->instruction_count == 2 && entry->pcs[1] == 0x1400);
+    assert(translation_cache_validate(cache, entry, insts, pcs, 2));
+    assert(!translation_cache_validate(cache, entry, insts, NULL, 2));
+    assert(!translation_cache_validate(cache, entry, insts, pcs, 1));
+    translation_cache_release(entry);
+
+    translation_cache_close(cache);
+}
+
+static void test_compiled_block_roundtrip() {
+    RegisterFile* regs = registers_create();
+    Memory* memory = memory_create();
+    TranslationCache* cache = translation_cache_open(cache_dir, 42);
+    uint32_t word = 0x14000004;   /* b #16 */
+
+    JITBlock* block = block_create(0x4000);
+    block->instructions = (Instruction*)calloc(1, sizeof(Instruction));
+    decode_words(&word, 1, block->instructions);
+    block->instruction_count = 1;
+    block->size = 4;
+    block->cache_key = translation_cache_key(cache, block->address, block->instructions, 1);
+
+    /* The first compiler emits and stores; a fresh one (a later run) loads */
+    for (int run = 0; run < 2; run++) {
+        JITCompiler* compiler = jit_compiler_create(cache);
+        CompileResult result;
+        assert(jit_compiler_compile(compiler, block, &result));
+        assert(result.exit_count == 1 && result.exit_targets[0] == 0x4010);
+        assert(block_set_exits(block, result.exit_targets, result.exit_count));
+        assert(((BlockFunction)result.code)(regs, memory, block) == 0x4010);
+        jit_compile_result_free(&result);
+        jit_compiler_destroy(compiler);
+    }
+
+    TranslationCacheStats stats;
+    translation_cache_get_stats(cache, &stats);
+    assert(stats.stores == 1);
+    assert(stats.hits == 1);
+
+    block_destroy(block);
+    translation_cache_close(cache);
+    registers_destroy(regs);
+    memory_destroy(memory);
+}
+
+/* One run of a program compiling a single straight-line block at 0x4000 */
+static void run_with_levels(BlockOptLevel first, BlockOptLevel hot, TranslationCacheStats* stats,
+                            uint64_t* key) {
+    RegisterFile* regs = registers_create();
+    Memory* memory = memory_create();
+    uint32_t words[2] = { 0x91000400, 0xD65F03C0 };   /* add x0, x0, #1; ret */
+    assert(memory_map(memory, 0x4000, 0x1000, PERM_READ | PERM_WRITE | PERM_EXEC));
+    assert(memory_copy_to(memory, 0x4000, words, sizeof(words)));
+
+    JITContext* context = jit_create(memory, regs);
+    assert(jit_set_cache_directory(context, cache_dir));
+    jit_set_tier_threshold(context, 0);
+    jit_set_opt_levels(context, first, hot);
+    JITBlock* block = jit_compile_block(context, 0x4000);
+    assert(block != NULL && block->opt_level == first);
+    *key = block->cache_key;
+    translation_cache_get_stats(context->translation_cache, stats);
+
+    jit_destroy(context);
+    registers_destroy(regs);
+    memory_destroy(memory);
+}
+
+/* Objects built by one pipeline are never loaded for another */
+static void test_opt_level_keys() {
+    TranslationCacheStats stats;
+    uint64_t none_key, again_key, fast_key;
+
+    run_with_levels(BLOCK_OPT_NONE, BLOCK_OPT_FULL, &stats, &none_key);
+    assert(stats.hits == 0 && stats.stores == 1);
+    run_with_levels(BLOCK_OPT_NONE, BLOCK_OPT_FULL, &stats, &again_key);
+    assert(stats.hits == 1 && stats.stores == 0);
+    assert(again_key == none_key);
+
+    /* Nor does a first-tier object stand in for the hot tier */
+    run_with_levels(BLOCK_OPT_FAST, BLOCK_OPT_FULL, &stats, &fast_key);
+    assert(stats.hits == 0 && stats.stores == 1);
+    assert(fast_key != none_key);
+}
+
+static void remove_cache_dir() {
+    char command[256];
+    snprintf(command, sizeof(command), "rm -rf %s", cache_dir);
+    assert(system(command) == 0);
+}
+
+int main() {
+    printf("Running translation cache tests...\n");
+
+    assert(mkdtemp(cache_dir) != NULL);
+    test_keys();
+    test_store_and_load();
+    test_trace_entry();
+    test_compiled_block_roundtrip();
+    test_opt_level_keys();
+    remove_cache_dir();
+
+    printf("All translation cache tests passed!\n");
+    return 0;
+}
@@ -0,0 +1,348 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "../include/decoder.h"
+#include "jit_test.h"
+
+/* Runs "words; b JIT_TEST_EXIT" as a freshly compiled block */
+static void run(JitTest* t, const uint32_t* words, size_t count) {
+    JITBlock* block = jit_test_compile_next(t, words, count);
+    assert(jit_execute_block(t->jit, block));
+    assert(jit_test_pc(t) == JIT_TEST_EXIT);
+}
+
+static void run_one(JitTest* t, uint32_t word) {
+    run(t, &word, 1);
+}
+
+static void randomize(uint8_t* v) {
+    for (int i = 0; i < 16; i++) v[i] = (uint8_t)rand();
+}
+
+static uint64_t get_lane(const uint8_t* v, unsigned size, unsigned i) {
+    uint64_t x = 0;
+    memcpy(&x, v + i * size, size);
+    return x;
+}
+
+static void set_lane(uint8_t* v, unsigned size, unsigned i, uint64_t x) {
+    memcpy(v + i * size, &x, size);
+}
+
+static int64_t sign_extend(uint64_t x, unsigned bits) {
+    return bits == 64 ? (int64_t)x : (int64_t)(x << (64 - bits)) >> (64 - bits);
+}
+
+static uint32_t three_same(bool q, bool u, unsigned size, unsigned opcode) {
+    return (q << 30) | (u << 29) | 0x0E200400 | (size << 22) | (2 << 16) | (opcode << 11) | (1 << 5) | 0;
+}
+
+enum { ADD, SUB, MUL, CMEQ, CMGT, CMHI, AND, BIC, ORR, EOR };
+
+static const struct {
+    bool u;
+    unsigned opcode;
+    int size;           /* fixed size field, or -1 for any lane size */
+} integer_ops[] = {
+    [ADD] = { 0, 0x10, -1 }, [SUB] = { 1, 0x10, -1 }, [MUL] = { 0, 0x13, -1 },
+    [CMEQ] = { 1, 0x11, -1 }, [CMGT] = { 0, 0x06, -1 }, [CMHI] = { 1, 0x06, -1 },
+    [AND] = { 0, 0x03, 0 }, [BIC] = { 0, 0x03, 1 }, [ORR] = { 0, 0x03, 2 }, [EOR] = { 1, 0x03, 0 },
+};
+
+static uint64_t integer_reference(int op, uint64_t a, uint64_t b, unsigned bits) {
+    uint64_t mask = bits == 64 ? UINT64_MAX : (1ULL << bits) - 1;
+    uint64_t r;
+    switch (op) {
+        case ADD: r = a + b; break;
+        case SUB: r = a - b; break;
+        case MUL: r = a * b; break;
+        case CMEQ: r = a == b ? mask : 0; break;
+        case CMGT: r = sign_extend(a, bits) > sign_extend(b, bits) ? mask : 0; break;
+        case CMHI: r = a > b ? mask : 0; break;
+        case AND: r = a & b; break;
+        case BIC: r = a & ~b; break;
+        case ORR: r = a | b; break;
+        default: r = a ^ b; break;
+    }
+    return r & mask;
+}
+
+static void test_integer_arithmetic(JitTest* t) {
+    for (int op = ADD; op <= EOR; op++) {
+        for (unsigned size = 0; size < 4; size++) {
+            if (integer_ops[op].size >= 0 && size > 0) break;
+            if (op == MUL && size == 3) break;
+            unsigned field = integer_ops[op].size >= 0 ? (unsigned)integer_ops[op].size : size;
+            unsigned lane_size = integer_ops[op].size >= 0 ? 1 : 1U << size;
+
+            for (int q = 0; q < 2; q++) {
+                if (lane_size == 8 && !q) continue;
+                uint8_t expected[16] = { 0 };
+                randomize(t->regs->v[0]);
+                randomize(t->regs->v[1]);
+                randomize(t->regs->v[2]);
+                /* Equal lanes give the compares something to find */
+                memcpy(t->regs->v[2], t->regs->v[1], 4);
+
+                for (unsigned i = 0; i < (q ? 16U : 8U) / lane_size; i++) {
+                    set_lane(expected, lane_size, i,
+                             integer_reference(op, get_lane(t->regs->v[1], lane_size, i),
+                                               get_lane(t->regs->v[2], lane_size, i), lane_size * 8));
+                }
+                run_one(t, three_same(q, integer_ops[op].u, field, integer_ops[op].opcode));
+                assert(memcmp(t->regs->v[0], expected, 16) == 0);
+            }
+        }
+    }
+}
+
+static void test_float_arithmetic(JitTest* t) {
+    static const struct { bool u; unsigned opcode; unsigned size_high; } ops[] = {
+        { 0, 0x1A, 0 }, { 0, 0x1A, 2 }, { 1, 0x1B, 0 }, { 1, 0x1F, 0 },
+    };
+
+    for (size_t op = 0; op < 4; op++) {
+        for (unsigned sz = 0; sz < 2; sz++) {
+            for (int q = 0; q < 2; q++) {
+                if (sz && !q) continue;
+                uint8_t expected[16] = { 0 };
+                unsigned lanes = (q ? 16U : 8U) / (sz ? 8 : 4);
+
+                for (unsigned i = 0; i < 4; i++) {
+                    double a = (rand() % 2000 - 1000) / 7.0;
+                    double b = (rand() % 2000 + 1) / 3.0;
+                    if (sz) {
+                        if (i >= 2) break;
+                        memcpy(&t->regs->v[1][i * 8], &a, 8);
+                        memcpy(&t->regs->v[2][i * 8], &b, 8);
+                        double r = op == 0 ? a + b : op == 1 ? a - b : op == 2 ? a * b : a / b;
+                        if (i < lanes) memcpy(&expected[i * 8], &r, 8);
+                    } else {
+                        float fa = (float)a, fb = (float)b;
+                        memcpy(&t->regs->v[1][i * 4], &fa, 4);
+                        memcpy(&t->regs->v[2][i * 4], &fb, 4);
+                        float r = op == 0 ? fa + fb : op == 1 ? fa - fb : op == 2 ? fa * fb : fa / fb;
+                        if (i < lanes) memcpy(&expected[i * 4], &r, 4);
+                    }
+                }
+                run_one(t, three_same(q, ops[op].u, ops[op].size_high | sz, ops[op].opcode));
+                assert(memcmp(t->regs->v[0], expected, 16) == 0);
+            }
+        }
+    }
+}
+
+enum { UZP1 = 1, TRN1 = 2, ZIP1 = 3, UZP2 = 5, TRN2 = 6, ZIP2 = 7, EXT = 8 };
+
+static void permute_reference(int op, const uint8_t* a, const uint8_t* b, uint8_t* r,
+                              unsigned size, unsigned n, unsigned index) {
+    uint8_t concat[32];
+    memcpy(concat, a, n * size);
+    memcpy(concat + n * size, b, n * size);
+
+    for (unsigned k = 0; k < n; k++) {
+        uint64_t lane;
+        unsigned half = k / 2;
+        switch (op) {
+            case ZIP1: lane = get_lane(k & 1 ? b : a, size, half); break;
+            case ZIP2: lane = get_lane(k & 1 ? b : a, size, n / 2 + half); break;
+            case UZP1: lane = get_lane(concat, size, 2 * k); break;
+            case UZP2: lane = get_lane(concat, size, 2 * k + 1); break;
+            case TRN1: lane = get_lane(k & 1 ? b : a, size, 2 * half); break;
+            case TRN2: lane = get_lane(k & 1 ? b : a, size, 2 * half + 1); break;
+            default: lane = get_lane(concat, 1, index + k); break;
+        }
+        set_lane(r, size, k, lane);
+    }
+}
+
+static void test_permutes(JitTest* t) {
+    static const int ops[] = { ZIP1, ZIP2, UZP1, UZP2, TRN1, TRN2 };
+
+    for (size_t op = 0; op < sizeof(ops) / sizeof(ops[0]); op++) {
+        for (unsigned size = 0; size < 4; size++) {
+            for (int q = 0; q < 2; q++) {
+                if (size == 3 && !q) continue;
+                uint8_t expected[16] = { 0 };
+                randomize(t->regs->v[1]);
+                randomize(t->regs->v[2]);
+                permute_reference(ops[op], t->regs->v[1], t->regs->v[2], expected,
+                                  1U << size, (q ? 16U : 8U) >> size, 0);
+                run_one(t, (q << 30) | 0x0E000800 | (size << 22) | (2 << 16) | (ops[op] << 12) | (1 << 5));
+                assert(memcmp(t->regs->v[0], expected, 16) == 0);
+            }
+        }
+    }
+
+    for (int q = 0; q < 2; q++) {
+        for (unsigned index = 0; index < (q ? 16U : 8U); index += 3) {
+            uint8_t expected[16] = { 0 };
+            randomize(t->regs->v[1]);
+            randomize(t->regs->v[2]);
+            permute_reference(EXT, t->regs->v[1], t->regs->v[2], expected, 1, q ? 16 : 8, index);
+            run_one(t, (q << 30) | 0x2E000000 | (2 << 16) | (index << 11) | (1 << 5));
+            assert(memcmp(t->regs->v[0], expected, 16) == 0);
+        }
+    }
+}
+
+static void test_shifts(JitTest* t) {
+    for (unsigned size = 0; size < 4; size++) {
+        unsigned bytes = 1U << size, bits = bytes * 8;
+        for (int q = 0; q < 2; q++) {
+            if (size == 3 && !q) continue;
+            unsigned lanes = (q ? 16U : 8U) / bytes;
+            static const unsigned shifts[] = { 1, 3, 7 };
+
+            for (size_t s = 0; s < 4; s++) {
+                /* The last round shifts right by the whole lane */
+                unsigned shift = s < 3 ? shifts[s] : bits;
+                randomize(t->regs->v[1]);
+                uint8_t shl[16] = { 0 }, ushr[16] = { 0 }, sshr[16] = { 0 };
+                for (unsigned i = 0; i < lanes; i++) {
+                    uint64_t x = get_lane(t->regs->v[1], bytes, i);
+                    if (shift < bits) set_lane(shl, bytes, i, x << shift);
+                    set_lane(ushr, bytes, i, shift < 64 ? x >> shift : 0);
+                    set_lane(sshr, bytes, i, sign_extend(x, bits) >> (shift < bits ? shift : bits - 1));
+                }
+
+                if (shift < bits) {
+                    run_one(t, (q << 30) | 0x0F005400 | ((bits + shift) << 16) | (1 << 5));
+                    assert(memcmp(t->regs->v[0], shl, 16) == 0);
+                }
+                run_one(t, (q << 30) | 0x2F000400 | ((2 * bits - shift) << 16) | (1 << 5));
+                assert(memcmp(t->regs->v[0], ushr, 16) == 0);
+                run_one(t, (q << 30) | 0x0F000400 | ((2 * bits - shift) << 16) | (1 << 5));
+                assert(memcmp(t->regs->v[0], sshr, 16) == 0);
+            }
+        }
+    }
+}
+
+static void test_general_register_moves(JitTest* t) {
+    t->regs->x[3] = 0x8877665544332211ULL;
+    for (unsigned size = 0; size < 4; size++) {
+        unsigned bytes = 1U << size;
+        for (int q = 0; q < 2; q++) {
+            if (size == 3 && !q) continue;
+            uint8_t expected[16] = { 0 };
+            for (unsigned i = 0; i < (q ? 16U : 8U) / bytes; i++) {
+                set_lane(expected, bytes, i, t->regs->x[3]);
+            }
+            randomize(t->regs->v[0]);
+            run_one(t, (q << 30) | 0x0E000C00 | (bytes << 16) | (3 << 5));   /* dup v0.T, x3 */
+            assert(memcmp(t->regs->v[0], expected, 16) == 0);
+        }
+
+        /* ins v0.T[lane], x3 keeps the other lanes; umov x4, v0.T[lane] reads it back */
+        unsigned lane = (16 / bytes) - 1;
+        unsigned imm5 = (lane << (size + 1)) | bytes;
+        uint8_t expected[16];
+        randomize(t->regs->v[0]);
+        memcpy(expected, t->regs->v[0], 16);
+        set_lane(expected, bytes, lane, t->regs->x[3]);
+        const uint32_t words[] = {
+            0x4E001C00 | (imm5 << 16) | (3 << 5),
+            ((size == 3) << 30) | 0x0E003C00 | (imm5 << 16) | 4,
+        };
+        run(t, words, 2);
+        assert(memcmp(t->regs->v[0], expected, 16) == 0);
+        assert(t->regs->x[4] == get_lane(expected, bytes, lane));
+    }
+}
+
+static void test_loads_and_stores(JitTest* t) {
+    uint8_t data[64];
+    for (int i = 0; i < 64; i++) data[i] = (uint8_t)(i * 7 + 1);
+    assert(memory_copy_to(t->memory, JIT_TEST_DATA, data, sizeof(data)));
+
+    /* Scalar forms load the low bytes and clear the rest */
+    static const struct { uint32_t word; unsigned bytes; } loads[] = {
+        { 0x3D400000, 1 }, { 0x7D400000, 2 }, { 0xBD400000, 4 }, { 0xFD400000, 8 }, { 0x3DC00000, 16 },
+    };
+    t->regs->x[1] = JIT_TEST_DATA;
+    for (size_t i = 0; i < 5; i++) {
+        uint8_t expected[16] = { 0 };
+        memcpy(expected, data + loads[i].bytes, loads[i].bytes);
+        randomize(t->regs->v[0]);
+        run_one(t, loads[i].word | (1 << 10) | (1 << 5));   /* ldr b/h/s/d/q0, [x1, #size] */
+        assert(memcmp(t->regs->v[0], expected, 16) == 0);
+    }
+
+    /* ld1 {v0.16b}, [x1], #16; ld1 {v1.4s}, [x1], x5; add v2.4s, v0.4s, v1.4s;
+     * st1 {v2.2d}, [x2]; str d0, [x2, #24]; umov x3, v2.d[1]
+     */
+    const uint32_t words[] = {
+        0x4CDF7020,
+        0x4CC57821,
+        0x4EA18402,
+        0x4C007C42,
+        0xFD000C40,
+        0x4E183C43,
+    };
+    t->regs->x[1] = JIT_TEST_DATA;
+    t->regs->x[2] = JIT_TEST_DATA + 0x100;
+    t->regs->x[5] = 32;
+    run(t, words, 6);
+    assert(t->regs->x[1] == JIT_TEST_DATA + 48);
+
+    uint8_t sum[16];
+    for (unsigned i = 0; i < 4; i++) {
+        set_lane(sum, 4, i, (uint32_t)(get_lane(data, 4, i) + get_lane(data + 16, 4, i)));
+    }
+    uint8_t stored[32];
+    assert(memory_copy_from(t->memory, JIT_TEST_DATA + 0x100, stored, 32));
+    assert(memcmp(stored, sum, 16) == 0);
+    assert(memcmp(stored + 24, data, 8) == 0);
+    assert(t->regs->x[3] == get_lane(sum, 8, 1));
+
+    /* A faulting load leaves the base register alone */
+    t->regs->x[1] = 0x900000;
+    uint32_t word = 0x4CDF7020;
+    assert(memory_copy_to(t->memory, t->next_block, &word, 4));
+    JITBlock* block = jit_compile_block(t->jit, t->next_block);
+    assert(block != NULL && block->code != NULL);
+    assert(!jit_execute_block(t->jit, block));
+    assert(t->regs->x[1] == 0x900000);
+}
+
+static void test_decode() {
+    DecoderContext* decoder;
+    Instruction inst;
+
+    /* SIMD&FP register loads are not general register loads */
+    uint32_t ldr_q = 0x3DC00420;        /* ldr q0, [x1, #16] */
+    decoder = decoder_create((const uint8_t*)&ldr_q, 4);
+    assert(decoder_decode_next(decoder, &inst) == DECODER_SUCCESS);
+    assert(inst.opcode == 0x42 && instruction_get_access_size(&inst) == 16);
+    assert(instruction_get_operand(&inst, 0).value.mem.offset == 16);
+    assert(!instruction_modifies_register(&inst, 0));
+    decoder_destroy(decoder);
+
+    /* The reserved .1D arrangement is rejected */
+    uint32_t add_1d = 0x0EE28420;       /* add v0.1d, v1.1d, v2.1d */
+    decoder = decoder_create((const uint8_t*)&add_1d, 4);
+    assert(decoder_decode_next(decoder, &inst) != DECODER_SUCCESS);
+    decoder_destroy(decoder);
+}
+
+int main() {
+    printf("Running vector tests...\n");
+    srand(1);
+
+    test_decode();
+
+    JitTest t;
+    jit_test_setup(&t, NULL, 0, 0);
+    test_integer_arithmetic(&t);
+    test_float_arithmetic(&t);
+    test_permutes(&t);
+    test_shifts(&t);
+    test_general_register_moves(&t);
+    test_loads_and_stores(&t);
+    jit_test_teardown(&t);
+
+    printf("All vector tests passed!\n");
+    return 0;
+}
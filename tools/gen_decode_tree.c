@@ -0,0 +1,181 @@
+/* Builds the decoder's lookup tree from include/a64_encodings.h and writes
+ * it to stdout as C, for src/decoder.c to include.
+ *
+ * Each inner node selects a child by a field of up to MAX_FIELD_WIDTH bits
+ * of the instruction word. Fields are chosen among the bits every encoding
+ * still in play fixes, so no encoding appears under two children; only
+ * when those run out does a single bit some encodings fix split the rest,
+ * and the others go down both sides. A leaf lists the encodings that can
+ * still match, in table order, for the decoder to check one by one.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+typedef struct Encoding {
+    uint32_t mask;
+    uint32_t value;
+    const char* decode;
+} Encoding;
+
+static const Encoding encodings[] = {
+#define ENCODING(mask, value, decode) { mask, value, #decode },
+#include "a64_encodings.h"
+#undef ENCODING
+};
+
+#define ENCODING_COUNT (sizeof(encodings) / sizeof(encodings[0]))
+#define MAX_FIELD_WIDTH 5
+#define MAX_NODES 8192
+#define MAX_CANDIDATES 8192
+#define DECODE_END 0xFFFF
+
+typedef struct Node {
+    uint8_t shift;
+    uint8_t width;      /* 0 for a leaf */
+    uint16_t child;     /* first child node, or a leaf's first candidate */
+} Node;
+
+static Node nodes[MAX_NODES];
+static size_t node_count;
+static uint16_t candidates[MAX_CANDIDATES];
+static size_t candidate_count;
+static unsigned max_depth;
+static size_t max_leaf;
+
+static bool fits(const Encoding* e, uint32_t field, uint32_t bits) {
+    return ((bits ^ e->value) & e->mask & field) == 0;
+}
+
+static size_t partition(const uint16_t* set, size_t count, uint32_t field, uint32_t bits, uint16_t* out) {
+    size_t n = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (fits(&encodings[set[i]], field, bits)) out[n++] = set[i];
+    }
+    return n;
+}
+
+/* The field that leaves the fewest encodings in its largest child, then
+ * the fewest in all children together, then the narrowest. False if no
+ * field separates anything.
+ */
+static bool choose_field(const uint16_t* set, size_t count, uint32_t used,
+                         unsigned* best_shift, unsigned* best_width) {
+    uint32_t common = ~used, any = 0;
+    for (size_t i = 0; i < count; i++) {
+        common &= encodings[set[i]].mask;
+        any |= encodings[set[i]].mask;
+    }
+    any &= ~used;
+
+    uint16_t scratch[ENCODING_COUNT];
+    for (int pass = 0; pass < 2; pass++) {
+        uint32_t allowed = pass == 0 ? common : any;
+        unsigned max_width = pass == 0 ? MAX_FIELD_WIDTH : 1;
+        size_t best_max = count, best_total = 0;
+        bool found = false;
+
+        for (unsigned shift = 0; shift < 32; shift++) {
+            for (unsigned width = 1; width <= max_width && shift + width <= 32; width++) {
+                uint32_t field = (uint32_t)(((1ULL << width) - 1) << shift);
+                if ((field & allowed) != field) break;
+
+                size_t largest = 0, total = 0;
+                for (uint32_t v = 0; v < (1U << width); v++) {
+                    size_t n = partition(set, count, field, v << shift, scratch);
+                    if (n > largest) largest = n;
+                    total += n;
+                }
+                if (largest < best_max || (largest == best_max && found && total < best_total)) {
+                    best_max = largest;
+                    best_total = total;
+                    *best_shift = shift;
+                    *best_width = width;
+                    found = true;
+                }
+            }
+        }
+        if (found) return true;
+    }
+    return false;
+}
+
+/* Index of the candidate list, reusing an identical one */
+static uint16_t add_leaf(const uint16_t* set, size_t count) {
+    for (size_t start = 0; start + count < candidate_count; start++) {
+        if (memcmp(&candidates[start], set, count * sizeof(uint16_t)) == 0 &&
+            candidates[start + count] == DECODE_END) {
+            return (uint16_t)start;
+        }
+    }
+    if (candidate_count + count + 1 > MAX_CANDIDATES) {
+        fprintf(stderr, "gen_decode_tree: too many candidates\n");
+        exit(1);
+    }
+    uint16_t start = (uint16_t)candidate_count;
+    memcpy(&candidates[candidate_count], set, count * sizeof(uint16_t));
+    candidate_count += count;
+    candidates[candidate_count++] = DECODE_END;
+    if (count > max_leaf) max_leaf = count;
+    return start;
+}
+
+static void build(size_t index, const uint16_t* set, size_t count, uint32_t used, unsigned depth) {
+    unsigned shift, width;
+    if (depth > max_depth) max_depth = depth;
+    if (count <= 1 || !choose_field(set, count, used, &shift, &width)) {
+        nodes[index] = (Node){ 0, 0, add_leaf(set, count) };
+        return;
+    }
+
+    size_t first = node_count;
+    node_count += 1U << width;
+    if (node_count > MAX_NODES) {
+        fprintf(stderr, "gen_decode_tree: too many nodes\n");
+        exit(1);
+    }
+    nodes[index] = (Node){ (uint8_t)shift, (uint8_t)width, (uint16_t)first };
+
+    uint32_t field = (uint32_t)(((1ULL << width) - 1) << shift);
+    for (uint32_t v = 0; v < (1U << width); v++) {
+        uint16_t subset[ENCODING_COUNT];
+        size_t n = partition(set, count, field, v << shift, subset);
+        build(first + v, subset, n, used | field, depth + 1);
+    }
+}
+
+int main(void) {
+    uint16_t all[ENCODING_COUNT];
+    for (size_t i = 0; i < ENCODING_COUNT; i++) all[i] = (uint16_t)i;
+
+    /* The empty list comes first, for the many leaves nothing reaches */
+    candidates[candidate_count++] = DECODE_END;
+    node_count = 1;
+    build(0, all, ENCODING_COUNT, 0, 0);
+
+    printf("/* Generated by tools/gen_decode_tree.c from include/a64_encodings.h; do not edit */\n\n");
+    printf("/* %zu encodings: at most %u node lookups, then %zu mask checks */\n",
+           (size_t)ENCODING_COUNT, max_depth, max_leaf);
+    printf("#define DECODE_TREE_DEPTH %u\n", max_depth);
+    printf("#define DECODE_MAX_CANDIDATES %zu\n\n", max_leaf);
+
+    printf("static const DecodeNode decode_tree[%zu] = {\n", node_count);
+    for (size_t i = 0; i < node_count; i++) {
+        printf("    { %2u, %u, %4u },\n", nodes[i].shift, nodes[i].width, nodes[i].child);
+    }
+    printf("};\n\n");
+
+    printf("static const uint16_t decode_candidates[%zu] = {\n", candidate_count);
+    for (size_t i = 0; i < candidate_count; i++) {
+        if (candidates[i] == DECODE_END) {
+            printf("    DECODE_END,\n");
+        } else {
+            printf("    %2u,     /* %s */\n", candidates[i], encodings[candidates[i]].decode);
+        }
+    }
+    printf("};\n");
+    return 0;
+}